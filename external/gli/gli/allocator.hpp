@@ -0,0 +1,40 @@
+/// @brief Include to allocate texture storages from memory managed by the application.
+/// @file gli/allocator.hpp
+
+#pragma once
+
+#include "type.hpp"
+#include <cstddef>
+
+namespace gli
+{
+	/// Alignment of the texels of the storages allocators create, a cache line and the widest SIMD register
+	std::size_t const STORAGE_ALIGNMENT = 64;
+
+	/// Source of the memory of texture storages, such as an arena reset once a batch of loaded textures is uploaded.
+	/// An allocator has to outlive the storages created with it.
+	class allocator
+	{
+	public:
+		virtual ~allocator(){}
+
+		/// Return Size bytes aligned on Alignment bytes, or nullptr if it can't.
+		/// The memory isn't expected to be initialised.
+		virtual void * allocate(std::size_t Size, std::size_t Alignment) = 0;
+
+		/// Release memory returned by allocate once no texture references it anymore.
+		virtual void deallocate(void * Pointer, std::size_t Size) = 0;
+	};
+
+	/// Return the allocator of the heap, used by the textures created without an allocator.
+	///
+	/// @code
+	/// #include <gli/gli.hpp>
+	/// ...
+	/// // Texels are left uninitialised as they are about to be overwritten
+	/// gli::texture2D Texture(gli::FORMAT_RGBA8_UNORM_PACK8, gli::texture2D::texelcoord_type(256), 1, gli::default_allocator());
+	/// @endcode
+	allocator & default_allocator();
+}//namespace gli
+
+#include "./core/allocator.inl"
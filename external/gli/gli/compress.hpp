@@ -0,0 +1,41 @@
+/// @brief Include to compress textures to block compressed formats and to decompress them.
+/// @file gli/compress.hpp
+
+#pragma once
+
+#include "texture2d.hpp"
+#include "texture2d_array.hpp"
+#include "texture3d.hpp"
+#include "texture_cube.hpp"
+#include "texture_cube_array.hpp"
+
+namespace gli
+{
+	/// What the texels of a texture stand for, it picks the block format that keeps them best
+	enum content
+	{
+		CONTENT_COLOR,	///< Colours, BC1 if they are opaque, BC3 otherwise or BC7 for a higher quality
+		CONTENT_NORMAL,	///< Tangent space normals, BC5 keeps red and green: blue is to be rebuilt from them
+		CONTENT_SCALAR	///< A single value in red such as roughness, metalness or height, BC4
+	};
+
+	/// Whether compress accepts texels of this Format: 8 bits per channel UNORM or SRGB, from one to four channels.
+	bool is_compressible(format Format);
+
+	/// Block compressed format for the Content of Texture, SRGB if Texture is. The alpha of the base level tells whether colours are opaque.
+	format compressed_format(texture const & Texture, content Content, bool HighQuality = false);
+
+	/// Allocate a texture and encode every level, layer and face of Texture to Format: BC1, BC3, BC4, BC5 or BC7 in its mode 6 only.
+	/// The blocks of all the images are spread over as many threads as the hardware has.
+	/// Returns an empty texture if Texture isn't compressible or Format isn't one of these.
+	template <typename texture_type>
+	texture_type compress(texture_type const & Texture, format Format);
+
+	/// Allocate a RGBA8 texture, SRGB if Texture is, and decode every level, layer and face of Texture into it.
+	/// BC1, BC2, BC3, BC4 and BC5 UNORM and SRGB textures are decoded, the channels missing from BC4 and BC5 are zero and alpha is one.
+	/// Returns an empty texture for the other formats.
+	template <typename texture_type>
+	texture_type decompress(texture_type const & Texture);
+}//namespace gli
+
+#include "./core/compress.inl"
@@ -0,0 +1,38 @@
+/// @brief Include to convert the texels of images and textures from a format to another in bulk.
+/// @file gli/convert.hpp
+
+#pragma once
+
+#include "image.hpp"
+#include "texture2d.hpp"
+#include "texture2d_array.hpp"
+#include "texture3d.hpp"
+#include "texture_cube.hpp"
+#include "texture_cube_array.hpp"
+
+namespace gli
+{
+	/// Whether convert reads and writes texels of this Format: R to RGBA and BGR(A) 8 bits UNORM or SRGB, 16 or 32 bits SFLOAT.
+	bool is_convertible(format Format);
+
+	/// Convert every texel of Source into Destination, an image of the same dimensions such as a level of a texture.
+	/// Decoded texels are swizzled by Swizzles then encoded, channels missing from Source are zero and alpha is one.
+	/// Rows are spread over as many threads as the hardware has for large images.
+	/// Returns false, leaving Destination untouched, if a format isn't convertible or the dimensions differ.
+	///
+	/// @code
+	/// #include <gli/convert.hpp>
+	/// ...
+	/// gli::texture2D Readback(gli::FORMAT_BGRA8_UNORM_PACK8, Dimensions, 1, gli::default_allocator());
+	/// gli::texture2D Image(gli::FORMAT_RGB8_UNORM_PACK8, Dimensions, 1, gli::default_allocator());
+	/// gli::convert(Readback[0], Image[0]);
+	/// @endcode
+	bool convert(image const & Source, image Destination, swizzles const & Swizzles = swizzles(SWIZZLE_RED, SWIZZLE_GREEN, SWIZZLE_BLUE, SWIZZLE_ALPHA));
+
+	/// Allocate a texture of Format and convert every level, layer and face of Texture into it.
+	/// Returns an empty texture if a format isn't convertible.
+	template <typename texture_type>
+	texture_type convert(texture_type const & Texture, format Format, swizzles const & Swizzles = swizzles(SWIZZLE_RED, SWIZZLE_GREEN, SWIZZLE_BLUE, SWIZZLE_ALPHA));
+}//namespace gli
+
+#include "./core/convert.inl"
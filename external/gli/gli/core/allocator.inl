@@ -0,0 +1,37 @@
+#include <cstdint>
+#include <cstdlib>
+
+namespace gli{
+namespace detail
+{
+	class heap_allocator : public allocator
+	{
+	public:
+		// Over-allocate to align by hand and keep the pointer malloc returned just before the texels
+		void * allocate(std::size_t Size, std::size_t Alignment)
+		{
+			GLI_ASSERT(Alignment >= sizeof(void*) && (Alignment & (Alignment - 1)) == 0);
+
+			void * Base = std::malloc(Size + Alignment);
+			if(!Base)
+				return nullptr;
+
+			void * Pointer = reinterpret_cast<void*>((reinterpret_cast<std::uintptr_t>(Base) + Alignment) & ~static_cast<std::uintptr_t>(Alignment - 1));
+			static_cast<void**>(Pointer)[-1] = Base;
+			return Pointer;
+		}
+
+		void deallocate(void * Pointer, std::size_t)
+		{
+			if(Pointer)
+				std::free(static_cast<void**>(Pointer)[-1]);
+		}
+	};
+}//namespace detail
+
+	inline allocator & default_allocator()
+	{
+		static detail::heap_allocator Allocator;
+		return Allocator;
+	}
+}//namespace gli
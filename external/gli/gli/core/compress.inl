@@ -0,0 +1,372 @@
+#include "compress_block.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace gli{
+namespace detail
+{
+	enum compress_encoder
+	{
+		COMPRESS_ENCODER_BC1,
+		COMPRESS_ENCODER_BC1_PUNCH_THROUGH,
+		COMPRESS_ENCODER_BC3,
+		COMPRESS_ENCODER_BC4,
+		COMPRESS_ENCODER_BC5,
+		COMPRESS_ENCODER_BC7,
+		COMPRESS_ENCODER_INVALID
+	};
+
+	inline compress_encoder get_compress_encoder(format Format)
+	{
+		switch(Format)
+		{
+		case FORMAT_RGB_DXT1_UNORM_BLOCK8:
+		case FORMAT_RGB_DXT1_SRGB_BLOCK8:
+			return COMPRESS_ENCODER_BC1;
+		case FORMAT_RGBA_DXT1_UNORM_BLOCK8:
+		case FORMAT_RGBA_DXT1_SRGB_BLOCK8:
+			return COMPRESS_ENCODER_BC1_PUNCH_THROUGH;
+		case FORMAT_RGBA_DXT5_UNORM_BLOCK16:
+		case FORMAT_RGBA_DXT5_SRGB_BLOCK16:
+			return COMPRESS_ENCODER_BC3;
+		case FORMAT_R_ATI1N_UNORM_BLOCK8:
+			return COMPRESS_ENCODER_BC4;
+		case FORMAT_RG_ATI2N_UNORM_BLOCK16:
+			return COMPRESS_ENCODER_BC5;
+		case FORMAT_RGBA_BP_UNORM_BLOCK16:
+		case FORMAT_RGBA_BP_SRGB_BLOCK16:
+			return COMPRESS_ENCODER_BC7;
+		default:
+			return COMPRESS_ENCODER_INVALID;
+		}
+	}
+
+	// Byte of each RGBA channel in a source texel, -1 for the channels the format doesn't have
+	struct compress_source
+	{
+		int TexelSize;
+		int Offsets[4];
+	};
+
+	inline bool get_compress_source(format Format, compress_source & Source)
+	{
+		static compress_source const Sources[] =
+		{
+			{1, {0, -1, -1, -1}},
+			{2, {0, 1, -1, -1}},
+			{3, {0, 1, 2, -1}},
+			{3, {2, 1, 0, -1}},
+			{4, {0, 1, 2, 3}},
+			{4, {2, 1, 0, 3}}
+		};
+
+		switch(Format)
+		{
+		case FORMAT_R8_UNORM_PACK8:
+			Source = Sources[0];
+			return true;
+		case FORMAT_RG8_UNORM_PACK8:
+			Source = Sources[1];
+			return true;
+		case FORMAT_RGB8_UNORM_PACK8:
+		case FORMAT_RGB8_SRGB_PACK8:
+			Source = Sources[2];
+			return true;
+		case FORMAT_BGR8_UNORM_PACK8:
+		case FORMAT_BGR8_SRGB_PACK8:
+			Source = Sources[3];
+			return true;
+		case FORMAT_RGBA8_UNORM_PACK8:
+		case FORMAT_RGBA8_SRGB_PACK8:
+			Source = Sources[4];
+			return true;
+		case FORMAT_BGRA8_UNORM_PACK8:
+		case FORMAT_BGRA8_SRGB_PACK8:
+			Source = Sources[5];
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	// One slice of one image, its blocks are numbered from FirstBlock on over the whole texture
+	struct compress_image
+	{
+		std::uint8_t const * Source;
+		std::uint8_t * Destination;
+		texture::texelcoord_type Dimensions;
+		int BlocksX;
+		int BlocksY;
+		std::size_t FirstBlock;
+	};
+
+	// Texels of a block in RGBA, the edge texels are repeated past the end of the image
+	inline void compress_read_block(compress_source const & Source, compress_image const & Image, int BlockX, int BlockY, std::uint8_t (&Texels)[16][4])
+	{
+		static std::uint8_t const Missing[4] = {0, 0, 0, 255};
+
+		for(int y = 0; y < 4; ++y)
+		{
+			int const SourceY = std::min(BlockY * 4 + y, Image.Dimensions.y - 1);
+			std::uint8_t const * Row = Image.Source + static_cast<std::size_t>(SourceY) * Image.Dimensions.x * Source.TexelSize;
+
+			for(int x = 0; x < 4; ++x)
+			{
+				std::uint8_t const * Texel = Row + std::min(BlockX * 4 + x, Image.Dimensions.x - 1) * Source.TexelSize;
+				for(int c = 0; c < 4; ++c)
+					Texels[y * 4 + x][c] = Source.Offsets[c] < 0 ? Missing[c] : Texel[Source.Offsets[c]];
+			}
+		}
+	}
+
+	inline void compress_block(compress_encoder Encoder, std::uint8_t const (&Texels)[16][4], std::uint8_t * Block)
+	{
+		switch(Encoder)
+		{
+		case COMPRESS_ENCODER_BC1:
+			encode_bc1(Texels, false, Block);
+			break;
+		case COMPRESS_ENCODER_BC1_PUNCH_THROUGH:
+			encode_bc1(Texels, true, Block);
+			break;
+		case COMPRESS_ENCODER_BC3:
+			encode_bc3(Texels, Block);
+			break;
+		case COMPRESS_ENCODER_BC4:
+			encode_bc4(Texels, 0, Block);
+			break;
+		case COMPRESS_ENCODER_BC5:
+			encode_bc5(Texels, Block);
+			break;
+		case COMPRESS_ENCODER_BC7:
+			encode_bc7(Texels, Block);
+			break;
+		default:
+			GLI_ASSERT(0);
+			break;
+		}
+	}
+
+	inline texture compress_texture(texture const & Texture, format Format)
+	{
+		typedef texture::size_type size_type;
+
+		compress_source Source;
+		compress_encoder const Encoder = get_compress_encoder(Format);
+		if(Texture.empty() || Encoder == COMPRESS_ENCODER_INVALID || !get_compress_source(Texture.format(), Source))
+			return texture();
+
+		texture Result(Texture.target(), Format, Texture.dimensions(), Texture.layers(), Texture.faces(), Texture.levels(), default_allocator());
+
+		std::vector<compress_image> Images;
+		std::size_t Blocks = 0;
+		for(size_type Layer = 0; Layer < Texture.layers(); ++Layer)
+		for(size_type Face = 0; Face < Texture.faces(); ++Face)
+		for(size_type Level = 0; Level < Texture.levels(); ++Level)
+		{
+			texture::texelcoord_type const Dimensions(Texture.dimensions(Level));
+			texture::texelcoord_type const BlockCount(glm::max(Result.dimensions(Level) / block_dimensions(Format), texture::texelcoord_type(1)));
+
+			// Blocks are two dimensional, the slices of a 3D texture follow each other
+			for(int z = 0; z < Dimensions.z; ++z)
+			{
+				compress_image Image;
+				Image.Source = static_cast<std::uint8_t const *>(Texture.data(Layer, Face, Level)) + static_cast<std::size_t>(z) * Dimensions.x * Dimensions.y * Source.TexelSize;
+				Image.Destination = static_cast<std::uint8_t *>(Result.data(Layer, Face, Level)) + static_cast<std::size_t>(z) * BlockCount.x * BlockCount.y * block_size(Format);
+				Image.Dimensions = Dimensions;
+				Image.BlocksX = BlockCount.x;
+				Image.BlocksY = BlockCount.y;
+				Image.FirstBlock = Blocks;
+				Images.push_back(Image);
+
+				Blocks += static_cast<std::size_t>(BlockCount.x) * BlockCount.y;
+			}
+		}
+
+		get_compress_tables();
+
+		std::size_t const BlockSize = block_size(Format);
+
+		// Enough blocks per thread for its start to be negligible, the images of the small levels go together
+		kernel_parallel(Blocks, 1024, [&](std::size_t Begin, std::size_t End)
+		{
+			std::uint8_t Texels[16][4];
+
+			std::size_t ImageIndex = 0;
+			while(ImageIndex + 1 < Images.size() && Images[ImageIndex + 1].FirstBlock <= Begin)
+				++ImageIndex;
+
+			for(std::size_t Block = Begin; Block < End; ++Block)
+			{
+				while(ImageIndex + 1 < Images.size() && Images[ImageIndex + 1].FirstBlock <= Block)
+					++ImageIndex;
+
+				compress_image const & Image = Images[ImageIndex];
+				std::size_t const Index = Block - Image.FirstBlock;
+				int const BlockX = static_cast<int>(Index % Image.BlocksX);
+				int const BlockY = static_cast<int>(Index / Image.BlocksX);
+
+				compress_read_block(Source, Image, BlockX, BlockY, Texels);
+				compress_block(Encoder, Texels, Image.Destination + Index * BlockSize);
+			}
+		});
+
+		return Result;
+	}
+
+	// Texels of a block of Format in RGBA, false if the format can't be decoded
+	inline bool decompress_block(format Format, std::uint8_t const * Block, std::uint8_t (&Texels)[16][4])
+	{
+		switch(Format)
+		{
+		case FORMAT_RGB_DXT1_UNORM_BLOCK8:
+		case FORMAT_RGB_DXT1_SRGB_BLOCK8:
+			decode_bc1(Block, false, Texels);
+			for(int i = 0; i < 16; ++i)
+				Texels[i][3] = 255;
+			return true;
+		case FORMAT_RGBA_DXT1_UNORM_BLOCK8:
+		case FORMAT_RGBA_DXT1_SRGB_BLOCK8:
+			decode_bc1(Block, false, Texels);
+			return true;
+		case FORMAT_RGBA_DXT3_UNORM_BLOCK16:
+		case FORMAT_RGBA_DXT3_SRGB_BLOCK16:
+			decode_bc1(Block + 8, true, Texels);
+			decode_bc2_alpha(Block, Texels);
+			return true;
+		case FORMAT_RGBA_DXT5_UNORM_BLOCK16:
+		case FORMAT_RGBA_DXT5_SRGB_BLOCK16:
+			decode_bc1(Block + 8, true, Texels);
+			decode_bc4(Block, 3, Texels);
+			return true;
+		case FORMAT_R_ATI1N_UNORM_BLOCK8:
+			std::memset(Texels, 0, sizeof(Texels));
+			decode_bc4(Block, 0, Texels);
+			for(int i = 0; i < 16; ++i)
+				Texels[i][3] = 255;
+			return true;
+		case FORMAT_RG_ATI2N_UNORM_BLOCK16:
+			std::memset(Texels, 0, sizeof(Texels));
+			decode_bc4(Block, 0, Texels);
+			decode_bc4(Block + 8, 1, Texels);
+			for(int i = 0; i < 16; ++i)
+				Texels[i][3] = 255;
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	inline texture decompress_texture(texture const & Texture)
+	{
+		typedef texture::size_type size_type;
+
+		std::uint8_t Probe[16][4];
+		std::uint8_t const Zero[16] = {};
+		if(Texture.empty() || !decompress_block(Texture.format(), Zero, Probe))
+			return texture();
+
+		format const Format = is_srgb(Texture.format()) ? FORMAT_RGBA8_SRGB_PACK8 : FORMAT_RGBA8_UNORM_PACK8;
+		texture::texelcoord_type const Dimensions(Texture.dimensions());
+		texture Result(Texture.target(), Format, Dimensions, Texture.layers(), Texture.faces(), Texture.levels(), default_allocator());
+
+		std::size_t const BlockSize = block_size(Texture.format());
+
+		// One image per task, the images of a level are the same size
+		size_type const Images = Texture.layers() * Texture.faces() * Texture.levels();
+		kernel_parallel(Images, 1, [&](std::size_t Begin, std::size_t End)
+		{
+			std::uint8_t Texels[16][4];
+
+			for(std::size_t Image = Begin; Image < End; ++Image)
+			{
+				size_type const Layer = Image / (Texture.faces() * Texture.levels());
+				size_type const Face = (Image / Texture.levels()) % Texture.faces();
+				size_type const Level = Image % Texture.levels();
+
+				texture::texelcoord_type const LevelDimensions(Result.dimensions(Level));
+				texture::texelcoord_type const BlockCount(glm::max(Texture.dimensions(Level) / block_dimensions(Texture.format()), texture::texelcoord_type(1)));
+
+				std::uint8_t const * Source = static_cast<std::uint8_t const *>(Texture.data(Layer, Face, Level));
+				std::uint8_t * Destination = static_cast<std::uint8_t *>(Result.data(Layer, Face, Level));
+
+				for(int z = 0; z < LevelDimensions.z; ++z)
+				for(int BlockY = 0; BlockY < BlockCount.y; ++BlockY)
+				for(int BlockX = 0; BlockX < BlockCount.x; ++BlockX)
+				{
+					decompress_block(Texture.format(), Source + ((static_cast<std::size_t>(z) * BlockCount.y + BlockY) * BlockCount.x + BlockX) * BlockSize, Texels);
+
+					// The blocks of the levels smaller than a block are partly outside
+					for(int y = 0; y < 4 && BlockY * 4 + y < LevelDimensions.y; ++y)
+					for(int x = 0; x < 4 && BlockX * 4 + x < LevelDimensions.x; ++x)
+					{
+						std::size_t const Texel = (static_cast<std::size_t>(z) * LevelDimensions.y + BlockY * 4 + y) * LevelDimensions.x + BlockX * 4 + x;
+						std::memcpy(Destination + Texel * 4, Texels[y * 4 + x], 4);
+					}
+				}
+			}
+		});
+
+		return Result;
+	}
+}//namespace detail
+
+	inline bool is_compressible(format Format)
+	{
+		detail::compress_source Source;
+		return detail::get_compress_source(Format, Source);
+	}
+
+	inline format compressed_format(texture const & Texture, content Content, bool HighQuality)
+	{
+		GLI_ASSERT(!Texture.empty());
+
+		bool const Srgb = is_srgb(Texture.format());
+
+		switch(Content)
+		{
+		case CONTENT_NORMAL:
+			return FORMAT_RG_ATI2N_UNORM_BLOCK16;
+		case CONTENT_SCALAR:
+			return FORMAT_R_ATI1N_UNORM_BLOCK8;
+		default:
+			break;
+		}
+
+		if(HighQuality)
+			return Srgb ? FORMAT_RGBA_BP_SRGB_BLOCK16 : FORMAT_RGBA_BP_UNORM_BLOCK16;
+
+		detail::compress_source Source;
+		bool Opaque = true;
+		if(detail::get_compress_source(Texture.format(), Source) && Source.Offsets[3] >= 0)
+		{
+			texture::texelcoord_type const Dimensions(Texture.dimensions(0));
+			std::size_t const Texels = static_cast<std::size_t>(Dimensions.x) * Dimensions.y * Dimensions.z;
+
+			for(size_t Layer = 0; Layer < Texture.layers() && Opaque; ++Layer)
+			for(size_t Face = 0; Face < Texture.faces() && Opaque; ++Face)
+			{
+				std::uint8_t const * Data = static_cast<std::uint8_t const *>(Texture.data(Layer, Face, 0)) + Source.Offsets[3];
+				for(std::size_t Texel = 0; Texel < Texels && Opaque; ++Texel)
+					Opaque = Data[Texel * Source.TexelSize] == 255;
+			}
+		}
+
+		if(Opaque)
+			return Srgb ? FORMAT_RGB_DXT1_SRGB_BLOCK8 : FORMAT_RGB_DXT1_UNORM_BLOCK8;
+		return Srgb ? FORMAT_RGBA_DXT5_SRGB_BLOCK16 : FORMAT_RGBA_DXT5_UNORM_BLOCK16;
+	}
+
+	template <typename texture_type>
+	inline texture_type compress(texture_type const & Texture, format Format)
+	{
+		return texture_type(detail::compress_texture(Texture, Format));
+	}
+
+	template <typename texture_type>
+	inline texture_type decompress(texture_type const & Texture)
+	{
+		return texture_type(detail::decompress_texture(Texture));
+	}
+}//namespace gli
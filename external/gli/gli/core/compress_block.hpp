@@ -0,0 +1,659 @@
+#pragma once
+
+#include "mipmaps_kernel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace gli{
+namespace detail
+{
+	// Texels of a block, one array per channel so that SIMD lanes process four texels at once
+	struct block_texels
+	{
+		float Channel[4][16];
+		int Count;
+	};
+
+	// Endpoints of the single colour blocks of BC1, built once
+	struct compress_tables
+	{
+		std::uint8_t Match5[256][2];	// 5 bits endpoints whose two thirds interpolation is the closest to a value
+		std::uint8_t Match6[256][2];	// 6 bits endpoints, likewise
+
+		compress_tables()
+		{
+			build(Match5, 5);
+			build(Match6, 6);
+		}
+
+		static int expand(int Value, int Bits)
+		{
+			return (Value << (8 - Bits)) | (Value >> (2 * Bits - 8));
+		}
+
+		static void build(std::uint8_t (&Match)[256][2], int Bits)
+		{
+			int const Size = 1 << Bits;
+
+			for(int Value = 0; Value < 256; ++Value)
+			{
+				int BestError = 256;
+				for(int Max = 0; Max < Size; ++Max)
+				for(int Min = 0; Min < Size; ++Min)
+				{
+					int const Interpolated = (2 * expand(Max, Bits) + expand(Min, Bits)) / 3;
+
+					// Prefer close endpoints, they are the ones the hardware interpolates the most precisely
+					int const Error = std::abs(Interpolated - Value) * 100 + std::abs(Max - Min) * 3;
+					if(Error < BestError)
+					{
+						BestError = Error;
+						Match[Value][0] = static_cast<std::uint8_t>(Max);
+						Match[Value][1] = static_cast<std::uint8_t>(Min);
+					}
+				}
+			}
+		}
+	};
+
+	inline compress_tables const & get_compress_tables()
+	{
+		static compress_tables const Tables;
+		return Tables;
+	}
+
+	// Smallest and largest value of every channel of the sixteen texels of a block
+	inline void block_bounds(std::uint8_t const (&Texels)[16][4], std::uint8_t (&Min)[4], std::uint8_t (&Max)[4])
+	{
+#		if GLI_KERNEL_SSE2
+			__m128i Low = _mm_loadu_si128(reinterpret_cast<__m128i const *>(Texels[0]));
+			__m128i High = Low;
+			for(int i = 4; i < 16; i += 4)
+			{
+				__m128i const Row = _mm_loadu_si128(reinterpret_cast<__m128i const *>(Texels[i]));
+				Low = _mm_min_epu8(Low, Row);
+				High = _mm_max_epu8(High, Row);
+			}
+
+			// Fold the four texels of the registers to one
+			Low = _mm_min_epu8(Low, _mm_srli_si128(Low, 8));
+			Low = _mm_min_epu8(Low, _mm_srli_si128(Low, 4));
+			High = _mm_max_epu8(High, _mm_srli_si128(High, 8));
+			High = _mm_max_epu8(High, _mm_srli_si128(High, 4));
+
+			int const MinBits = _mm_cvtsi128_si32(Low);
+			int const MaxBits = _mm_cvtsi128_si32(High);
+			std::memcpy(Min, &MinBits, 4);
+			std::memcpy(Max, &MaxBits, 4);
+#		else
+			std::memcpy(Min, Texels[0], 4);
+			std::memcpy(Max, Texels[0], 4);
+			for(int i = 1; i < 16; ++i)
+			for(int c = 0; c < 4; ++c)
+			{
+				Min[c] = std::min(Min[c], Texels[i][c]);
+				Max[c] = std::max(Max[c], Texels[i][c]);
+			}
+#		endif
+	}
+
+	// Principal axis of the texels through their mean, by power iteration from the diagonal of their bounds
+	inline void block_axis(block_texels const & Texels, int Channels, float (&Mean)[4], float (&Axis)[4])
+	{
+		float Min[4], Max[4];
+		for(int c = 0; c < Channels; ++c)
+		{
+			Mean[c] = 0.f;
+			Min[c] = Max[c] = Texels.Channel[c][0];
+			for(int i = 0; i < Texels.Count; ++i)
+			{
+				Mean[c] += Texels.Channel[c][i];
+				Min[c] = std::min(Min[c], Texels.Channel[c][i]);
+				Max[c] = std::max(Max[c], Texels.Channel[c][i]);
+			}
+			Mean[c] /= static_cast<float>(Texels.Count);
+		}
+
+		float Covariance[4][4] = {};
+		for(int i = 0; i < Texels.Count; ++i)
+		for(int c0 = 0; c0 < Channels; ++c0)
+		for(int c1 = c0; c1 < Channels; ++c1)
+			Covariance[c0][c1] += (Texels.Channel[c0][i] - Mean[c0]) * (Texels.Channel[c1][i] - Mean[c1]);
+		for(int c0 = 0; c0 < Channels; ++c0)
+		for(int c1 = 0; c1 < c0; ++c1)
+			Covariance[c0][c1] = Covariance[c1][c0];
+
+		for(int c = 0; c < Channels; ++c)
+			Axis[c] = Max[c] - Min[c];
+
+		for(int Iteration = 0; Iteration < 8; ++Iteration)
+		{
+			float Next[4] = {};
+			float Length = 0.f;
+			for(int c0 = 0; c0 < Channels; ++c0)
+			{
+				for(int c1 = 0; c1 < Channels; ++c1)
+					Next[c0] += Covariance[c0][c1] * Axis[c1];
+				Length = std::max(Length, std::abs(Next[c0]));
+			}
+
+			// No spread left, the diagonal of the bounds is as good as any
+			if(Length < 1e-6f)
+				break;
+
+			for(int c = 0; c < Channels; ++c)
+				Axis[c] = Next[c] / Length;
+		}
+	}
+
+	// Endpoints at the extent of the texels along the principal axis
+	inline void block_extent(block_texels const & Texels, int Channels, float (&A)[4], float (&B)[4])
+	{
+		float Mean[4], Axis[4];
+		block_axis(Texels, Channels, Mean, Axis);
+
+		float Length = 0.f;
+		for(int c = 0; c < Channels; ++c)
+			Length += Axis[c] * Axis[c];
+
+		float Low = 0.f, High = 0.f;
+		if(Length > 0.f)
+		{
+			for(int i = 0; i < Texels.Count; ++i)
+			{
+				float Projection = 0.f;
+				for(int c = 0; c < Channels; ++c)
+					Projection += (Texels.Channel[c][i] - Mean[c]) * Axis[c];
+				Low = std::min(Low, Projection);
+				High = std::max(High, Projection);
+			}
+			Low /= Length;
+			High /= Length;
+		}
+
+		for(int c = 0; c < Channels; ++c)
+		{
+			A[c] = glm::clamp(Mean[c] + Axis[c] * Low, 0.f, 255.f);
+			B[c] = glm::clamp(Mean[c] + Axis[c] * High, 0.f, 255.f);
+		}
+	}
+
+	// Closest entry of the Palette of every texel, returns the sum of the squared errors
+	inline float block_match(block_texels const & Texels, int Channels, float const (*Palette)[4], int Entries, std::uint8_t (&Indices)[16])
+	{
+		float Error = 0.f;
+
+#		if GLI_KERNEL_SSE2
+			for(int i = 0; i < Texels.Count; i += 4)
+			{
+				__m128 Best = _mm_set1_ps(1e30f);
+				__m128i BestIndex = _mm_setzero_si128();
+
+				for(int Entry = 0; Entry < Entries; ++Entry)
+				{
+					__m128 Distance = _mm_setzero_ps();
+					for(int c = 0; c < Channels; ++c)
+					{
+						__m128 const Delta = _mm_sub_ps(_mm_loadu_ps(&Texels.Channel[c][i]), _mm_set1_ps(Palette[Entry][c]));
+						Distance = _mm_add_ps(Distance, _mm_mul_ps(Delta, Delta));
+					}
+
+					__m128i const Closer = _mm_castps_si128(_mm_cmplt_ps(Distance, Best));
+					Best = _mm_min_ps(Distance, Best);
+					BestIndex = _mm_or_si128(_mm_and_si128(Closer, _mm_set1_epi32(Entry)), _mm_andnot_si128(Closer, BestIndex));
+				}
+
+				float Errors[4];
+				std::int32_t Closest[4];
+				_mm_storeu_ps(Errors, Best);
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(Closest), BestIndex);
+
+				for(int Lane = 0; Lane < 4 && i + Lane < Texels.Count; ++Lane)
+				{
+					Indices[i + Lane] = static_cast<std::uint8_t>(Closest[Lane]);
+					Error += Errors[Lane];
+				}
+			}
+#		else
+			for(int i = 0; i < Texels.Count; ++i)
+			{
+				float Best = 1e30f;
+				for(int Entry = 0; Entry < Entries; ++Entry)
+				{
+					float Distance = 0.f;
+					for(int c = 0; c < Channels; ++c)
+					{
+						float const Delta = Texels.Channel[c][i] - Palette[Entry][c];
+						Distance += Delta * Delta;
+					}
+
+					if(Distance < Best)
+					{
+						Best = Distance;
+						Indices[i] = static_cast<std::uint8_t>(Entry);
+					}
+				}
+				Error += Best;
+			}
+#		endif
+
+		return Error;
+	}
+
+	// Endpoints minimizing the squared error of the texels interpolated with the Weights of their indices, false if they are all the same
+	inline bool block_fit(block_texels const & Texels, int Channels, std::uint8_t const (&Indices)[16], float const * Weights, float (&A)[4], float (&B)[4])
+	{
+		float AA = 0.f, AB = 0.f, BB = 0.f;
+		float AX[4] = {}, BX[4] = {};
+
+		for(int i = 0; i < Texels.Count; ++i)
+		{
+			float const w = Weights[Indices[i]];
+			AA += (1.f - w) * (1.f - w);
+			AB += (1.f - w) * w;
+			BB += w * w;
+			for(int c = 0; c < Channels; ++c)
+			{
+				AX[c] += (1.f - w) * Texels.Channel[c][i];
+				BX[c] += w * Texels.Channel[c][i];
+			}
+		}
+
+		float const Determinant = AA * BB - AB * AB;
+		if(std::abs(Determinant) < 1e-6f)
+			return false;
+
+		for(int c = 0; c < Channels; ++c)
+		{
+			A[c] = glm::clamp((AX[c] * BB - BX[c] * AB) / Determinant, 0.f, 255.f);
+			B[c] = glm::clamp((BX[c] * AA - AX[c] * AB) / Determinant, 0.f, 255.f);
+		}
+		return true;
+	}
+
+	inline std::uint16_t pack_565(float const (&Color)[4])
+	{
+		int const r = static_cast<int>(Color[0] * 31.f / 255.f + 0.5f);
+		int const g = static_cast<int>(Color[1] * 63.f / 255.f + 0.5f);
+		int const b = static_cast<int>(Color[2] * 31.f / 255.f + 0.5f);
+		return static_cast<std::uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	inline void unpack_565(std::uint16_t Packed, float (&Color)[4])
+	{
+		Color[0] = static_cast<float>(compress_tables::expand((Packed >> 11) & 31, 5));
+		Color[1] = static_cast<float>(compress_tables::expand((Packed >> 5) & 63, 6));
+		Color[2] = static_cast<float>(compress_tables::expand(Packed & 31, 5));
+		Color[3] = 255.f;
+	}
+
+	// Colours of a BC1 block, four of them or three and transparent black
+	inline void bc1_palette(std::uint16_t Color0, std::uint16_t Color1, bool ThreeColors, float (&Palette)[4][4])
+	{
+		unpack_565(Color0, Palette[0]);
+		unpack_565(Color1, Palette[1]);
+		for(int c = 0; c < 3; ++c)
+		{
+			if(ThreeColors)
+			{
+				Palette[2][c] = std::floor((Palette[0][c] + Palette[1][c]) / 2.f);
+				Palette[3][c] = 0.f;
+			}
+			else
+			{
+				Palette[2][c] = std::floor((2.f * Palette[0][c] + Palette[1][c]) / 3.f);
+				Palette[3][c] = std::floor((Palette[0][c] + 2.f * Palette[1][c]) / 3.f);
+			}
+		}
+	}
+
+	inline void write_bc1(std::uint16_t Color0, std::uint16_t Color1, std::uint32_t Bits, std::uint8_t * Block)
+	{
+		Block[0] = static_cast<std::uint8_t>(Color0);
+		Block[1] = static_cast<std::uint8_t>(Color0 >> 8);
+		Block[2] = static_cast<std::uint8_t>(Color1);
+		Block[3] = static_cast<std::uint8_t>(Color1 >> 8);
+		for(int i = 0; i < 4; ++i)
+			Block[4 + i] = static_cast<std::uint8_t>(Bits >> (i * 8));
+	}
+
+	// BC1 colour block, texels whose alpha is under half are transparent if PunchThrough, the other ones are opaque
+	inline void encode_bc1(std::uint8_t const (&Texels)[16][4], bool PunchThrough, std::uint8_t * Block)
+	{
+		bool Transparent[16];
+		block_texels Opaque;
+		Opaque.Count = 0;
+		for(int i = 0; i < 16; ++i)
+		{
+			Transparent[i] = PunchThrough && Texels[i][3] < 128;
+			if(Transparent[i])
+				continue;
+			for(int c = 0; c < 3; ++c)
+				Opaque.Channel[c][Opaque.Count] = static_cast<float>(Texels[i][c]);
+			++Opaque.Count;
+		}
+
+		if(Opaque.Count == 0)
+		{
+			write_bc1(0, 0, 0xFFFFFFFF, Block);
+			return;
+		}
+
+		bool const ThreeColors = Opaque.Count < 16;
+
+		// Pad to a multiple of four texels for the SIMD lanes, the padding repeats a texel and is never written
+		for(int i = Opaque.Count; i < ((Opaque.Count + 3) & ~3); ++i)
+		for(int c = 0; c < 3; ++c)
+			Opaque.Channel[c][i] = Opaque.Channel[c][0];
+
+		std::uint16_t Color0, Color1;
+		std::uint8_t Indices[16] = {};
+
+		std::uint8_t Min[4], Max[4];
+		block_bounds(Texels, Min, Max);
+
+		if(!ThreeColors && Min[0] == Max[0] && Min[1] == Max[1] && Min[2] == Max[2])
+		{
+			// Two thirds between the closest endpoints is more precise than 565 alone
+			compress_tables const & Tables = get_compress_tables();
+			int const r = static_cast<int>(Opaque.Channel[0][0]), g = static_cast<int>(Opaque.Channel[1][0]), b = static_cast<int>(Opaque.Channel[2][0]);
+			Color0 = static_cast<std::uint16_t>((Tables.Match5[r][0] << 11) | (Tables.Match6[g][0] << 5) | Tables.Match5[b][0]);
+			Color1 = static_cast<std::uint16_t>((Tables.Match5[r][1] << 11) | (Tables.Match6[g][1] << 5) | Tables.Match5[b][1]);
+			std::fill(Indices, Indices + 16, 2);
+		}
+		else
+		{
+			float A[4], B[4];
+			block_extent(Opaque, 3, A, B);
+
+			float const Weights4[4] = {0.f, 1.f, 1.f / 3.f, 2.f / 3.f};
+			float const Weights3[4] = {0.f, 1.f, 1.f / 2.f, 0.f};
+			int const Entries = ThreeColors ? 3 : 4;
+
+			Color0 = pack_565(A);
+			Color1 = pack_565(B);
+
+			float Palette[4][4];
+			bc1_palette(Color0, Color1, ThreeColors, Palette);
+			float Error = block_match(Opaque, 3, Palette, Entries, Indices);
+
+			// Least squares endpoints of the indices found, kept while they reduce the error
+			for(int Iteration = 0; Iteration < 2 && Error > 0.f; ++Iteration)
+			{
+				if(!block_fit(Opaque, 3, Indices, ThreeColors ? Weights3 : Weights4, A, B))
+					break;
+
+				std::uint16_t const Refined0 = pack_565(A), Refined1 = pack_565(B);
+				std::uint8_t RefinedIndices[16] = {};
+				bc1_palette(Refined0, Refined1, ThreeColors, Palette);
+				float const RefinedError = block_match(Opaque, 3, Palette, Entries, RefinedIndices);
+				if(RefinedError >= Error)
+					break;
+
+				Color0 = Refined0;
+				Color1 = Refined1;
+				Error = RefinedError;
+				std::copy(RefinedIndices, RefinedIndices + 16, Indices);
+			}
+		}
+
+		// Back from the opaque texels to the sixteen of the block
+		std::uint8_t BlockIndices[16];
+		for(int i = 0, j = 0; i < 16; ++i)
+			BlockIndices[i] = Transparent[i] ? 3 : Indices[j++];
+
+		// The order of the endpoints selects the mode: four colours if the first one is greater
+		if(ThreeColors)
+		{
+			if(Color0 > Color1)
+			{
+				std::swap(Color0, Color1);
+				for(int i = 0; i < 16; ++i)
+					BlockIndices[i] = BlockIndices[i] < 2 ? static_cast<std::uint8_t>(BlockIndices[i] ^ 1) : BlockIndices[i];
+			}
+		}
+		else if(Color0 < Color1)
+		{
+			std::swap(Color0, Color1);
+			for(int i = 0; i < 16; ++i)
+				BlockIndices[i] ^= 1;
+		}
+		else if(Color0 == Color1)
+			std::fill(BlockIndices, BlockIndices + 16, 0);
+
+		std::uint32_t Bits = 0;
+		for(int i = 0; i < 16; ++i)
+			Bits |= static_cast<std::uint32_t>(BlockIndices[i]) << (i * 2);
+
+		write_bc1(Color0, Color1, Bits, Block);
+	}
+
+	// BC4 block of one channel, with eight values interpolated between the extremes of the block
+	inline void encode_bc4(std::uint8_t const (&Values)[16], std::uint8_t * Block)
+	{
+		int Min = Values[0], Max = Values[0];
+		for(int i = 1; i < 16; ++i)
+		{
+			Min = std::min<int>(Min, Values[i]);
+			Max = std::max<int>(Max, Values[i]);
+		}
+
+		Block[0] = static_cast<std::uint8_t>(Max);
+		Block[1] = static_cast<std::uint8_t>(Min);
+
+		std::uint64_t Bits = 0;
+		if(Max > Min)
+		{
+			int const Range = Max - Min;
+			for(int i = 0; i < 16; ++i)
+			{
+				// Step from the smallest value, index 0 is the largest one, 1 the smallest and 2 to 7 the steps down from the largest
+				int const Step = ((Values[i] - Min) * 14 + Range) / (2 * Range);
+				int const Index = Step == 7 ? 0 : Step == 0 ? 1 : 8 - Step;
+				Bits |= static_cast<std::uint64_t>(Index) << (i * 3);
+			}
+		}
+
+		for(int i = 0; i < 6; ++i)
+			Block[2 + i] = static_cast<std::uint8_t>(Bits >> (i * 8));
+	}
+
+	inline void encode_bc4(std::uint8_t const (&Texels)[16][4], int Channel, std::uint8_t * Block)
+	{
+		std::uint8_t Values[16];
+		for(int i = 0; i < 16; ++i)
+			Values[i] = Texels[i][Channel];
+		encode_bc4(Values, Block);
+	}
+
+	// BC3 block: a BC4 block of alpha and a four colours BC1 block
+	inline void encode_bc3(std::uint8_t const (&Texels)[16][4], std::uint8_t * Block)
+	{
+		encode_bc4(Texels, 3, Block);
+		encode_bc1(Texels, false, Block + 8);
+	}
+
+	// BC5 block: BC4 blocks of red and green
+	inline void encode_bc5(std::uint8_t const (&Texels)[16][4], std::uint8_t * Block)
+	{
+		encode_bc4(Texels, 0, Block);
+		encode_bc4(Texels, 1, Block + 8);
+	}
+
+	// Closest 7 bits endpoint with its shared bit, Color is set to the value it decodes to
+	inline void quantize_bc7_mode6(float (&Color)[4], int (&Quantized)[4], int & Bit)
+	{
+		float BestError = 1e30f;
+		for(int p = 0; p < 2; ++p)
+		{
+			int Candidate[4];
+			float Error = 0.f;
+			for(int c = 0; c < 4; ++c)
+			{
+				Candidate[c] = glm::clamp(static_cast<int>((Color[c] - static_cast<float>(p)) / 2.f + 0.5f), 0, 127);
+				float const Delta = static_cast<float>((Candidate[c] << 1) | p) - Color[c];
+				Error += Delta * Delta;
+			}
+
+			if(Error < BestError)
+			{
+				BestError = Error;
+				Bit = p;
+				std::copy(Candidate, Candidate + 4, Quantized);
+			}
+		}
+
+		for(int c = 0; c < 4; ++c)
+			Color[c] = static_cast<float>((Quantized[c] << 1) | Bit);
+	}
+
+	// Weight out of 64 of the second endpoint for each of the sixteen indices
+	inline int bc7_weight(int Index)
+	{
+		static int const Weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+		return Weights[Index];
+	}
+
+	inline void bc7_mode6_palette(float const (&A)[4], float const (&B)[4], float (&Palette)[16][4])
+	{
+		for(int Entry = 0; Entry < 16; ++Entry)
+		for(int c = 0; c < 4; ++c)
+			Palette[Entry][c] = static_cast<float>(((64 - bc7_weight(Entry)) * static_cast<int>(A[c]) + bc7_weight(Entry) * static_cast<int>(B[c]) + 32) >> 6);
+	}
+
+	// BC7 block in mode 6 only: one subset of RGBA endpoints of 7 bits and a shared bit each, with sixteen steps between them
+	inline void encode_bc7(std::uint8_t const (&Texels)[16][4], std::uint8_t * Block)
+	{
+		block_texels Source;
+		Source.Count = 16;
+		for(int i = 0; i < 16; ++i)
+		for(int c = 0; c < 4; ++c)
+			Source.Channel[c][i] = static_cast<float>(Texels[i][c]);
+
+		float A[4], B[4];
+		block_extent(Source, 4, A, B);
+
+		int QuantizedA[4], QuantizedB[4], BitA = 0, BitB = 0;
+		quantize_bc7_mode6(A, QuantizedA, BitA);
+		quantize_bc7_mode6(B, QuantizedB, BitB);
+
+		float Palette[16][4];
+		bc7_mode6_palette(A, B, Palette);
+
+		std::uint8_t Indices[16] = {};
+		float Error = block_match(Source, 4, Palette, 16, Indices);
+
+		float Weights[16];
+		for(int Entry = 0; Entry < 16; ++Entry)
+			Weights[Entry] = static_cast<float>(bc7_weight(Entry)) / 64.f;
+
+		for(int Iteration = 0; Iteration < 2 && Error > 0.f; ++Iteration)
+		{
+			float RefinedA[4], RefinedB[4];
+			if(!block_fit(Source, 4, Indices, Weights, RefinedA, RefinedB))
+				break;
+
+			int RefinedQuantizedA[4], RefinedQuantizedB[4], RefinedBitA = 0, RefinedBitB = 0;
+			quantize_bc7_mode6(RefinedA, RefinedQuantizedA, RefinedBitA);
+			quantize_bc7_mode6(RefinedB, RefinedQuantizedB, RefinedBitB);
+			bc7_mode6_palette(RefinedA, RefinedB, Palette);
+
+			std::uint8_t RefinedIndices[16] = {};
+			float const RefinedError = block_match(Source, 4, Palette, 16, RefinedIndices);
+			if(RefinedError >= Error)
+				break;
+
+			Error = RefinedError;
+			std::copy(RefinedQuantizedA, RefinedQuantizedA + 4, QuantizedA);
+			std::copy(RefinedQuantizedB, RefinedQuantizedB + 4, QuantizedB);
+			BitA = RefinedBitA;
+			BitB = RefinedBitB;
+			std::copy(RefinedIndices, RefinedIndices + 16, Indices);
+		}
+
+		// The top bit of the index of the first texel isn't stored, it has to be zero
+		if(Indices[0] & 8)
+		{
+			std::swap(QuantizedA, QuantizedB);
+			std::swap(BitA, BitB);
+			for(int i = 0; i < 16; ++i)
+				Indices[i] = static_cast<std::uint8_t>(15 - Indices[i]);
+		}
+
+		std::uint64_t Bits[2] = {0, 0};
+		int Position = 0;
+		auto const Write = [&](std::uint64_t Value, int Count)
+		{
+			for(int i = 0; i < Count; ++i, ++Position)
+				Bits[Position >> 6] |= ((Value >> i) & 1) << (Position & 63);
+		};
+
+		Write(1 << 6, 7);
+		for(int c = 0; c < 4; ++c)
+		{
+			Write(static_cast<std::uint64_t>(QuantizedA[c]), 7);
+			Write(static_cast<std::uint64_t>(QuantizedB[c]), 7);
+		}
+		Write(static_cast<std::uint64_t>(BitA), 1);
+		Write(static_cast<std::uint64_t>(BitB), 1);
+		Write(Indices[0], 3);
+		for(int i = 1; i < 16; ++i)
+			Write(Indices[i], 4);
+
+		for(int i = 0; i < 16; ++i)
+			Block[i] = static_cast<std::uint8_t>(Bits[i >> 3] >> ((i & 7) * 8));
+	}
+	// Texels of a BC1 block, in its three colours mode the fourth entry is transparent black.
+	// The colour blocks of BC2 and BC3 always have four colours.
+	inline void decode_bc1(std::uint8_t const * Block, bool FourColors, std::uint8_t (&Texels)[16][4])
+	{
+		std::uint16_t const Color0 = static_cast<std::uint16_t>(Block[0] | (Block[1] << 8));
+		std::uint16_t const Color1 = static_cast<std::uint16_t>(Block[2] | (Block[3] << 8));
+		bool const ThreeColors = !FourColors && Color0 <= Color1;
+
+		float Palette[4][4];
+		bc1_palette(Color0, Color1, ThreeColors, Palette);
+		Palette[2][3] = 255.f;
+		Palette[3][3] = ThreeColors ? 0.f : 255.f;
+
+		for(int i = 0; i < 16; ++i)
+		for(int c = 0; c < 4; ++c)
+			Texels[i][c] = static_cast<std::uint8_t>(Palette[(Block[4 + i / 4] >> ((i % 4) * 2)) & 3][c]);
+	}
+
+	// Values of a BC4 block into the Channel of the texels
+	inline void decode_bc4(std::uint8_t const * Block, int Channel, std::uint8_t (&Texels)[16][4])
+	{
+		int const Value0 = Block[0], Value1 = Block[1];
+
+		// Eight values between the endpoints, or six and the extremes if the first endpoint isn't the greater
+		int Palette[8] = {Value0, Value1};
+		for(int i = 2; i < 8; ++i)
+		{
+			if(Value0 > Value1)
+				Palette[i] = ((8 - i) * Value0 + (i - 1) * Value1) / 7;
+			else
+				Palette[i] = i < 6 ? ((6 - i) * Value0 + (i - 1) * Value1) / 5 : i == 6 ? 0 : 255;
+		}
+
+		std::uint64_t Bits = 0;
+		for(int i = 0; i < 6; ++i)
+			Bits |= static_cast<std::uint64_t>(Block[2 + i]) << (i * 8);
+		for(int i = 0; i < 16; ++i)
+			Texels[i][Channel] = static_cast<std::uint8_t>(Palette[(Bits >> (i * 3)) & 7]);
+	}
+
+	// Explicit alpha of a BC2 block, four bits per texel
+	inline void decode_bc2_alpha(std::uint8_t const * Block, std::uint8_t (&Texels)[16][4])
+	{
+		for(int i = 0; i < 16; ++i)
+		{
+			int const Alpha = (Block[i / 2] >> ((i % 2) * 4)) & 15;
+			Texels[i][3] = static_cast<std::uint8_t>(Alpha * 17);
+		}
+	}
+}//namespace detail
+}//namespace gli
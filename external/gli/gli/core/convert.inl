@@ -0,0 +1,554 @@
+#include "mipmaps_kernel.hpp"
+
+// Byte shuffles of 8 bits texels, when the compiler targets SSSE3 or later
+#if GLI_KERNEL_SSE2 && (defined(__SSSE3__) || defined(__AVX__))
+#	define GLI_CONVERT_SSSE3 1
+#	include <tmmintrin.h>
+#else
+#	define GLI_CONVERT_SSSE3 0
+#endif
+
+namespace gli{
+namespace detail
+{
+	enum convert_type
+	{
+		CONVERT_TYPE_UNORM8,
+		CONVERT_TYPE_SRGB8,
+		CONVERT_TYPE_SFLOAT16,
+		CONVERT_TYPE_SFLOAT32,
+		CONVERT_TYPE_INVALID
+	};
+
+	// How a format stores a texel: Channels values of Type, blue first if Reversed
+	struct convert_layout
+	{
+		convert_type Type;
+		int Channels;
+		bool Reversed;
+	};
+
+	inline convert_layout make_convert_layout(convert_type Type, int Channels, bool Reversed = false)
+	{
+		convert_layout const Layout = {Type, Channels, Reversed};
+		return Layout;
+	}
+
+	inline convert_layout get_convert_layout(format Format)
+	{
+		switch(Format)
+		{
+		case FORMAT_R8_UNORM_PACK8: return make_convert_layout(CONVERT_TYPE_UNORM8, 1);
+		case FORMAT_RG8_UNORM_PACK8: return make_convert_layout(CONVERT_TYPE_UNORM8, 2);
+		case FORMAT_RGB8_UNORM_PACK8: return make_convert_layout(CONVERT_TYPE_UNORM8, 3);
+		case FORMAT_BGR8_UNORM_PACK8: return make_convert_layout(CONVERT_TYPE_UNORM8, 3, true);
+		case FORMAT_RGBA8_UNORM_PACK8: return make_convert_layout(CONVERT_TYPE_UNORM8, 4);
+		case FORMAT_BGRA8_UNORM_PACK8: return make_convert_layout(CONVERT_TYPE_UNORM8, 4, true);
+		case FORMAT_R8_SRGB_PACK8: return make_convert_layout(CONVERT_TYPE_SRGB8, 1);
+		case FORMAT_RG8_SRGB_PACK8: return make_convert_layout(CONVERT_TYPE_SRGB8, 2);
+		case FORMAT_RGB8_SRGB_PACK8: return make_convert_layout(CONVERT_TYPE_SRGB8, 3);
+		case FORMAT_BGR8_SRGB_PACK8: return make_convert_layout(CONVERT_TYPE_SRGB8, 3, true);
+		case FORMAT_RGBA8_SRGB_PACK8: return make_convert_layout(CONVERT_TYPE_SRGB8, 4);
+		case FORMAT_BGRA8_SRGB_PACK8: return make_convert_layout(CONVERT_TYPE_SRGB8, 4, true);
+		case FORMAT_R16_SFLOAT_PACK16: return make_convert_layout(CONVERT_TYPE_SFLOAT16, 1);
+		case FORMAT_RG16_SFLOAT_PACK16: return make_convert_layout(CONVERT_TYPE_SFLOAT16, 2);
+		case FORMAT_RGB16_SFLOAT_PACK16: return make_convert_layout(CONVERT_TYPE_SFLOAT16, 3);
+		case FORMAT_RGBA16_SFLOAT_PACK16: return make_convert_layout(CONVERT_TYPE_SFLOAT16, 4);
+		case FORMAT_R32_SFLOAT_PACK32: return make_convert_layout(CONVERT_TYPE_SFLOAT32, 1);
+		case FORMAT_RG32_SFLOAT_PACK32: return make_convert_layout(CONVERT_TYPE_SFLOAT32, 2);
+		case FORMAT_RGB32_SFLOAT_PACK32: return make_convert_layout(CONVERT_TYPE_SFLOAT32, 3);
+		case FORMAT_RGBA32_SFLOAT_PACK32: return make_convert_layout(CONVERT_TYPE_SFLOAT32, 4);
+		default: return make_convert_layout(CONVERT_TYPE_INVALID, 0);
+		}
+	}
+
+	inline std::size_t convert_value_size(convert_type Type)
+	{
+		return Type == CONVERT_TYPE_SFLOAT32 ? 4 : Type == CONVERT_TYPE_SFLOAT16 ? 2 : 1;
+	}
+
+	enum
+	{
+		CONVERT_ZERO = 4,
+		CONVERT_ONE = 5
+	};
+
+	// Where each channel of a destination texel, in memory order, comes from:
+	// a channel of the source texel in memory order, or CONVERT_ZERO or CONVERT_ONE
+	struct convert_map
+	{
+		int Source[4];
+		bool Identity;
+	};
+
+	// BGR formats swap red and blue, alpha stays last. The swap is its own inverse.
+	inline int convert_memory_channel(convert_layout const & Layout, int Channel)
+	{
+		return Layout.Reversed && Channel < 3 ? 2 - Channel : Channel;
+	}
+
+	inline convert_map get_convert_map(convert_layout const & Source, convert_layout const & Destination, swizzles const & Swizzles)
+	{
+		convert_map Map = {{CONVERT_ZERO, CONVERT_ZERO, CONVERT_ZERO, CONVERT_ZERO}, Source.Channels == Destination.Channels};
+
+		for(int Channel = 0; Channel < Destination.Channels; ++Channel)
+		{
+			swizzle const Swizzle = Swizzles[convert_memory_channel(Destination, Channel)];
+
+			int Select = Swizzle == SWIZZLE_ONE ? CONVERT_ONE : CONVERT_ZERO;
+			if(is_channel(Swizzle))
+			{
+				if(static_cast<int>(Swizzle) < Source.Channels)
+					Select = convert_memory_channel(Source, static_cast<int>(Swizzle));
+				else
+					Select = Swizzle == SWIZZLE_ALPHA ? CONVERT_ONE : CONVERT_ZERO;
+			}
+
+			Map.Source[Channel] = Select;
+			Map.Identity = Map.Identity && Select == Channel;
+		}
+
+		return Map;
+	}
+
+	inline std::uint32_t convert_float_bits(float Value)
+	{
+		std::uint32_t Bits;
+		std::memcpy(&Bits, &Value, sizeof(Bits));
+		return Bits;
+	}
+
+	inline float convert_bits_float(std::uint32_t Bits)
+	{
+		float Value;
+		std::memcpy(&Value, &Bits, sizeof(Value));
+		return Value;
+	}
+
+	// Exact for every half, the SIMD version below gives the same bits
+	inline float convert_half_to_float(std::uint16_t Half)
+	{
+		std::uint32_t const Magnitude = static_cast<std::uint32_t>(Half & 0x7fff) << 13;
+		std::uint32_t const Sign = static_cast<std::uint32_t>(Half & 0x8000) << 16;
+
+		// Infinity and NaN keep their mantissa, scaling the others by 2^112 rebiases the exponent and normalizes denormals
+		if(Magnitude > 0x0f7fffff)
+			return convert_bits_float(Magnitude | 0x7f800000 | Sign);
+		return convert_bits_float(convert_float_bits(convert_bits_float(Magnitude) * convert_bits_float(0x77800000)) | Sign);
+	}
+
+	// Rounds to nearest even, overflows to infinity and keeps NaN a NaN
+	inline std::uint16_t convert_float_to_half(float Value)
+	{
+		std::uint32_t Bits = convert_float_bits(Value);
+		std::uint32_t const Sign = Bits & 0x80000000u;
+		Bits ^= Sign;
+
+		std::uint32_t Half;
+		if(Bits > 0x477fffff)
+			Half = Bits > 0x7f800000 ? 0x7e00 : 0x7c00;
+		else if(Bits < 0x38800000)
+			// Below the smallest normal half, adding 0.5 lines the mantissa up with the one of a denormal half and rounds it
+			Half = convert_float_bits(convert_bits_float(Bits) + 0.5f) - 0x3f000000;
+		else
+			// Rebias the exponent, the half way point rounds up when the lowest kept bit is odd
+			Half = (Bits + 0xc8000fffu + ((Bits >> 13) & 1)) >> 13;
+
+		return static_cast<std::uint16_t>(Half | (Sign >> 16));
+	}
+
+#	if GLI_KERNEL_SSE2
+		// Four halves in the low 16 bits of each lane
+		inline __m128 convert_half_to_float(__m128i Half)
+		{
+			__m128i const Magnitude = _mm_slli_epi32(_mm_and_si128(Half, _mm_set1_epi32(0x7fff)), 13);
+			__m128i const Sign = _mm_slli_epi32(_mm_and_si128(Half, _mm_set1_epi32(0x8000)), 16);
+			__m128i const Special = _mm_cmpgt_epi32(Magnitude, _mm_set1_epi32(0x0f7fffff));
+			__m128i const Scaled = _mm_castps_si128(_mm_mul_ps(_mm_castsi128_ps(Magnitude), _mm_castsi128_ps(_mm_set1_epi32(0x77800000))));
+			__m128i const Bits = _mm_or_si128(_mm_andnot_si128(Special, Scaled), _mm_and_si128(Special, _mm_or_si128(Magnitude, _mm_set1_epi32(0x7f800000))));
+			return _mm_castsi128_ps(_mm_or_si128(Bits, Sign));
+		}
+
+		// Four halves in the low 16 bits of each lane
+		inline __m128i convert_float_to_half(__m128 Value)
+		{
+			__m128i Bits = _mm_castps_si128(Value);
+			__m128i const Sign = _mm_and_si128(Bits, _mm_set1_epi32(static_cast<int>(0x80000000u)));
+			Bits = _mm_xor_si128(Bits, Sign);
+
+			__m128i const Large = _mm_cmpgt_epi32(Bits, _mm_set1_epi32(0x477fffff));
+			__m128i const NaN = _mm_cmpgt_epi32(Bits, _mm_set1_epi32(0x7f800000));
+			__m128i const Infinite = _mm_or_si128(_mm_set1_epi32(0x7c00), _mm_and_si128(NaN, _mm_set1_epi32(0x0200)));
+
+			__m128i const Small = _mm_cmplt_epi32(Bits, _mm_set1_epi32(0x38800000));
+			__m128i const Denormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(Bits), _mm_set1_ps(0.5f))), _mm_set1_epi32(0x3f000000));
+
+			__m128i const Odd = _mm_and_si128(_mm_srli_epi32(Bits, 13), _mm_set1_epi32(1));
+			__m128i const Normal = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(Bits, _mm_set1_epi32(static_cast<int>(0xc8000fffu))), Odd), 13);
+
+			__m128i Half = _mm_or_si128(_mm_andnot_si128(Small, Normal), _mm_and_si128(Small, Denormal));
+			Half = _mm_or_si128(_mm_andnot_si128(Large, Half), _mm_and_si128(Large, Infinite));
+			return _mm_or_si128(Half, _mm_srli_epi32(Sign, 16));
+		}
+
+		// Eight halves from the low 16 bits of the lanes of two vectors, packs saturates so the bits are sign extended first
+		inline __m128i convert_pack_halves(__m128i Low, __m128i High)
+		{
+			return _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(Low, 16), 16), _mm_srai_epi32(_mm_slli_epi32(High, 16), 16));
+		}
+#	endif
+
+	// Count values of a row, in memory order, to floats
+	inline void convert_decode(convert_layout const & Layout, void const * Source, std::size_t Count, float * Values)
+	{
+		kernel_tables const & Tables = get_kernel_tables();
+
+		std::size_t i = 0;
+		switch(Layout.Type)
+		{
+		case CONVERT_TYPE_UNORM8:
+		{
+			std::uint8_t const * Data = static_cast<std::uint8_t const *>(Source);
+#			if GLI_KERNEL_SSE2
+				__m128i const Zero = _mm_setzero_si128();
+				__m128 const Max = _mm_set1_ps(255.f);
+				for(; i + 16 <= Count; i += 16)
+				{
+					__m128i const Bytes = _mm_loadu_si128(reinterpret_cast<__m128i const *>(Data + i));
+					__m128i const Low = _mm_unpacklo_epi8(Bytes, Zero);
+					__m128i const High = _mm_unpackhi_epi8(Bytes, Zero);
+
+					// A division like the tables, for the same values
+					_mm_storeu_ps(Values + i + 0, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(Low, Zero)), Max));
+					_mm_storeu_ps(Values + i + 4, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(Low, Zero)), Max));
+					_mm_storeu_ps(Values + i + 8, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(High, Zero)), Max));
+					_mm_storeu_ps(Values + i + 12, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(High, Zero)), Max));
+				}
+#			endif
+			for(; i < Count; ++i)
+				Values[i] = Tables.Unorm8[Data[i]];
+			break;
+		}
+		case CONVERT_TYPE_SRGB8:
+		{
+			// Alpha, the fourth channel, isn't sRGB encoded
+			std::uint8_t const * Data = static_cast<std::uint8_t const *>(Source);
+			if(Layout.Channels == 4)
+			{
+				for(; i < Count; i += 4)
+				{
+					Values[i + 0] = Tables.Srgb8[Data[i + 0]];
+					Values[i + 1] = Tables.Srgb8[Data[i + 1]];
+					Values[i + 2] = Tables.Srgb8[Data[i + 2]];
+					Values[i + 3] = Tables.Unorm8[Data[i + 3]];
+				}
+			}
+			else
+			{
+				for(; i < Count; ++i)
+					Values[i] = Tables.Srgb8[Data[i]];
+			}
+			break;
+		}
+		case CONVERT_TYPE_SFLOAT16:
+		{
+			std::uint16_t const * Data = static_cast<std::uint16_t const *>(Source);
+#			if GLI_KERNEL_SSE2
+				__m128i const Zero = _mm_setzero_si128();
+				for(; i + 8 <= Count; i += 8)
+				{
+					__m128i const Halves = _mm_loadu_si128(reinterpret_cast<__m128i const *>(Data + i));
+					_mm_storeu_ps(Values + i + 0, convert_half_to_float(_mm_unpacklo_epi16(Halves, Zero)));
+					_mm_storeu_ps(Values + i + 4, convert_half_to_float(_mm_unpackhi_epi16(Halves, Zero)));
+				}
+#			endif
+			for(; i < Count; ++i)
+				Values[i] = convert_half_to_float(Data[i]);
+			break;
+		}
+		case CONVERT_TYPE_SFLOAT32:
+			std::memcpy(Values, Source, Count * sizeof(float));
+			break;
+		default:
+			GLI_ASSERT(0);
+			break;
+		}
+	}
+
+	// Count floats, in memory order, to values of a row
+	inline void convert_encode(convert_layout const & Layout, float const * Values, std::size_t Count, void * Destination)
+	{
+		kernel_tables const & Tables = get_kernel_tables();
+
+		std::size_t i = 0;
+		switch(Layout.Type)
+		{
+		case CONVERT_TYPE_UNORM8:
+		{
+			std::uint8_t * Data = static_cast<std::uint8_t *>(Destination);
+#			if GLI_KERNEL_SSE2
+				__m128 const Zero = _mm_setzero_ps();
+				__m128 const One = _mm_set1_ps(1.f);
+				__m128 const Max = _mm_set1_ps(255.f);
+				__m128 const Half = _mm_set1_ps(0.5f);
+				for(; i + 16 <= Count; i += 16)
+				{
+					__m128i Codes[4];
+					for(int j = 0; j < 4; ++j)
+					{
+						__m128 const Value = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(Values + i + j * 4), Zero), One);
+						Codes[j] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(Value, Max), Half));
+					}
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(Data + i), _mm_packus_epi16(_mm_packs_epi32(Codes[0], Codes[1]), _mm_packs_epi32(Codes[2], Codes[3])));
+				}
+#			endif
+			for(; i < Count; ++i)
+				Data[i] = static_cast<std::uint8_t>(glm::clamp(Values[i], 0.f, 1.f) * 255.f + 0.5f);
+			break;
+		}
+		case CONVERT_TYPE_SRGB8:
+		{
+			std::uint8_t * Data = static_cast<std::uint8_t *>(Destination);
+			for(; i < Count; ++i)
+			{
+				if(Layout.Channels == 4 && i % 4 == 3)
+					Data[i] = static_cast<std::uint8_t>(glm::clamp(Values[i], 0.f, 1.f) * 255.f + 0.5f);
+				else
+					Data[i] = Tables.to_srgb8(Values[i]);
+			}
+			break;
+		}
+		case CONVERT_TYPE_SFLOAT16:
+		{
+			std::uint16_t * Data = static_cast<std::uint16_t *>(Destination);
+#			if GLI_KERNEL_SSE2
+				for(; i + 8 <= Count; i += 8)
+				{
+					__m128i const Low = convert_float_to_half(_mm_loadu_ps(Values + i + 0));
+					__m128i const High = convert_float_to_half(_mm_loadu_ps(Values + i + 4));
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(Data + i), convert_pack_halves(Low, High));
+				}
+#			endif
+			for(; i < Count; ++i)
+				Data[i] = convert_float_to_half(Values[i]);
+			break;
+		}
+		case CONVERT_TYPE_SFLOAT32:
+			std::memcpy(Destination, Values, Count * sizeof(float));
+			break;
+		default:
+			GLI_ASSERT(0);
+			break;
+		}
+	}
+
+	template <int DestinationChannels>
+	inline void convert_bytes(convert_map const & Map, int SourceChannels, std::uint8_t const * Source, std::uint8_t * Destination, std::size_t Texels)
+	{
+		std::size_t Texel = 0;
+
+#		if GLI_CONVERT_SSSE3
+			if(SourceChannels == 4 && DestinationChannels >= 3)
+			{
+				// Four texels per shuffle, the bytes it zeroes get the constants
+				std::int8_t Shuffle[16];
+				std::uint8_t Constant[16];
+				for(int Byte = 0; Byte < 16; ++Byte)
+				{
+					int const Index = Byte / DestinationChannels;
+					int const Select = Map.Source[Byte % DestinationChannels];
+					Shuffle[Byte] = Index < 4 && Select < 4 ? static_cast<std::int8_t>(Index * 4 + Select) : static_cast<std::int8_t>(-128);
+					Constant[Byte] = Index < 4 && Select == CONVERT_ONE ? 0xff : 0x00;
+				}
+
+				__m128i const ShuffleMask = _mm_loadu_si128(reinterpret_cast<__m128i const *>(Shuffle));
+				__m128i const ConstantMask = _mm_loadu_si128(reinterpret_cast<__m128i const *>(Constant));
+
+				// Sixteen RGB texels fill three vectors out of the twelve bytes of four shuffles
+				if(DestinationChannels == 3)
+				{
+					for(; Texel + 16 <= Texels; Texel += 16)
+					{
+						__m128i const * Input = reinterpret_cast<__m128i const *>(Source + Texel * 4);
+						__m128i * Output = reinterpret_cast<__m128i *>(Destination + Texel * 3);
+
+						__m128i const A = _mm_or_si128(_mm_shuffle_epi8(_mm_loadu_si128(Input + 0), ShuffleMask), ConstantMask);
+						__m128i const B = _mm_or_si128(_mm_shuffle_epi8(_mm_loadu_si128(Input + 1), ShuffleMask), ConstantMask);
+						__m128i const C = _mm_or_si128(_mm_shuffle_epi8(_mm_loadu_si128(Input + 2), ShuffleMask), ConstantMask);
+						__m128i const D = _mm_or_si128(_mm_shuffle_epi8(_mm_loadu_si128(Input + 3), ShuffleMask), ConstantMask);
+
+						_mm_storeu_si128(Output + 0, _mm_or_si128(A, _mm_slli_si128(B, 12)));
+						_mm_storeu_si128(Output + 1, _mm_or_si128(_mm_srli_si128(B, 4), _mm_slli_si128(C, 8)));
+						_mm_storeu_si128(Output + 2, _mm_or_si128(_mm_srli_si128(C, 8), _mm_slli_si128(D, 4)));
+					}
+				}
+
+				for(; Texel + 4 <= Texels; Texel += 4)
+				{
+					__m128i const Bytes = _mm_or_si128(_mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const *>(Source + Texel * 4)), ShuffleMask), ConstantMask);
+					std::uint8_t * Out = Destination + Texel * DestinationChannels;
+					if(DestinationChannels == 4)
+						_mm_storeu_si128(reinterpret_cast<__m128i *>(Out), Bytes);
+					else
+					{
+						// Twelve bytes, not a byte past the texels
+						_mm_storel_epi64(reinterpret_cast<__m128i *>(Out), Bytes);
+						std::int32_t const Last = _mm_cvtsi128_si32(_mm_srli_si128(Bytes, 8));
+						std::memcpy(Out + 8, &Last, sizeof(Last));
+					}
+				}
+			}
+#		endif
+
+		// Dropping alpha: constant offsets the compiler vectorizes
+		if(SourceChannels == 4 && DestinationChannels == 3 && Map.Source[0] == 0 && Map.Source[1] == 1 && Map.Source[2] == 2)
+		{
+			for(; Texel < Texels; ++Texel)
+			{
+				Destination[Texel * 3 + 0] = Source[Texel * 4 + 0];
+				Destination[Texel * 3 + 1] = Source[Texel * 4 + 1];
+				Destination[Texel * 3 + 2] = Source[Texel * 4 + 2];
+			}
+			return;
+		}
+
+		for(; Texel < Texels; ++Texel)
+		{
+			std::uint8_t const * In = Source + Texel * SourceChannels;
+			std::uint8_t * Out = Destination + Texel * DestinationChannels;
+			for(int Channel = 0; Channel < DestinationChannels; ++Channel)
+			{
+				int const Select = Map.Source[Channel];
+				Out[Channel] = Select < 4 ? In[Select] : Select == CONVERT_ONE ? 0xff : 0x00;
+			}
+		}
+	}
+
+	// Texels of a contiguous span of rows
+	inline void convert_span
+	(
+		convert_layout const & SourceLayout, convert_layout const & DestinationLayout, convert_map const & Map,
+		std::uint8_t const * Source, std::uint8_t * Destination, std::size_t Texels
+	)
+	{
+		// 8 bits texels of the same encoding only have their bytes moved around
+		if(SourceLayout.Type == DestinationLayout.Type && convert_value_size(SourceLayout.Type) == 1)
+		{
+			if(Map.Identity)
+			{
+				std::memcpy(Destination, Source, Texels * DestinationLayout.Channels);
+				return;
+			}
+
+			switch(DestinationLayout.Channels)
+			{
+			case 1: convert_bytes<1>(Map, SourceLayout.Channels, Source, Destination, Texels); break;
+			case 2: convert_bytes<2>(Map, SourceLayout.Channels, Source, Destination, Texels); break;
+			case 3: convert_bytes<3>(Map, SourceLayout.Channels, Source, Destination, Texels); break;
+			default: convert_bytes<4>(Map, SourceLayout.Channels, Source, Destination, Texels); break;
+			}
+			return;
+		}
+
+		// Other conversions go through floats, by chunks that stay in the L1 cache
+		std::size_t const Chunk = 256;
+		float Decoded[Chunk * 4];
+		float Swizzled[Chunk * 4];
+
+		std::size_t const SourceTexelSize = SourceLayout.Channels * convert_value_size(SourceLayout.Type);
+		std::size_t const DestinationTexelSize = DestinationLayout.Channels * convert_value_size(DestinationLayout.Type);
+
+		for(std::size_t Begin = 0; Begin < Texels; Begin += Chunk)
+		{
+			std::size_t const Count = std::min(Chunk, Texels - Begin);
+
+			convert_decode(SourceLayout, Source + Begin * SourceTexelSize, Count * SourceLayout.Channels, Decoded);
+
+			float const * Values = Decoded;
+			if(!Map.Identity)
+			{
+				float const Constants[2] = {0.f, 1.f};
+				for(std::size_t Texel = 0; Texel < Count; ++Texel)
+				for(int Channel = 0; Channel < DestinationLayout.Channels; ++Channel)
+				{
+					int const Select = Map.Source[Channel];
+					Swizzled[Texel * DestinationLayout.Channels + Channel] = Select < 4 ? Decoded[Texel * SourceLayout.Channels + Select] : Constants[Select - CONVERT_ZERO];
+				}
+				Values = Swizzled;
+			}
+
+			convert_encode(DestinationLayout, Values, Count * DestinationLayout.Channels, Destination + Begin * DestinationTexelSize);
+		}
+	}
+
+	inline void convert_texels
+	(
+		convert_layout const & SourceLayout, convert_layout const & DestinationLayout, convert_map const & Map,
+		void const * Source, void * Destination, texture::texelcoord_type const & Dimensions
+	)
+	{
+		std::size_t const Width = static_cast<std::size_t>(Dimensions.x);
+		std::size_t const Rows = static_cast<std::size_t>(Dimensions.y) * static_cast<std::size_t>(Dimensions.z);
+		std::size_t const SourceRowSize = Width * SourceLayout.Channels * convert_value_size(SourceLayout.Type);
+		std::size_t const DestinationRowSize = Width * DestinationLayout.Channels * convert_value_size(DestinationLayout.Type);
+
+		// Rows of at least 64K texels per thread, it isn't worth starting one for less
+		kernel_parallel(Rows, std::max<std::size_t>(65536 / std::max<std::size_t>(Width, 1), 1), [&](std::size_t Begin, std::size_t End)
+		{
+			convert_span(SourceLayout, DestinationLayout, Map,
+				static_cast<std::uint8_t const *>(Source) + Begin * SourceRowSize,
+				static_cast<std::uint8_t *>(Destination) + Begin * DestinationRowSize,
+				(End - Begin) * Width);
+		});
+	}
+
+	inline texture convert_texture(texture const & Texture, format Format, swizzles const & Swizzles)
+	{
+		typedef texture::size_type size_type;
+
+		if(Texture.empty() || !is_convertible(Texture.format()) || !is_convertible(Format))
+			return texture();
+
+		texture Result(Texture.target(), Format, Texture.dimensions(), Texture.layers(), Texture.faces(), Texture.levels(), default_allocator());
+
+		convert_layout const SourceLayout = get_convert_layout(Texture.format());
+		convert_layout const DestinationLayout = get_convert_layout(Format);
+		convert_map const Map = get_convert_map(SourceLayout, DestinationLayout, Swizzles);
+
+		for(size_type Layer = 0; Layer < Texture.layers(); ++Layer)
+		for(size_type Face = 0; Face < Texture.faces(); ++Face)
+		for(size_type Level = 0; Level < Texture.levels(); ++Level)
+			convert_texels(SourceLayout, DestinationLayout, Map, Texture.data(Layer, Face, Level), Result.data(Layer, Face, Level), Texture.dimensions(Level));
+
+		return Result;
+	}
+}//namespace detail
+
+	inline bool is_convertible(format Format)
+	{
+		return detail::get_convert_layout(Format).Type != detail::CONVERT_TYPE_INVALID;
+	}
+
+	inline bool convert(image const & Source, image Destination, swizzles const & Swizzles)
+	{
+		if(Source.empty() || Destination.empty() || !is_convertible(Source.format()) || !is_convertible(Destination.format()))
+			return false;
+		if(Source.dimensions() != Destination.dimensions())
+			return false;
+
+		detail::convert_layout const SourceLayout = detail::get_convert_layout(Source.format());
+		detail::convert_layout const DestinationLayout = detail::get_convert_layout(Destination.format());
+
+		detail::convert_texels(
+			SourceLayout, DestinationLayout, detail::get_convert_map(SourceLayout, DestinationLayout, Swizzles),
+			Source.data(), Destination.data(), Source.dimensions());
+
+		return true;
+	}
+
+	template <typename texture_type>
+	inline texture_type convert(texture_type const & Texture, format Format, swizzles const & Swizzles)
+	{
+		return texture_type(detail::convert_texture(Texture, Format, Swizzles));
+	}
+}//namespace gli
@@ -46,7 +46,8 @@ namespace detail
 			Texture.dimensions(),
 			Texture.layers(),
 			Texture.faces(),
-			Texture.levels());
+			Texture.levels(),
+			default_allocator());
 
 		detail::copy_images(
 			Texture, Copy,
@@ -68,7 +69,8 @@ namespace detail
 			Texture.texture::dimensions(),
 			Texture.layers(),
 			Texture.faces(),
-			Texture.levels());
+			Texture.levels(),
+			default_allocator());
 
 		detail::copy_images(
 			Texture, Copy,
@@ -92,7 +94,8 @@ namespace detail
 			Texture.dimensions(),
 			Texture.layers(),
 			Texture.faces(),
-			Texture.levels());
+			Texture.levels(),
+			default_allocator());
 
 		detail::copy_images(
 			Texture, Copy,
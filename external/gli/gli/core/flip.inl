@@ -32,7 +32,7 @@ inline texture2D flip(texture2D const & Texture)
 {
 	assert(!gli::is_compressed(Texture.format()));
 
-	texture2D Flip(Texture.format(), Texture.dimensions(), Texture.levels());
+	texture2D Flip(Texture.format(), Texture.dimensions(), Texture.levels(), default_allocator());
 
 	texture2D::size_type const BlockSize = block_size(Texture.format());
 
@@ -47,7 +47,7 @@ inline texture2DArray flip(texture2DArray const & Texture)
 {
 	assert(!gli::is_compressed(Texture.format()));
 
-	texture2DArray Flip(Texture.format(), Texture.dimensions(), Texture.layers(), Texture.levels());
+	texture2DArray Flip(Texture.format(), Texture.dimensions(), Texture.layers(), Texture.levels(), default_allocator());
 
 	texture2DArray::size_type const BlockSize = block_size(Texture.format());
 
@@ -5,6 +5,7 @@
 #include <gli/sampler3d.hpp>
 #include <gli/sampler_cube.hpp>
 #include <gli/sampler_cube_array.hpp>
+#include "mipmaps_kernel.hpp"
 
 namespace gli
 {
@@ -124,4 +125,63 @@ namespace gli
 	{
 		return generate_mipmaps(Texture, Texture.base_layer(), Texture.max_layer(), Texture.base_face(), Texture.max_face(), Texture.base_level(), Texture.max_level(), Minification);
 	}
+
+	inline texture2D generate_mipmaps(
+		texture2D const & Texture,
+		texture2D::size_type BaseLevel, texture2D::size_type MaxLevel,
+		kernel Kernel)
+	{
+		if(detail::get_kernel_format(Texture.format()) == detail::KERNEL_FORMAT_INVALID)
+			return generate_mipmaps(Texture, BaseLevel, MaxLevel, FILTER_LINEAR);
+
+		texture2D Result(Texture);
+		detail::generate_mipmaps_kernel(Result, 0, 0, 0, 0, BaseLevel, MaxLevel, Kernel == KERNEL_KAISER);
+		return Result;
+	}
+
+	inline texture2DArray generate_mipmaps(
+		texture2DArray const & Texture,
+		texture2DArray::size_type BaseLayer, texture2DArray::size_type MaxLayer,
+		texture2DArray::size_type BaseLevel, texture2DArray::size_type MaxLevel,
+		kernel Kernel)
+	{
+		if(detail::get_kernel_format(Texture.format()) == detail::KERNEL_FORMAT_INVALID)
+			return generate_mipmaps(Texture, BaseLayer, MaxLayer, BaseLevel, MaxLevel, FILTER_LINEAR);
+
+		texture2DArray Result(Texture);
+		detail::generate_mipmaps_kernel(Result, BaseLayer, MaxLayer, 0, 0, BaseLevel, MaxLevel, Kernel == KERNEL_KAISER);
+		return Result;
+	}
+
+	inline textureCube generate_mipmaps(
+		textureCube const & Texture,
+		textureCube::size_type BaseFace, textureCube::size_type MaxFace,
+		textureCube::size_type BaseLevel, textureCube::size_type MaxLevel,
+		kernel Kernel)
+	{
+		if(detail::get_kernel_format(Texture.format()) == detail::KERNEL_FORMAT_INVALID)
+			return generate_mipmaps(Texture, BaseFace, MaxFace, BaseLevel, MaxLevel, FILTER_LINEAR);
+
+		textureCube Result(Texture);
+		detail::generate_mipmaps_kernel(Result, 0, 0, BaseFace, MaxFace, BaseLevel, MaxLevel, Kernel == KERNEL_KAISER);
+		return Result;
+	}
+
+	template <>
+	inline texture2D generate_mipmaps<texture2D>(texture2D const & Texture, kernel Kernel)
+	{
+		return generate_mipmaps(Texture, Texture.base_level(), Texture.max_level(), Kernel);
+	}
+
+	template <>
+	inline texture2DArray generate_mipmaps<texture2DArray>(texture2DArray const & Texture, kernel Kernel)
+	{
+		return generate_mipmaps(Texture, Texture.base_layer(), Texture.max_layer(), Texture.base_level(), Texture.max_level(), Kernel);
+	}
+
+	template <>
+	inline textureCube generate_mipmaps<textureCube>(textureCube const & Texture, kernel Kernel)
+	{
+		return generate_mipmaps(Texture, Texture.base_face(), Texture.max_face(), Texture.base_level(), Texture.max_level(), Kernel);
+	}
 }//namespace gli
@@ -5,20 +5,20 @@
 namespace gli
 {
 	/// Load a texture (DDS, KTX or KMG) from memory
-	inline texture load(char const * Data, std::size_t Size)
+	inline texture load(char const * Data, std::size_t Size, allocator & Allocator)
 	{
 		{
-			texture Texture = load_dds(Data, Size);
+			texture Texture = load_dds(Data, Size, Allocator);
 			if(!Texture.empty())
 				return Texture;
 		}
 		{
-			texture Texture = load_kmg(Data, Size);
+			texture Texture = load_kmg(Data, Size, Allocator);
 			if(!Texture.empty())
 				return Texture;
 		}
 		{
-			texture Texture = load_ktx(Data, Size);
+			texture Texture = load_ktx(Data, Size, Allocator);
 			if(!Texture.empty())
 				return Texture;
 		}
@@ -29,21 +29,12 @@ namespace gli
 	/// Load a texture (DDS, KTX or KMG) from file
 	inline texture load(char const * Filename)
 	{
-		FILE* File = std::fopen(Filename, "rb");
-		if(!File)
+		std::size_t Size = 0;
+		std::shared_ptr<char> const Mapping(detail::map_file(Filename, Size));
+		if(!Mapping)
 			return texture();
 
-		long Beg = std::ftell(File);
-		std::fseek(File, 0, SEEK_END);
-		long End = std::ftell(File);
-		std::fseek(File, 0, SEEK_SET);
-
-		std::vector<char> Data(static_cast<std::size_t>(End - Beg));
-
-		std::fread(&Data[0], 1, Data.size(), File);
-		std::fclose(File);
-
-		return load(&Data[0], Data.size());
+		return load(Mapping.get(), Size);
 	}
 
 	/// Load a texture (DDS, KTX or KMG) from file
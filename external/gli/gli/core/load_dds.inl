@@ -1,4 +1,5 @@
 #include "../dx.hpp"
+#include "mapping.hpp"
 #include <cstdio>
 #include <cassert>
 
@@ -141,22 +142,60 @@ namespace detail
 	}
 }//namespace detail
 
-	inline texture load_dds(char const * Data, std::size_t Size)
+	inline std::size_t dds_layout::level_size(texture::size_type Level) const
 	{
-		assert(Data && (Size >= sizeof(detail::FOURCC_DDS)));
+		GLI_ASSERT(Level < this->Levels);
 
-		if(strncmp(Data, detail::FOURCC_DDS, 4) != 0)
-			return texture();
-		std::size_t Offset = sizeof(detail::FOURCC_DDS);
+		texture::texelcoord_type const BlockDimensions(gli::block_dimensions(this->Format));
+		texture::texelcoord_type const BlockCount(glm::max(this->Dimensions / BlockDimensions, texture::texelcoord_type(1)));
 
-		assert(Size >= sizeof(detail::ddsHeader));
+		// Same rounding as storage::level_size so that the offsets match the ones of a loaded texture
+		return gli::block_size(this->Format) * glm::compMul(glm::max(BlockCount >> texture::texelcoord_type(static_cast<texture::texelcoord_type::value_type>(Level)), texture::texelcoord_type(1)));
+	}
+
+	inline std::size_t dds_layout::offset(texture::size_type Layer, texture::size_type Face, texture::size_type Level) const
+	{
+		GLI_ASSERT(Layer < this->Layers && Face < this->Faces && Level < this->Levels);
+
+		std::size_t FaceSize(0);
+		std::size_t LevelOffset(0);
+		for(texture::size_type LevelIndex = 0; LevelIndex < this->Levels; ++LevelIndex)
+		{
+			if(LevelIndex == Level)
+				LevelOffset = FaceSize;
+			FaceSize += this->level_size(LevelIndex);
+		}
+
+		return this->Offset + (Layer * this->Faces + Face) * FaceSize + LevelOffset;
+	}
 
-		detail::ddsHeader const & Header(*reinterpret_cast<detail::ddsHeader const *>(Data + Offset));
+	inline std::size_t dds_layout::size() const
+	{
+		std::size_t FaceSize(0);
+		for(texture::size_type Level = 0; Level < this->Levels; ++Level)
+			FaceSize += this->level_size(Level);
+
+		return this->Offset + this->Layers * this->Faces * FaceSize;
+	}
+
+	inline bool load_dds_layout(char const * Data, std::size_t Size, dds_layout & Layout)
+	{
+		assert(Data);
+
+		if(Size < sizeof(detail::FOURCC_DDS) + sizeof(detail::ddsHeader) || strncmp(Data, detail::FOURCC_DDS, 4) != 0)
+			return false;
+		std::size_t Offset = sizeof(detail::FOURCC_DDS);
+
+		detail::ddsHeader Header;
+		std::memcpy(&Header, Data + Offset, sizeof(Header));
 		Offset += sizeof(detail::ddsHeader);
 
 		detail::ddsHeader10 Header10;
 		if((Header.Format.flags & dx::DDPF_FOURCC) && (Header.Format.fourCC == dx::D3DFMT_DX10 || Header.Format.fourCC == dx::D3DFMT_GLI1))
 		{
+			if(Size < Offset + sizeof(Header10))
+				return false;
+
 			std::memcpy(&Header10, Data + Offset, sizeof(Header10));
 			Offset += sizeof(detail::ddsHeader10);
 		}
@@ -253,6 +292,8 @@ namespace detail
 			Format = DX.find(Header.Format.fourCC, Header10.Format, Header.Format.flags);
 
 		assert(Format != static_cast<format>(gli::FORMAT_INVALID));
+		if(Format == static_cast<format>(gli::FORMAT_INVALID))
+			return false;
 
 		size_t const MipMapCount = (Header.Flags & detail::DDSD_MIPMAPCOUNT) ? Header.MipMapLevels : 1;
 		size_t FaceCount = 1;
@@ -263,40 +304,71 @@ namespace detail
 		if(Header.CubemapFlags & detail::DDSCAPS2_VOLUME)
 			DepthCount = Header.Depth;
 
-		texture Texture(
-			getTarget(Header, Header10), Format,
-			texture::texelcoord_type(Header.Width, Header.Height, DepthCount),
-			std::max<texture::size_type>(Header10.ArraySize, 1), FaceCount, MipMapCount);
+		Layout.Target = getTarget(Header, Header10);
+		Layout.Format = Format;
+		Layout.Dimensions = texture::texelcoord_type(Header.Width, Header.Height, DepthCount);
+		Layout.Layers = std::max<texture::size_type>(Header10.ArraySize, 1);
+		Layout.Faces = FaceCount;
+		Layout.Levels = std::max<texture::size_type>(MipMapCount, 1);
+		Layout.Offset = Offset;
 
-		std::size_t const SourceSize = Offset + Texture.size();
-		assert(SourceSize == Size);
+		return true;
+	}
 
-		std::memcpy(Texture.data(), Data + Offset, Texture.size());
+	inline texture load_dds(char const * Data, std::size_t Size, allocator & Allocator)
+	{
+		assert(Data && (Size >= sizeof(detail::FOURCC_DDS)));
+
+		dds_layout Layout;
+		if(!load_dds_layout(Data, Size, Layout))
+			return texture();
+
+		texture Texture(Layout.Target, Layout.Format, Layout.Dimensions, Layout.Layers, Layout.Faces, Layout.Levels, Allocator);
+
+		// A truncated container would be read past its end, which is the end of the mapping for files
+		if(Layout.Offset + Texture.size() > Size)
+			return texture();
+
+		std::memcpy(Texture.data(), Data + Layout.Offset, Texture.size());
 
 		return Texture;
 	}
 
 	inline texture load_dds(char const * Filename)
 	{
-		FILE* File = std::fopen(Filename, "rb");
-		if(!File)
+		// The texels are copied once, from the mapping to the storage
+		std::size_t Size = 0;
+		std::shared_ptr<char> const Mapping(detail::map_file(Filename, Size));
+		if(!Mapping)
 			return texture();
 
-		long Beg = std::ftell(File);
-		std::fseek(File, 0, SEEK_END);
-		long End = std::ftell(File);
-		std::fseek(File, 0, SEEK_SET);
+		return load_dds(Mapping.get(), Size);
+	}
+
+	inline texture load_dds(std::string const & Filename)
+	{
+		return load_dds(Filename.c_str());
+	}
+
+	inline texture map_dds(char const * Filename)
+	{
+		std::size_t Size = 0;
+		std::shared_ptr<char> const Mapping(detail::map_file(Filename, Size));
+		if(!Mapping)
+			return texture();
 
-		std::vector<char> Data(static_cast<std::size_t>(End - Beg));
+		dds_layout Layout;
+		if(!load_dds_layout(Mapping.get(), Size, Layout) || Layout.size() > Size)
+			return texture();
 
-		std::fread(&Data[0], 1, Data.size(), File);
-		std::fclose(File);
+		// The storage shares the ownership of the whole mapping but points to the texels
+		std::shared_ptr<texture::data_type> const Texels(Mapping, reinterpret_cast<texture::data_type*>(Mapping.get() + Layout.Offset));
 
-		return load_dds(&Data[0], Data.size());
+		return texture(Layout.Target, Layout.Format, Layout.Dimensions, Layout.Layers, Layout.Faces, Layout.Levels, Texels);
 	}
 
-	inline texture load_dds(std::string const & Filename)
+	inline texture map_dds(std::string const & Filename)
 	{
-		return load_dds(Filename.c_str());
+		return map_dds(Filename.c_str());
 	}
 }//namespace gli
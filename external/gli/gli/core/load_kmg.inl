@@ -26,7 +26,7 @@ namespace detail
 		std::uint32_t MaxLevel;
 	};
 
-	inline texture load_kmg100(char const * Data, std::size_t Size)
+	inline texture load_kmg100(char const * Data, std::size_t Size, allocator & Allocator)
 	{
 		detail::kmgHeader10 const & Header(*reinterpret_cast<detail::kmgHeader10 const *>(Data));
 
@@ -39,6 +39,7 @@ namespace detail
 			Header.Layers,
 			Header.Faces,
 			Header.Levels,
+			Allocator,
 			texture::swizzles_type(Header.SwizzleRed, Header.SwizzleGreen, Header.SwizzleBlue, Header.SwizzleAlpha));
 
 		for(texture::size_type Layer = 0, Layers = Texture.layers(); Layer < Layers; ++Layer)
@@ -63,14 +64,14 @@ namespace detail
 	}
 }//namespace detail
 
-	inline texture load_kmg(char const * Data, std::size_t Size)
+	inline texture load_kmg(char const * Data, std::size_t Size, allocator & Allocator)
 	{
 		assert(Data && (Size >= sizeof(detail::kmgHeader10)));
 
 		// KMG100
 		{
 			if(memcmp(Data, detail::FOURCC_KMG100, sizeof(detail::FOURCC_KMG100)) == 0)
-				return detail::load_kmg100(Data + sizeof(detail::FOURCC_KMG100), Size - sizeof(detail::FOURCC_KMG100));
+				return detail::load_kmg100(Data + sizeof(detail::FOURCC_KMG100), Size - sizeof(detail::FOURCC_KMG100), Allocator);
 		}
 
 		return texture();
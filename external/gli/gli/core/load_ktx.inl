@@ -49,7 +49,7 @@ namespace detail
 			return TARGET_2D;
 	}
 
-	inline texture load_ktx10(char const * Data, std::size_t Size)
+	inline texture load_ktx10(char const * Data, std::size_t Size, allocator & Allocator)
 	{
 		detail::ktxHeader10 const & Header(*reinterpret_cast<detail::ktxHeader10 const *>(Data));
 
@@ -76,7 +76,8 @@ namespace detail
 				std::max<texture::size_type>(Header.PixelDepth, 1)),
 			std::max<texture::size_type>(Header.NumberOfArrayElements, 1),
 			std::max<texture::size_type>(Header.NumberOfFaces, 1),
-			std::max<texture::size_type>(Header.NumberOfMipmapLevels, 1));
+			std::max<texture::size_type>(Header.NumberOfMipmapLevels, 1),
+			Allocator);
 
 		for(texture::size_type Level = 0, Levels = Texture.levels(); Level < Levels; ++Level)
 		{
@@ -97,14 +98,14 @@ namespace detail
 	}
 }//namespace detail
 
-	inline texture load_ktx(char const * Data, std::size_t Size)
+	inline texture load_ktx(char const * Data, std::size_t Size, allocator & Allocator)
 	{
 		assert(Data && (Size >= sizeof(detail::ktxHeader10)));
 
 		// KTX10
 		{
 			if(memcmp(Data, detail::FOURCC_KTX10, sizeof(detail::FOURCC_KTX10)) == 0)
-				return detail::load_ktx10(Data + sizeof(detail::FOURCC_KTX10), Size - sizeof(detail::FOURCC_KTX10));
+				return detail::load_ktx10(Data + sizeof(detail::FOURCC_KTX10), Size - sizeof(detail::FOURCC_KTX10), Allocator);
 		}
 
 		return texture();
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#if defined(_WIN32)
+#	ifndef NOMINMAX
+#		define NOMINMAX
+#	endif
+#	ifndef WIN32_LEAN_AND_MEAN
+#		define WIN32_LEAN_AND_MEAN
+#	endif
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+namespace gli{
+namespace detail
+{
+	/// Maps a whole file in memory, copy on write: changes to the memory are private to the process and never reach the file.
+	/// The file is unmapped when the last copy of the returned pointer goes away. Returns nullptr in case of failure.
+	///
+	/// @param Filename Path of the file to map
+	/// @param Size Size of the file in bytes, once mapped
+	inline std::shared_ptr<char> map_file(char const * Filename, std::size_t & Size)
+	{
+		Size = 0;
+
+#		if defined(_WIN32)
+			HANDLE File = CreateFileA(Filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if(File == INVALID_HANDLE_VALUE)
+				return nullptr;
+
+			LARGE_INTEGER FileSize;
+			if(!GetFileSizeEx(File, &FileSize) || FileSize.QuadPart == 0)
+			{
+				CloseHandle(File);
+				return nullptr;
+			}
+
+			// The view keeps the mapping alive once both handles are closed
+			HANDLE Mapping = CreateFileMappingA(File, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+			CloseHandle(File);
+			if(!Mapping)
+				return nullptr;
+
+			void* View = MapViewOfFile(Mapping, FILE_MAP_COPY, 0, 0, 0);
+			CloseHandle(Mapping);
+			if(!View)
+				return nullptr;
+
+			Size = static_cast<std::size_t>(FileSize.QuadPart);
+			return std::shared_ptr<char>(static_cast<char*>(View), [](char* View){UnmapViewOfFile(View);});
+#		else
+			int const File = open(Filename, O_RDONLY);
+			if(File < 0)
+				return nullptr;
+
+			struct stat Stat;
+			if(fstat(File, &Stat) != 0 || Stat.st_size <= 0)
+			{
+				close(File);
+				return nullptr;
+			}
+
+			std::size_t const MappedSize = static_cast<std::size_t>(Stat.st_size);
+
+			// The mapping outlives the file descriptor
+			void* View = mmap(nullptr, MappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, File, 0);
+			close(File);
+			if(View == MAP_FAILED)
+				return nullptr;
+
+			Size = MappedSize;
+			return std::shared_ptr<char>(static_cast<char*>(View), [MappedSize](char* View){munmap(View, MappedSize);});
+#		endif
+	}
+}//namespace detail
+}//namespace gli
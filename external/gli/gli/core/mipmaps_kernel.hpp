@@ -0,0 +1,566 @@
+#pragma once
+
+#include "../texture.hpp"
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define GLI_KERNEL_SSE2 1
+#	include <emmintrin.h>
+#else
+#	define GLI_KERNEL_SSE2 0
+#endif
+
+namespace gli{
+namespace detail
+{
+	// One texel of four channels in the linear space the kernels filter in
+#	if GLI_KERNEL_SSE2
+		typedef __m128 kernel_texel;
+
+		inline kernel_texel kernel_load(float const * Data){return _mm_loadu_ps(Data);}
+		inline void kernel_store(float * Data, kernel_texel Texel){_mm_storeu_ps(Data, Texel);}
+		inline kernel_texel kernel_zero(){return _mm_setzero_ps();}
+		inline kernel_texel kernel_madd(kernel_texel Sum, float Weight, kernel_texel Texel){return _mm_add_ps(Sum, _mm_mul_ps(_mm_set1_ps(Weight), Texel));}
+#	else
+		struct kernel_texel{float Data[4];};
+
+		inline kernel_texel kernel_load(float const * Data){kernel_texel Texel = {{Data[0], Data[1], Data[2], Data[3]}}; return Texel;}
+		inline void kernel_store(float * Data, kernel_texel Texel){std::copy(Texel.Data, Texel.Data + 4, Data);}
+		inline kernel_texel kernel_zero(){kernel_texel Texel = {{0.f, 0.f, 0.f, 0.f}}; return Texel;}
+		inline kernel_texel kernel_madd(kernel_texel Sum, float Weight, kernel_texel Texel)
+		{
+			for(int i = 0; i < 4; ++i)
+				Sum.Data[i] += Weight * Texel.Data[i];
+			return Sum;
+		}
+#	endif
+
+	enum kernel_format
+	{
+		KERNEL_FORMAT_UNORM8,
+		KERNEL_FORMAT_SRGB8,
+		KERNEL_FORMAT_SFLOAT16,
+		KERNEL_FORMAT_SFLOAT32,
+		KERNEL_FORMAT_INVALID
+	};
+
+	inline kernel_format get_kernel_format(format Format)
+	{
+		// The kernels treat the four channels alike, the order only matters for sRGB alpha which is the last one either way
+		switch(Format)
+		{
+		case FORMAT_RGBA8_UNORM_PACK8:
+		case FORMAT_BGRA8_UNORM_PACK8:
+			return KERNEL_FORMAT_UNORM8;
+		case FORMAT_RGBA8_SRGB_PACK8:
+		case FORMAT_BGRA8_SRGB_PACK8:
+			return KERNEL_FORMAT_SRGB8;
+		case FORMAT_RGBA16_SFLOAT_PACK16:
+			return KERNEL_FORMAT_SFLOAT16;
+		case FORMAT_RGBA32_SFLOAT_PACK32:
+			return KERNEL_FORMAT_SFLOAT32;
+		default:
+			return KERNEL_FORMAT_INVALID;
+		}
+	}
+
+	// Conversion tables, built once
+	struct kernel_tables
+	{
+		float Unorm8[256];			// to [0, 1]
+		float Srgb8[256];			// sRGB code to linear
+		float Srgb8Threshold[255];	// linear value of the sRGB value half way between two codes
+		std::uint8_t Srgb8Start[4097];	// sRGB code of every 1/4096 of the linear range
+		std::vector<float> Half;	// every half float
+
+		kernel_tables()
+			: Half(65536)
+		{
+			for(int Code = 0; Code < 256; ++Code)
+			{
+				Unorm8[Code] = static_cast<float>(Code) / 255.f;
+				Srgb8[Code] = to_linear(static_cast<float>(Code) / 255.f);
+			}
+
+			for(int Code = 0; Code < 255; ++Code)
+				Srgb8Threshold[Code] = to_linear((static_cast<float>(Code) + 0.5f) / 255.f);
+
+			for(int Step = 0; Step <= 4096; ++Step)
+				Srgb8Start[Step] = static_cast<std::uint8_t>(std::upper_bound(Srgb8Threshold, Srgb8Threshold + 255, static_cast<float>(Step) / 4096.f) - Srgb8Threshold);
+
+			for(std::size_t Bits = 0; Bits < Half.size(); ++Bits)
+				Half[Bits] = glm::unpackHalf1x16(static_cast<glm::uint16>(Bits));
+		}
+
+		static float to_linear(float Srgb)
+		{
+			return Srgb <= 0.04045f ? Srgb / 12.92f : std::pow((Srgb + 0.055f) / 1.055f, 2.4f);
+		}
+
+		// Closest sRGB code in sRGB space, exact rounding: the code of the step the value is in is
+		// at most a couple of codes too low where the sRGB curve is the steepest
+		std::uint8_t to_srgb8(float Linear) const
+		{
+			Linear = glm::clamp(Linear, 0.f, 1.f);
+
+			int Code = Srgb8Start[static_cast<int>(Linear * 4096.f)];
+			while(Code < 255 && Linear >= Srgb8Threshold[Code])
+				++Code;
+			return static_cast<std::uint8_t>(Code);
+		}
+	};
+
+	inline kernel_tables const & get_kernel_tables()
+	{
+		static kernel_tables const Tables;
+		return Tables;
+	}
+
+	// Source texels to linear float
+	inline void kernel_read_row(kernel_format Format, void const * Source, std::size_t Count, float * Row)
+	{
+		kernel_tables const & Tables = get_kernel_tables();
+
+		switch(Format)
+		{
+		case KERNEL_FORMAT_UNORM8:
+		{
+			std::uint8_t const * Data = static_cast<std::uint8_t const *>(Source);
+			std::size_t i = 0;
+#			if GLI_KERNEL_SSE2
+				// Four texels per step, dividing like the table does so that both give the same floats
+				__m128i const Zero = _mm_setzero_si128();
+				__m128 const Max = _mm_set1_ps(255.f);
+				for(; i + 16 <= Count * 4; i += 16)
+				{
+					__m128i const Bytes = _mm_loadu_si128(reinterpret_cast<__m128i const *>(Data + i));
+					__m128i const Low = _mm_unpacklo_epi8(Bytes, Zero);
+					__m128i const High = _mm_unpackhi_epi8(Bytes, Zero);
+					_mm_storeu_ps(Row + i + 0, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(Low, Zero)), Max));
+					_mm_storeu_ps(Row + i + 4, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(Low, Zero)), Max));
+					_mm_storeu_ps(Row + i + 8, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(High, Zero)), Max));
+					_mm_storeu_ps(Row + i + 12, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(High, Zero)), Max));
+				}
+#			endif
+			for(; i < Count * 4; ++i)
+				Row[i] = Tables.Unorm8[Data[i]];
+			break;
+		}
+		case KERNEL_FORMAT_SRGB8:
+		{
+			std::uint8_t const * Data = static_cast<std::uint8_t const *>(Source);
+			for(std::size_t i = 0; i < Count * 4; i += 4)
+			{
+				Row[i + 0] = Tables.Srgb8[Data[i + 0]];
+				Row[i + 1] = Tables.Srgb8[Data[i + 1]];
+				Row[i + 2] = Tables.Srgb8[Data[i + 2]];
+				Row[i + 3] = Tables.Unorm8[Data[i + 3]];
+			}
+			break;
+		}
+		case KERNEL_FORMAT_SFLOAT16:
+		{
+			std::uint16_t const * Data = static_cast<std::uint16_t const *>(Source);
+			for(std::size_t i = 0; i < Count * 4; ++i)
+				Row[i] = Tables.Half[Data[i]];
+			break;
+		}
+		case KERNEL_FORMAT_SFLOAT32:
+			std::memcpy(Row, Source, Count * 4 * sizeof(float));
+			break;
+		default:
+			GLI_ASSERT(0);
+			break;
+		}
+	}
+
+	// Linear float to destination texels
+	inline void kernel_write_row(kernel_format Format, float const * Row, std::size_t Count, void * Destination)
+	{
+		kernel_tables const & Tables = get_kernel_tables();
+
+		switch(Format)
+		{
+		case KERNEL_FORMAT_UNORM8:
+		{
+			std::uint8_t * Data = static_cast<std::uint8_t *>(Destination);
+			std::size_t i = 0;
+#			if GLI_KERNEL_SSE2
+				// Four texels per step, rounded by truncating like the scalar conversion
+				__m128 const Zero = _mm_setzero_ps();
+				__m128 const One = _mm_set1_ps(1.f);
+				__m128 const Scale = _mm_set1_ps(255.f);
+				__m128 const Half = _mm_set1_ps(0.5f);
+				for(; i + 16 <= Count * 4; i += 16)
+				{
+					__m128i Codes[4];
+					for(int j = 0; j < 4; ++j)
+					{
+						__m128 const Clamped = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(Row + i + j * 4), Zero), One);
+						Codes[j] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(Clamped, Scale), Half));
+					}
+					__m128i const Bytes = _mm_packus_epi16(_mm_packs_epi32(Codes[0], Codes[1]), _mm_packs_epi32(Codes[2], Codes[3]));
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(Data + i), Bytes);
+				}
+#			endif
+			for(; i < Count * 4; ++i)
+				Data[i] = static_cast<std::uint8_t>(glm::clamp(Row[i], 0.f, 1.f) * 255.f + 0.5f);
+			break;
+		}
+		case KERNEL_FORMAT_SRGB8:
+		{
+			std::uint8_t * Data = static_cast<std::uint8_t *>(Destination);
+			for(std::size_t i = 0; i < Count * 4; i += 4)
+			{
+				Data[i + 0] = Tables.to_srgb8(Row[i + 0]);
+				Data[i + 1] = Tables.to_srgb8(Row[i + 1]);
+				Data[i + 2] = Tables.to_srgb8(Row[i + 2]);
+				Data[i + 3] = static_cast<std::uint8_t>(glm::clamp(Row[i + 3], 0.f, 1.f) * 255.f + 0.5f);
+			}
+			break;
+		}
+		case KERNEL_FORMAT_SFLOAT16:
+		{
+			std::uint16_t * Data = static_cast<std::uint16_t *>(Destination);
+			for(std::size_t i = 0; i < Count * 4; ++i)
+				Data[i] = glm::packHalf1x16(Row[i]);
+			break;
+		}
+		case KERNEL_FORMAT_SFLOAT32:
+			std::memcpy(Destination, Row, Count * 4 * sizeof(float));
+			break;
+		default:
+			GLI_ASSERT(0);
+			break;
+		}
+	}
+
+	// Taps of a kernel halving a level, relative to the first of the two source texels under a destination texel
+	struct kernel_taps
+	{
+		int Offsets[8];
+		float Weights[8];
+		int Count;
+	};
+
+	inline double bessel_i0(double x)
+	{
+		double Sum = 1.0, Term = 1.0;
+		for(int k = 1; k < 32; ++k)
+		{
+			Term *= (x * 0.5 / k) * (x * 0.5 / k);
+			Sum += Term;
+		}
+		return Sum;
+	}
+
+	inline kernel_taps get_kernel_taps(bool Kaiser)
+	{
+		kernel_taps Taps;
+
+		if(!Kaiser)
+		{
+			Taps.Count = 2;
+			Taps.Offsets[0] = 0; Taps.Weights[0] = 0.5f;
+			Taps.Offsets[1] = 1; Taps.Weights[1] = 0.5f;
+			return Taps;
+		}
+
+		// Sinc windowed by a Kaiser window two destination texels wide on each side
+		double const Pi = 3.14159265358979323846;
+		double const Alpha = 4.0;
+		double const Radius = 2.0;
+
+		double Sum = 0.0;
+		double Weights[8];
+		for(int Tap = 0; Tap < 8; ++Tap)
+		{
+			// Distance from the centre of the destination texel, in destination texels
+			double const t = (static_cast<double>(Tap - 3) - 0.5) * 0.5;
+			double const Sinc = std::sin(Pi * t) / (Pi * t);
+			double const x = t / Radius;
+			double const Window = bessel_i0(Alpha * std::sqrt(std::max(0.0, 1.0 - x * x))) / bessel_i0(Alpha);
+
+			Weights[Tap] = Sinc * Window;
+			Sum += Weights[Tap];
+		}
+
+		Taps.Count = 8;
+		for(int Tap = 0; Tap < 8; ++Tap)
+		{
+			Taps.Offsets[Tap] = Tap - 3;
+			Taps.Weights[Tap] = static_cast<float>(Weights[Tap] / Sum);
+		}
+
+		return Taps;
+	}
+
+	// Chunks of at least Grain items [0, Count) is split in, at most one per hardware thread
+	inline std::size_t kernel_chunks(std::size_t Count, std::size_t Grain)
+	{
+		std::size_t const Hardware = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+		return std::min(Hardware, std::max<std::size_t>(Count / std::max<std::size_t>(Grain, 1), 1));
+	}
+
+	// Threads started once for all the levels of a generation, each level is a dispatch the calling thread waits the end of
+	class kernel_workers
+	{
+	public:
+		explicit kernel_workers(std::size_t Count)
+			: Generation(0)
+			, Pending(0)
+			, Items(0)
+			, Chunks(0)
+			, Task(nullptr)
+			, Stop(false)
+		{
+			for(std::size_t Worker = 1; Worker <= Count; ++Worker)
+				this->Threads.push_back(std::thread([this, Worker]{this->work(Worker);}));
+		}
+
+		~kernel_workers()
+		{
+			{
+				std::lock_guard<std::mutex> Lock(this->Mutex);
+				this->Stop = true;
+			}
+			this->Started.notify_all();
+
+			for(std::size_t i = 0; i < this->Threads.size(); ++i)
+				this->Threads[i].join();
+		}
+
+		// Run Function(Begin, End) over [0, Count) in ChunkCount chunks, the calling thread takes the first one.
+		// A single chunk runs inline without waking the workers.
+		template <typename task_type>
+		void run(std::size_t Count, std::size_t ChunkCount, task_type const & Function)
+		{
+			ChunkCount = std::min(ChunkCount, this->Threads.size() + 1);
+			if(ChunkCount <= 1)
+			{
+				Function(0, Count);
+				return;
+			}
+
+			std::function<void(std::size_t, std::size_t)> const Wrapped(Function);
+			{
+				std::lock_guard<std::mutex> Lock(this->Mutex);
+				this->Items = Count;
+				this->Chunks = ChunkCount;
+				this->Task = &Wrapped;
+				this->Pending = ChunkCount - 1;
+				++this->Generation;
+			}
+			this->Started.notify_all();
+
+			Function(0, Count / ChunkCount);
+
+			std::unique_lock<std::mutex> Lock(this->Mutex);
+			this->Done.wait(Lock, [this]{return this->Pending == 0;});
+			this->Task = nullptr;
+		}
+
+	private:
+		kernel_workers(kernel_workers const &);
+		kernel_workers & operator=(kernel_workers const &);
+
+		void work(std::size_t Worker)
+		{
+			std::size_t Seen = 0;
+			std::unique_lock<std::mutex> Lock(this->Mutex);
+			for(;;)
+			{
+				this->Started.wait(Lock, [&]{return this->Stop || this->Generation != Seen;});
+				if(this->Stop)
+					return;
+
+				// Workers past the chunks of a dispatch sit it out, the caller doesn't wait for them
+				Seen = this->Generation;
+				if(Worker >= this->Chunks)
+					continue;
+
+				std::size_t const Begin = this->Items * Worker / this->Chunks;
+				std::size_t const End = this->Items * (Worker + 1) / this->Chunks;
+				std::function<void(std::size_t, std::size_t)> const & Function = *this->Task;
+
+				Lock.unlock();
+				Function(Begin, End);
+				Lock.lock();
+
+				if(--this->Pending == 0)
+					this->Done.notify_one();
+			}
+		}
+
+		std::vector<std::thread> Threads;
+		std::mutex Mutex;
+		std::condition_variable Started;
+		std::condition_variable Done;
+		std::size_t Generation;
+		std::size_t Pending;
+		std::size_t Items;
+		std::size_t Chunks;
+		std::function<void(std::size_t, std::size_t)> const * Task;
+		bool Stop;
+	};
+
+	// Run Task(Begin, End) over [0, Count) split in chunks of at least Grain items, for work dispatched once
+	template <typename task_type>
+	inline void kernel_parallel(std::size_t Count, std::size_t Grain, task_type const & Task)
+	{
+		std::size_t const Chunks = kernel_chunks(Count, Grain);
+
+		kernel_workers Workers(Chunks - 1);
+		Workers.run(Count, Chunks, Task);
+	}
+
+	// Destination rows [RowBegin, RowEnd) of one face of one layer: rows of the source are filtered horizontally, then columns vertically
+	inline void kernel_downsample_rows
+	(
+		kernel_format Format, kernel_taps const & Taps,
+		void const * Source, texture::texelcoord_type const & SourceDimensions,
+		void * Destination, texture::texelcoord_type const & DestinationDimensions,
+		int RowBegin, int RowEnd
+	)
+	{
+		std::size_t const TexelSize = Format == KERNEL_FORMAT_SFLOAT32 ? 16 : Format == KERNEL_FORMAT_SFLOAT16 ? 8 : 4;
+		int const SourceWidth = SourceDimensions.x, SourceHeight = SourceDimensions.y;
+		int const Width = DestinationDimensions.x;
+
+		int const FirstRow = glm::clamp(RowBegin * 2 + Taps.Offsets[0], 0, SourceHeight - 1);
+		int const LastRow = glm::clamp((RowEnd - 1) * 2 + Taps.Offsets[Taps.Count - 1], 0, SourceHeight - 1);
+
+		// Source texel of every tap of every destination column, clamped to the edge
+		std::vector<int> Columns(Width * Taps.Count);
+		for(int x = 0; x < Width; ++x)
+		for(int Tap = 0; Tap < Taps.Count; ++Tap)
+			Columns[x * Taps.Count + Tap] = glm::clamp(x * 2 + Taps.Offsets[Tap], 0, SourceWidth - 1) * 4;
+
+		std::vector<float> Row(SourceWidth * 4);
+		std::vector<float> Filtered((LastRow - FirstRow + 1) * Width * 4);
+
+		for(int y = FirstRow; y <= LastRow; ++y)
+		{
+			kernel_read_row(Format, static_cast<std::uint8_t const *>(Source) + static_cast<std::size_t>(y) * SourceWidth * TexelSize, SourceWidth, &Row[0]);
+
+			float * Output = &Filtered[(y - FirstRow) * Width * 4];
+			for(int x = 0; x < Width; ++x)
+			{
+				int const * Column = &Columns[x * Taps.Count];
+
+				kernel_texel Sum = kernel_zero();
+				for(int Tap = 0; Tap < Taps.Count; ++Tap)
+					Sum = kernel_madd(Sum, Taps.Weights[Tap], kernel_load(&Row[Column[Tap]]));
+				kernel_store(Output + x * 4, Sum);
+			}
+		}
+
+		std::vector<float> Result(Width * 4);
+		float const * Rows[8];
+
+		for(int y = RowBegin; y < RowEnd; ++y)
+		{
+			for(int Tap = 0; Tap < Taps.Count; ++Tap)
+				Rows[Tap] = &Filtered[(glm::clamp(y * 2 + Taps.Offsets[Tap], 0, SourceHeight - 1) - FirstRow) * Width * 4];
+
+			for(int i = 0; i < Width * 4; i += 4)
+			{
+				kernel_texel Sum = kernel_zero();
+				for(int Tap = 0; Tap < Taps.Count; ++Tap)
+					Sum = kernel_madd(Sum, Taps.Weights[Tap], kernel_load(Rows[Tap] + i));
+				kernel_store(&Result[i], Sum);
+			}
+
+			kernel_write_row(Format, &Result[0], Width, static_cast<std::uint8_t *>(Destination) + static_cast<std::size_t>(y) * Width * TexelSize);
+		}
+	}
+
+	// Each level is generated from the previous one, the rows of all the layers and faces of a level are spread over
+	// threads started once for the whole chain. Levels too small to be split run on the calling thread alone.
+	inline void generate_mipmaps_kernel
+	(
+		texture & Texture,
+		texture::size_type BaseLayer, texture::size_type MaxLayer,
+		texture::size_type BaseFace, texture::size_type MaxFace,
+		texture::size_type BaseLevel, texture::size_type MaxLevel,
+		bool Kaiser
+	)
+	{
+		typedef texture::size_type size_type;
+
+		kernel_format const Format = get_kernel_format(Texture.format());
+		GLI_ASSERT(Format != KERNEL_FORMAT_INVALID);
+
+		kernel_taps const Taps = get_kernel_taps(Kaiser);
+		get_kernel_tables();
+
+		size_type const Layers = MaxLayer - BaseLayer + 1;
+		size_type const Faces = MaxFace - BaseFace + 1;
+
+		// Enough destination texels per task to be worth a thread
+		std::size_t const TexelsPerTask = 1 << 16;
+
+		struct level_plan
+		{
+			std::size_t RowsPerTile;
+			std::size_t Tiles;
+			std::size_t Chunks;
+		};
+
+		std::vector<level_plan> Plans;
+		std::size_t MaxChunks = 1;
+		for(size_type Level = BaseLevel; Level < MaxLevel; ++Level)
+		{
+			texture::texelcoord_type const DestinationDimensions(Texture.dimensions(Level + 1));
+
+			level_plan Plan;
+			Plan.RowsPerTile = std::max<std::size_t>(TexelsPerTask / DestinationDimensions.x, 1);
+			Plan.Tiles = (DestinationDimensions.y + Plan.RowsPerTile - 1) / Plan.RowsPerTile;
+
+			// Small levels are a tile each, several of their faces and layers go to the same thread
+			std::size_t const TileTexels = std::min<std::size_t>(Plan.RowsPerTile, DestinationDimensions.y) * DestinationDimensions.x;
+			Plan.Chunks = kernel_chunks(Layers * Faces * Plan.Tiles, std::max<std::size_t>(TexelsPerTask / TileTexels, 1));
+
+			MaxChunks = std::max(MaxChunks, Plan.Chunks);
+			Plans.push_back(Plan);
+		}
+
+		kernel_workers Workers(MaxChunks - 1);
+
+		for(size_type Level = BaseLevel; Level < MaxLevel; ++Level)
+		{
+			texture::texelcoord_type const SourceDimensions(Texture.dimensions(Level));
+			texture::texelcoord_type const DestinationDimensions(Texture.dimensions(Level + 1));
+
+			std::size_t const RowsPerTile = Plans[Level - BaseLevel].RowsPerTile;
+			std::size_t const Tiles = Plans[Level - BaseLevel].Tiles;
+
+			Workers.run(Layers * Faces * Tiles, Plans[Level - BaseLevel].Chunks, [&](std::size_t Begin, std::size_t End)
+			{
+				for(std::size_t Job = Begin; Job < End; ++Job)
+				{
+					size_type const Layer = BaseLayer + Job / (Faces * Tiles);
+					size_type const Face = BaseFace + (Job / Tiles) % Faces;
+					int const RowBegin = static_cast<int>((Job % Tiles) * RowsPerTile);
+					int const RowEnd = std::min(RowBegin + static_cast<int>(RowsPerTile), DestinationDimensions.y);
+
+					kernel_downsample_rows(Format, Taps,
+						Texture.data(Layer, Face, Level), SourceDimensions,
+						Texture.data(Layer, Face, Level + 1), DestinationDimensions,
+						RowBegin, RowEnd);
+				}
+			});
+		}
+	}
+}//namespace detail
+}//namespace gli
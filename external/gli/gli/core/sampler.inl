@@ -12,6 +12,7 @@ namespace detail
 
 	inline sampler::sampler(wrap Wrap, filter Mip, filter Min)
 		: Wrap(getFunc(Wrap))
+		, WrapMode(Wrap)
 		, Mip(Mip)
 		, Min(Min)
 	{}
@@ -60,6 +60,26 @@ namespace gli
 		return this->Filter(this->Texture, this->Convert.Fetch, SampleCoordWrap, size_type(0), size_type(0), Level, this->BorderColor);
 	}
 
+	template <typename T, precision P>
+	inline void sampler2D<T, P>::texture_lod(samplecoord_type const * SampleCoords, level_type const * Levels, size_type Count, T * Red, T * Green, T * Blue, T * Alpha) const
+	{
+		GLI_ASSERT(!this->Texture.empty());
+		GLI_ASSERT(std::numeric_limits<T>::is_iec559);
+		GLI_ASSERT(SampleCoords && Red && Green && Blue && Alpha);
+
+		if(detail::sample_batch<T>::call(this->Texture, this->WrapMode, this->Mip, this->Min, SampleCoords, Levels, Count, Red, Green, Blue, Alpha))
+			return;
+
+		for(size_type Sample = 0; Sample < Count; ++Sample)
+		{
+			texel_type const Texel = this->texture_lod(SampleCoords[Sample], Levels ? Levels[Sample] : level_type(0));
+			Red[Sample] = Texel.x;
+			Green[Sample] = Texel.y;
+			Blue[Sample] = Texel.z;
+			Alpha[Sample] = Texel.w;
+		}
+	}
+
 	template <typename T, precision P>
 	inline void sampler2D<T, P>::generate_mipmaps(filter Minification)
 	{
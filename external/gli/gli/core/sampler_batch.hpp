@@ -0,0 +1,375 @@
+#pragma once
+
+#include "mipmaps_kernel.hpp"
+#include "../sampler.hpp"
+#include "../texture2d.hpp"
+#include <glm/gtc/color_space.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace gli{
+namespace detail
+{
+	// How the batch path reads the texels of a format, in the order they are stored as texture_lod fetches them
+	enum batch_format
+	{
+		BATCH_FORMAT_UNORM8,
+		BATCH_FORMAT_SRGB8,
+		BATCH_FORMAT_SFLOAT32,
+		BATCH_FORMAT_NONE
+	};
+
+	struct batch_layout
+	{
+		batch_format Format;
+		int Channels;
+	};
+
+	inline batch_layout get_batch_layout(format Format)
+	{
+		switch(Format)
+		{
+		case FORMAT_R8_UNORM_PACK8:
+			return batch_layout{BATCH_FORMAT_UNORM8, 1};
+		case FORMAT_RG8_UNORM_PACK8:
+			return batch_layout{BATCH_FORMAT_UNORM8, 2};
+		case FORMAT_RGBA8_UNORM_PACK8:
+		case FORMAT_BGRA8_UNORM_PACK8:
+			return batch_layout{BATCH_FORMAT_UNORM8, 4};
+		case FORMAT_RGBA8_SRGB_PACK8:
+		case FORMAT_BGRA8_SRGB_PACK8:
+			return batch_layout{BATCH_FORMAT_SRGB8, 4};
+		case FORMAT_R32_SFLOAT_PACK32:
+			return batch_layout{BATCH_FORMAT_SFLOAT32, 1};
+		case FORMAT_RG32_SFLOAT_PACK32:
+			return batch_layout{BATCH_FORMAT_SFLOAT32, 2};
+		case FORMAT_RGBA32_SFLOAT_PACK32:
+			return batch_layout{BATCH_FORMAT_SFLOAT32, 4};
+		default:
+			return batch_layout{BATCH_FORMAT_NONE, 0};
+		}
+	}
+
+	// One level of the sampled texture
+	struct batch_level
+	{
+		std::uint8_t const * Data;
+		std::int32_t Width;
+		float LastS;
+		float LastT;
+	};
+
+#	if GLI_KERNEL_SSE2
+		// The sRGB decoding of the 256 values of a channel, as convertSRGBToLinear gives them
+		struct batch_srgb_table
+		{
+			float Linear[256];
+			float Alpha[256];
+
+			batch_srgb_table()
+			{
+				for(int i = 0; i < 256; ++i)
+				{
+					Linear[i] = convertSRGBToLinear(tvec3<float, defaultp>(static_cast<float>(i) / 255.f)).x;
+					Alpha[i] = static_cast<float>(i) / 255.f;
+				}
+			}
+		};
+
+		inline batch_srgb_table const & get_batch_srgb_table()
+		{
+			static batch_srgb_table const Table;
+			return Table;
+		}
+
+		template <batch_format Format, int Channels>
+		struct batch_fetch
+		{};
+
+		template <int Channels>
+		struct batch_fetch<BATCH_FORMAT_UNORM8, Channels>
+		{
+			// missing channels are zero and alpha is one, as make_vec4 completes them
+			static __m128 call(std::uint8_t const * Texel)
+			{
+				std::uint32_t Packed;
+				if(Channels == 4)
+					std::memcpy(&Packed, Texel, sizeof(Packed));
+				else
+					Packed = 0xFF000000u | Texel[0] | (Channels > 1 ? static_cast<std::uint32_t>(Texel[1]) << 8 : 0u);
+
+				__m128i const Zero = _mm_setzero_si128();
+				__m128i const Bytes = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int>(Packed)), Zero), Zero);
+				return _mm_div_ps(_mm_cvtepi32_ps(Bytes), _mm_set1_ps(255.f));
+			}
+		};
+
+		template <int Channels>
+		struct batch_fetch<BATCH_FORMAT_SRGB8, Channels>
+		{
+			static __m128 call(std::uint8_t const * Texel)
+			{
+				batch_srgb_table const & Table = get_batch_srgb_table();
+				return _mm_set_ps(Table.Alpha[Texel[3]], Table.Linear[Texel[2]], Table.Linear[Texel[1]], Table.Linear[Texel[0]]);
+			}
+		};
+
+		template <int Channels>
+		struct batch_fetch<BATCH_FORMAT_SFLOAT32, Channels>
+		{
+			static __m128 call(std::uint8_t const * Texel)
+			{
+				float const * Data = reinterpret_cast<float const *>(Texel);
+				if(Channels == 4)
+					return _mm_loadu_ps(Data);
+				return _mm_set_ps(1.f, 0.f, Channels > 1 ? Data[1] : 0.f, Data[0]);
+			}
+		};
+
+		inline __m128 batch_select(__m128 Mask, __m128 A, __m128 B)
+		{
+			return _mm_or_ps(_mm_and_ps(Mask, A), _mm_andnot_ps(Mask, B));
+		}
+
+		// floor of coordinates within the range of int32
+		inline __m128 batch_floor(__m128 Value)
+		{
+			__m128 const Truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(Value));
+			return _mm_sub_ps(Truncated, _mm_and_ps(_mm_cmpgt_ps(Truncated, Value), _mm_set1_ps(1.f)));
+		}
+
+		// round half away from zero, as round does, of positive values
+		inline __m128 batch_round(__m128 Value)
+		{
+			__m128 const Truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(Value));
+			return _mm_add_ps(Truncated, _mm_and_ps(_mm_cmpge_ps(_mm_sub_ps(Value, Truncated), _mm_set1_ps(0.5f)), _mm_set1_ps(1.f)));
+		}
+
+		inline __m128 batch_lerp(__m128 A, __m128 B, __m128 Blend)
+		{
+			return _mm_add_ps(A, _mm_mul_ps(Blend, _mm_sub_ps(B, A)));
+		}
+
+		// The channels of four texels, one register per channel holding the four of them
+		struct batch_texels
+		{
+			__m128 Channel[4];
+		};
+
+		template <typename fetch>
+		inline batch_texels batch_gather(batch_level const * const (&Levels)[4], std::int32_t const (&X)[4], std::int32_t const (&Y)[4], std::size_t TexelSize)
+		{
+			batch_texels Texels;
+			for(int Lane = 0; Lane < 4; ++Lane)
+				Texels.Channel[Lane] = fetch::call(Levels[Lane]->Data + (static_cast<std::size_t>(Y[Lane]) * Levels[Lane]->Width + X[Lane]) * TexelSize);
+
+			_MM_TRANSPOSE4_PS(Texels.Channel[0], Texels.Channel[1], Texels.Channel[2], Texels.Channel[3]);
+			return Texels;
+		}
+
+		// Sample four wrapped coordinates at one level index each
+		template <typename fetch>
+		inline batch_texels batch_sample_level(std::vector<batch_level> const & Levels, std::size_t TexelSize, filter Min, __m128 S, __m128 T, __m128 LevelIndex)
+		{
+			std::int32_t Indices[4];
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(Indices), _mm_cvttps_epi32(LevelIndex));
+
+			batch_level const * const Lanes[4] = {&Levels[Indices[0]], &Levels[Indices[1]], &Levels[Indices[2]], &Levels[Indices[3]]};
+
+			__m128 const ScaledS = _mm_mul_ps(S, _mm_set_ps(Lanes[3]->LastS, Lanes[2]->LastS, Lanes[1]->LastS, Lanes[0]->LastS));
+			__m128 const ScaledT = _mm_mul_ps(T, _mm_set_ps(Lanes[3]->LastT, Lanes[2]->LastT, Lanes[1]->LastT, Lanes[0]->LastT));
+
+			if(Min == FILTER_NEAREST)
+			{
+				std::int32_t X[4], Y[4];
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(X), _mm_cvttps_epi32(batch_round(ScaledS)));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(Y), _mm_cvttps_epi32(batch_round(ScaledT)));
+				return batch_gather<fetch>(Lanes, X, Y, TexelSize);
+			}
+
+			__m128 const One = _mm_set1_ps(1.f);
+			__m128 const FloorS = batch_floor(ScaledS);
+			__m128 const FloorT = batch_floor(ScaledT);
+			__m128 const CeilS = _mm_add_ps(FloorS, _mm_and_ps(_mm_cmpgt_ps(ScaledS, FloorS), One));
+			__m128 const CeilT = _mm_add_ps(FloorT, _mm_and_ps(_mm_cmpgt_ps(ScaledT, FloorT), One));
+			__m128 const BlendS = _mm_sub_ps(ScaledS, FloorS);
+			__m128 const BlendT = _mm_sub_ps(ScaledT, FloorT);
+
+			std::int32_t X0[4], Y0[4], X1[4], Y1[4];
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(X0), _mm_cvttps_epi32(FloorS));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(Y0), _mm_cvttps_epi32(FloorT));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(X1), _mm_cvttps_epi32(CeilS));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(Y1), _mm_cvttps_epi32(CeilT));
+
+			batch_texels const Texels00 = batch_gather<fetch>(Lanes, X0, Y0, TexelSize);
+			batch_texels const Texels10 = batch_gather<fetch>(Lanes, X1, Y0, TexelSize);
+			batch_texels const Texels01 = batch_gather<fetch>(Lanes, X0, Y1, TexelSize);
+			batch_texels const Texels11 = batch_gather<fetch>(Lanes, X1, Y1, TexelSize);
+
+			batch_texels Result;
+			for(int Channel = 0; Channel < 4; ++Channel)
+			{
+				__m128 const ValueA = batch_lerp(Texels00.Channel[Channel], Texels10.Channel[Channel], BlendS);
+				__m128 const ValueB = batch_lerp(Texels01.Channel[Channel], Texels11.Channel[Channel], BlendS);
+				Result.Channel[Channel] = batch_lerp(ValueA, ValueB, BlendT);
+			}
+			return Result;
+		}
+
+		template <typename fetch>
+		inline void batch_sample(
+			std::vector<batch_level> const & Levels, std::size_t TexelSize, bool Repeat, filter Mip, filter Min,
+			float const * SampleCoords, float const * SampleLevels, std::size_t Count,
+			float * Red, float * Green, float * Blue, float * Alpha)
+		{
+			float * const Outputs[4] = {Red, Green, Blue, Alpha};
+			__m128 const MaxLevel = _mm_set1_ps(static_cast<float>(Levels.size() - 1));
+
+			for(std::size_t Sample = 0; Sample < Count; Sample += 4)
+			{
+				std::size_t const Lanes = std::min<std::size_t>(4, Count - Sample);
+
+				// the last samples are padded with the last coordinate when Count isn't a multiple of four
+				float Coords[8];
+				float Lods[4] = {0.f, 0.f, 0.f, 0.f};
+				for(std::size_t Lane = 0; Lane < 4; ++Lane)
+				{
+					std::size_t const Index = Sample + std::min(Lane, Lanes - 1);
+					Coords[Lane * 2 + 0] = SampleCoords[Index * 2 + 0];
+					Coords[Lane * 2 + 1] = SampleCoords[Index * 2 + 1];
+					if(SampleLevels)
+						Lods[Lane] = SampleLevels[Index];
+				}
+
+				__m128 const CoordsA = _mm_loadu_ps(Coords);
+				__m128 const CoordsB = _mm_loadu_ps(Coords + 4);
+				__m128 S = _mm_shuffle_ps(CoordsA, CoordsB, _MM_SHUFFLE(2, 0, 2, 0));
+				__m128 T = _mm_shuffle_ps(CoordsA, CoordsB, _MM_SHUFFLE(3, 1, 3, 1));
+
+				if(Repeat)
+				{
+					S = _mm_sub_ps(S, batch_floor(S));
+					T = _mm_sub_ps(T, batch_floor(T));
+				}
+				else
+				{
+					S = _mm_min_ps(_mm_max_ps(S, _mm_setzero_ps()), _mm_set1_ps(1.f));
+					T = _mm_min_ps(_mm_max_ps(T, _mm_setzero_ps()), _mm_set1_ps(1.f));
+				}
+
+				__m128 const Lod = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(Lods), _mm_setzero_ps()), MaxLevel);
+
+				batch_texels Result;
+				if(Mip == FILTER_NEAREST)
+					Result = batch_sample_level<fetch>(Levels, TexelSize, Min, S, T, batch_round(Lod));
+				else
+				{
+					__m128 const LodFloor = batch_floor(Lod);
+					__m128 const LodBlend = _mm_sub_ps(Lod, LodFloor);
+					__m128 const LodCeil = batch_select(_mm_cmpgt_ps(LodBlend, _mm_setzero_ps()), _mm_add_ps(LodFloor, _mm_set1_ps(1.f)), LodFloor);
+
+					batch_texels const Texels0 = batch_sample_level<fetch>(Levels, TexelSize, Min, S, T, LodFloor);
+					batch_texels const Texels1 = batch_sample_level<fetch>(Levels, TexelSize, Min, S, T, LodCeil);
+					for(int Channel = 0; Channel < 4; ++Channel)
+						Result.Channel[Channel] = batch_lerp(Texels0.Channel[Channel], Texels1.Channel[Channel], LodBlend);
+				}
+
+				for(int Channel = 0; Channel < 4; ++Channel)
+				{
+					if(Lanes == 4)
+						_mm_storeu_ps(Outputs[Channel] + Sample, Result.Channel[Channel]);
+					else
+					{
+						float Values[4];
+						_mm_storeu_ps(Values, Result.Channel[Channel]);
+						std::copy(Values, Values + Lanes, Outputs[Channel] + Sample);
+					}
+				}
+			}
+		}
+
+		template <batch_format Format>
+		inline void batch_sample_format(
+			int Channels, std::vector<batch_level> const & Levels, std::size_t TexelSize, bool Repeat, filter Mip, filter Min,
+			float const * SampleCoords, float const * SampleLevels, std::size_t Count,
+			float * Red, float * Green, float * Blue, float * Alpha)
+		{
+			switch(Channels)
+			{
+			case 1:
+				batch_sample<batch_fetch<Format, 1> >(Levels, TexelSize, Repeat, Mip, Min, SampleCoords, SampleLevels, Count, Red, Green, Blue, Alpha);
+				break;
+			case 2:
+				batch_sample<batch_fetch<Format, 2> >(Levels, TexelSize, Repeat, Mip, Min, SampleCoords, SampleLevels, Count, Red, Green, Blue, Alpha);
+				break;
+			default:
+				batch_sample<batch_fetch<Format, 4> >(Levels, TexelSize, Repeat, Mip, Min, SampleCoords, SampleLevels, Count, Red, Green, Blue, Alpha);
+				break;
+			}
+		}
+#	endif//GLI_KERNEL_SSE2
+
+	// Samplers of other types than float have no batch path, their batches are sampled one coordinate at a time
+	template <typename T>
+	struct sample_batch
+	{
+		template <typename samplecoord_type, typename level_type>
+		static bool call(texture2D const &, wrap, filter, filter, samplecoord_type const *, level_type const *, std::size_t, T *, T *, T *, T *)
+		{
+			return false;
+		}
+	};
+
+	template <>
+	struct sample_batch<float>
+	{
+		// Returns false when the texture format, the wrap mode or the instruction set has no batch path
+		template <precision P>
+		static bool call(
+			texture2D const & Texture, wrap Wrap, filter Mip, filter Min,
+			tvec2<float, P> const * SampleCoords, float const * SampleLevels, std::size_t Count,
+			float * Red, float * Green, float * Blue, float * Alpha)
+		{
+#			if GLI_KERNEL_SSE2
+				batch_layout const Layout = get_batch_layout(Texture.format());
+				if(Layout.Format == BATCH_FORMAT_NONE || (Wrap != WRAP_CLAMP_TO_EDGE && Wrap != WRAP_REPEAT))
+					return false;
+
+				std::vector<batch_level> Levels(Texture.levels());
+				for(std::size_t Level = 0; Level < Levels.size(); ++Level)
+				{
+					texture2D::texelcoord_type const Dimensions(Texture.dimensions(Level));
+					Levels[Level].Data = static_cast<std::uint8_t const *>(Texture[Level].data());
+					Levels[Level].Width = Dimensions.x;
+					Levels[Level].LastS = static_cast<float>(Dimensions.x) - 1.f;
+					Levels[Level].LastT = static_cast<float>(Dimensions.y) - 1.f;
+				}
+
+				std::size_t const TexelSize = block_size(Texture.format());
+				bool const Repeat = Wrap == WRAP_REPEAT;
+				float const * Coords = &SampleCoords[0].x;
+
+				switch(Layout.Format)
+				{
+				case BATCH_FORMAT_UNORM8:
+					batch_sample_format<BATCH_FORMAT_UNORM8>(Layout.Channels, Levels, TexelSize, Repeat, Mip, Min, Coords, SampleLevels, Count, Red, Green, Blue, Alpha);
+					break;
+				case BATCH_FORMAT_SRGB8:
+					batch_sample_format<BATCH_FORMAT_SRGB8>(Layout.Channels, Levels, TexelSize, Repeat, Mip, Min, Coords, SampleLevels, Count, Red, Green, Blue, Alpha);
+					break;
+				default:
+					batch_sample_format<BATCH_FORMAT_SFLOAT32>(Layout.Channels, Levels, TexelSize, Repeat, Mip, Min, Coords, SampleLevels, Count, Red, Green, Blue, Alpha);
+					break;
+				}
+				return true;
+#			else
+				return false;
+#			endif
+		}
+	};
+}//namespace detail
+}//namespace gli
@@ -8,9 +8,11 @@
 #include <cmath>
 #include <cstring>
 #include <memory>
+#include <new>
 
 #include "../type.hpp"
 #include "../format.hpp"
+#include "../allocator.hpp"
 
 // GLM
 #include <glm/gtc/round.hpp>
@@ -42,6 +44,26 @@ namespace gli
 			size_type Faces,
 			size_type Levels);
 
+		/// Create a storage whose texels come from Allocator, aligned on STORAGE_ALIGNMENT bytes and left uninitialised.
+		/// For storages about to be overwritten, a load or a readback, that don't need zeroed texels.
+		storage(
+			format_type Format,
+			texelcoord_type const & Dimensions,
+			size_type Layers,
+			size_type Faces,
+			size_type Levels,
+			allocator & Allocator);
+
+		/// Create a storage over memory it doesn't allocate, laid out like the one it would.
+		/// Memory keeps the texels alive as long as the storage exists.
+		storage(
+			format_type Format,
+			texelcoord_type const & Dimensions,
+			size_type Layers,
+			size_type Faces,
+			size_type Levels,
+			std::shared_ptr<data_type> const & Memory);
+
 		bool empty() const;
 		size_type size() const; // Express is bytes
 		size_type layers() const;
@@ -77,7 +99,8 @@ namespace gli
 		texelcoord_type const BlockCount;
 		texelcoord_type const BlockDimensions;
 		texelcoord_type const Dimensions;
-		std::vector<data_type> Data;
+		size_type const Size;
+		std::shared_ptr<data_type> Data;
 	};
 
 /*
@@ -1,5 +1,23 @@
-namespace gli
+namespace gli{
+namespace detail
 {
+	// The deleter hands the texels back to the allocator they come from once the last texture referencing them is gone
+	inline std::shared_ptr<storage::data_type> allocate_storage(allocator & Allocator, storage::size_type Size)
+	{
+		storage::data_type * Pointer = static_cast<storage::data_type*>(Allocator.allocate(Size, STORAGE_ALIGNMENT));
+		if(!Pointer)
+			throw std::bad_alloc();
+
+		GLI_ASSERT(reinterpret_cast<std::uintptr_t>(Pointer) % STORAGE_ALIGNMENT == 0);
+
+		allocator * Owner = &Allocator;
+		return std::shared_ptr<storage::data_type>(Pointer, [Owner, Size](storage::data_type * Texels)
+		{
+			Owner->deallocate(Texels, Size);
+		});
+	}
+}//namespace detail
+
 	inline storage::storage()
 		: Layers(0)
 		, Faces(0)
@@ -8,6 +26,7 @@ namespace gli
 		, BlockCount(0)
 		, BlockDimensions(0)
 		, Dimensions(0)
+		, Size(0)
 	{}
 
 	inline storage::storage(format_type Format, texelcoord_type const & Dimensions, size_type Layers, size_type Faces, size_type Levels)
@@ -18,18 +37,55 @@ namespace gli
 		, BlockCount(glm::max(Dimensions / gli::block_dimensions(Format), texelcoord_type(1)))
 		, BlockDimensions(gli::block_dimensions(Format))
 		, Dimensions(Dimensions)
+		, Size(this->layer_size(0, Faces - 1, 0, Levels - 1) * Layers)
+		, Data(detail::allocate_storage(default_allocator(), this->Size))
 	{
 		GLI_ASSERT(Layers > 0);
 		GLI_ASSERT(Faces > 0);
 		GLI_ASSERT(Levels > 0);
 		GLI_ASSERT(glm::all(glm::greaterThan(Dimensions, texelcoord_type(0))));
 
-		this->Data.resize(this->layer_size(0, Faces - 1, 0, Levels - 1) * Layers, 0);
+		memset(this->Data.get(), 0, this->Size);
+	}
+
+	inline storage::storage(format_type Format, texelcoord_type const & Dimensions, size_type Layers, size_type Faces, size_type Levels, allocator & Allocator)
+		: Layers(Layers)
+		, Faces(Faces)
+		, Levels(Levels)
+		, BlockSize(gli::block_size(Format))
+		, BlockCount(glm::max(Dimensions / gli::block_dimensions(Format), texelcoord_type(1)))
+		, BlockDimensions(gli::block_dimensions(Format))
+		, Dimensions(Dimensions)
+		, Size(this->layer_size(0, Faces - 1, 0, Levels - 1) * Layers)
+		, Data(detail::allocate_storage(Allocator, this->Size))
+	{
+		GLI_ASSERT(Layers > 0);
+		GLI_ASSERT(Faces > 0);
+		GLI_ASSERT(Levels > 0);
+		GLI_ASSERT(glm::all(glm::greaterThan(Dimensions, texelcoord_type(0))));
+	}
+
+	inline storage::storage(format_type Format, texelcoord_type const & Dimensions, size_type Layers, size_type Faces, size_type Levels, std::shared_ptr<data_type> const & Memory)
+		: Layers(Layers)
+		, Faces(Faces)
+		, Levels(Levels)
+		, BlockSize(gli::block_size(Format))
+		, BlockCount(glm::max(Dimensions / gli::block_dimensions(Format), texelcoord_type(1)))
+		, BlockDimensions(gli::block_dimensions(Format))
+		, Dimensions(Dimensions)
+		, Size(this->layer_size(0, Faces - 1, 0, Levels - 1) * Layers)
+		, Data(Memory)
+	{
+		GLI_ASSERT(Layers > 0);
+		GLI_ASSERT(Faces > 0);
+		GLI_ASSERT(Levels > 0);
+		GLI_ASSERT(glm::all(glm::greaterThan(Dimensions, texelcoord_type(0))));
+		GLI_ASSERT(Memory);
 	}
 
 	inline bool storage::empty() const
 	{
-		return this->Data.empty();
+		return !this->Data;
 	}
 
 	inline storage::size_type storage::layers() const
@@ -75,14 +131,14 @@ namespace gli
 	{
 		GLI_ASSERT(!this->empty());
 
-		return static_cast<size_type>(this->Data.size());
+		return this->Size;
 	}
 
 	inline storage::data_type * storage::data()
 	{
 		GLI_ASSERT(!this->empty());
 
-		return &this->Data[0];
+		return this->Data.get();
 	}
 
 	inline storage::size_type storage::offset(size_type Layer, size_type Face, size_type Level) const
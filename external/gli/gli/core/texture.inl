@@ -34,6 +34,56 @@ namespace gli
 		this->build_cache();
 	}
 
+	inline texture::texture
+	(
+		target_type Target,
+		format_type Format,
+		texelcoord_type const & Dimensions,
+		size_type Layers,
+		size_type Faces,
+		size_type Levels,
+		allocator & Allocator,
+		swizzles_type const & Swizzles
+	)
+		: Storage(std::make_shared<storage>(Format, Dimensions, Layers, Faces, Levels, Allocator))
+		, Target(Target)
+		, Format(Format)
+		, BaseLayer(0), MaxLayer(Layers - 1)
+		, BaseFace(0), MaxFace(Faces - 1)
+		, BaseLevel(0), MaxLevel(Levels - 1)
+		, Swizzles(Swizzles)
+	{
+		assert(Target != TARGET_CUBE || (Target == TARGET_CUBE && Dimensions.x == Dimensions.y));
+		assert(Target != TARGET_CUBE_ARRAY || (Target == TARGET_CUBE_ARRAY && Dimensions.x == Dimensions.y));
+
+		this->build_cache();
+	}
+
+	inline texture::texture
+	(
+		target_type Target,
+		format_type Format,
+		texelcoord_type const & Dimensions,
+		size_type Layers,
+		size_type Faces,
+		size_type Levels,
+		std::shared_ptr<data_type> const & Memory,
+		swizzles_type const & Swizzles
+	)
+		: Storage(std::make_shared<storage>(Format, Dimensions, Layers, Faces, Levels, Memory))
+		, Target(Target)
+		, Format(Format)
+		, BaseLayer(0), MaxLayer(Layers - 1)
+		, BaseFace(0), MaxFace(Faces - 1)
+		, BaseLevel(0), MaxLevel(Levels - 1)
+		, Swizzles(Swizzles)
+	{
+		assert(Target != TARGET_CUBE || (Target == TARGET_CUBE && Dimensions.x == Dimensions.y));
+		assert(Target != TARGET_CUBE_ARRAY || (Target == TARGET_CUBE_ARRAY && Dimensions.x == Dimensions.y));
+
+		this->build_cache();
+	}
+
 	inline texture::texture
 	(
 		texture const & Texture,
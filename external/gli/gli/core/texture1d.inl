@@ -17,6 +17,12 @@ namespace gli
 		this->build_cache();
 	}
 
+	inline texture1D::texture1D(format_type Format, texelcoord_type const & Dimensions, size_type Levels, allocator & Allocator)
+		: texture(TARGET_1D, Format, texture::texelcoord_type(Dimensions.x, 1, 1), 1, 1, Levels, Allocator)
+	{
+		this->build_cache();
+	}
+
 	inline texture1D::texture1D(texture const & Texture)
 		: texture(Texture, TARGET_1D, Texture.format())
 	{
@@ -17,6 +17,12 @@ namespace gli
 		this->build_cache();
 	}
 
+	inline texture1DArray::texture1DArray(format_type Format, texelcoord_type const & Dimensions, size_type Layers, size_type Levels, allocator & Allocator)
+		: texture(TARGET_1D_ARRAY, Format, texture::texelcoord_type(Dimensions.x, 1, 1), Layers, 1, Levels, Allocator)
+	{
+		this->build_cache();
+	}
+
 	inline texture1DArray::texture1DArray(texture const & Texture)
 		: texture(Texture, TARGET_1D_ARRAY, Texture.format())
 	{
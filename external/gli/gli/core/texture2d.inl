@@ -17,6 +17,12 @@ namespace gli
 		this->build_cache();
 	}
 
+	inline texture2D::texture2D(format_type Format, texelcoord_type const & Dimensions, size_type Levels, allocator & Allocator)
+		: texture(TARGET_2D, Format, texture::texelcoord_type(Dimensions, 1), 1, 1, Levels, Allocator)
+	{
+		this->build_cache();
+	}
+
 	inline texture2D::texture2D(texture const & Texture)
 		: texture(Texture, TARGET_2D, Texture.format())
 	{
@@ -17,6 +17,12 @@ namespace gli
 		this->build_cache();
 	}
 
+	inline texture2DArray::texture2DArray(format_type Format, texelcoord_type const & Dimensions, size_type Layers, size_type Levels, allocator & Allocator)
+		: texture(TARGET_2D_ARRAY, Format, texture::texelcoord_type(Dimensions, 1), Layers, 1, Levels, Allocator)
+	{
+		this->build_cache();
+	}
+
 	inline texture2DArray::texture2DArray(texture const & Texture)
 		: texture(Texture, gli::TARGET_2D_ARRAY, Texture.format())
 	{
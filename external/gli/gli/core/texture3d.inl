@@ -18,6 +18,12 @@ namespace gli
 		this->build_cache();
 	}
 
+	inline texture3D::texture3D(format_type Format, texelcoord_type const & Dimensions, size_type Levels, allocator & Allocator)
+		: texture(TARGET_3D, Format, Dimensions, 1, 1, Levels, Allocator)
+	{
+		this->build_cache();
+	}
+
 	inline texture3D::texture3D(texture const & Texture)
 		: texture(Texture, TARGET_3D, Texture.format())
 	{
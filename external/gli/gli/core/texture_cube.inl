@@ -15,6 +15,12 @@ namespace gli
 		this->build_cache();
 	}
 
+	inline textureCube::textureCube(format_type Format, texelcoord_type const & Dimensions, size_type Levels, allocator & Allocator)
+		: texture(TARGET_CUBE, Format, texture::texelcoord_type(Dimensions, 1), 1, 6, Levels, Allocator)
+	{
+		this->build_cache();
+	}
+
 	inline textureCube::textureCube(texture const & Texture)
 		: texture(Texture, TARGET_CUBE, Texture.format())
 	{
@@ -15,6 +15,12 @@ namespace gli
 		this->build_cache();
 	}
 
+	inline textureCubeArray::textureCubeArray(format_type Format, texelcoord_type const & Dimensions, size_type Layers, size_type Levels, allocator & Allocator)
+		: texture(TARGET_CUBE_ARRAY, Format, texture::texelcoord_type(Dimensions, 1), Layers, 6, Levels, Allocator)
+	{
+		this->build_cache();
+	}
+
 	inline textureCubeArray::textureCubeArray(texture const & Texture)
 		: texture(Texture, gli::TARGET_CUBE_ARRAY, Texture.format())
 	{
@@ -14,6 +14,13 @@
 
 namespace gli
 {
+	/// Downsampling kernels of the mipmap generation
+	enum kernel
+	{
+		KERNEL_BOX,		///< Average of the two by two texels under each texel of the next level
+		KERNEL_KAISER	///< Kaiser windowed sinc over eight by eight texels, sharper than the box
+	};
+
 	/// Allocate a texture and generate all the mipmaps of the texture using the Minification filter.
 	template <typename texture_type>
 	texture_type generate_mipmaps(texture_type const & Texture, filter Minification);
@@ -64,6 +71,33 @@ namespace gli
 		textureCubeArray::size_type BaseFace, textureCubeArray::size_type MaxFace,
 		textureCubeArray::size_type BaseLevel, textureCubeArray::size_type MaxLevel,
 		filter Minification);
+
+	/// Generate all the mipmaps of the texture in place using the Kernel, each level from the previous one.
+	/// RGBA8 and BGRA8 UNORM and SRGB, RGBA16 SFLOAT and RGBA32 SFLOAT textures are filtered in linear space, four channels at a time with SIMD,
+	/// on as many threads as the hardware has. UNORM rows are converted with SIMD too, SRGB and SFLOAT16 ones through tables.
+	/// Other formats fall back to the linear minification filter.
+	template <typename texture_type>
+	texture_type generate_mipmaps(texture_type const & Texture, kernel Kernel);
+
+	/// Generate the mipmaps of the texture in place from the BaseLevel to the MaxLevel included using the Kernel.
+	texture2D generate_mipmaps(
+		texture2D const & Texture,
+		texture2D::size_type BaseLevel, texture2D::size_type MaxLevel,
+		kernel Kernel);
+
+	/// Generate the mipmaps of the texture in place from the BaseLayer to the MaxLayer and from the BaseLevel to the MaxLevel included using the Kernel.
+	texture2DArray generate_mipmaps(
+		texture2DArray const & Texture,
+		texture2DArray::size_type BaseLayer, texture2DArray::size_type MaxLayer,
+		texture2DArray::size_type BaseLevel, texture2DArray::size_type MaxLevel,
+		kernel Kernel);
+
+	/// Generate the mipmaps of the texture in place from the BaseFace to the MaxFace and from the BaseLevel to the MaxLevel included using the Kernel.
+	textureCube generate_mipmaps(
+		textureCube const & Texture,
+		textureCube::size_type BaseFace, textureCube::size_type MaxFace,
+		textureCube::size_type BaseLevel, textureCube::size_type MaxLevel,
+		kernel Kernel);
 }//namespace gli
 
 #include "./core/generate_mipmaps.inl"
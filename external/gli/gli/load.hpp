@@ -21,7 +21,8 @@ namespace gli
 	///
 	/// @param Data Data of a texture
 	/// @param Size Size of the data
-	texture load(char const * Data, std::size_t Size);
+	/// @param Allocator Allocator of the texture storage, its texels are copied from Data without being cleared first
+	texture load(char const * Data, std::size_t Size, allocator & Allocator = default_allocator());
 }//namespace gli
 
 #include "./core/load.inl"
@@ -21,7 +21,56 @@ namespace gli
 	///
 	/// @param Data Pointer to the beginning of the texture container data to read
 	/// @param Size Size of texture container Data to read
-	texture load_dds(char const* Data, std::size_t Size);
+	/// @param Allocator Allocator of the texture storage, its texels are copied from Data without being cleared first
+	texture load_dds(char const* Data, std::size_t Size, allocator & Allocator = default_allocator());
+
+	/// Maps a DDS file in memory and returns a texture over its texels, which are neither copied nor cleared first.
+	/// Changes to the texture are private to the process, the file stays mapped as long as the texture or a view of it exists.
+	/// Returns an empty texture in case of failure.
+	///
+	/// @param Path Path of the file to map including filename and filename extension
+	texture map_dds(char const* Path);
+
+	/// Maps a DDS file in memory and returns a texture over its texels, which are neither copied nor cleared first.
+	/// Changes to the texture are private to the process, the file stays mapped as long as the texture or a view of it exists.
+	/// Returns an empty texture in case of failure.
+	///
+	/// @param Path Path of the file to map including filename and filename extension
+	texture map_dds(std::string const & Path);
+
+	/// Number of bytes at the beginning of a DDS container that always hold its whole header.
+	static std::size_t const DDS_HEADER_MAX_SIZE = 148;
+
+	/// Layout of the texture of a DDS container, known from its header alone.
+	/// Levels are stored layer by layer and face by face, like in a texture storage.
+	struct dds_layout
+	{
+		target Target;
+		format Format;
+		texture::texelcoord_type Dimensions;
+		texture::size_type Layers;
+		texture::size_type Faces;
+		texture::size_type Levels;
+
+		/// Offset of the texel data from the beginning of the container
+		std::size_t Offset;
+
+		/// Size of one level of one face, in bytes
+		std::size_t level_size(texture::size_type Level) const;
+
+		/// Offset of a level from the beginning of the container
+		std::size_t offset(texture::size_type Layer, texture::size_type Face, texture::size_type Level) const;
+
+		/// Size of the whole container, header included
+		std::size_t size() const;
+	};
+
+	/// Reads the layout of the texture of DDS memory without touching its texels. Returns false in case of failure.
+	///
+	/// @param Data Pointer to the beginning of the texture container data to read
+	/// @param Size Size of Data, DDS_HEADER_MAX_SIZE bytes or the whole container if it is shorter are enough
+	/// @param Layout Layout of the texture, left unchanged in case of failure
+	bool load_dds_layout(char const* Data, std::size_t Size, dds_layout & Layout);
 }//namespace gli
 
 #include "./core/load_dds.inl"
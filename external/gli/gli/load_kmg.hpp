@@ -21,7 +21,8 @@ namespace gli
 	///
 	/// @param Data Pointer to the beginning of the texture container data to read
 	/// @param Size Size of texture container Data to read
-	texture load_kmg(char const* Data, std::size_t Size);
+	/// @param Allocator Allocator of the texture storage, its texels are copied from Data without being cleared first
+	texture load_kmg(char const* Data, std::size_t Size, allocator & Allocator = default_allocator());
 }//namespace gli
 
 #include "./core/load_kmg.inl"
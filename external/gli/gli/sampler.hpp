@@ -41,6 +41,7 @@ namespace gli
 		wrap_type getFunc(wrap WrapMode) const;
 
 		wrap_type Wrap;
+		wrap WrapMode;
 		filter Mip;
 		filter Min;
 	};
@@ -7,6 +7,7 @@
 #include "texture2d.hpp"
 #include "core/mipmaps_compute.hpp"
 #include "core/convert_func.hpp"
+#include "core/sampler_batch.hpp"
 
 namespace gli
 {
@@ -44,6 +45,12 @@ namespace gli
 		/// Sample the sampler texture at a specific level
 		texel_type texture_lod(samplecoord_type const & SampleCoord, level_type Level) const;
 
+		/// Sample the sampler texture at Count coordinates, each at its level in Levels or at the base level if Levels is null.
+		/// The texels are written channel by channel to Red, Green, Blue and Alpha, Count values each.
+		/// Float samplers of R8, RG8, RGBA8 and BGRA8 UNORM, RGBA8 and BGRA8 SRGB and R32, RG32 and RGBA32 SFLOAT textures wrapped with clamp to edge or repeat
+		/// sample four coordinates at a time with SSE2, levels clamped to the texture ones. The others sample one coordinate at a time with texture_lod.
+		void texture_lod(samplecoord_type const * SampleCoords, level_type const * Levels, size_type Count, T * Red, T * Green, T * Blue, T * Alpha) const;
+
 		/// Generate all the mipmaps of the sampler texture from the texture base level
 		void generate_mipmaps(filter Minification);
 
@@ -32,6 +32,30 @@ namespace gli
 			size_type Levels,
 			swizzles_type const & Swizzles = swizzles_type(SWIZZLE_RED, SWIZZLE_GREEN, SWIZZLE_BLUE, SWIZZLE_ALPHA));
 
+		/// Create a texture object and allocate a texture storage for it from Allocator.
+		/// Its texels are left uninitialised, for textures about to be overwritten like loads and readbacks.
+		texture(
+			target_type Target,
+			format_type Format,
+			texelcoord_type const & Dimensions,
+			size_type Layers,
+			size_type Faces,
+			size_type Levels,
+			allocator & Allocator,
+			swizzles_type const & Swizzles = swizzles_type(SWIZZLE_RED, SWIZZLE_GREEN, SWIZZLE_BLUE, SWIZZLE_ALPHA));
+
+		/// Create a texture object over texels it doesn't own, laid out like in a texture storage, such as a file mapping.
+		/// Memory keeps them alive as long as the texture or a view of it exists.
+		texture(
+			target_type Target,
+			format_type Format,
+			texelcoord_type const & Dimensions,
+			size_type Layers,
+			size_type Faces,
+			size_type Levels,
+			std::shared_ptr<data_type> const & Memory,
+			swizzles_type const & Swizzles = swizzles_type(SWIZZLE_RED, SWIZZLE_GREEN, SWIZZLE_BLUE, SWIZZLE_ALPHA));
+
 		/// Create a texture object by sharing an existing texture storage from another texture instance.
 		/// This texture object is effectively a texture view where the layer, the face and the level allows identifying
 		/// a specific subset of the texture storage source. 
@@ -24,6 +24,13 @@ namespace gli
 			texelcoord_type const & Dimensions,
 			size_type Levels);
 
+		/// Create a texture1D and allocate a new storage from Allocator, its texels left uninitialised.
+		explicit texture1D(
+			format_type Format,
+			texelcoord_type const & Dimensions,
+			size_type Levels,
+			allocator & Allocator);
+
 		/// Create a texture1D and allocate a new storage with a complete mipmap chain
 		explicit texture1D(
 			format_type Format,
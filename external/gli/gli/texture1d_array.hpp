@@ -24,6 +24,14 @@ namespace gli
 			size_type Layers,
 			size_type Levels);
 
+		/// Create a texture1DArray and allocate a new storage from Allocator, its texels left uninitialised.
+		explicit texture1DArray(
+			format_type Format,
+			texelcoord_type const & Dimensions,
+			size_type Layers,
+			size_type Levels,
+			allocator & Allocator);
+
 		/// Create a texture1DArray and allocate a new storage with a complete mipmap chain
 		explicit texture1DArray(
 			format_type Format,
@@ -25,6 +25,13 @@ namespace gli
 			texelcoord_type const & Dimensions,
 			size_type Levels);
 
+		/// Create a texture3D and allocate a new storage from Allocator, its texels left uninitialised.
+		explicit texture3D(
+			format_type Format,
+			texelcoord_type const & Dimensions,
+			size_type Levels,
+			allocator & Allocator);
+
 		/// Create a texture3D and allocate a new storage with a complete mipmap chain
 		explicit texture3D(
 			format_type Format,
@@ -23,6 +23,13 @@ namespace gli
 			texelcoord_type const & Dimensions,
 			size_type Levels);
 
+		/// Create a textureCube and allocate a new storage from Allocator, its texels left uninitialised.
+		explicit textureCube(
+			format_type Format,
+			texelcoord_type const & Dimensions,
+			size_type Levels,
+			allocator & Allocator);
+
 		/// Create a textureCube and allocate a new storage with a complete mipmap chain
 		explicit textureCube(
 			format_type Format,
@@ -0,0 +1,426 @@
+//////////////////////////////////////////////////////////////////////////////////
+/// OpenGL Image (gli.g-truc.net)
+///
+/// Copyright (c) 2008 - 2015 G-Truc Creation (www.g-truc.net)
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in
+/// all copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+/// THE SOFTWARE.
+///
+/// @ref core
+/// @file gli/test/core/core_compress.cpp
+///////////////////////////////////////////////////////////////////////////////////
+
+#include <gli/comparison.hpp>
+#include <gli/compress.hpp>
+#include <gli/copy.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+
+// Reference decoders of the blocks, written from the format specifications
+namespace decode
+{
+	glm::ivec4 color565(std::uint16_t Color)
+	{
+		int const r = (Color >> 11) & 31, g = (Color >> 5) & 63, b = Color & 31;
+		return glm::ivec4((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2), 255);
+	}
+
+	void bc1(std::uint8_t const * Block, glm::ivec4 (&Texels)[16])
+	{
+		std::uint16_t const Color0 = static_cast<std::uint16_t>(Block[0] | (Block[1] << 8));
+		std::uint16_t const Color1 = static_cast<std::uint16_t>(Block[2] | (Block[3] << 8));
+
+		glm::ivec4 Palette[4];
+		Palette[0] = color565(Color0);
+		Palette[1] = color565(Color1);
+		if(Color0 > Color1)
+		{
+			Palette[2] = (Palette[0] * 2 + Palette[1]) / 3;
+			Palette[3] = (Palette[0] + Palette[1] * 2) / 3;
+		}
+		else
+		{
+			Palette[2] = (Palette[0] + Palette[1]) / 2;
+			Palette[3] = glm::ivec4(0);
+		}
+
+		for(int i = 0; i < 16; ++i)
+			Texels[i] = Palette[(Block[4 + i / 4] >> ((i % 4) * 2)) & 3];
+	}
+
+	void bc4(std::uint8_t const * Block, int (&Values)[16])
+	{
+		int const Value0 = Block[0], Value1 = Block[1];
+
+		int Palette[8] = {Value0, Value1};
+		for(int i = 2; i < 8; ++i)
+			Palette[i] = Value0 > Value1 ? ((8 - i) * Value0 + (i - 1) * Value1) / 7 : i < 6 ? ((6 - i) * Value0 + (i - 1) * Value1) / 5 : i == 6 ? 0 : 255;
+
+		std::uint64_t Bits = 0;
+		for(int i = 0; i < 6; ++i)
+			Bits |= static_cast<std::uint64_t>(Block[2 + i]) << (i * 8);
+		for(int i = 0; i < 16; ++i)
+			Values[i] = Palette[(Bits >> (i * 3)) & 7];
+	}
+
+	// Mode 6 only, returns false for the other modes
+	bool bc7(std::uint8_t const * Block, glm::ivec4 (&Texels)[16])
+	{
+		int Position = 0;
+		auto const Read = [&](int Count)
+		{
+			int Value = 0;
+			for(int i = 0; i < Count; ++i, ++Position)
+				Value |= ((Block[Position >> 3] >> (Position & 7)) & 1) << i;
+			return Value;
+		};
+
+		if(Read(7) != 1 << 6)
+			return false;
+
+		glm::ivec4 Endpoint0, Endpoint1;
+		for(int c = 0; c < 4; ++c)
+		{
+			Endpoint0[c] = Read(7) << 1;
+			Endpoint1[c] = Read(7) << 1;
+		}
+		Endpoint0 |= glm::ivec4(Read(1));
+		Endpoint1 |= glm::ivec4(Read(1));
+
+		int const Weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+		for(int i = 0; i < 16; ++i)
+		{
+			int const Weight = Weights[Read(i == 0 ? 3 : 4)];
+			Texels[i] = (Endpoint0 * (64 - Weight) + Endpoint1 * Weight + 32) >> 6;
+		}
+		return true;
+	}
+}//namespace decode
+
+namespace
+{
+	gli::texture2D random_texture(gli::format Format, int Size, bool Smooth)
+	{
+		gli::texture2D Texture(Format, gli::texture2D::texelcoord_type(Size));
+		Texture.clear(glm::u8vec4(0));
+
+		std::srand(1);
+		for(int j = 0; j < Size; ++j)
+		for(int i = 0; i < Size; ++i)
+		{
+			glm::u8vec4 const Texel = Smooth
+				? glm::u8vec4(i * 255 / Size, j * 255 / Size, (i + j) * 127 / Size, 255 - i * 255 / Size)
+				: glm::u8vec4(std::rand() % 256, std::rand() % 256, std::rand() % 256, std::rand() % 256);
+			Texture.store(gli::texture2D::texelcoord_type(i, j), 0, Texel);
+		}
+
+		return Texture;
+	}
+
+	// Root mean square error of the channels of the base level, decoded
+	float rms(gli::texture2D const & Source, gli::texture2D const & Compressed, int Channels)
+	{
+		gli::texture2D::texelcoord_type const Dimensions(Source.dimensions(0));
+		std::uint8_t const * Blocks = Compressed.data<std::uint8_t>();
+		std::size_t const BlockSize = gli::block_size(Compressed.format());
+
+		double Sum = 0.0;
+		for(int BlockY = 0; BlockY < Dimensions.y / 4; ++BlockY)
+		for(int BlockX = 0; BlockX < Dimensions.x / 4; ++BlockX)
+		{
+			std::uint8_t const * Block = Blocks + (BlockY * Dimensions.x / 4 + BlockX) * BlockSize;
+
+			glm::ivec4 Texels[16];
+			int Red[16], Green[16], Alpha[16];
+			switch(Compressed.format())
+			{
+			case gli::FORMAT_RGB_DXT1_UNORM_BLOCK8:
+				decode::bc1(Block, Texels);
+				break;
+			case gli::FORMAT_RGBA_DXT5_UNORM_BLOCK16:
+				decode::bc4(Block, Alpha);
+				decode::bc1(Block + 8, Texels);
+				for(int i = 0; i < 16; ++i)
+					Texels[i].w = Alpha[i];
+				break;
+			case gli::FORMAT_R_ATI1N_UNORM_BLOCK8:
+				decode::bc4(Block, Red);
+				for(int i = 0; i < 16; ++i)
+					Texels[i] = glm::ivec4(Red[i], 0, 0, 255);
+				break;
+			case gli::FORMAT_RG_ATI2N_UNORM_BLOCK16:
+				decode::bc4(Block, Red);
+				decode::bc4(Block + 8, Green);
+				for(int i = 0; i < 16; ++i)
+					Texels[i] = glm::ivec4(Red[i], Green[i], 0, 255);
+				break;
+			case gli::FORMAT_RGBA_BP_UNORM_BLOCK16:
+				if(!decode::bc7(Block, Texels))
+					return 255.f;
+				break;
+			default:
+				return 255.f;
+			}
+
+			for(int i = 0; i < 16; ++i)
+			{
+				glm::ivec4 const Texel(Source.load<glm::u8vec4>(gli::texture2D::texelcoord_type(BlockX * 4 + i % 4, BlockY * 4 + i / 4), 0));
+				for(int c = 0; c < Channels; ++c)
+					Sum += static_cast<double>((Texel[c] - Texels[i][c]) * (Texel[c] - Texels[i][c]));
+			}
+		}
+
+		return static_cast<float>(std::sqrt(Sum / (static_cast<double>(Dimensions.x) * Dimensions.y * Channels)));
+	}
+}//namespace
+
+namespace quality
+{
+	// Smooth gradients keep within a few codes, noise is the worst case of each format
+	int test(gli::format Format, int Channels, float MaxSmooth, float MaxNoise)
+	{
+		int Error = 0;
+
+		gli::texture2D Smooth(random_texture(gli::FORMAT_RGBA8_UNORM_PACK8, 64, true));
+		gli::texture2D Noise(random_texture(gli::FORMAT_RGBA8_UNORM_PACK8, 64, false));
+
+		gli::texture2D SmoothCompressed(gli::compress(Smooth, Format));
+		gli::texture2D NoiseCompressed(gli::compress(Noise, Format));
+		Error += !SmoothCompressed.empty() && SmoothCompressed.format() == Format ? 0 : 1;
+		Error += SmoothCompressed.levels() == Smooth.levels() ? 0 : 1;
+
+		Error += rms(Smooth, SmoothCompressed, Channels) <= MaxSmooth ? 0 : 1;
+		Error += rms(Noise, NoiseCompressed, Channels) <= MaxNoise ? 0 : 1;
+
+		GLI_ASSERT(!Error);
+		return Error;
+	}
+}//namespace quality
+
+namespace uniform
+{
+	// A single colour is matched exactly or nearly by every format
+	int test(gli::format Format, int Channels, float MaxError)
+	{
+		int Error = 0;
+
+		std::srand(2);
+		for(int Color = 0; Color < 64; ++Color)
+		{
+			glm::u8vec4 const Texel(std::rand() % 256, std::rand() % 256, std::rand() % 256, 255);
+
+			gli::texture2D Texture(gli::FORMAT_RGBA8_UNORM_PACK8, gli::texture2D::texelcoord_type(4), 1);
+			Texture.clear(Texel);
+
+			Error += rms(Texture, gli::compress(Texture, Format), Channels) <= MaxError ? 0 : 1;
+		}
+
+		GLI_ASSERT(!Error);
+		return Error;
+	}
+}//namespace uniform
+
+namespace alpha
+{
+	// Transparent texels of a punch through BC1 block decode to transparent black, the others are opaque
+	int test_punch_through()
+	{
+		int Error = 0;
+
+		gli::texture2D Texture(gli::FORMAT_RGBA8_UNORM_PACK8, gli::texture2D::texelcoord_type(4), 1);
+		for(int j = 0; j < 4; ++j)
+		for(int i = 0; i < 4; ++i)
+			Texture.store(gli::texture2D::texelcoord_type(i, j), 0, glm::u8vec4(i * 60, j * 60, 128, (i + j) % 2 ? 0 : 255));
+
+		gli::texture2D Compressed(gli::compress(Texture, gli::FORMAT_RGBA_DXT1_UNORM_BLOCK8));
+
+		glm::ivec4 Texels[16];
+		decode::bc1(Compressed.data<std::uint8_t>(), Texels);
+		for(int i = 0; i < 16; ++i)
+			Error += Texels[i].w == ((i % 4 + i / 4) % 2 ? 0 : 255) ? 0 : 1;
+
+		GLI_ASSERT(!Error);
+		return Error;
+	}
+
+	// Two values in a BC4 block are its endpoints, they are kept exactly
+	int test_bc4_exact()
+	{
+		int Error = 0;
+
+		gli::texture2D Texture(gli::FORMAT_R8_UNORM_PACK8, gli::texture2D::texelcoord_type(4), 1);
+		for(int j = 0; j < 4; ++j)
+		for(int i = 0; i < 4; ++i)
+			Texture.store(gli::texture2D::texelcoord_type(i, j), 0, static_cast<std::uint8_t>(i < 2 ? 17 : 230));
+
+		gli::texture2D Compressed(gli::compress(Texture, gli::FORMAT_R_ATI1N_UNORM_BLOCK8));
+
+		int Values[16];
+		decode::bc4(Compressed.data<std::uint8_t>(), Values);
+		for(int i = 0; i < 16; ++i)
+			Error += Values[i] == (i % 4 < 2 ? 17 : 230) ? 0 : 1;
+
+		GLI_ASSERT(!Error);
+		return Error;
+	}
+}//namespace alpha
+
+namespace images
+{
+	// Every layer and level is encoded, and encoding them on many threads at once doesn't change them
+	int test()
+	{
+		int Error = 0;
+
+		gli::texture2DArray Texture(gli::FORMAT_BGRA8_UNORM_PACK8, gli::texture2DArray::texelcoord_type(256), 3);
+		std::srand(3);
+		for(std::size_t Layer = 0; Layer < Texture.layers(); ++Layer)
+		for(std::size_t Level = 0; Level < Texture.levels(); ++Level)
+		{
+			gli::texture2DArray::texelcoord_type const Dimensions(Texture.dimensions(Level));
+			for(int j = 0; j < Dimensions.y; ++j)
+			for(int i = 0; i < Dimensions.x; ++i)
+				Texture.store(gli::texture2DArray::texelcoord_type(i, j), Layer, Level, glm::u8vec4(std::rand() % 256, j, i, 255));
+		}
+
+		gli::texture2DArray Compressed(gli::compress(Texture, gli::FORMAT_RGBA_BP_UNORM_BLOCK16));
+		Error += Compressed.layers() == Texture.layers() && Compressed.levels() == Texture.levels() ? 0 : 1;
+
+		for(std::size_t Layer = 0; Layer < Texture.layers(); ++Layer)
+		{
+			gli::texture2D const Single(gli::compress(gli::texture2D(gli::copy(Texture[Layer])), gli::FORMAT_RGBA_BP_UNORM_BLOCK16));
+			Error += Single == gli::texture2D(Compressed[Layer]) ? 0 : 1;
+		}
+
+		gli::textureCube Cube(gli::FORMAT_RGB8_UNORM_PACK8, gli::textureCube::texelcoord_type(8));
+		Cube.clear(glm::u8vec3(0, 128, 255));
+		gli::textureCube CubeCompressed(gli::compress(Cube, gli::FORMAT_RGB_DXT1_UNORM_BLOCK8));
+		Error += CubeCompressed.faces() == 6 && CubeCompressed.levels() == Cube.levels() ? 0 : 1;
+
+		GLI_ASSERT(!Error);
+		return Error;
+	}
+}//namespace images
+
+namespace decompress
+{
+	// Decompressed texels are the ones of the reference decoders, down to the levels smaller than a block
+	int test(gli::format Format)
+	{
+		int Error = 0;
+
+		gli::texture2D Source(random_texture(gli::FORMAT_RGBA8_UNORM_PACK8, 16, false));
+		gli::texture2D Compressed(gli::compress(Source, Format));
+		gli::texture2D Decompressed(gli::decompress(Compressed));
+
+		Error += Decompressed.format() == gli::FORMAT_RGBA8_UNORM_PACK8 && Decompressed.levels() == Compressed.levels() ? 0 : 1;
+		Error += Decompressed.dimensions(Decompressed.max_level()) == gli::texture2D::texelcoord_type(1) ? 0 : 1;
+
+		std::uint8_t const * Blocks = Compressed.data<std::uint8_t>();
+		std::size_t const BlockSize = gli::block_size(Format);
+		for(int BlockY = 0; BlockY < 4; ++BlockY)
+		for(int BlockX = 0; BlockX < 4; ++BlockX)
+		{
+			std::uint8_t const * Block = Blocks + (BlockY * 4 + BlockX) * BlockSize;
+
+			glm::ivec4 Texels[16];
+			int Red[16], Green[16], Alpha[16];
+			if(Format == gli::FORMAT_RG_ATI2N_UNORM_BLOCK16)
+			{
+				decode::bc4(Block, Red);
+				decode::bc4(Block + 8, Green);
+				for(int i = 0; i < 16; ++i)
+					Texels[i] = glm::ivec4(Red[i], Green[i], 0, 255);
+			}
+			else if(Format == gli::FORMAT_RGBA_DXT5_UNORM_BLOCK16)
+			{
+				decode::bc4(Block, Alpha);
+				decode::bc1(Block + 8, Texels);
+				for(int i = 0; i < 16; ++i)
+					Texels[i].w = Alpha[i];
+			}
+			else
+				decode::bc1(Block, Texels);
+
+			for(int i = 0; i < 16; ++i)
+			{
+				glm::ivec4 const Texel(Decompressed.load<glm::u8vec4>(gli::texture2D::texelcoord_type(BlockX * 4 + i % 4, BlockY * 4 + i / 4), 0));
+				Error += Texel == Texels[i] ? 0 : 1;
+			}
+		}
+
+		Error += gli::decompress(gli::texture2D(gli::FORMAT_RGBA8_UNORM_PACK8, gli::texture2D::texelcoord_type(4))).empty() ? 0 : 1;
+
+		GLI_ASSERT(!Error);
+		return Error;
+	}
+}//namespace decompress
+
+namespace formats
+{
+	int test()
+	{
+		int Error = 0;
+
+		gli::texture2D Float(gli::FORMAT_RGBA32_SFLOAT_PACK32, gli::texture2D::texelcoord_type(4), 1);
+		Error += gli::compress(Float, gli::FORMAT_RGB_DXT1_UNORM_BLOCK8).empty() ? 0 : 1;
+		Error += gli::is_compressible(gli::FORMAT_RGBA32_SFLOAT_PACK32) ? 1 : 0;
+		Error += gli::is_compressible(gli::FORMAT_BGRA8_SRGB_PACK8) ? 0 : 1;
+
+		gli::texture2D Opaque(gli::FORMAT_RGBA8_SRGB_PACK8, gli::texture2D::texelcoord_type(4), 1);
+		Opaque.clear(glm::u8vec4(10, 20, 30, 255));
+		gli::texture2D Translucent(gli::FORMAT_RGBA8_UNORM_PACK8, gli::texture2D::texelcoord_type(4), 1);
+		Translucent.clear(glm::u8vec4(10, 20, 30, 254));
+
+		Error += gli::compressed_format(Opaque, gli::CONTENT_COLOR) == gli::FORMAT_RGB_DXT1_SRGB_BLOCK8 ? 0 : 1;
+		Error += gli::compressed_format(Translucent, gli::CONTENT_COLOR) == gli::FORMAT_RGBA_DXT5_UNORM_BLOCK16 ? 0 : 1;
+		Error += gli::compressed_format(Opaque, gli::CONTENT_COLOR, true) == gli::FORMAT_RGBA_BP_SRGB_BLOCK16 ? 0 : 1;
+		Error += gli::compressed_format(Translucent, gli::CONTENT_NORMAL) == gli::FORMAT_RG_ATI2N_UNORM_BLOCK16 ? 0 : 1;
+		Error += gli::compressed_format(Translucent, gli::CONTENT_SCALAR) == gli::FORMAT_R_ATI1N_UNORM_BLOCK8 ? 0 : 1;
+
+		GLI_ASSERT(!Error);
+		return Error;
+	}
+}//namespace formats
+
+int main()
+{
+	int Error = 0;
+
+	Error += quality::test(gli::FORMAT_RGB_DXT1_UNORM_BLOCK8, 3, 4.0f, 60.0f);
+	Error += quality::test(gli::FORMAT_RGBA_DXT5_UNORM_BLOCK16, 4, 4.0f, 60.0f);
+	Error += quality::test(gli::FORMAT_R_ATI1N_UNORM_BLOCK8, 1, 2.0f, 20.0f);
+	Error += quality::test(gli::FORMAT_RG_ATI2N_UNORM_BLOCK16, 2, 2.0f, 20.0f);
+	Error += quality::test(gli::FORMAT_RGBA_BP_UNORM_BLOCK16, 4, 4.0f, 60.0f);
+
+	Error += uniform::test(gli::FORMAT_RGB_DXT1_UNORM_BLOCK8, 3, 2.0f);
+	Error += uniform::test(gli::FORMAT_R_ATI1N_UNORM_BLOCK8, 1, 0.0f);
+	Error += uniform::test(gli::FORMAT_RG_ATI2N_UNORM_BLOCK16, 2, 0.0f);
+	Error += uniform::test(gli::FORMAT_RGBA_BP_UNORM_BLOCK16, 4, 1.0f);
+
+	Error += alpha::test_punch_through();
+	Error += alpha::test_bc4_exact();
+	Error += images::test();
+	Error += decompress::test(gli::FORMAT_RGB_DXT1_UNORM_BLOCK8);
+	Error += decompress::test(gli::FORMAT_RGBA_DXT5_UNORM_BLOCK16);
+	Error += decompress::test(gli::FORMAT_RG_ATI2N_UNORM_BLOCK16);
+	Error += formats::test();
+
+	return Error;
+}
@@ -0,0 +1,249 @@
+//////////////////////////////////////////////////////////////////////////////////
+/// OpenGL Image (gli.g-truc.net)
+///
+/// Copyright (c) 2008 - 2015 G-Truc Creation (www.g-truc.net)
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in
+/// all copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+/// THE SOFTWARE.
+///
+/// @ref core
+/// @file gli/test/core/core_convert_bulk.cpp
+
+#include <gli/convert.hpp>
+
+#include <glm/gtc/packing.hpp>
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+namespace half
+{
+	int test()
+	{
+		int Error = 0;
+
+		// Every half decodes to what GLM decodes it to, and encodes back to itself
+		std::vector<glm::uint16> Halves(65536);
+		for(std::size_t Bits = 0; Bits < Halves.size(); ++Bits)
+			Halves[Bits] = static_cast<glm::uint16>(Bits);
+
+		gli::texture2D Source(gli::FORMAT_R16_SFLOAT_PACK16, gli::texture2D::texelcoord_type(256), 1, gli::default_allocator());
+		memcpy(Source.data(), &Halves[0], Source.size());
+
+		gli::texture2D const Floats(gli::convert(Source, gli::FORMAT_R32_SFLOAT_PACK32));
+		gli::texture2D const Back(gli::convert(Floats, gli::FORMAT_R16_SFLOAT_PACK16));
+		Error += !Floats.empty() && !Back.empty() ? 0 : 1;
+		if(Error)
+			return Error;
+
+		for(std::size_t Bits = 0; Bits < Halves.size(); ++Bits)
+		{
+			float const Value = Floats.data<float>()[Bits];
+			float const Expected = glm::unpackHalf1x16(Halves[Bits]);
+			if(std::isnan(Expected))
+			{
+				Error += std::isnan(Value) ? 0 : 1;
+				Error += (Back.data<glm::uint16>()[Bits] & 0x7c00) == 0x7c00 && (Back.data<glm::uint16>()[Bits] & 0x03ff) != 0 ? 0 : 1;
+				continue;
+			}
+
+			Error += memcmp(&Value, &Expected, sizeof(float)) == 0 ? 0 : 1;
+			Error += Back.data<glm::uint16>()[Bits] == Halves[Bits] ? 0 : 1;
+		}
+
+		// Encoding rounds to nearest even, overflows to infinity and matches the scalar code on every lane
+		float const Values[] = {
+			0.f, -0.f, 1.f, 65504.f, 65519.f, 65520.f, 1e10f, -1e10f, 6.1035156e-5f, 5.9604645e-8f, 2.9802322e-8f, 2.9802326e-8f, 1e-10f,
+			1.00048828125f, 1.00146484375f, 1.000732421875f, -2.5f, 3.14159265f, 0.33333333f};
+		std::size_t const Count = sizeof(Values) / sizeof(Values[0]);
+		glm::uint16 const Expected[] = {
+			0x0000, 0x8000, 0x3c00, 0x7bff, 0x7bff, 0x7c00, 0x7c00, 0xfc00, 0x0400, 0x0001, 0x0000, 0x0001, 0x0000,
+			0x3c00, 0x3c02, 0x3c01, 0xc100, 0x4248, 0x3555};
+
+		gli::texture2D Encoded(gli::FORMAT_R32_SFLOAT_PACK32, gli::texture2D::texelcoord_type(static_cast<int>(Count), 1), 1, gli::default_allocator());
+		memcpy(Encoded.data(), Values, sizeof(Values));
+		gli::texture2D const Decoded(gli::convert(Encoded, gli::FORMAT_R16_SFLOAT_PACK16));
+		for(std::size_t i = 0; i < Count; ++i)
+		{
+			Error += Decoded.data<glm::uint16>()[i] == Expected[i] ? 0 : 1;
+			Error += gli::detail::convert_float_to_half(Values[i]) == Expected[i] ? 0 : 1;
+		}
+
+		std::srand(7);
+		gli::texture2D Random(gli::FORMAT_RGBA32_SFLOAT_PACK32, gli::texture2D::texelcoord_type(33, 3), 1, gli::default_allocator());
+		for(std::size_t i = 0; i < Random.size() / sizeof(float); ++i)
+			Random.data<float>()[i] = (static_cast<float>(std::rand()) / RAND_MAX - 0.5f) * std::ldexp(1.f, std::rand() % 48 - 30);
+		gli::texture2D const RandomHalves(gli::convert(Random, gli::FORMAT_RGBA16_SFLOAT_PACK16));
+		for(std::size_t i = 0; i < Random.size() / sizeof(float); ++i)
+			Error += RandomHalves.data<glm::uint16>()[i] == gli::detail::convert_float_to_half(Random.data<float>()[i]) ? 0 : 1;
+
+		return Error;
+	}
+}//namespace half
+
+namespace bytes
+{
+	glm::u8vec4 random_texel()
+	{
+		return glm::u8vec4(std::rand() % 256, std::rand() % 256, std::rand() % 256, std::rand() % 256);
+	}
+
+	int test()
+	{
+		int Error = 0;
+
+		std::srand(11);
+		gli::texture2D::texelcoord_type const Dimensions(37, 5);
+		gli::texture2D RGBA(gli::FORMAT_RGBA8_UNORM_PACK8, Dimensions, 1, gli::default_allocator());
+		for(std::size_t i = 0; i < RGBA.size() / 4; ++i)
+			RGBA.data<glm::u8vec4>()[i] = random_texel();
+		glm::u8vec4 const * Texels = RGBA.data<glm::u8vec4>();
+
+		gli::texture2D const RGB(gli::convert(RGBA, gli::FORMAT_RGB8_UNORM_PACK8));
+		gli::texture2D const BGRA(gli::convert(RGBA, gli::FORMAT_BGRA8_UNORM_PACK8));
+		gli::texture2D const BGR(gli::convert(RGBA, gli::FORMAT_BGR8_UNORM_PACK8));
+		gli::texture2D const RG(gli::convert(RGBA, gli::FORMAT_RG8_UNORM_PACK8));
+		gli::texture2D const Swizzled(gli::convert(RGBA, gli::FORMAT_RGBA8_UNORM_PACK8, gli::swizzles(gli::SWIZZLE_ALPHA, gli::SWIZZLE_ZERO, gli::SWIZZLE_RED, gli::SWIZZLE_ONE)));
+		gli::texture2D const Expanded(gli::convert(RG, gli::FORMAT_BGRA8_UNORM_PACK8));
+		gli::texture2D const FromRGB(gli::convert(RGB, gli::FORMAT_RGBA8_UNORM_PACK8));
+
+		for(std::size_t i = 0; i < RGBA.size() / 4; ++i)
+		{
+			glm::u8vec4 const Texel = Texels[i];
+			Error += RGB.data<glm::u8vec3>()[i] == glm::u8vec3(Texel) ? 0 : 1;
+			Error += BGRA.data<glm::u8vec4>()[i] == glm::u8vec4(Texel.z, Texel.y, Texel.x, Texel.w) ? 0 : 1;
+			Error += BGR.data<glm::u8vec3>()[i] == glm::u8vec3(Texel.z, Texel.y, Texel.x) ? 0 : 1;
+			Error += RG.data<glm::u8vec2>()[i] == glm::u8vec2(Texel) ? 0 : 1;
+			Error += Swizzled.data<glm::u8vec4>()[i] == glm::u8vec4(Texel.w, 0, Texel.x, 255) ? 0 : 1;
+			Error += Expanded.data<glm::u8vec4>()[i] == glm::u8vec4(0, Texel.y, Texel.x, 255) ? 0 : 1;
+			Error += FromRGB.data<glm::u8vec4>()[i] == glm::u8vec4(Texel.x, Texel.y, Texel.z, 255) ? 0 : 1;
+		}
+
+		// Into an existing image, larger than a thread's share
+		gli::texture2D Large(gli::FORMAT_BGRA8_SRGB_PACK8, gli::texture2D::texelcoord_type(512, 300), 1, gli::default_allocator());
+		for(std::size_t i = 0; i < Large.size() / 4; ++i)
+			Large.data<glm::u8vec4>()[i] = random_texel();
+		gli::texture2D LargeRGB(gli::FORMAT_RGB8_SRGB_PACK8, Large.dimensions(), 1, gli::default_allocator());
+		Error += gli::convert(Large[0], LargeRGB[0]) ? 0 : 1;
+		for(std::size_t i = 0; i < Large.size() / 4; ++i)
+		{
+			glm::u8vec4 const Texel = Large.data<glm::u8vec4>()[i];
+			Error += LargeRGB.data<glm::u8vec3>()[i] == glm::u8vec3(Texel.z, Texel.y, Texel.x) ? 0 : 1;
+		}
+
+		return Error;
+	}
+}//namespace bytes
+
+namespace values
+{
+	float to_linear(float Srgb)
+	{
+		return Srgb <= 0.04045f ? Srgb / 12.92f : std::pow((Srgb + 0.055f) / 1.055f, 2.4f);
+	}
+
+	int test()
+	{
+		int Error = 0;
+
+		gli::texture2D Codes(gli::FORMAT_RGBA8_UNORM_PACK8, gli::texture2D::texelcoord_type(64, 4), 1, gli::default_allocator());
+		for(std::size_t i = 0; i < Codes.size(); ++i)
+			Codes.data<glm::uint8>()[i] = static_cast<glm::uint8>(i * 7 + i / 256);
+
+		// UNORM and sRGB to floats and back are exact
+		gli::texture2D const Srgb(gli::FORMAT_RGBA8_SRGB_PACK8, Codes.dimensions(), 1, gli::default_allocator());
+		memcpy(const_cast<gli::texture2D &>(Srgb).data(), Codes.data(), Codes.size());
+
+		gli::texture2D const Unorm32(gli::convert(Codes, gli::FORMAT_RGBA32_SFLOAT_PACK32));
+		gli::texture2D const Srgb32(gli::convert(Srgb, gli::FORMAT_RGBA32_SFLOAT_PACK32));
+		gli::texture2D const Unorm16(gli::convert(Codes, gli::FORMAT_RGBA16_SFLOAT_PACK16));
+		gli::texture2D const UnormBack(gli::convert(Unorm32, gli::FORMAT_RGBA8_UNORM_PACK8));
+		gli::texture2D const SrgbBack(gli::convert(Srgb32, gli::FORMAT_RGBA8_SRGB_PACK8));
+		gli::texture2D const SrgbFrom16(gli::convert(gli::convert(Srgb, gli::FORMAT_RGBA16_SFLOAT_PACK16), gli::FORMAT_RGBA8_SRGB_PACK8));
+		gli::texture2D const Linearized(gli::convert(Srgb, gli::FORMAT_RGBA8_UNORM_PACK8));
+
+		for(std::size_t i = 0; i < Codes.size(); ++i)
+		{
+			glm::uint8 const Code = Codes.data<glm::uint8>()[i];
+			bool const Alpha = i % 4 == 3;
+			float const Linear = Alpha ? Code / 255.f : to_linear(Code / 255.f);
+
+			Error += Unorm32.data<float>()[i] == Code / 255.f ? 0 : 1;
+			Error += std::abs(Srgb32.data<float>()[i] - Linear) < 1e-6f ? 0 : 1;
+			Error += Unorm16.data<glm::uint16>()[i] == glm::packHalf1x16(Code / 255.f) || std::abs(glm::unpackHalf1x16(Unorm16.data<glm::uint16>()[i]) - Code / 255.f) < 5e-4f ? 0 : 1;
+			Error += UnormBack.data<glm::uint8>()[i] == Code ? 0 : 1;
+			Error += SrgbBack.data<glm::uint8>()[i] == Code ? 0 : 1;
+			Error += Linearized.data<glm::uint8>()[i] == static_cast<glm::uint8>(Linear * 255.f + 0.5f) ? 0 : 1;
+			if(Code > 8)
+				Error += SrgbFrom16.data<glm::uint8>()[i] == Code ? 0 : 1;
+		}
+
+		// Out of range floats are clamped
+		gli::texture2D Floats(gli::FORMAT_RG32_SFLOAT_PACK32, gli::texture2D::texelcoord_type(1), 1, gli::default_allocator());
+		Floats.data<glm::vec2>()[0] = glm::vec2(-3.f, 7.f);
+		gli::texture2D const Clamped(gli::convert(Floats, gli::FORMAT_RGBA8_UNORM_PACK8, gli::swizzles(gli::SWIZZLE_RED, gli::SWIZZLE_GREEN, gli::SWIZZLE_ONE, gli::SWIZZLE_GREEN)));
+		Error += Clamped.data<glm::u8vec4>()[0] == glm::u8vec4(0, 255, 255, 255) ? 0 : 1;
+
+		return Error;
+	}
+}//namespace values
+
+namespace texture
+{
+	int test()
+	{
+		int Error = 0;
+
+		gli::textureCube Cube(gli::FORMAT_RGBA8_UNORM_PACK8, gli::textureCube::texelcoord_type(16));
+		for(std::size_t i = 0; i < Cube.size(); ++i)
+			Cube.data<glm::uint8>()[i] = static_cast<glm::uint8>(i);
+
+		gli::textureCube const Float(gli::convert(Cube, gli::FORMAT_RGBA32_SFLOAT_PACK32));
+		Error += Float.levels() == Cube.levels() && Float.faces() == 6 ? 0 : 1;
+		for(gli::textureCube::size_type Face = 0; Face < Cube.faces(); ++Face)
+		for(gli::textureCube::size_type Level = 0; Level < Cube.levels(); ++Level)
+		{
+			glm::uint8 const * Source = Cube[Face][Level].data<glm::uint8>();
+			float const * Destination = Float[Face][Level].data<float>();
+			for(std::size_t i = 0; i < Cube[Face][Level].size(); ++i)
+				Error += Destination[i] == Source[i] / 255.f ? 0 : 1;
+		}
+
+		// Block compressed textures and images of other dimensions aren't converted
+		gli::texture2D const Compressed(gli::FORMAT_RGBA_DXT5_UNORM_BLOCK16, gli::texture2D::texelcoord_type(8), 1);
+		Error += gli::convert(Compressed, gli::FORMAT_RGBA8_UNORM_PACK8).empty() ? 0 : 1;
+		Error += !gli::is_convertible(gli::FORMAT_RGBA_DXT5_UNORM_BLOCK16) ? 0 : 1;
+
+		gli::texture2D Small(gli::FORMAT_RGBA8_UNORM_PACK8, gli::texture2D::texelcoord_type(8), 1);
+		Error += !gli::convert(Cube[0][0], Small[0]) ? 0 : 1;
+
+		return Error;
+	}
+}//namespace texture
+
+int main()
+{
+	int Error = 0;
+
+	Error += half::test();
+	Error += bytes::test();
+	Error += values::test();
+	Error += texture::test();
+
+	return Error;
+}
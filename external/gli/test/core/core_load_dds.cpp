@@ -96,6 +96,37 @@ namespace load_mem
 	}
 }//namespace load_mem
 
+namespace map_file
+{
+	int test(params const & Params)
+	{
+		int Error(0);
+
+		gli::texture TextureA(gli::load_dds(path(Params.Filename.c_str())));
+
+		// A view keeps the mapping alive once the mapped texture is gone
+		gli::texture View([&]()
+		{
+			gli::texture TextureB(gli::map_dds(path(Params.Filename.c_str())));
+			Error += TextureB.format() == Params.Format ? 0 : 1;
+			Error += TextureA == TextureB ? 0 : 1;
+			GLI_ASSERT(!Error);
+
+			return gli::texture(TextureB, TextureB.target(), TextureB.format());
+		}());
+		Error += TextureA == View ? 0 : 1;
+		GLI_ASSERT(!Error);
+
+		// Changes to the mapped texels stay in memory
+		std::memset(View.data(), 0, View.size(0));
+		gli::texture TextureC(gli::map_dds(path(Params.Filename.c_str())));
+		Error += TextureA == TextureC ? 0 : 1;
+		GLI_ASSERT(!Error);
+
+		return Error;
+	}
+}//namespace map_file
+
 namespace load_mem_only
 {
 	int test(std::vector<char> const & Data, params const & Params)
@@ -115,10 +146,53 @@ namespace load_mem_only
 		Error += TextureA == TextureB ? 0 : 1;
 		GLI_ASSERT(!Error);
 
+		// A truncated container is refused rather than read past its end
+		gli::texture TextureC(gli::load_dds(&Data[0], Data.size() - 1));
+		Error += TextureC.empty() ? 0 : 1;
+		GLI_ASSERT(!Error);
+
 		return Error;
 	}
 }//namespace load_mem_only
 
+namespace load_layout
+{
+	int test(std::vector<char> const & Data, params const & Params)
+	{
+		int Error(0);
+
+		gli::texture Texture(gli::load_dds(&Data[0], Data.size()));
+
+		// The header alone is enough to locate every level of the container
+		gli::dds_layout Layout;
+		Error += gli::load_dds_layout(&Data[0], std::min(Data.size(), gli::DDS_HEADER_MAX_SIZE), Layout) ? 0 : 1;
+		GLI_ASSERT(!Error);
+
+		Error += Layout.Format == Params.Format ? 0 : 1;
+		Error += Layout.Target == Texture.target() ? 0 : 1;
+		Error += Layout.Dimensions == Texture.dimensions() ? 0 : 1;
+		Error += Layout.Layers == Texture.layers() && Layout.Faces == Texture.faces() && Layout.Levels == Texture.levels() ? 0 : 1;
+		Error += Layout.size() == Data.size() ? 0 : 1;
+		GLI_ASSERT(!Error);
+
+		for(std::size_t Layer = 0; Layer < Texture.layers(); ++Layer)
+		for(std::size_t Face = 0; Face < Texture.faces(); ++Face)
+		for(std::size_t Level = 0; Level < Texture.levels(); ++Level)
+		{
+			Error += Layout.level_size(Level) == Texture.size(Level) ? 0 : 1;
+			Error += std::memcmp(&Data[Layout.offset(Layer, Face, Level)], Texture.data(Layer, Face, Level), Texture.size(Level)) == 0 ? 0 : 1;
+			GLI_ASSERT(!Error);
+		}
+
+		// A truncated header or another container is refused
+		Error += !gli::load_dds_layout(&Data[0], 64, Layout) ? 0 : 1;
+		Error += !gli::load_dds_layout("KTX 11", 6, Layout) ? 0 : 1;
+		GLI_ASSERT(!Error);
+
+		return Error;
+	}
+}//namespace load_layout
+
 int main()
 {
 	std::vector<params> Params;
@@ -179,6 +253,13 @@ int main()
 	}
 	std::clock_t TimeFileEnd = std::clock();
 
+	std::clock_t TimeMapStart = std::clock();
+	{
+		for(std::size_t Index = 0; Index < Params.size(); ++Index)
+			Error += map_file::test(Params[Index]);
+	}
+	std::clock_t TimeMapEnd = std::clock();
+
 	std::clock_t TimeMemStart = std::clock();
 	{
 		for(std::size_t Index = 0; Index < Params.size(); ++Index)
@@ -210,10 +291,13 @@ int main()
 
 		for(std::size_t Index = 0; Index < Params.size(); ++Index)
 			Error += load_mem_only::test(Memory[Index], Params[Index]);
+
+		for(std::size_t Index = 0; Index < Params.size(); ++Index)
+			Error += load_layout::test(Memory[Index], Params[Index]);
 	}
 	std::clock_t TimeMemOnlyEnd = std::clock();
 
-	std::printf("File: %lu, Mem: %lu, Mem Only: %lu\n", TimeFileEnd - TimeFileStart, TimeMemEnd - TimeMemStart, TimeMemOnlyEnd - TimeMemOnlyStart);
+	std::printf("File: %lu, Map: %lu, Mem: %lu, Mem Only: %lu\n", TimeFileEnd - TimeFileStart, TimeMapEnd - TimeMapStart, TimeMemEnd - TimeMemStart, TimeMemOnlyEnd - TimeMemOnlyStart);
 
 	return Error;
 }
@@ -27,6 +27,7 @@
 ///////////////////////////////////////////////////////////////////////////////////
 
 #include <gli/core/storage.hpp>
+#include <gli/texture2d.hpp>
 
 int test_storage_layer_size()
 {
@@ -81,12 +82,139 @@ int test_storage_face_size()
 	return Error;
 }
 
+namespace allocator
+{
+	// Bump allocator over a fixed buffer, the way a loader arena would hand out texels
+	class arena : public gli::allocator
+	{
+	public:
+		arena() : Used(0), Allocations(0), Deallocations(0) {}
+
+		void * allocate(std::size_t Size, std::size_t Alignment)
+		{
+			std::size_t const Begin = (reinterpret_cast<std::uintptr_t>(Buffer) + Used + Alignment - 1) / Alignment * Alignment - reinterpret_cast<std::uintptr_t>(Buffer);
+			if(Begin + Size > sizeof(Buffer))
+				return nullptr;
+
+			Used = Begin + Size;
+			++Allocations;
+			return Buffer + Begin;
+		}
+
+		void deallocate(void *, std::size_t)
+		{
+			++Deallocations;
+		}
+
+		char Buffer[4096];
+		std::size_t Used;
+		int Allocations;
+		int Deallocations;
+	};
+
+	bool aligned(void const * Pointer)
+	{
+		return reinterpret_cast<std::uintptr_t>(Pointer) % gli::STORAGE_ALIGNMENT == 0;
+	}
+
+	int test_zero()
+	{
+		int Error(0);
+
+		gli::storage Storage(gli::FORMAT_RGBA8_UNORM_PACK8, gli::storage::texelcoord_type(7, 5, 1), 1, 1, 1);
+		Error += aligned(Storage.data()) ? 0 : 1;
+
+		for(std::size_t i = 0; i < Storage.size(); ++i)
+			Error += Storage.data()[i] == 0 ? 0 : 1;
+
+		return Error;
+	}
+
+	int test_default()
+	{
+		int Error(0);
+
+		for(int Size = 1; Size < 64; Size += 7)
+		{
+			gli::texture2D Texture(gli::FORMAT_R8_UNORM_PACK8, gli::texture2D::texelcoord_type(Size, 3), 1, gli::default_allocator());
+			Error += aligned(Texture.data()) ? 0 : 1;
+			Error += Texture.size() == static_cast<std::size_t>(Size * 3) ? 0 : 1;
+
+			memset(Texture.data(), 0xff, Texture.size());
+		}
+
+		return Error;
+	}
+
+	int test_arena()
+	{
+		int Error(0);
+
+		arena Arena;
+		{
+			std::unique_ptr<gli::texture2D> Texture(new gli::texture2D(gli::FORMAT_RGBA8_UNORM_PACK8, gli::texture2D::texelcoord_type(4, 4), 3, Arena));
+			Error += Texture->data() >= static_cast<void*>(Arena.Buffer) && Texture->data() < static_cast<void*>(Arena.Buffer + sizeof(Arena.Buffer)) ? 0 : 1;
+			Error += aligned(Texture->data()) ? 0 : 1;
+			Error += Texture->size() == (16 + 4 + 1) * 4 ? 0 : 1;
+			Error += Arena.Allocations == 1 ? 0 : 1;
+
+			gli::texture2D const View(*Texture, 1, 2);
+			Texture.reset();
+
+			// The view keeps the texels alive once the texture is gone
+			Error += Arena.Deallocations == 0 ? 0 : 1;
+			Error += View.levels() == 2 ? 0 : 1;
+		}
+		Error += Arena.Deallocations == 1 ? 0 : 1;
+
+		{
+			gli::texture2D Texture(gli::FORMAT_RGBA8_UNORM_PACK8, gli::texture2D::texelcoord_type(5, 3), 1, Arena);
+			Error += aligned(Texture.data()) ? 0 : 1;
+		}
+		Error += Arena.Allocations == 2 && Arena.Deallocations == 2 ? 0 : 1;
+
+		// An allocator out of memory throws like the heap does
+		bool Thrown = false;
+		try
+		{
+			gli::texture2D Texture(gli::FORMAT_RGBA32_SFLOAT_PACK32, gli::texture2D::texelcoord_type(64, 64), 1, Arena);
+		}
+		catch(std::bad_alloc const &)
+		{
+			Thrown = true;
+		}
+		Error += Thrown ? 0 : 1;
+		Error += Arena.Allocations == 2 ? 0 : 1;
+
+		return Error;
+	}
+
+	int test_adopt()
+	{
+		int Error(0);
+
+		std::shared_ptr<gli::storage::data_type> Memory(new gli::storage::data_type[16], std::default_delete<gli::storage::data_type[]>());
+		memset(Memory.get(), 7, 16);
+
+		gli::texture Texture(gli::TARGET_2D, gli::FORMAT_RGBA8_UNORM_PACK8, gli::texture::texelcoord_type(2, 2, 1), 1, 1, 1, Memory);
+		Error += Texture.data() == Memory.get() ? 0 : 1;
+		Error += Texture.size() == 16 ? 0 : 1;
+		Error += Memory.use_count() == 2 ? 0 : 1;
+
+		return Error;
+	}
+}//namespace allocator
+
 int main()
 {
 	int Error(0);
 
 	Error += test_storage_layer_size();
 	Error += test_storage_face_size();
+	Error += allocator::test_zero();
+	Error += allocator::test_default();
+	Error += allocator::test_arena();
+	Error += allocator::test_adopt();
 
 	assert(!Error);
 
@@ -0,0 +1,210 @@
+//////////////////////////////////////////////////////////////////////////////////
+/// OpenGL Image (gli.g-truc.net)
+///
+/// Copyright (c) 2008 - 2015 G-Truc Creation (www.g-truc.net)
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in
+/// all copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+/// THE SOFTWARE.
+///
+/// @ref core
+/// @file gli/test/core/generate_mipmaps_kernel.cpp
+///////////////////////////////////////////////////////////////////////////////////
+
+#include <gli/comparison.hpp>
+#include <gli/copy.hpp>
+#include <gli/generate_mipmaps.hpp>
+
+#include <glm/gtc/epsilon.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <cstdlib>
+
+namespace uniform
+{
+	// Any normalized kernel keeps a uniform texture uniform down to the last level
+	template <typename genType>
+	int test(gli::format Format, genType const & Color, int Size, gli::kernel Kernel)
+	{
+		int Error = 0;
+
+		gli::texture2D Texture2D(Format, gli::texture2D::texelcoord_type(Size));
+		Texture2D.clear(genType(0));
+		Texture2D[0].clear(Color);
+		gli::texture2D Mipmaps2D(gli::generate_mipmaps(Texture2D, Kernel));
+		for(std::size_t Level = 0; Level < Mipmaps2D.levels(); ++Level)
+			Error += Mipmaps2D.load<genType>(gli::texture2D::texelcoord_type(0), Level) == Color ? 0 : 1;
+
+		gli::texture2DArray Texture2DArray(Format, gli::texture2DArray::texelcoord_type(Size), 3);
+		Texture2DArray.clear(genType(0));
+		for(std::size_t Layer = 0; Layer < Texture2DArray.layers(); ++Layer)
+			Texture2DArray[Layer][0].clear(Color);
+		gli::texture2DArray Mipmaps2DArray(gli::generate_mipmaps(Texture2DArray, Kernel));
+		for(std::size_t Layer = 0; Layer < Mipmaps2DArray.layers(); ++Layer)
+			Error += Mipmaps2DArray.load<genType>(gli::texture2DArray::texelcoord_type(0), Layer, Mipmaps2DArray.max_level()) == Color ? 0 : 1;
+
+		gli::textureCube TextureCube(Format, gli::textureCube::texelcoord_type(Size));
+		TextureCube.clear(genType(0));
+		for(std::size_t Face = 0; Face < TextureCube.faces(); ++Face)
+			TextureCube[Face][0].clear(Color);
+		gli::textureCube MipmapsCube(gli::generate_mipmaps(TextureCube, Kernel));
+		for(std::size_t Face = 0; Face < MipmapsCube.faces(); ++Face)
+			Error += MipmapsCube.load<genType>(gli::textureCube::texelcoord_type(0), Face, MipmapsCube.max_level()) == Color ? 0 : 1;
+
+		GLI_ASSERT(!Error);
+		return Error;
+	}
+}//namespace uniform
+
+namespace srgb
+{
+	// Black and white texels average to half the light, not half the sRGB code
+	int test()
+	{
+		int Error = 0;
+
+		gli::texture2D TextureUnorm(gli::FORMAT_RGBA8_UNORM_PACK8, gli::texture2D::texelcoord_type(2));
+		gli::texture2D TextureSrgb(gli::FORMAT_RGBA8_SRGB_PACK8, gli::texture2D::texelcoord_type(2));
+		for(int j = 0; j < 2; ++j)
+		for(int i = 0; i < 2; ++i)
+		{
+			glm::u8vec4 const Texel = (i + j) % 2 ? glm::u8vec4(255) : glm::u8vec4(0, 0, 0, 255);
+			TextureUnorm.store(gli::texture2D::texelcoord_type(i, j), 0, Texel);
+			TextureSrgb.store(gli::texture2D::texelcoord_type(i, j), 0, Texel);
+		}
+
+		gli::texture2D MipmapsUnorm(gli::generate_mipmaps(TextureUnorm, gli::KERNEL_BOX));
+		gli::texture2D MipmapsSrgb(gli::generate_mipmaps(TextureSrgb, gli::KERNEL_BOX));
+
+		Error += MipmapsUnorm.load<glm::u8vec4>(gli::texture2D::texelcoord_type(0), 1) == glm::u8vec4(128, 128, 128, 255) ? 0 : 1;
+		Error += MipmapsSrgb.load<glm::u8vec4>(gli::texture2D::texelcoord_type(0), 1) == glm::u8vec4(188, 188, 188, 255) ? 0 : 1;
+
+		GLI_ASSERT(!Error);
+		return Error;
+	}
+}//namespace srgb
+
+namespace box
+{
+	// Levels large enough to be split across threads match a straightforward average
+	int test_rgba8(int Size)
+	{
+		int Error = 0;
+
+		gli::texture2D Texture(gli::FORMAT_RGBA8_UNORM_PACK8, gli::texture2D::texelcoord_type(Size));
+		std::srand(1);
+		for(int j = 0; j < Size; ++j)
+		for(int i = 0; i < Size; ++i)
+			Texture.store(gli::texture2D::texelcoord_type(i, j), 0, glm::u8vec4(std::rand() % 256, std::rand() % 256, std::rand() % 256, std::rand() % 256));
+
+		gli::texture2D Mipmaps(gli::generate_mipmaps(gli::texture2D(gli::copy(Texture)), gli::KERNEL_BOX));
+
+		for(std::size_t Level = 1; Level < Mipmaps.levels() && !Error; ++Level)
+		{
+			gli::texture2D::texelcoord_type const Dimensions(Mipmaps.dimensions(Level));
+			for(int j = 0; j < Dimensions.y; ++j)
+			for(int i = 0; i < Dimensions.x; ++i)
+			{
+				glm::vec4 Sum(0);
+				for(int y = 0; y < 2; ++y)
+				for(int x = 0; x < 2; ++x)
+					Sum += glm::vec4(Mipmaps.load<glm::u8vec4>(gli::texture2D::texelcoord_type(i * 2 + x, j * 2 + y), Level - 1));
+
+				// One code apart at most from rounding the average of the rounded texels
+				glm::vec4 const Texel(Mipmaps.load<glm::u8vec4>(gli::texture2D::texelcoord_type(i, j), Level));
+				Error += glm::all(glm::lessThanEqual(glm::abs(Texel - Sum * 0.25f), glm::vec4(1.0f))) ? 0 : 1;
+			}
+		}
+
+		GLI_ASSERT(!Error);
+		return Error;
+	}
+
+	int test_rgba32f()
+	{
+		int Error = 0;
+
+		gli::textureCube Texture(gli::FORMAT_RGBA32_SFLOAT_PACK32, gli::textureCube::texelcoord_type(16));
+		for(std::size_t Face = 0; Face < Texture.faces(); ++Face)
+		for(int j = 0; j < 16; ++j)
+		for(int i = 0; i < 16; ++i)
+			Texture.store(gli::textureCube::texelcoord_type(i, j), Face, 0, glm::vec4(i, j, Face, i * j));
+
+		gli::textureCube Mipmaps(gli::generate_mipmaps(gli::textureCube(gli::copy(Texture)), gli::KERNEL_BOX));
+
+		for(std::size_t Face = 0; Face < Mipmaps.faces(); ++Face)
+		for(int j = 0; j < 8; ++j)
+		for(int i = 0; i < 8; ++i)
+		{
+			glm::vec4 Expected(0);
+			for(int y = 0; y < 2; ++y)
+			for(int x = 0; x < 2; ++x)
+				Expected += glm::vec4(i * 2 + x, j * 2 + y, Face, (i * 2 + x) * (j * 2 + y)) * 0.25f;
+
+			glm::vec4 const Texel(Mipmaps.load<glm::vec4>(gli::textureCube::texelcoord_type(i, j), Face, 1));
+			Error += glm::all(glm::epsilonEqual(Texel, Expected, 0.0001f)) ? 0 : 1;
+		}
+
+		GLI_ASSERT(!Error);
+		return Error;
+	}
+}//namespace box
+
+namespace fallback
+{
+	// Formats without a kernel use the linear minification filter
+	int test()
+	{
+		int Error = 0;
+
+		gli::texture2D Texture(gli::FORMAT_RG8_UNORM_PACK8, gli::texture2D::texelcoord_type(8));
+		Texture.clear(glm::u8vec2(0));
+		Texture[0].clear(glm::u8vec2(255, 127));
+
+		gli::texture2D MipmapsA(gli::generate_mipmaps(gli::texture2D(gli::copy(Texture)), gli::FILTER_LINEAR));
+		gli::texture2D MipmapsB(gli::generate_mipmaps(gli::texture2D(gli::copy(Texture)), gli::KERNEL_KAISER));
+		Error += MipmapsA == MipmapsB ? 0 : 1;
+
+		GLI_ASSERT(!Error);
+		return Error;
+	}
+}//namespace fallback
+
+int main()
+{
+	int Error = 0;
+
+	int const Sizes[] = {1, 2, 3, 15, 16, 17, 32};
+	gli::kernel const Kernels[] = {gli::KERNEL_BOX, gli::KERNEL_KAISER};
+
+	for(std::size_t KernelIndex = 0; KernelIndex < sizeof(Kernels) / sizeof(Kernels[0]); ++KernelIndex)
+	for(std::size_t SizeIndex = 0; SizeIndex < sizeof(Sizes) / sizeof(Sizes[0]); ++SizeIndex)
+	{
+		Error += uniform::test(gli::FORMAT_RGBA8_UNORM_PACK8, glm::u8vec4(255, 127, 0, 255), Sizes[SizeIndex], Kernels[KernelIndex]);
+		Error += uniform::test(gli::FORMAT_RGBA8_SRGB_PACK8, glm::u8vec4(255, 127, 3, 200), Sizes[SizeIndex], Kernels[KernelIndex]);
+		Error += uniform::test(gli::FORMAT_BGRA8_UNORM_PACK8, glm::u8vec4(1, 2, 3, 4), Sizes[SizeIndex], Kernels[KernelIndex]);
+		Error += uniform::test(gli::FORMAT_RGBA16_SFLOAT_PACK16, gli::packHalf(glm::vec4(1.0f, 0.5f, 0.0f, 1.0f)), Sizes[SizeIndex], Kernels[KernelIndex]);
+		Error += uniform::test(gli::FORMAT_RGBA32_SFLOAT_PACK32, glm::vec4(1.0f, 0.5f, 0.0f, 1.0f), Sizes[SizeIndex], Kernels[KernelIndex]);
+	}
+
+	Error += srgb::test();
+	Error += box::test_rgba8(17);
+	Error += box::test_rgba8(1024);
+	Error += box::test_rgba32f();
+	Error += fallback::test();
+
+	return Error;
+}
@@ -33,6 +33,8 @@
 #include <ctime>
 #include <limits>
 #include <array>
+#include <cstdlib>
+#include <vector>
 
 namespace load
 {
@@ -106,6 +108,100 @@ namespace texture_lod
 	}
 }//namespace texture_lod
 
+namespace texture_lod_batch
+{
+	// Sample Count random coordinates and levels through the batch path and one by one, the results must match
+	template <typename T>
+	int test(gli::format Format, gli::wrap Wrap, gli::filter Mip, gli::filter Min)
+	{
+		typedef gli::sampler2D<T> sampler;
+
+		int Error = 0;
+
+		gli::texture2D Texture(Format, gli::texture2D::texelcoord_type(13, 6));
+		sampler Sampler(Texture, Wrap, Mip, Min);
+
+		std::srand(static_cast<unsigned int>(Format));
+		for(gli::texture2D::size_type Level = 0; Level < Texture.levels(); ++Level)
+		{
+			gli::texture2D::texelcoord_type const Dimensions(Texture.dimensions(Level));
+			for(int y = 0; y < Dimensions.y; ++y)
+			for(int x = 0; x < Dimensions.x; ++x)
+			{
+				typename sampler::texel_type const Texel(
+					static_cast<T>(std::rand() % 256) / static_cast<T>(255),
+					static_cast<T>(std::rand() % 256) / static_cast<T>(255),
+					static_cast<T>(std::rand() % 256) / static_cast<T>(255),
+					static_cast<T>(std::rand() % 256) / static_cast<T>(255));
+				Sampler.texel_write(gli::texture2D::texelcoord_type(x, y), Level, Texel);
+			}
+		}
+
+		std::size_t const Count = 37;
+		std::vector<typename sampler::samplecoord_type> SampleCoords(Count);
+		std::vector<typename sampler::level_type> Levels(Count);
+		for(std::size_t i = 0; i < Count; ++i)
+		{
+			SampleCoords[i] = typename sampler::samplecoord_type(
+				static_cast<float>(std::rand() % 4001) / 1000.f - 1.5f,
+				static_cast<float>(std::rand() % 4001) / 1000.f - 1.5f);
+			Levels[i] = static_cast<float>(std::rand() % 1001) / 1000.f * static_cast<float>(Texture.max_level());
+		}
+		SampleCoords[0] = typename sampler::samplecoord_type(0.5f);
+		SampleCoords[1] = typename sampler::samplecoord_type(1.0f, 0.0f);
+
+		std::vector<T> Red(Count), Green(Count), Blue(Count), Alpha(Count);
+		Sampler.texture_lod(&SampleCoords[0], &Levels[0], Count, &Red[0], &Green[0], &Blue[0], &Alpha[0]);
+
+		for(std::size_t i = 0; i < Count; ++i)
+		{
+			typename sampler::texel_type const Texel = Sampler.texture_lod(SampleCoords[i], Levels[i]);
+			typename sampler::texel_type const Batch(Red[i], Green[i], Blue[i], Alpha[i]);
+			Error += gli::all(gli::epsilonEqual(Texel, Batch, static_cast<T>(0.00001))) ? 0 : 1;
+		}
+
+		// without levels, the base level is sampled
+		Sampler.texture_lod(&SampleCoords[0], nullptr, Count, &Red[0], &Green[0], &Blue[0], &Alpha[0]);
+		for(std::size_t i = 0; i < Count; ++i)
+		{
+			typename sampler::texel_type const Texel = Sampler.texture_lod(SampleCoords[i], 0.0f);
+			Error += gli::all(gli::epsilonEqual(Texel, typename sampler::texel_type(Red[i], Green[i], Blue[i], Alpha[i]), static_cast<T>(0.00001))) ? 0 : 1;
+		}
+
+		return Error;
+	}
+
+	int test()
+	{
+		int Error = 0;
+
+		gli::format const Formats[] =
+		{
+			gli::FORMAT_R8_UNORM_PACK8,
+			gli::FORMAT_RG8_UNORM_PACK8,
+			gli::FORMAT_RGBA8_UNORM_PACK8,
+			gli::FORMAT_BGRA8_UNORM_PACK8,
+			gli::FORMAT_RGBA8_SRGB_PACK8,
+			gli::FORMAT_R32_SFLOAT_PACK32,
+			gli::FORMAT_RGBA32_SFLOAT_PACK32,
+			gli::FORMAT_RGBA16_SFLOAT_PACK16
+		};
+
+		gli::wrap const Wraps[] = {gli::WRAP_CLAMP_TO_EDGE, gli::WRAP_REPEAT, gli::WRAP_MIRROR_REPEAT};
+		gli::filter const Filters[] = {gli::FILTER_NEAREST, gli::FILTER_LINEAR};
+
+		for(std::size_t FormatIndex = 0; FormatIndex < sizeof(Formats) / sizeof(Formats[0]); ++FormatIndex)
+		for(std::size_t WrapIndex = 0; WrapIndex < sizeof(Wraps) / sizeof(Wraps[0]); ++WrapIndex)
+		for(std::size_t MipIndex = 0; MipIndex < 2; ++MipIndex)
+		for(std::size_t MinIndex = 0; MinIndex < 2; ++MinIndex)
+			Error += test<float>(Formats[FormatIndex], Wraps[WrapIndex], Filters[MipIndex], Filters[MinIndex]);
+
+		Error += test<double>(gli::FORMAT_RGBA8_UNORM_PACK8, gli::WRAP_CLAMP_TO_EDGE, gli::FILTER_LINEAR, gli::FILTER_LINEAR);
+
+		return Error;
+	}
+}//namespace texture_lod_batch
+
 namespace sampler_type
 {
 	int test()
@@ -136,6 +232,7 @@ int main()
 	int Error(0);
 
 	Error += texture_lod::test();
+	Error += texture_lod_batch::test();
 	Error += load::test();
 	Error += sampler_type::test();
 
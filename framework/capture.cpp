@@ -0,0 +1,281 @@
+///////////////////////////////////////////////////////////////////////////////////
+/// OpenGL Samples Pack (ogl-samples.g-truc.net)
+///
+/// Copyright (c) 2004 - 2014 G-Truc Creation (www.g-truc.net)
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+/// 
+/// The above copyright notice and this permission notice shall be included in
+/// all copies or substantial portions of the Software.
+/// 
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+/// THE SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////
+
+#include "capture.hpp"
+#include "compare.hpp"
+#include "png.hpp"
+
+#include <cstring>
+
+capture::capture(std::string const & OutputPath, encoding OutputEncoding, std::size_t FrameLatency, std::size_t PendingFrames) :
+	Path(OutputPath),
+	Encoding(OutputEncoding),
+	Latency(glm::max<std::size_t>(FrameLatency, 2)),
+	MaxPendingFrames(glm::max<std::size_t>(PendingFrames, 1)),
+	WriteSlot(0),
+	FrameIndex(0),
+	Size(0),
+	DroppedFrames(0),
+	CapturedFrames(0),
+	BusyJobs(0),
+	Stop(false),
+	Sequence(nullptr)
+{
+	if(this->Encoding == RAW_SEQUENCE)
+	{
+		this->Sequence = std::fopen((this->Path + ".raw").c_str(), "wb");
+		if(this->Sequence)
+		{
+			raw_header const Header = {{'G', 'R', 'A', 'W'}, 1};
+			std::fwrite(&Header, sizeof(Header), 1, this->Sequence);
+		}
+		else
+			fprintf(stdout, "capture: unable to open %s.raw\n", this->Path.c_str());
+	}
+
+	this->Encoder = std::thread([this]{this->encode();});
+}
+
+capture::~capture()
+{
+	this->flush();
+	this->destroy();
+
+	{
+		std::lock_guard<std::mutex> Lock(this->Mutex);
+		this->Stop = true;
+	}
+	this->Condition.notify_all();
+	this->Encoder.join();
+
+	if(this->Sequence)
+		std::fclose(this->Sequence);
+
+	if(this->DroppedFrames > 0)
+		fprintf(stdout, "capture: %d frames dropped\n", static_cast<int>(this->DroppedFrames));
+}
+
+void capture::create(glm::uvec2 const & WindowSize)
+{
+	this->destroy();
+
+	this->Size = WindowSize;
+	this->Slots.resize(this->Latency);
+	this->WriteSlot = 0;
+
+	for(slot & Slot : this->Slots)
+	{
+		glGenBuffers(1, &Slot.Buffer);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, Slot.Buffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, WindowSize.x * WindowSize.y * 4, nullptr, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void capture::destroy()
+{
+	this->retire(true);
+
+	for(slot & Slot : this->Slots)
+		glDeleteBuffers(1, &Slot.Buffer);
+	this->Slots.clear();
+}
+
+void capture::frame(glm::uvec2 const & WindowSize)
+{
+	if(WindowSize.x == 0 || WindowSize.y == 0)
+		return;
+
+	if(this->Slots.empty() || WindowSize != this->Size)
+		this->create(WindowSize);
+
+	this->retire(false);
+
+	{
+		std::lock_guard<std::mutex> Lock(this->Mutex);
+		if(this->Jobs.size() + this->BusyJobs >= this->MaxPendingFrames)
+		{
+			++this->DroppedFrames;
+			++this->FrameIndex;
+			return;
+		}
+	}
+
+	// The ring is full when the GPU is more than Latency frames behind, only then we wait
+	slot & Slot = this->Slots[this->WriteSlot];
+	if(Slot.Fence)
+		this->read(Slot, true);
+
+	// Tightly packed rows from the default framebuffer, the sample's own state is restored after the readback
+	GLint PackAlignment(4);
+	GLint ReadFramebuffer(0);
+	glGetIntegerv(GL_PACK_ALIGNMENT, &PackAlignment);
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &ReadFramebuffer);
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, Slot.Buffer);
+	glReadPixels(0, 0, static_cast<GLsizei>(WindowSize.x), static_cast<GLsizei>(WindowSize.y), GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(ReadFramebuffer));
+	glPixelStorei(GL_PACK_ALIGNMENT, PackAlignment);
+
+	Slot.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	Slot.FrameIndex = this->FrameIndex++;
+	this->WriteSlot = (this->WriteSlot + 1) % this->Slots.size();
+}
+
+void capture::retire(bool Wait)
+{
+	// Oldest slots first, the slot about to be written is the oldest one
+	for(std::size_t Offset = 0; Offset < this->Slots.size(); ++Offset)
+	{
+		slot & Slot = this->Slots[(this->WriteSlot + Offset) % this->Slots.size()];
+		if(!Slot.Fence)
+			continue;
+
+		// Leave the most recent frames alone so that mapping doesn't synchronize with the GPU
+		if(!Wait && Slot.FrameIndex + this->Latency - 1 > this->FrameIndex)
+			break;
+
+		if(!this->read(Slot, Wait))
+			break;
+	}
+}
+
+bool capture::read(slot & Slot, bool Wait)
+{
+	GLenum const Status = glClientWaitSync(Slot.Fence, Wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, Wait ? GL_TIMEOUT_IGNORED : 0);
+	if(Status == GL_TIMEOUT_EXPIRED)
+		return false;
+
+	glDeleteSync(Slot.Fence);
+	Slot.Fence = nullptr;
+
+	// The readback may not have been written, drop the frame rather than encode it
+	if(Status == GL_WAIT_FAILED)
+	{
+		fprintf(stdout, "capture: waiting for frame %d failed, dropped\n", static_cast<int>(Slot.FrameIndex));
+
+		std::lock_guard<std::mutex> Lock(this->Mutex);
+		++this->DroppedFrames;
+		return true;
+	}
+
+	job Job(Slot.FrameIndex, gli::texture2D(gli::FORMAT_RGBA8_UNORM_PACK8, gli::texture2D::texelcoord_type(this->Size), 1, gli::default_allocator()));
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, Slot.Buffer);
+	void const * Pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(Job.Image.size()), GL_MAP_READ_BIT);
+	if(Pixels)
+	{
+		std::memcpy(Job.Image.data(), Pixels, Job.Image.size());
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	{
+		std::lock_guard<std::mutex> Lock(this->Mutex);
+		if(Pixels)
+			this->Jobs.push_back(std::move(Job));
+		else
+			++this->DroppedFrames;
+	}
+	this->Condition.notify_one();
+
+	return true;
+}
+
+void capture::flush()
+{
+	this->retire(true);
+
+	std::unique_lock<std::mutex> Lock(this->Mutex);
+	this->Idle.wait(Lock, [this]{return this->Jobs.empty() && this->BusyJobs == 0;});
+}
+
+std::size_t capture::capturedFrames() const
+{
+	std::lock_guard<std::mutex> Lock(this->Mutex);
+	return this->CapturedFrames;
+}
+
+std::size_t capture::droppedFrames() const
+{
+	std::lock_guard<std::mutex> Lock(this->Mutex);
+	return this->DroppedFrames;
+}
+
+void capture::encode()
+{
+	std::unique_lock<std::mutex> Lock(this->Mutex);
+	for(;;)
+	{
+		this->Condition.wait(Lock, [this]{return this->Stop || !this->Jobs.empty();});
+		if(this->Jobs.empty())
+			return;
+
+		job const Job(std::move(this->Jobs.front()));
+		this->Jobs.pop_front();
+		++this->BusyJobs;
+
+		Lock.unlock();
+		this->write(Job);
+		Lock.lock();
+
+		--this->BusyJobs;
+		++this->CapturedFrames;
+		this->Idle.notify_all();
+	}
+}
+
+void capture::write(job const & Job)
+{
+	// The alpha channel of the default framebuffer is meaningless
+	gli::texture2D const Image(compare::to_rgb8(Job.Image));
+
+	switch(this->Encoding)
+	{
+	case PNG:
+		{
+			char Suffix[32];
+			std::sprintf(Suffix, "-%05d.png", static_cast<int>(Job.FrameIndex));
+			save_png(Image, (this->Path + Suffix).c_str());
+		}
+		break;
+	case RAW_SEQUENCE:
+		if(this->Sequence)
+		{
+			raw_frame const Frame =
+			{
+				static_cast<glm::uint32>(Job.FrameIndex),
+				static_cast<glm::uint32>(Image.dimensions().x),
+				static_cast<glm::uint32>(Image.dimensions().y),
+				3
+			};
+			std::fwrite(&Frame, sizeof(Frame), 1, this->Sequence);
+			std::fwrite(Image.data(), 1, Image.size(), this->Sequence);
+		}
+		break;
+	}
+}
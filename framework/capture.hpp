@@ -0,0 +1,137 @@
+///////////////////////////////////////////////////////////////////////////////////
+/// OpenGL Samples Pack (ogl-samples.g-truc.net)
+///
+/// Copyright (c) 2004 - 2014 G-Truc Creation (www.g-truc.net)
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+/// 
+/// The above copyright notice and this permission notice shall be included in
+/// all copies or substantial portions of the Software.
+/// 
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+/// THE SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#define GLM_FORCE_RADIANS
+#include <gli/gli.hpp>
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Asynchronous capture of the default framebuffer.
+/// Frames are read into a ring of pixel pack buffers, mapped a few frames later once their fence is signaled
+/// and encoded by a worker thread so that the render loop neither waits for the read back nor for the compression.
+class capture
+{
+public:
+	enum encoding
+	{
+		/// One PNG file per frame, named <Path>-<frame>.png
+		PNG,
+		/// All the frames appended to <Path>.raw, see raw_header and raw_frame
+		RAW_SEQUENCE
+	};
+
+	/// Layout of the RAW_SEQUENCE files: a raw_header followed by a raw_frame and its RGB8 rows, bottom to top, for each frame.
+	struct raw_header
+	{
+		char Magic[4];
+		glm::uint32 Version;
+	};
+
+	struct raw_frame
+	{
+		glm::uint32 FrameIndex;
+		glm::uint32 Width;
+		glm::uint32 Height;
+		glm::uint32 Components;
+	};
+
+	/// FrameLatency is the number of frames in flight, PendingFrames the number of read back frames waiting
+	/// for the encoder above which new frames are dropped.
+	capture(std::string const & OutputPath, encoding OutputEncoding, std::size_t FrameLatency = 3, std::size_t PendingFrames = 8);
+	~capture();
+
+	/// Queue the read back of the default framebuffer, to call before swapping the buffers.
+	void frame(glm::uvec2 const & WindowSize);
+
+	/// Encode every frame in flight and wait for the encoder to be done.
+	void flush();
+
+	std::size_t capturedFrames() const;
+	std::size_t droppedFrames() const;
+
+private:
+	struct slot
+	{
+		slot() :
+			Buffer(0),
+			Fence(nullptr),
+			FrameIndex(0)
+		{}
+
+		GLuint Buffer;
+		GLsync Fence;
+		std::size_t FrameIndex;
+	};
+
+	struct job
+	{
+		job(std::size_t Index, gli::texture2D const & Texture) :
+			FrameIndex(Index),
+			Image(Texture)
+		{}
+
+		std::size_t FrameIndex;
+		gli::texture2D Image;
+	};
+
+	capture(capture const &) = delete;
+	capture & operator=(capture const &) = delete;
+
+	void create(glm::uvec2 const & WindowSize);
+	void destroy();
+	void retire(bool Wait);
+	bool read(slot & Slot, bool Wait);
+	void encode();
+	void write(job const & Job);
+
+	std::string const Path;
+	encoding const Encoding;
+	std::size_t const Latency;
+	std::size_t const MaxPendingFrames;
+
+	std::vector<slot> Slots;
+	std::size_t WriteSlot;
+	std::size_t FrameIndex;
+	glm::uvec2 Size;
+	std::size_t DroppedFrames;
+	std::size_t CapturedFrames;
+
+	std::thread Encoder;
+	std::deque<job> Jobs;
+	std::size_t BusyJobs;
+	mutable std::mutex Mutex;
+	std::condition_variable Condition;
+	std::condition_variable Idle;
+	bool Stop;
+	FILE* Sequence;
+};
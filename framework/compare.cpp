@@ -0,0 +1,247 @@
+///////////////////////////////////////////////////////////////////////////////////
+/// OpenGL Samples Pack (ogl-samples.g-truc.net)
+///
+/// Copyright (c) 2004 - 2014 G-Truc Creation (www.g-truc.net)
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+/// 
+/// The above copyright notice and this permission notice shall be included in
+/// all copies or substantial portions of the Software.
+/// 
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+/// THE SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////
+
+#include "compare.hpp"
+#include "parallel.hpp"
+
+#include <gli/convert.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <mutex>
+
+#if GLM_ARCH & GLM_ARCH_SSE2
+#	include <emmintrin.h>
+#endif
+
+namespace
+{
+	// Minimum number of texels processed by a parallel task
+	std::size_t const TASK_TEXELS(1 << 16);
+
+	struct partial
+	{
+		partial() :
+			SumSquared(0),
+			MaxError(0),
+			DifferingTexels(0)
+		{}
+
+		glm::uint64 SumSquared;
+		glm::uint MaxError;
+		std::size_t DifferingTexels;
+	};
+
+	inline std::size_t bit_count(glm::uint64 Value)
+	{
+		std::size_t Count = 0;
+		for(; Value; Value &= Value - 1)
+			++Count;
+		return Count;
+	}
+
+	inline std::size_t rows_per_task(std::size_t Width)
+	{
+		return std::max<std::size_t>(TASK_TEXELS / std::max<std::size_t>(Width, 1), 1);
+	}
+
+	void compare_row(glm::u8 const * A, glm::u8 const * B, std::size_t TexelCount, glm::uint Threshold, partial & Result)
+	{
+		std::size_t TexelIndex = 0;
+
+#		if GLM_ARCH & GLM_ARCH_SSE2
+		{
+			// 16 RGB8 texels per iteration, three vectors. Each 32 bits lane of Squares grows by at most
+			// 3 * 4 * 255^2 per iteration so it is flushed every 1024 iterations.
+			std::size_t const BLOCK_TEXELS(16);
+			std::size_t const FLUSH_BLOCKS(1024);
+
+			__m128i const Zero = _mm_setzero_si128();
+			__m128i const Limit = _mm_set1_epi8(static_cast<char>(std::min<glm::uint>(Threshold, 255)));
+			__m128i Max = Zero;
+			__m128i Squares = Zero;
+			std::size_t BlockCount = 0;
+
+			for(; TexelIndex + BLOCK_TEXELS <= TexelCount; TexelIndex += BLOCK_TEXELS)
+			{
+				glm::uint64 Mask = 0;
+				for(std::size_t VectorIndex = 0; VectorIndex < 3; ++VectorIndex)
+				{
+					std::size_t const Offset = TexelIndex * 3 + VectorIndex * 16;
+					__m128i const VectorA = _mm_loadu_si128(reinterpret_cast<__m128i const *>(A + Offset));
+					__m128i const VectorB = _mm_loadu_si128(reinterpret_cast<__m128i const *>(B + Offset));
+					__m128i const Diff = _mm_or_si128(_mm_subs_epu8(VectorA, VectorB), _mm_subs_epu8(VectorB, VectorA));
+
+					Max = _mm_max_epu8(Max, Diff);
+
+					__m128i const Low = _mm_unpacklo_epi8(Diff, Zero);
+					__m128i const High = _mm_unpackhi_epi8(Diff, Zero);
+					Squares = _mm_add_epi32(Squares, _mm_add_epi32(_mm_madd_epi16(Low, Low), _mm_madd_epi16(High, High)));
+
+					__m128i const Within = _mm_cmpeq_epi8(_mm_subs_epu8(Diff, Limit), Zero);
+					Mask |= static_cast<glm::uint64>(~_mm_movemask_epi8(Within) & 0xFFFF) << (VectorIndex * 16);
+				}
+
+				// One bit per channel, fold the three channels of each texel on its first bit
+				Result.DifferingTexels += bit_count((Mask | (Mask >> 1) | (Mask >> 2)) & 0x249249249249ull);
+
+				if(++BlockCount == FLUSH_BLOCKS || TexelIndex + BLOCK_TEXELS * 2 > TexelCount)
+				{
+					glm::uint32 Lanes[4];
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(Lanes), Squares);
+					Result.SumSquared += static_cast<glm::uint64>(Lanes[0]) + Lanes[1] + Lanes[2] + Lanes[3];
+					Squares = Zero;
+					BlockCount = 0;
+				}
+			}
+
+			glm::u8 Bytes[16];
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(Bytes), Max);
+			for(std::size_t ByteIndex = 0; ByteIndex < 16; ++ByteIndex)
+				Result.MaxError = std::max<glm::uint>(Result.MaxError, Bytes[ByteIndex]);
+		}
+#		endif//GLM_ARCH & GLM_ARCH_SSE2
+
+		for(; TexelIndex < TexelCount; ++TexelIndex)
+		{
+			bool Differ = false;
+			for(std::size_t Channel = 0; Channel < 3; ++Channel)
+			{
+				int const Diff = glm::abs(static_cast<int>(A[TexelIndex * 3 + Channel]) - static_cast<int>(B[TexelIndex * 3 + Channel]));
+				Result.SumSquared += static_cast<glm::uint64>(Diff * Diff);
+				Result.MaxError = std::max<glm::uint>(Result.MaxError, static_cast<glm::uint>(Diff));
+				Differ = Differ || static_cast<glm::uint>(Diff) > Threshold;
+			}
+			Result.DifferingTexels += Differ ? 1 : 0;
+		}
+	}
+
+	bool comparable(gli::texture2D const & Reference, gli::texture2D const & Generated)
+	{
+		return !Reference.empty() && !Generated.empty() &&
+			Reference.format() == gli::FORMAT_RGB8_UNORM_PACK8 &&
+			Generated.format() == gli::FORMAT_RGB8_UNORM_PACK8 &&
+			Reference.dimensions() == Generated.dimensions();
+	}
+}//namespace
+
+namespace compare
+{
+	gli::texture2D to_rgb8(gli::texture2D const & Texture)
+	{
+		assert(Texture.format() == gli::FORMAT_RGBA8_UNORM_PACK8);
+
+		return gli::convert(Texture, gli::FORMAT_RGB8_UNORM_PACK8);
+	}
+
+	metrics measure(gli::texture2D const & Reference, gli::texture2D const & Generated, glm::uint Threshold)
+	{
+		metrics Metrics;
+
+		if(!comparable(Reference, Generated))
+		{
+			Metrics.MeanSquaredError = 255.0 * 255.0;
+			Metrics.MaxError = 255;
+			Metrics.DifferingTexels = Generated.empty() ? 0 : static_cast<std::size_t>(Generated.dimensions().x * Generated.dimensions().y);
+			Metrics.DifferingPercent = 100.0;
+			return Metrics;
+		}
+
+		std::size_t const Width = static_cast<std::size_t>(Reference.dimensions().x);
+		std::size_t const Height = static_cast<std::size_t>(Reference.dimensions().y);
+		std::size_t const Pitch = Width * 3;
+		glm::u8 const * DataA = reinterpret_cast<glm::u8 const *>(Reference.data<glm::u8vec3>());
+		glm::u8 const * DataB = reinterpret_cast<glm::u8 const *>(Generated.data<glm::u8vec3>());
+
+		partial Total;
+		std::mutex Mutex;
+
+		parallel::for_range(0, Height, rows_per_task(Width), [&](std::size_t RowBegin, std::size_t RowEnd)
+		{
+			partial Partial;
+			for(std::size_t RowIndex = RowBegin; RowIndex < RowEnd; ++RowIndex)
+				compare_row(DataA + RowIndex * Pitch, DataB + RowIndex * Pitch, Width, Threshold, Partial);
+
+			std::lock_guard<std::mutex> Lock(Mutex);
+			Total.SumSquared += Partial.SumSquared;
+			Total.MaxError = std::max(Total.MaxError, Partial.MaxError);
+			Total.DifferingTexels += Partial.DifferingTexels;
+		});
+
+		std::size_t const TexelCount = Width * Height;
+		Metrics.MeanSquaredError = TexelCount ? static_cast<double>(Total.SumSquared) / static_cast<double>(TexelCount * 3) : 0.0;
+		Metrics.PSNR = Metrics.MeanSquaredError > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / Metrics.MeanSquaredError) : std::numeric_limits<double>::infinity();
+		Metrics.MaxError = Total.MaxError;
+		Metrics.DifferingTexels = Total.DifferingTexels;
+		Metrics.DifferingPercent = TexelCount ? 100.0 * static_cast<double>(Total.DifferingTexels) / static_cast<double>(TexelCount) : 0.0;
+
+		return Metrics;
+	}
+
+	bool accept(metrics const & Metrics, tolerance const & Tolerance)
+	{
+		return Metrics.MaxError <= Tolerance.MaxError &&
+			Metrics.DifferingPercent <= Tolerance.MaxDifferingPercent &&
+			Metrics.PSNR >= Tolerance.MinPSNR;
+	}
+
+	gli::texture2D heatmap(gli::texture2D const & Reference, gli::texture2D const & Generated)
+	{
+		if(!comparable(Reference, Generated))
+			return gli::texture2D();
+
+		// Errors are amplified eight times, like the absolute difference images used to be
+		std::array<glm::u8vec3, 256> Palette;
+		{
+			glm::vec3 const Ramp[] = {glm::vec3(0), glm::vec3(0, 0, 1), glm::vec3(1, 0, 0), glm::vec3(1, 1, 0), glm::vec3(1)};
+			for(std::size_t Error = 0; Error < Palette.size(); ++Error)
+			{
+				float const Scaled = glm::min(static_cast<float>(Error) * 8.f, 255.f) / 255.f * 4.f;
+				std::size_t const Index = std::min<std::size_t>(static_cast<std::size_t>(Scaled), 3);
+				Palette[Error] = glm::u8vec3(glm::mix(Ramp[Index], Ramp[Index + 1], Scaled - static_cast<float>(Index)) * 255.f + 0.5f);
+			}
+		}
+
+		gli::texture2D Result(gli::FORMAT_RGB8_UNORM_PACK8, Reference.dimensions(), 1, gli::default_allocator());
+
+		std::size_t const Width = static_cast<std::size_t>(Reference.dimensions().x);
+		glm::u8vec3 const * DataA = Reference.data<glm::u8vec3>();
+		glm::u8vec3 const * DataB = Generated.data<glm::u8vec3>();
+		glm::u8vec3 * DataResult = Result.data<glm::u8vec3>();
+
+		parallel::for_range(0, static_cast<std::size_t>(Reference.dimensions().y), rows_per_task(Width), [&](std::size_t RowBegin, std::size_t RowEnd)
+		{
+			for(std::size_t TexelIndex = RowBegin * Width, TexelEnd = RowEnd * Width; TexelIndex < TexelEnd; ++TexelIndex)
+			{
+				glm::ivec3 const Diff = glm::abs(glm::ivec3(DataA[TexelIndex]) - glm::ivec3(DataB[TexelIndex]));
+				DataResult[TexelIndex] = Palette[glm::max(Diff.x, glm::max(Diff.y, Diff.z))];
+			}
+		});
+
+		return Result;
+	}
+}//namespace compare
@@ -0,0 +1,95 @@
+///////////////////////////////////////////////////////////////////////////////////
+/// OpenGL Samples Pack (ogl-samples.g-truc.net)
+///
+/// Copyright (c) 2004 - 2014 G-Truc Creation (www.g-truc.net)
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+/// 
+/// The above copyright notice and this permission notice shall be included in
+/// all copies or substantial portions of the Software.
+/// 
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+/// THE SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#include <gli/gli.hpp>
+
+#include <cstddef>
+
+namespace compare
+{
+	/// Acceptance thresholds used to compare a rendered image against its template.
+	struct tolerance
+	{
+		tolerance() :
+			Threshold(2),
+			MaxError(32),
+			MaxDifferingPercent(0.5),
+			MinPSNR(40.0)
+		{}
+
+		tolerance(glm::uint Threshold, glm::uint MaxError, double MaxDifferingPercent, double MinPSNR) :
+			Threshold(Threshold),
+			MaxError(MaxError),
+			MaxDifferingPercent(MaxDifferingPercent),
+			MinPSNR(MinPSNR)
+		{}
+
+		/// Bit exact comparison
+		static tolerance exact()
+		{
+			return tolerance(0, 0, 0.0, 0.0);
+		}
+
+		/// A texel counts as differing when one of its channels differs by more than Threshold
+		glm::uint Threshold;
+		/// Largest per channel difference accepted
+		glm::uint MaxError;
+		/// Largest percentage of differing texels accepted
+		double MaxDifferingPercent;
+		/// Lowest peak signal to noise ratio accepted, in dB
+		double MinPSNR;
+	};
+
+	struct metrics
+	{
+		metrics() :
+			MeanSquaredError(0.0),
+			PSNR(0.0),
+			MaxError(0),
+			DifferingTexels(0),
+			DifferingPercent(0.0)
+		{}
+
+		double MeanSquaredError;
+		/// Infinite when both images are identical
+		double PSNR;
+		glm::uint MaxError;
+		std::size_t DifferingTexels;
+		double DifferingPercent;
+	};
+
+	/// Convert a RGBA8 texture to RGB8, rows are converted in parallel.
+	gli::texture2D to_rgb8(gli::texture2D const & Texture);
+
+	/// Compare two RGB8 textures of the first level, rows are compared in parallel.
+	/// Textures of different formats or dimensions are reported as entirely different.
+	metrics measure(gli::texture2D const & Reference, gli::texture2D const & Generated, glm::uint Threshold);
+
+	bool accept(metrics const & Metrics, tolerance const & Tolerance);
+
+	/// RGB8 visualization of the per texel error, black where both images match, then blue, red, yellow and white as the error grows.
+	gli::texture2D heatmap(gli::texture2D const & Reference, gli::texture2D const & Generated);
+}//namespace compare
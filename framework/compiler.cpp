@@ -10,13 +10,18 @@
 //**********************************
 
 #include "compiler.hpp"
+#include "util.hpp"
 
 #include <glm/gtc/random.hpp>
 
+#include <algorithm>
 #include <string>
 #include <sstream>
 #include <fstream>
 #include <cstdarg>
+#include <cstring>
+#include <memory>
+#include <mutex>
 
 std::string getDataDirectory();
 
@@ -92,83 +97,330 @@ std::string compiler::commandline::getDefines() const
 
 // compiler::parser
 
-std::string compiler::parser::operator()(commandline const & CommandLine, std::string const & Filename) const
+namespace
 {
-	std::string Source = loadFile(Filename);
-	assert(!Source.empty());
+	glm::uint64 const HashBasis = 14695981039346656037ull;
+	glm::uint64 const HashPrime = 1099511628211ull;
+
+	glm::uint64 hashBytes(char const * Data, std::size_t Size)
+	{
+		glm::uint64 Hash = HashBasis;
+		for(std::size_t i = 0; i < Size; ++i)
+			Hash = (Hash ^ static_cast<unsigned char>(Data[i])) * HashPrime;
+		return Hash;
+	}
 
-	std::stringstream Stream;
-	Stream << Source;
-	std::string Line, Text;
+	// Includes nested deeper are left out. Cycles never get that deep, an include of
+	// a file already being included is reported as a compile error instead.
+	std::size_t const MaxIncludeDepth = 32;
 
-	// Handle command line version and profile arguments
-	if(CommandLine.getVersion() != -1)
-		Text += format("#version %d %s\n", CommandLine.getVersion(), CommandLine.getProfile().c_str());
+	struct token
+	{
+		enum kind
+		{
+			TEXT,		// lines copied as they are, newlines included
+			VERSION,	// a #version line without its newline
+			INCLUDE		// the name between the quotes of an #include
+		};
+
+		kind Kind;
+		std::size_t Offset;
+		std::size_t Size;
+		std::size_t Line;	// first line of the token in the file
+		std::size_t Lines;	// lines of a TEXT token
+	};
+
+	struct source
+	{
+		std::string Text;
+		std::size_t Size;	// of the file, Text may end with a newline added to it
+		std::vector<token> Tokens;
+	};
+
+	// Files by content, two paths of the same text share it while they are cached
+	std::map<glm::uint64, std::weak_ptr<source const> > SourceCache;
+
+	struct cached_file
+	{
+		time_t Time;
+		std::shared_ptr<source const> Source;
+	};
+
+	std::map<std::string, cached_file> FileCache;
+	std::mutex CacheMutex;
 
-	// Handle command line defines
-	Text += CommandLine.getDefines();
+	enum directive
+	{
+		ABSENT,
+		PRESENT,
+		COMMENTED	// a // comment starts before it, the line is dropped as it always was
+	};
+
+	directive findDirective(char const * Begin, char const * End, char const * Word, char const *& Found)
+	{
+		Found = std::search(Begin, End, Word, Word + std::strlen(Word));
+		if(Found == End)
+			return ABSENT;
 
-	while(std::getline(Stream, Line))
+		char const Comment[] = "//";
+		return std::search(Begin, Found, Comment, Comment + 2) == Found ? PRESENT : COMMENTED;
+	}
+
+	std::shared_ptr<source const> tokenize(std::string && Text)
 	{
-		std::size_t Offset = 0;
+		std::shared_ptr<source> Source = std::make_shared<source>();
+		Source->Text = std::move(Text);
+		Source->Size = Source->Text.size();
+
+		char const * const Data = Source->Text.data();
+		std::size_t const Size = Source->Text.size();
 
-		// Version
-		Offset = Line.find("#version");
-		if(Offset != std::string::npos)
+		token Run = {token::TEXT, 0, 0, 1, 0};
+		std::size_t LineNumber = 1;
+
+		for(std::size_t Begin = 0; Begin < Size; ++LineNumber)
 		{
-			std::size_t CommentOffset = Line.find("//");
-			if(CommentOffset != std::string::npos && CommentOffset < Offset)
-				continue;
-
-			// Reorder so that the #version line is always the first of a shader text
-			if(CommandLine.getVersion() == -1)
-				Text = Line + std::string("\n") + Text;
-			// else skip is version is only mentionned
-			continue;
+			char const * NewLine = static_cast<char const *>(std::memchr(Data + Begin, '\n', Size - Begin));
+			std::size_t const End = NewLine ? static_cast<std::size_t>(NewLine - Data) : Size;
+			std::size_t const Next = NewLine ? End + 1 : Size;
+
+			// A #version line, commented or not, is never taken for an #include
+			char const * Found = nullptr;
+			directive Version = ABSENT, Include = ABSENT;
+			if(std::memchr(Data + Begin, '#', End - Begin))
+			{
+				Version = findDirective(Data + Begin, Data + End, "#version", Found);
+				if(Version == ABSENT)
+					Include = findDirective(Data + Begin, Data + End, "#include", Found);
+			}
+
+			if(Version != ABSENT || Include != ABSENT)
+			{
+				if(Run.Size > 0)
+					Source->Tokens.push_back(Run);
+
+				if(Version == PRESENT)
+				{
+					token VersionToken = {token::VERSION, Begin, End - Begin, LineNumber, 1};
+					Source->Tokens.push_back(VersionToken);
+				}
+				else if(Include == PRESENT)
+				{
+					char const * FirstQuote = std::find(Found, Data + End, '"');
+					char const * SecondQuote = FirstQuote == Data + End ? FirstQuote : std::find(FirstQuote + 1, Data + End, '"');
+					token IncludeToken = {token::INCLUDE, static_cast<std::size_t>(FirstQuote - Data) + 1, 0, LineNumber, 1};
+					IncludeToken.Size = SecondQuote > FirstQuote ? static_cast<std::size_t>(SecondQuote - FirstQuote) - 1 : 0;
+					Source->Tokens.push_back(IncludeToken);
+				}
+
+				Run.Offset = Next;
+				Run.Size = 0;
+				Run.Line = LineNumber + 1;
+				Run.Lines = 0;
+			}
+			else
+			{
+				Run.Size = Next - Run.Offset;
+				++Run.Lines;
+			}
+
+			Begin = Next;
 		}
 
-		// Include
-		Offset = Line.find("#include");
-		if(Offset != std::string::npos)
+		if(Run.Size > 0)
 		{
-			std::size_t CommentOffset = Line.find("//");
-			if(CommentOffset != std::string::npos && CommentOffset < Offset)
-				continue;
+			// The last line gets the newline getline used to add
+			if(Source->Text[Size - 1] != '\n')
+			{
+				Source->Text += '\n';
+				++Run.Size;
+			}
+			Source->Tokens.push_back(Run);
+		}
 
-			std::string Include = parseInclude(Line, Offset);
+		return Source;
+	}
+
+	// The tokens of Filename, read again only when it changed. nullptr if it can't be read or is empty
+	std::shared_ptr<source const> findSource(std::string const & Filename)
+	{
+		time_t const Time = path::modification_time(Filename);
+		if(Time == 0)
+			return nullptr;
 
-			std::vector<std::string> Includes = CommandLine.getIncludes();
+		std::lock_guard<std::mutex> Lock(CacheMutex);
 
-			for(std::size_t i = 0; i < Includes.size(); ++i)
+		std::map<std::string, cached_file>::iterator Cached = FileCache.find(Filename);
+		if(Cached != FileCache.end() && Cached->second.Time == Time)
+			return Cached->second.Source;
+
+		std::string Text = loadFile(Filename);
+		if(Text.empty())
+			return nullptr;
+
+		glm::uint64 const Hash = hashBytes(Text.data(), Text.size());
+		std::shared_ptr<source const> Source = SourceCache[Hash].lock();
+		if(!Source || Source->Size != Text.size() || Source->Text.compare(0, Text.size(), Text) != 0)
+		{
+			Source = tokenize(std::move(Text));
+			SourceCache[Hash] = Source;
+		}
+
+		cached_file & File = FileCache[Filename];
+		File.Time = Time;
+		File.Source = Source;
+		return Source;
+	}
+
+	// The pieces of the text in order, then copied once into a buffer of their size
+	struct piece
+	{
+		source const * Source;	// nullptr for the directives written by the parser
+		std::size_t Offset;
+		std::size_t Size;
+	};
+
+	struct assembly
+	{
+		std::vector<piece> Pieces;
+		std::string Directives;
+		std::vector<std::shared_ptr<source const> > Sources;	// the cache may drop an include while it is referred to
+		std::vector<std::string> const * Includes;
+		std::vector<std::string> * Read;
+		std::vector<std::string> Stack;	// paths of the files being included, the outermost first
+		std::size_t Files;
+		std::size_t File;	// file and next line the compiler counts, File is npos when unknown
+		std::size_t Line;
+
+		void directive(std::string const & Text)
+		{
+			piece Piece = {nullptr, this->Directives.size(), Text.size()};
+			this->Directives += Text;
+			this->Pieces.push_back(Piece);
+		}
+
+		void text(source const & Source, token const & Token, std::size_t FileIndex)
+		{
+			if(this->File != FileIndex || this->Line != Token.Line)
+				this->directive(format("#line %d %d\n", static_cast<int>(Token.Line), static_cast<int>(FileIndex)));
+
+			piece Piece = {&Source, Token.Offset, Token.Size};
+			this->Pieces.push_back(Piece);
+			this->File = FileIndex;
+			this->Line = Token.Line + Token.Lines;
+		}
+
+		// An #error on the line of the #include, so that the compile log points at it
+		void error(token const & Token, std::size_t FileIndex, std::string const & Message)
+		{
+			this->directive(format("#line %d %d\n#error %s\n", static_cast<int>(Token.Line), static_cast<int>(FileIndex), Message.c_str()));
+			this->File = FileIndex;
+			this->Line = Token.Line + 1;
+		}
+
+		void append(source const & Source, std::size_t FileIndex, std::size_t Depth)
+		{
+			for(std::size_t i = 0; i < Source.Tokens.size(); ++i)
 			{
-				std::string PathName = Includes[i] + Include;
-				std::string IncludeSource = loadFile(PathName);
-				if (!IncludeSource.empty())
+				token const & Token = Source.Tokens[i];
+				if(Token.Kind == token::TEXT)
+					this->text(Source, Token, FileIndex);
+				else if(Token.Kind == token::INCLUDE && Depth < MaxIncludeDepth)
 				{
-					Text += IncludeSource;
-					break;
+					std::string const Name = Source.Text.substr(Token.Offset, Token.Size);
+					for(std::size_t j = 0; j < this->Includes->size(); ++j)
+					{
+						std::string const Path = (*this->Includes)[j] + Name;
+						std::shared_ptr<source const> Include = findSource(Path);
+						if(!Include)
+							continue;
+
+						if(std::find(this->Stack.begin(), this->Stack.end(), Path) != this->Stack.end())
+						{
+							this->error(Token, FileIndex, "include cycle, " + Name + " is already being included");
+							break;
+						}
+
+						if(this->Read && std::find(this->Read->begin(), this->Read->end(), Path) == this->Read->end())
+							this->Read->push_back(Path);
+
+						this->Sources.push_back(Include);
+						this->Stack.push_back(Path);
+						this->append(*Include, ++this->Files, Depth + 1);
+						this->Stack.pop_back();
+						break;
+					}
 				}
 			}
+		}
+	};
+}//namespace
 
-			continue;
-		} 
+std::string compiler::parser::operator()(commandline const & CommandLine, std::string const & Filename) const
+{
+	glm::uint64 Hash = 0;
+	return (*this)(CommandLine, Filename, Hash);
+}
 
-		Text += Line + "\n";
+std::string compiler::parser::operator()(commandline const & CommandLine, std::string const & Filename, glm::uint64 & Hash, std::vector<std::string> * Files) const
+{
+	std::shared_ptr<source const> Source = findSource(Filename);
+	assert(Source);
+
+	std::vector<std::string> const Includes = CommandLine.getIncludes();
+
+	if(Files)
+		Files->assign(1, Filename);
+
+	assembly Assembly;
+	Assembly.Includes = &Includes;
+	Assembly.Read = Files;
+	Assembly.Stack.assign(1, Filename);
+	Assembly.Files = 0;
+	Assembly.File = std::string::npos;
+	Assembly.Line = 0;
+
+	// Command line version and profile arguments, or the #version line first of the text
+	if(CommandLine.getVersion() != -1)
+		Assembly.directive(format("#version %d %s\n", CommandLine.getVersion(), CommandLine.getProfile().c_str()));
+	else if(Source)
+	{
+		for(std::size_t i = 0; i < Source->Tokens.size(); ++i)
+			if(Source->Tokens[i].Kind == token::VERSION)
+			{
+				piece Piece = {Source.get(), Source->Tokens[i].Offset, Source->Tokens[i].Size};
+				Assembly.Pieces.push_back(Piece);
+				Assembly.directive("\n");
+				break;
+			}
 	}
 
-	//Text += glf::format("\nconst float G_TRUC_GNI = %f;\n", glm::linearRand(0.0f, 1.0f));
+	// Command line defines
+	Assembly.directive(CommandLine.getDefines());
+
+	if(Source)
+		Assembly.append(*Source, 0, 0);
+
+	std::size_t Size = 0;
+	for(std::size_t i = 0; i < Assembly.Pieces.size(); ++i)
+		Size += Assembly.Pieces[i].Size;
+
+	std::string Text;
+	Text.reserve(Size);
+	for(std::size_t i = 0; i < Assembly.Pieces.size(); ++i)
+	{
+		piece const & Piece = Assembly.Pieces[i];
+		Text.append((Piece.Source ? Piece.Source->Text : Assembly.Directives).data() + Piece.Offset, Piece.Size);
+	}
 
+	Hash = hashBytes(Text.data(), Text.size());
 	return Text;
 }
 
-std::string compiler::parser::parseInclude(std::string const & Line, std::size_t const & Offset) const
+void compiler::parser::invalidate(std::string const & Filename)
 {
-	std::string Result;
-
-	std::string::size_type IncludeFirstQuote = Line.find("\"", Offset);
-	std::string::size_type IncludeSecondQuote = Line.find("\"", IncludeFirstQuote + 1);
-
-	return Line.substr(IncludeFirstQuote + 1, IncludeSecondQuote - IncludeFirstQuote - 1);
+	std::lock_guard<std::mutex> Lock(CacheMutex);
+	FileCache.erase(Filename);
 }
 
 // compiler
@@ -183,7 +435,9 @@ GLuint compiler::create(GLenum Type, std::string const & Filename, std::string c
 	
 	commandline CommandLine(Filename, Arguments);
 
-	std::string PreprocessedSource = parser()(CommandLine, Filename);
+	glm::uint64 Hash = 0;
+	std::vector<std::string> Files;
+	std::string PreprocessedSource = parser()(CommandLine, Filename, Hash, &Files);
 	assert(!PreprocessedSource.empty());
 	char const * PreprocessedSourcePointer = PreprocessedSource.c_str();
 
@@ -201,6 +455,9 @@ GLuint compiler::create(GLenum Type, std::string const & Filename, std::string c
 	assert(ResultNames.second);
 	std::pair<names_map::iterator, bool> ResultChecks = this->PendingChecks.insert(std::make_pair(Filename, Name));
 	assert(ResultChecks.second);
+	this->ShaderHashes[Name] = Hash;
+	this->ShaderSources[Name].swap(Files);
+	this->ShaderArguments[Name] = Arguments;
 
 	return Name;
 }
@@ -212,6 +469,9 @@ bool compiler::destroy(GLuint const & Name)
 		return false; // Shader name not found
 	std::string File = NameIterator->second;
 	this->ShaderFiles.erase(NameIterator);
+	this->ShaderHashes.erase(Name);
+	this->ShaderSources.erase(Name);
+	this->ShaderArguments.erase(Name);
 
 	// Remove from the pending checks list
 	names_map::iterator PendingIterator = this->PendingChecks.find(File);
@@ -306,6 +566,29 @@ bool compiler::checkShader(GLuint const & Name) const
 	return Success;
 }
 
+glm::uint64 compiler::getSourceHash(GLuint const & Name) const
+{
+	hashes_map::const_iterator HashIterator = this->ShaderHashes.find(Name);
+	return HashIterator != this->ShaderHashes.end() ? HashIterator->second : 0;
+}
+
+std::vector<std::string> compiler::getSourceFiles(GLuint const & Name) const
+{
+	sources_map::const_iterator SourcesIterator = this->ShaderSources.find(Name);
+	return SourcesIterator != this->ShaderSources.end() ? SourcesIterator->second : std::vector<std::string>();
+}
+
+std::string compiler::getArguments(GLuint const & Name) const
+{
+	files_map::const_iterator ArgumentsIterator = this->ShaderArguments.find(Name);
+	return ArgumentsIterator != this->ShaderArguments.end() ? ArgumentsIterator->second : std::string();
+}
+
+void compiler::invalidate(std::string const & Filename)
+{
+	parser::invalidate(Filename);
+}
+
 void compiler::clear()
 {
 	for(
@@ -316,6 +599,9 @@ void compiler::clear()
 
 	this->ShaderNames.clear();
 	this->ShaderFiles.clear();
+	this->ShaderHashes.clear();
+	this->ShaderSources.clear();
+	this->ShaderArguments.clear();
 	this->PendingChecks.clear();
 }
 
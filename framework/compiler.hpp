@@ -37,6 +37,8 @@ class compiler
 {
 	typedef std::map<std::string, GLuint> names_map;
 	typedef std::map<GLuint, std::string> files_map;
+	typedef std::map<GLuint, glm::uint64> hashes_map;
+	typedef std::map<GLuint, std::vector<std::string> > sources_map;
 
 	class commandline
 	{
@@ -63,13 +65,20 @@ class compiler
 		std::vector<std::string> Includes;
 	};
 
+	// Source files are split once into runs of lines and directives, cached by
+	// content and revalidated by modification time, so the includes shared by
+	// shaders are read and scanned once. #line directives keep the lines of the
+	// errors, the source string number is the order in which the files are included.
 	class parser
 	{
 	public:
 		std::string operator() (commandline const & CommandLine, std::string const & Filename) const;
 
-	private:
-		std::string parseInclude(std::string const & Line, std::size_t const & Offset) const;
+		// Hash is set to a 64 bits FNV-1a hash of the returned text, Files to the files read, Filename first
+		std::string operator() (commandline const & CommandLine, std::string const & Filename, glm::uint64 & Hash, std::vector<std::string> * Files = nullptr) const;
+
+		// Read Filename again the next time it is preprocessed, even if its modification time is the same
+		static void invalidate(std::string const & Filename);
 	};
 
 public:
@@ -82,11 +91,26 @@ public:
 	bool validateProgram(GLuint ProgramName) const;
 	bool checkShader(GLuint const & Name) const;
 
+	// Hash of the preprocessed text of a shader, the same text has the same hash, 0 if Name isn't one
+	glm::uint64 getSourceHash(GLuint const & Name) const;
+
+	// Files the text of a shader was preprocessed from, its file first then the includes
+	std::vector<std::string> getSourceFiles(GLuint const & Name) const;
+
+	// Arguments a shader was created with, to create it again with the same defines
+	std::string getArguments(GLuint const & Name) const;
+
+	// Forget the preprocessed Filename, the shaders created from now on read it again
+	static void invalidate(std::string const & Filename);
+
 	void clear();
 
 private:
 	names_map ShaderNames;
 	files_map ShaderFiles;
+	hashes_map ShaderHashes;
+	sources_map ShaderSources;
+	files_map ShaderArguments;
 	names_map PendingChecks;
 };
 
@@ -0,0 +1,181 @@
+///////////////////////////////////////////////////////////////////////////////////
+/// OpenGL Samples Pack (ogl-samples.g-truc.net)
+///
+/// Copyright (c) 2004 - 2014 G-Truc Creation (www.g-truc.net)
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+/// 
+/// The above copyright notice and this permission notice shall be included in
+/// all copies or substantial portions of the Software.
+/// 
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+/// THE SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////
+
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	class pool
+	{
+	public:
+		pool() :
+			Stop(false)
+		{
+			unsigned const WorkerCount = std::max(std::thread::hardware_concurrency(), 1u) - 1u;
+			for(unsigned WorkerIndex = 0; WorkerIndex < WorkerCount; ++WorkerIndex)
+				this->Workers.emplace_back([this]{this->run();});
+		}
+
+		~pool()
+		{
+			{
+				std::lock_guard<std::mutex> Lock(this->Mutex);
+				this->Stop = true;
+			}
+			this->Condition.notify_all();
+
+			for(std::thread & Worker : this->Workers)
+				Worker.join();
+		}
+
+		std::size_t size() const
+		{
+			return this->Workers.size();
+		}
+
+		void push(std::function<void()> Task)
+		{
+			{
+				std::lock_guard<std::mutex> Lock(this->Mutex);
+				this->Tasks.push_back(std::move(Task));
+			}
+			this->Condition.notify_one();
+		}
+
+	private:
+		void run()
+		{
+			for(;;)
+			{
+				std::function<void()> Task;
+				{
+					std::unique_lock<std::mutex> Lock(this->Mutex);
+					this->Condition.wait(Lock, [this]{return this->Stop || !this->Tasks.empty();});
+					if(this->Stop && this->Tasks.empty())
+						return;
+
+					Task = std::move(this->Tasks.front());
+					this->Tasks.pop_front();
+				}
+				Task();
+			}
+		}
+
+		std::vector<std::thread> Workers;
+		std::deque<std::function<void()>> Tasks;
+		std::mutex Mutex;
+		std::condition_variable Condition;
+		bool Stop;
+	};
+
+	pool & instance()
+	{
+		static pool Pool;
+		return Pool;
+	}
+
+	// Shared between the caller and the helpers it queued, helpers may start after the caller returned
+	struct range_job
+	{
+		std::size_t Begin;
+		std::size_t End;
+		std::size_t ChunkSize;
+		std::size_t ChunkCount;
+		std::function<void(std::size_t, std::size_t)> const * Task;
+		std::atomic<std::size_t> NextChunk;
+		std::atomic<std::size_t> DoneChunks;
+
+		void work()
+		{
+			for(std::size_t ChunkIndex = this->NextChunk++; ChunkIndex < this->ChunkCount; ChunkIndex = this->NextChunk++)
+			{
+				std::size_t const ChunkBegin = this->Begin + ChunkIndex * this->ChunkSize;
+				(*this->Task)(ChunkBegin, std::min(ChunkBegin + this->ChunkSize, this->End));
+				++this->DoneChunks;
+			}
+		}
+	};
+}//namespace
+
+namespace parallel
+{
+	std::size_t concurrency()
+	{
+		return instance().size() + 1;
+	}
+
+	void for_range(std::size_t Begin, std::size_t End, std::size_t Grain, std::function<void(std::size_t, std::size_t)> const & Task)
+	{
+		if(Begin >= End)
+			return;
+
+		pool & Pool = instance();
+		std::size_t const Count = End - Begin;
+		std::size_t const ThreadCount = Pool.size() + 1;
+
+		// A few chunks per thread so that uneven chunks balance out
+		std::size_t const ChunkSize = std::max(std::max<std::size_t>(Grain, 1), (Count + ThreadCount * 4 - 1) / (ThreadCount * 4));
+		std::size_t const ChunkCount = (Count + ChunkSize - 1) / ChunkSize;
+
+		if(ChunkCount == 1 || Pool.size() == 0)
+		{
+			Task(Begin, End);
+			return;
+		}
+
+		std::shared_ptr<range_job> Job = std::make_shared<range_job>();
+		Job->Begin = Begin;
+		Job->End = End;
+		Job->ChunkSize = ChunkSize;
+		Job->ChunkCount = ChunkCount;
+		Job->Task = &Task;
+		Job->NextChunk = 0;
+		Job->DoneChunks = 0;
+
+		for(std::size_t HelperIndex = 0, HelperCount = std::min(Pool.size(), ChunkCount - 1); HelperIndex < HelperCount; ++HelperIndex)
+			Pool.push([Job]{Job->work();});
+
+		Job->work();
+
+		while(Job->DoneChunks < ChunkCount)
+			std::this_thread::yield();
+	}
+
+	void async(std::function<void()> Task)
+	{
+		pool & Pool = instance();
+		if(Pool.size() == 0)
+			Task();
+		else
+			Pool.push(std::move(Task));
+	}
+}//namespace parallel
@@ -22,7 +22,15 @@
 ///////////////////////////////////////////////////////////////////////////////////
 
 #include "png.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <queue>
+#include <vector>
 
 //namespace
 //{
@@ -88,42 +96,619 @@ gli::texture2D load_png(char const * Filename)
 	return gli::texture2D();
 }
 
-void save_png(gli::texture2D const & Texture, char const * Filename)
+namespace
 {
-	//gli::texture2D Copy(gli::copy(Texture));
+	// Rows compressed together as one independent deflate stream, the streams are joined with sync flushes
+	std::size_t const STRIP_BYTES(1 << 18);
+	// Tokens coded with a single set of Huffman trees
+	std::size_t const BLOCK_TOKENS(1 << 16);
 
-	//switch(gli::component_count(Copy.format()))
-	//{
-	//default:
-	//	assert(0);
-	//	break;
-	//case 3:
-	//	for(std::size_t Offset = 0; Offset < Copy.size() / 3; ++Offset)
-	//	{
-	//		glm::u8vec3 Src = *(static_cast<glm::u8vec3 const *>(Copy.data()) + Offset);
-	//		*(static_cast<glm::u8vec3*>(Copy.data()) + Offset) = glm::u8vec3(Src.z, Src.y, Src.x);
-	//	}
-	//	break;
-	//case 4:
-	//	for(std::size_t Offset = 0; Offset < Copy.size() / 4; ++Offset)
-	//	{
-	//		glm::u8vec4 Src = *(static_cast<glm::u8vec4 const *>(Copy.data()) + Offset);
-	//		*(static_cast<glm::u8vec4*>(Copy.data()) + Offset) = glm::u8vec4(Src.z, Src.y, Src.x, Src.w);
-	//	}
-	//	break;
-	//}
+	std::size_t const WINDOW_SIZE(1 << 15);
+	std::size_t const HASH_BITS(15);
+	std::size_t const MAX_CHAIN(64);
+	std::size_t const MIN_MATCH(3);
+	std::size_t const MAX_MATCH(258);
 
-	//FreeImageInit();
+	glm::uint16 const LENGTH_BASE[] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+	glm::uint8 const LENGTH_EXTRA[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+	glm::uint16 const DISTANCE_BASE[] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+	glm::uint8 const DISTANCE_EXTRA[] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+	glm::uint8 const CODE_LENGTH_ORDER[] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
 
-	//FIBITMAP* Bitmap = FreeImage_ConvertFromRawBits(
-	//	Copy.data<BYTE>(),
-	//	Copy.dimensions().x, Copy.dimensions().y,
-	//	static_cast<int>(Copy.dimensions().x * gli::component_count(Copy.format())),
-	//	static_cast<unsigned int>(gli::component_count(Copy.format()) * 8), 0x0000FF, 0x00FF00, 0xFF0000, false);
+	glm::uint32 crc32(glm::uint32 Crc, glm::byte const * Data, std::size_t Size)
+	{
+		static std::array<glm::uint32, 256> const Table = []
+		{
+			std::array<glm::uint32, 256> Result;
+			for(glm::uint32 Index = 0; Index < 256; ++Index)
+			{
+				glm::uint32 Value = Index;
+				for(int Bit = 0; Bit < 8; ++Bit)
+					Value = (Value & 1) ? 0xEDB88320u ^ (Value >> 1) : Value >> 1;
+				Result[Index] = Value;
+			}
+			return Result;
+		}();
 
-	//BOOL Result = FreeImage_Save(FIF_PNG, Bitmap, Filename, 0);
-	//assert(Result);
+		Crc = ~Crc;
+		for(std::size_t Index = 0; Index < Size; ++Index)
+			Crc = Table[(Crc ^ Data[Index]) & 0xFF] ^ (Crc >> 8);
+		return ~Crc;
+	}
 
-	//FreeImage_Unload(Bitmap);
-}
+	glm::uint32 const ADLER_BASE(65521);
+
+	glm::uint32 adler32(glm::byte const * Data, std::size_t Size)
+	{
+		glm::uint32 A = 1, B = 0;
+		while(Size > 0)
+		{
+			// Largest run that cannot overflow B before the modulo
+			std::size_t const Run = std::min<std::size_t>(Size, 5552);
+			for(std::size_t Index = 0; Index < Run; ++Index)
+			{
+				A += Data[Index];
+				B += A;
+			}
+			A %= ADLER_BASE;
+			B %= ADLER_BASE;
+			Data += Run;
+			Size -= Run;
+		}
+		return (B << 16) | A;
+	}
+
+	// Checksum of the concatenation of two buffers from their checksums, SizeB being the size of the second buffer
+	glm::uint32 adler32_combine(glm::uint32 AdlerA, glm::uint32 AdlerB, std::size_t SizeB)
+	{
+		glm::uint32 const Remainder = static_cast<glm::uint32>(SizeB % ADLER_BASE);
+		glm::uint32 Sum1 = AdlerA & 0xFFFF;
+		glm::uint32 Sum2 = static_cast<glm::uint32>((static_cast<glm::uint64>(Remainder) * Sum1) % ADLER_BASE);
+		Sum1 += (AdlerB & 0xFFFF) + ADLER_BASE - 1;
+		Sum2 += ((AdlerA >> 16) & 0xFFFF) + ((AdlerB >> 16) & 0xFFFF) + ADLER_BASE - Remainder;
+		if(Sum1 >= ADLER_BASE)
+			Sum1 -= ADLER_BASE;
+		if(Sum1 >= ADLER_BASE)
+			Sum1 -= ADLER_BASE;
+		if(Sum2 >= (ADLER_BASE << 1))
+			Sum2 -= (ADLER_BASE << 1);
+		if(Sum2 >= ADLER_BASE)
+			Sum2 -= ADLER_BASE;
+		return Sum1 | (Sum2 << 16);
+	}
+
+	class bit_writer
+	{
+	public:
+		explicit bit_writer(std::vector<glm::byte> & Output) :
+			Output(Output),
+			Bits(0),
+			Count(0)
+		{}
+
+		// Deflate packs values starting from the least significant bit
+		void write(glm::uint32 Value, glm::uint Size)
+		{
+			this->Bits |= static_cast<glm::uint64>(Value) << this->Count;
+			this->Count += Size;
+			while(this->Count >= 8)
+			{
+				this->Output.push_back(static_cast<glm::byte>(this->Bits & 0xFF));
+				this->Bits >>= 8;
+				this->Count -= 8;
+			}
+		}
+
+		void align()
+		{
+			if(this->Count > 0)
+				this->write(0, 8 - this->Count);
+		}
+
+	private:
+		std::vector<glm::byte> & Output;
+		glm::uint64 Bits;
+		glm::uint Count;
+	};
+
+	struct huffman
+	{
+		std::vector<glm::uint8> Lengths;
+		// Bit reversed so that they can be written least significant bit first
+		std::vector<glm::uint16> Codes;
+	};
+
+	// Length limited Huffman code, frequencies are flattened until the tree is shallow enough
+	huffman build_huffman(std::vector<glm::uint32> Frequencies, glm::uint MaxBits)
+	{
+		std::size_t const SymbolCount = Frequencies.size();
+		huffman Huffman;
+		Huffman.Lengths.assign(SymbolCount, 0);
+		Huffman.Codes.assign(SymbolCount, 0);
+
+		// Inflaters expect at least two codes, a lone symbol is paired with a dummy one
+		std::size_t UsedCount = static_cast<std::size_t>(std::count_if(Frequencies.begin(), Frequencies.end(), [](glm::uint32 Frequency){return Frequency > 0;}));
+		for(std::size_t Symbol = 0; UsedCount < 2 && Symbol < SymbolCount; ++Symbol)
+			if(Frequencies[Symbol] == 0)
+			{
+				Frequencies[Symbol] = 1;
+				++UsedCount;
+			}
+
+		for(;;)
+		{
+			typedef std::pair<glm::uint64, std::size_t> node;
+			std::priority_queue<node, std::vector<node>, std::greater<node>> Queue;
+			std::vector<std::size_t> Parents(SymbolCount, 0);
+
+			for(std::size_t Symbol = 0; Symbol < SymbolCount; ++Symbol)
+				if(Frequencies[Symbol] > 0)
+					Queue.push(node(Frequencies[Symbol], Symbol));
+
+			while(Queue.size() > 1)
+			{
+				node const A = Queue.top();
+				Queue.pop();
+				node const B = Queue.top();
+				Queue.pop();
+
+				std::size_t const Parent = Parents.size();
+				Parents.push_back(0);
+				Parents[A.second] = Parent;
+				Parents[B.second] = Parent;
+				Queue.push(node(A.first + B.first, Parent));
+			}
+
+			std::size_t const Root = Queue.top().second;
+			glm::uint MaxLength = 0;
+			for(std::size_t Symbol = 0; Symbol < SymbolCount; ++Symbol)
+			{
+				if(Frequencies[Symbol] == 0)
+					continue;
+
+				glm::uint Length = 0;
+				for(std::size_t Node = Symbol; Node != Root; Node = Parents[Node])
+					++Length;
+				Huffman.Lengths[Symbol] = static_cast<glm::uint8>(std::min<glm::uint>(Length, 255));
+				MaxLength = std::max(MaxLength, Length);
+			}
+
+			if(MaxLength <= MaxBits)
+				break;
+
+			for(glm::uint32 & Frequency : Frequencies)
+				if(Frequency > 0)
+					Frequency = (Frequency >> 1) | 1;
+		}
+
+		// Canonical codes, RFC 1951 section 3.2.2
+		std::array<glm::uint16, 16> LengthCount;
+		std::array<glm::uint16, 16> NextCode;
+		LengthCount.fill(0);
+		NextCode.fill(0);
+		for(glm::uint8 Length : Huffman.Lengths)
+			++LengthCount[Length];
+		LengthCount[0] = 0;
+
+		glm::uint16 Code = 0;
+		for(std::size_t Bits = 1; Bits < 16; ++Bits)
+		{
+			Code = static_cast<glm::uint16>((Code + LengthCount[Bits - 1]) << 1);
+			NextCode[Bits] = Code;
+		}
+
+		for(std::size_t Symbol = 0; Symbol < SymbolCount; ++Symbol)
+		{
+			glm::uint const Length = Huffman.Lengths[Symbol];
+			if(Length == 0)
+				continue;
+
+			glm::uint16 const Canonical = NextCode[Length]++;
+			glm::uint16 Reversed = 0;
+			for(glm::uint Bit = 0; Bit < Length; ++Bit)
+				Reversed |= ((Canonical >> Bit) & 1) << (Length - 1 - Bit);
+			Huffman.Codes[Symbol] = Reversed;
+		}
+
+		return Huffman;
+	}
+
+	// Distance 0 marks a literal
+	struct token
+	{
+		glm::uint16 Value;
+		glm::uint16 Distance;
+	};
+
+	inline std::size_t length_code(std::size_t Length)
+	{
+		return static_cast<std::size_t>(std::upper_bound(LENGTH_BASE, LENGTH_BASE + 29, Length) - LENGTH_BASE) - 1;
+	}
+
+	inline std::size_t distance_code(std::size_t Distance)
+	{
+		return static_cast<std::size_t>(std::upper_bound(DISTANCE_BASE, DISTANCE_BASE + 30, Distance) - DISTANCE_BASE) - 1;
+	}
+
+	void match(glm::byte const * Data, std::size_t Size, std::vector<token> & Tokens)
+	{
+		std::size_t const HashSize = std::size_t(1) << HASH_BITS;
+		std::vector<glm::int32> Head(HashSize, -1);
+		std::vector<glm::int32> Previous(Size, -1);
+
+		auto hash = [&](std::size_t Position)
+		{
+			glm::uint32 const Value = Data[Position] | (Data[Position + 1] << 8) | (Data[Position + 2] << 16);
+			return static_cast<std::size_t>((Value * 2654435761u) >> (32 - HASH_BITS));
+		};
+
+		auto insert = [&](std::size_t Position)
+		{
+			if(Position + MIN_MATCH > Size)
+				return;
+			std::size_t const Hash = hash(Position);
+			Previous[Position] = Head[Hash];
+			Head[Hash] = static_cast<glm::int32>(Position);
+		};
+
+		Tokens.reserve(Tokens.size() + Size / 2);
+
+		for(std::size_t Position = 0; Position < Size;)
+		{
+			std::size_t BestLength = 0;
+			std::size_t BestDistance = 0;
+
+			if(Position + MIN_MATCH <= Size)
+			{
+				std::size_t const Limit = std::min(MAX_MATCH, Size - Position);
+				glm::int32 Candidate = Head[hash(Position)];
+				for(std::size_t Chain = 0; Candidate >= 0 && Chain < MAX_CHAIN; ++Chain, Candidate = Previous[Candidate])
+				{
+					std::size_t const Distance = Position - static_cast<std::size_t>(Candidate);
+					if(Distance > WINDOW_SIZE)
+						break;
 
+					glm::byte const * A = Data + Candidate;
+					glm::byte const * B = Data + Position;
+					if(A[BestLength] != B[BestLength])
+						continue;
+
+					std::size_t Length = 0;
+					while(Length < Limit && A[Length] == B[Length])
+						++Length;
+
+					if(Length > BestLength)
+					{
+						BestLength = Length;
+						BestDistance = Distance;
+						if(Length == Limit)
+							break;
+					}
+				}
+			}
+
+			if(BestLength >= MIN_MATCH)
+			{
+				token const Token = {static_cast<glm::uint16>(BestLength), static_cast<glm::uint16>(BestDistance)};
+				Tokens.push_back(Token);
+				for(std::size_t Offset = 0; Offset < BestLength; ++Offset)
+					insert(Position + Offset);
+				Position += BestLength;
+			}
+			else
+			{
+				token const Token = {Data[Position], 0};
+				Tokens.push_back(Token);
+				insert(Position);
+				++Position;
+			}
+		}
+	}
+
+	void write_block(bit_writer & Writer, token const * Tokens, std::size_t TokenCount, bool Final)
+	{
+		std::vector<glm::uint32> LiteralFrequencies(286, 0);
+		std::vector<glm::uint32> DistanceFrequencies(30, 0);
+		for(std::size_t TokenIndex = 0; TokenIndex < TokenCount; ++TokenIndex)
+		{
+			token const & Token = Tokens[TokenIndex];
+			if(Token.Distance == 0)
+				++LiteralFrequencies[Token.Value];
+			else
+			{
+				++LiteralFrequencies[257 + length_code(Token.Value)];
+				++DistanceFrequencies[distance_code(Token.Distance)];
+			}
+		}
+		LiteralFrequencies[256] = 1;
+
+		huffman const Literals = build_huffman(LiteralFrequencies, 15);
+		huffman const Distances = build_huffman(DistanceFrequencies, 15);
+
+		std::size_t LiteralCount = 286;
+		while(LiteralCount > 257 && Literals.Lengths[LiteralCount - 1] == 0)
+			--LiteralCount;
+		std::size_t DistanceCount = 30;
+		while(DistanceCount > 1 && Distances.Lengths[DistanceCount - 1] == 0)
+			--DistanceCount;
+
+		// Run length encoding of both code length sequences, RFC 1951 section 3.2.7
+		std::vector<glm::uint8> Lengths(Literals.Lengths.begin(), Literals.Lengths.begin() + LiteralCount);
+		Lengths.insert(Lengths.end(), Distances.Lengths.begin(), Distances.Lengths.begin() + DistanceCount);
+
+		std::vector<std::pair<glm::uint8, glm::uint8>> Runs;
+		for(std::size_t Index = 0; Index < Lengths.size();)
+		{
+			glm::uint8 const Length = Lengths[Index];
+			std::size_t Run = 1;
+			while(Index + Run < Lengths.size() && Lengths[Index + Run] == Length)
+				++Run;
+
+			if(Length == 0 && Run >= 11)
+			{
+				Run = std::min<std::size_t>(Run, 138);
+				Runs.push_back(std::make_pair(glm::uint8(18), static_cast<glm::uint8>(Run - 11)));
+			}
+			else if(Length == 0 && Run >= 3)
+				Runs.push_back(std::make_pair(glm::uint8(17), static_cast<glm::uint8>(Run - 3)));
+			else if(Length != 0 && Run >= 4)
+			{
+				Run = std::min<std::size_t>(Run, 7);
+				Runs.push_back(std::make_pair(Length, glm::uint8(0)));
+				Runs.push_back(std::make_pair(glm::uint8(16), static_cast<glm::uint8>(Run - 4)));
+			}
+			else
+			{
+				Run = 1;
+				Runs.push_back(std::make_pair(Length, glm::uint8(0)));
+			}
+			Index += Run;
+		}
+
+		std::vector<glm::uint32> CodeLengthFrequencies(19, 0);
+		for(std::pair<glm::uint8, glm::uint8> const & Run : Runs)
+			++CodeLengthFrequencies[Run.first];
+		huffman const CodeLengths = build_huffman(CodeLengthFrequencies, 7);
+
+		std::size_t CodeLengthCount = 19;
+		while(CodeLengthCount > 4 && CodeLengths.Lengths[CODE_LENGTH_ORDER[CodeLengthCount - 1]] == 0)
+			--CodeLengthCount;
+
+		Writer.write(Final ? 1 : 0, 1);
+		Writer.write(2, 2);
+		Writer.write(static_cast<glm::uint32>(LiteralCount - 257), 5);
+		Writer.write(static_cast<glm::uint32>(DistanceCount - 1), 5);
+		Writer.write(static_cast<glm::uint32>(CodeLengthCount - 4), 4);
+		for(std::size_t Index = 0; Index < CodeLengthCount; ++Index)
+			Writer.write(CodeLengths.Lengths[CODE_LENGTH_ORDER[Index]], 3);
+
+		glm::uint const RunExtra[] = {2, 3, 7};
+		for(std::pair<glm::uint8, glm::uint8> const & Run : Runs)
+		{
+			Writer.write(CodeLengths.Codes[Run.first], CodeLengths.Lengths[Run.first]);
+			if(Run.first >= 16)
+				Writer.write(Run.second, RunExtra[Run.first - 16]);
+		}
+
+		for(std::size_t TokenIndex = 0; TokenIndex < TokenCount; ++TokenIndex)
+		{
+			token const & Token = Tokens[TokenIndex];
+			if(Token.Distance == 0)
+			{
+				Writer.write(Literals.Codes[Token.Value], Literals.Lengths[Token.Value]);
+				continue;
+			}
+
+			std::size_t const LengthCode = length_code(Token.Value);
+			Writer.write(Literals.Codes[257 + LengthCode], Literals.Lengths[257 + LengthCode]);
+			Writer.write(static_cast<glm::uint32>(Token.Value - LENGTH_BASE[LengthCode]), LENGTH_EXTRA[LengthCode]);
+
+			std::size_t const DistanceCode = distance_code(Token.Distance);
+			Writer.write(Distances.Codes[DistanceCode], Distances.Lengths[DistanceCode]);
+			Writer.write(static_cast<glm::uint32>(Token.Distance - DISTANCE_BASE[DistanceCode]), DISTANCE_EXTRA[DistanceCode]);
+		}
+
+		Writer.write(Literals.Codes[256], Literals.Lengths[256]);
+	}
+
+	// Raw deflate data of an independent strip. Strips that are not the last end with an empty stored block
+	// (a sync flush) so that they are byte aligned and can be concatenated.
+	void deflate_strip(glm::byte const * Data, std::size_t Size, bool Last, std::vector<glm::byte> & Output)
+	{
+		std::vector<token> Tokens;
+		match(Data, Size, Tokens);
+
+		bit_writer Writer(Output);
+		if(Tokens.empty())
+			write_block(Writer, nullptr, 0, Last);
+		for(std::size_t TokenIndex = 0; TokenIndex < Tokens.size(); TokenIndex += BLOCK_TOKENS)
+		{
+			std::size_t const TokenCount = std::min(BLOCK_TOKENS, Tokens.size() - TokenIndex);
+			write_block(Writer, &Tokens[TokenIndex], TokenCount, Last && TokenIndex + TokenCount == Tokens.size());
+		}
+
+		if(!Last)
+		{
+			Writer.write(0, 1);
+			Writer.write(0, 2);
+			Writer.align();
+			Writer.write(0x0000, 16);
+			Writer.write(0xFFFF, 16);
+		}
+		Writer.align();
+	}
+
+	inline glm::byte paeth(glm::byte A, glm::byte B, glm::byte C)
+	{
+		int const P = static_cast<int>(A) + static_cast<int>(B) - static_cast<int>(C);
+		int const PA = glm::abs(P - static_cast<int>(A));
+		int const PB = glm::abs(P - static_cast<int>(B));
+		int const PC = glm::abs(P - static_cast<int>(C));
+		return (PA <= PB && PA <= PC) ? A : (PB <= PC ? B : C);
+	}
+
+	// Filters a row with each PNG filter type and keeps the one with the smallest sum of absolute values
+	void filter_row(glm::byte const * Row, glm::byte const * Above, std::size_t Size, std::size_t Stride, glm::byte * Output, std::vector<glm::byte> & Scratch)
+	{
+		Scratch.resize(Size);
+		std::size_t BestSum = ~std::size_t(0);
+
+		for(glm::byte Type = 0; Type < 5; ++Type)
+		{
+			std::size_t Sum = 0;
+			for(std::size_t Index = 0; Index < Size; ++Index)
+			{
+				glm::byte const Left = Index >= Stride ? Row[Index - Stride] : 0;
+				glm::byte const Up = Above ? Above[Index] : 0;
+				glm::byte const UpLeft = Above && Index >= Stride ? Above[Index - Stride] : 0;
+
+				glm::byte Predictor = 0;
+				switch(Type)
+				{
+				case 1: Predictor = Left; break;
+				case 2: Predictor = Up; break;
+				case 3: Predictor = static_cast<glm::byte>((static_cast<int>(Left) + static_cast<int>(Up)) >> 1); break;
+				case 4: Predictor = paeth(Left, Up, UpLeft); break;
+				}
+
+				glm::byte const Value = static_cast<glm::byte>(Row[Index] - Predictor);
+				Scratch[Index] = Value;
+				Sum += Value < 128 ? Value : 256 - Value;
+			}
+
+			if(Sum < BestSum)
+			{
+				BestSum = Sum;
+				Output[0] = Type;
+				std::memcpy(Output + 1, &Scratch[0], Size);
+			}
+		}
+	}
+
+	void write_chunk(FILE* File, char const * Type, glm::byte const * Data, std::size_t Size)
+	{
+		glm::byte Header[8] =
+		{
+			static_cast<glm::byte>(Size >> 24), static_cast<glm::byte>(Size >> 16), static_cast<glm::byte>(Size >> 8), static_cast<glm::byte>(Size),
+			static_cast<glm::byte>(Type[0]), static_cast<glm::byte>(Type[1]), static_cast<glm::byte>(Type[2]), static_cast<glm::byte>(Type[3])
+		};
+
+		glm::uint32 const Crc = crc32(crc32(0, Header + 4, 4), Data, Size);
+		glm::byte const Footer[4] = {static_cast<glm::byte>(Crc >> 24), static_cast<glm::byte>(Crc >> 16), static_cast<glm::byte>(Crc >> 8), static_cast<glm::byte>(Crc)};
+
+		std::fwrite(Header, 1, sizeof(Header), File);
+		if(Size > 0)
+			std::fwrite(Data, 1, Size, File);
+		std::fwrite(Footer, 1, sizeof(Footer), File);
+	}
+
+	inline void append_uint32(std::vector<glm::byte> & Output, glm::uint32 Value)
+	{
+		Output.push_back(static_cast<glm::byte>(Value >> 24));
+		Output.push_back(static_cast<glm::byte>(Value >> 16));
+		Output.push_back(static_cast<glm::byte>(Value >> 8));
+		Output.push_back(static_cast<glm::byte>(Value));
+	}
+}//namespace
+
+bool save_png(gli::texture2D const & Texture, char const * Filename)
+{
+	std::size_t Components = 0;
+	switch(Texture.format())
+	{
+	case gli::FORMAT_RGB8_UNORM_PACK8:
+	case gli::FORMAT_RGB8_SRGB_PACK8:
+		Components = 3;
+		break;
+	case gli::FORMAT_RGBA8_UNORM_PACK8:
+	case gli::FORMAT_RGBA8_SRGB_PACK8:
+		Components = 4;
+		break;
+	default:
+		fprintf(stdout, "save_png: unsupported format for %s\n", Filename);
+		return false;
+	}
+
+	std::size_t const Width = static_cast<std::size_t>(Texture.dimensions().x);
+	std::size_t const Height = static_cast<std::size_t>(Texture.dimensions().y);
+	std::size_t const Pitch = Width * Components;
+	glm::byte const * Data = static_cast<glm::byte const *>(Texture.data(0, 0, 0));
+
+	// PNG stores rows top to bottom, OpenGL read backs are bottom to top
+	auto row = [&](std::size_t Row)
+	{
+		return Data + (Height - 1 - Row) * Pitch;
+	};
+
+	std::size_t const StripRows = std::max<std::size_t>(STRIP_BYTES / (Pitch + 1), 1);
+	std::size_t const StripCount = (Height + StripRows - 1) / StripRows;
+
+	std::vector<std::vector<glm::byte>> Strips(StripCount);
+	std::vector<glm::uint32> Adlers(StripCount, 1);
+	std::vector<std::size_t> Sizes(StripCount, 0);
+
+	parallel::for_range(0, StripCount, 1, [&](std::size_t StripBegin, std::size_t StripEnd)
+	{
+		std::vector<glm::byte> Filtered;
+		std::vector<glm::byte> Scratch;
+
+		for(std::size_t StripIndex = StripBegin; StripIndex < StripEnd; ++StripIndex)
+		{
+			std::size_t const RowBegin = StripIndex * StripRows;
+			std::size_t const RowEnd = std::min(RowBegin + StripRows, Height);
+
+			Filtered.resize((RowEnd - RowBegin) * (Pitch + 1));
+			for(std::size_t Row = RowBegin; Row < RowEnd; ++Row)
+				filter_row(row(Row), Row > 0 ? row(Row - 1) : nullptr, Pitch, Components, &Filtered[(Row - RowBegin) * (Pitch + 1)], Scratch);
+
+			deflate_strip(Filtered.data(), Filtered.size(), StripIndex + 1 == StripCount, Strips[StripIndex]);
+			Adlers[StripIndex] = adler32(Filtered.data(), Filtered.size());
+			Sizes[StripIndex] = Filtered.size();
+		}
+	});
+
+	// zlib stream: header for a 32K window, the concatenated strips and the checksum of the filtered data
+	std::vector<glm::byte> Stream;
+	Stream.push_back(0x78);
+	Stream.push_back(0x9C);
+
+	glm::uint32 Adler = 1;
+	for(std::size_t StripIndex = 0; StripIndex < StripCount; ++StripIndex)
+	{
+		Stream.insert(Stream.end(), Strips[StripIndex].begin(), Strips[StripIndex].end());
+		Adler = adler32_combine(Adler, Adlers[StripIndex], Sizes[StripIndex]);
+	}
+	if(StripCount == 0)
+	{
+		bit_writer Writer(Stream);
+		write_block(Writer, nullptr, 0, true);
+		Writer.align();
+	}
+	append_uint32(Stream, Adler);
+
+	std::vector<glm::byte> Header;
+	append_uint32(Header, static_cast<glm::uint32>(Width));
+	append_uint32(Header, static_cast<glm::uint32>(Height));
+	Header.push_back(8);
+	Header.push_back(Components == 4 ? 6 : 2);
+	Header.push_back(0);
+	Header.push_back(0);
+	Header.push_back(0);
+
+	FILE* File = std::fopen(Filename, "wb");
+	if(!File)
+	{
+		fprintf(stdout, "save_png: unable to open %s\n", Filename);
+		return false;
+	}
+
+	glm::byte const Signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+	std::fwrite(Signature, 1, sizeof(Signature), File);
+	write_chunk(File, "IHDR", Header.data(), Header.size());
+	write_chunk(File, "IDAT", Stream.data(), Stream.size());
+	write_chunk(File, "IEND", nullptr, 0);
+
+	bool const Success = std::ferror(File) == 0;
+	std::fclose(File);
+	return Success;
+}
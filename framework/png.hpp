@@ -27,4 +27,7 @@
 #include <gli/gli.hpp>
 
 gli::texture2D load_png(char const * Filename);
-void save_png(gli::texture2D const & Texture, char const * Filename);
+
+/// Save the first level of a RGB8 or RGBA8 texture. Rows are expected bottom to top, like glReadPixels returns them.
+/// The image is compressed in strips of rows in parallel.
+bool save_png(gli::texture2D const & Texture, char const * Filename);
@@ -223,11 +223,21 @@ test::test
 #		endif
 
 		glGenQueries(1, &this->TimerQueryName);
+
+		for(int ArgIndex = 1; ArgIndex < argc; ++ArgIndex)
+		{
+			if(std::string(argv[ArgIndex]) == "--capture")
+				this->beginCapture(getBinaryDirectory() + Title + "-capture", capture::PNG);
+			else if(std::string(argv[ArgIndex]) == "--capture-raw")
+				this->beginCapture(getBinaryDirectory() + Title + "-capture", capture::RAW_SEQUENCE);
+		}
 	}
 }
 
 test::~test()
 {
+	this->endCapture();
+
 	if(this->TimerQueryName)
 		glDeleteQueries(1, &this->TimerQueryName);
 
@@ -281,12 +291,17 @@ int test::operator()()
 			break;
 		}
 
+		if(this->Capture)
+			this->Capture->frame(this->getWindowSize());
+
 		this->swap();
 
 		if(Automated)
 			--FrameNum;
 	}
 
+	this->endCapture();
+
 	if (Result == EXIT_SUCCESS)
 		Result = this->end() && (Result == EXIT_SUCCESS) ? EXIT_SUCCESS : EXIT_FAILURE;
 
@@ -378,24 +393,6 @@ glm::vec3 test::cameraPosition() const
 	return glm::vec3(this->PanningCurrent.x, this->PanningCurrent.y, -this->TranlationCurrent.y);
 }
 
-namespace
-{
-	gli::texture absolute_difference(gli::texture const & A, gli::texture const & B)
-	{
-		assert(A.format() == gli::FORMAT_RGB8_UNORM_PACK8 && B.format() == gli::FORMAT_RGB8_UNORM_PACK8);
-
-		gli::texture Result(A.target(), A.format(), A.dimensions(), A.layers(), A.faces(), A.levels());
-		for(std::size_t TexelIndex = 0, TexelCount = A.size<glm::u8vec3>(); TexelIndex < TexelCount; ++TexelIndex)
-		{
-			glm::u8vec3 const TexelA = *(A.data<glm::u8vec3>() + TexelIndex);
-			glm::u8vec3 const TexelB = *(B.data<glm::u8vec3>() + TexelIndex);
-			glm::u8vec3 const TexelResult = glm::mix(TexelA - TexelB, TexelB - TexelA, glm::greaterThan(TexelB, TexelA)) * glm::u8vec3(8);
-			*(Result.data<glm::u8vec3>() + TexelIndex) = TexelResult;
-		}
-		return Result;
-	}
-}//namespace
-
 bool test::checkTemplate(GLFWwindow* pWindow, char const * Title)
 {
 	GLint ColorType = GL_UNSIGNED_BYTE;
@@ -411,50 +408,64 @@ bool test::checkTemplate(GLFWwindow* pWindow, char const * Title)
 	GLint WindowSizeY(0);
 	glfwGetFramebufferSize(pWindow, &WindowSizeX, &WindowSizeY);
 
-	gli::texture2D TextureRead(ColorFormat == GL_RGBA ? gli::FORMAT_RGBA8_UNORM_PACK8 : gli::FORMAT_RGB8_UNORM_PACK8, gli::texture2D::texelcoord_type(WindowSizeX, WindowSizeY), 1);
-	gli::texture2D TextureRGB(gli::FORMAT_RGB8_UNORM_PACK8, gli::texture2D::texelcoord_type(WindowSizeX, WindowSizeY), 1);
+	gli::texture2D TextureRead(ColorFormat == GL_RGBA ? gli::FORMAT_RGBA8_UNORM_PACK8 : gli::FORMAT_RGB8_UNORM_PACK8, gli::texture2D::texelcoord_type(WindowSizeX, WindowSizeY), 1, gli::default_allocator());
+
+	// Tightly packed rows, the sample's own packing is restored after the readback
+	GLint PackAlignment(4);
+	glGetIntegerv(GL_PACK_ALIGNMENT, &PackAlignment);
 
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	glReadPixels(0, 0, WindowSizeX, WindowSizeY, ColorFormat, ColorType, TextureRead.format() == gli::FORMAT_RGBA8_UNORM_PACK8 ? TextureRead.data() : TextureRGB.data());
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, WindowSizeX, WindowSizeY, ColorFormat, ColorType, TextureRead.data());
+	glPixelStorei(GL_PACK_ALIGNMENT, PackAlignment);
 
-	if(TextureRead.format() == gli::FORMAT_RGBA8_UNORM_PACK8)
-	{
-		for(gli::size_t y = 0; y < TextureRGB.dimensions().y; ++y)
-		for(gli::size_t x = 0; x < TextureRGB.dimensions().x; ++x)
-		{
-			gli::texture2D::texelcoord_type TexelCoord(x, y);
+	gli::texture2D TextureRGB(TextureRead.format() == gli::FORMAT_RGBA8_UNORM_PACK8 ? compare::to_rgb8(TextureRead) : TextureRead);
 
-			glm::u8vec3 Color(TextureRead.load<glm::u8vec4>(TexelCoord, 0));
-			TextureRGB.store(TexelCoord, 0, Color);
-		}
+	gli::texture2D Template(gli::load_dds((getDataDirectory() + "templates/" + Title + ".dds").c_str()));
+	if(Template.empty())
+	{
+		fprintf(stdout, "Missing template for %s\n", Title);
+		return false;
 	}
 
-	bool Success = true;
+	compare::metrics const Metrics = compare::measure(Template, TextureRGB, this->Tolerance.Threshold);
+	bool const Success = compare::accept(Metrics, this->Tolerance);
+
+	fprintf(stdout, "\nTemplate %s: PSNR %2.2f dB, max error %d, %2.4f%% texels differ%s\n",
+		Title, Metrics.PSNR, Metrics.MaxError, Metrics.DifferingPercent, Success ? "" : " - FAILED");
 
-	if(Success)
+	if(!Success)
 	{
-		gli::texture Template(gli::load_dds((getDataDirectory() + "templates/" + Title + ".dds").c_str()));
+		save_dds(Template, (getBinaryDirectory() + "/" + Title + "-template.dds").c_str());
+		save_dds(TextureRGB, (getBinaryDirectory() + "/" + Title + "-generated.dds").c_str());
 
-		if(Success)
-		{
-			Success = Success && !Template.empty();
+		gli::texture2D Heatmap(compare::heatmap(Template, TextureRGB));
+		if(!Heatmap.empty())
+			save_dds(Heatmap, (getBinaryDirectory() + "/" + Title + "-diff.dds").c_str());
+	}
 
-		}
+	return Success;
+}
 
-		if(Success)
-			Success = Success && (Template == TextureRGB);
+void test::setTolerance(compare::tolerance const & Tolerance)
+{
+	this->Tolerance = Tolerance;
+}
 
-		// Save abs diff
-		if(!Success && !Template.empty())
-		{
-			gli::texture Diff = ::absolute_difference(Template, TextureRGB);
-			save_dds(TextureRGB, (getBinaryDirectory() + "/" + Title + "-template.dds").c_str());
-			save_dds(TextureRGB, (getBinaryDirectory() + "/" + Title + "-generated.dds").c_str());
-			save_dds(gli::texture2D(Diff), (getBinaryDirectory() + "/" + Title + "-diff.dds").c_str());
-		}
-	}
+void test::beginCapture(std::string const & Path, capture::encoding Encoding)
+{
+	this->endCapture();
+	this->Capture.reset(new capture(Path, Encoding));
+}
 
-	return Success;
+void test::endCapture()
+{
+	if(!this->Capture)
+		return;
+
+	this->Capture->flush();
+	fprintf(stdout, "\nCaptured %d frames, %d dropped\n", static_cast<int>(this->Capture->capturedFrames()), static_cast<int>(this->Capture->droppedFrames()));
+	this->Capture.reset();
 }
 
 void test::beginTimer()
@@ -33,6 +33,8 @@
 #include "buffer.hpp"
 #include "caps.hpp"
 #include "util.hpp"
+#include "compare.hpp"
+#include "capture.hpp"
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -283,6 +285,11 @@ protected:
 	float cameraDistance() const {return this->TranlationCurrent.y;}
 	glm::vec3 cameraPosition() const;
 	bool checkTemplate(GLFWwindow* pWindow, char const * Title);
+	void setTolerance(compare::tolerance const & Tolerance);
+
+	/// Record every frame until endCapture, also enabled with --capture (PNG files) or --capture-raw (raw sequence)
+	void beginCapture(std::string const & Path, capture::encoding Encoding);
+	void endCapture();
 
 protected:
 	void beginTimer();
@@ -318,6 +325,8 @@ private:
 	int MouseButtonFlags;
 	std::array<key_action, 512> KeyCurAction;
 	bool Error;
+	compare::tolerance Tolerance;
+	std::unique_ptr<capture> Capture;
 
 private:
 	double TimeSum, TimeMin, TimeMax;
@@ -23,8 +23,11 @@
 
 #pragma once
 
+#include <ctime>
 #include <string>
 
+#include <sys/stat.h>
+
 std::string message_format(const char* Message, ...);
 
 template<typename Enum>
@@ -58,4 +61,11 @@ namespace path
 
 		return filename;
 	}
+
+	// modification time of file_path, 0 if it doesn't exist
+	inline time_t modification_time(const std::string& file_path)
+	{
+		struct stat status;
+		return stat(file_path.c_str(), &status) == 0 ? status.st_mtime : 0;
+	}
 }
\ No newline at end of file
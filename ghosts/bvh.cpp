@@ -0,0 +1,640 @@
+#include "bvh.hpp"
+#include "simd.hpp"
+#include "parallel.hpp"
+#include "logging.hpp"
+#include "format.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <functional>
+
+namespace
+{
+	// leaves are children with the top bit set, the first leaf slot above the count
+	const uint32_t s_leaf = 0x80000000u;
+	const uint32_t s_count_bits = 4;
+	const uint32_t s_count_mask = (1u << s_count_bits) - 1;
+
+	// triangles in a leaf at most, the heuristic often stops before
+	const uint32_t s_max_leaf_triangles = 8;
+
+	// candidate splits along every axis
+	const uint32_t s_bin_count = 16;
+
+	// cost of visiting a node, relative to testing a triangle
+	const float s_traversal_cost = 1.f;
+
+	// subtrees of more triangles build their two halves in parallel
+	const uint32_t s_triangles_per_task = 4096;
+
+	// spheres and leaf slots a task goes through
+	const size_t s_spheres_per_task = 256;
+	const size_t s_slots_per_task = 4096;
+
+	// the trees are shallow, a node pushes at most four children
+	const size_t s_stack_size = 256;
+
+	const float s_epsilon = 1e-12f;
+
+	struct box
+	{
+		glm::vec3 p_Min;
+		glm::vec3 p_Max;
+
+		box() : p_Min(FLT_MAX), p_Max(-FLT_MAX) {}
+
+		inline void grow(const glm::vec3& in_point) { p_Min = glm::min(p_Min, in_point); p_Max = glm::max(p_Max, in_point); }
+		inline void grow(const box& in_box) { p_Min = glm::min(p_Min, in_box.p_Min); p_Max = glm::max(p_Max, in_box.p_Max); }
+
+		inline float area() const
+		{
+			const glm::vec3 size = glm::max(p_Max - p_Min, glm::vec3(0.f));
+			return size.x * size.y + size.y * size.z + size.z * size.x;
+		}
+	};
+
+	// binary tree of the build, collapsed into nodes of four children afterwards
+	struct build_node
+	{
+		box			p_Bounds;
+		uint32_t	p_Left;		// the right child follows it
+		uint32_t	p_First;	// leaf triangles in the order, when p_Count isn't zero
+		uint32_t	p_Count;
+	};
+
+	struct builder
+	{
+		std::vector<box>		p_Bounds;		// of every triangle
+		std::vector<glm::vec3>	p_Centroids;	// of the bounds of every triangle
+		std::vector<uint32_t>	p_Order;		// triangles, leaves are ranges of it
+		std::vector<build_node>	p_Nodes;
+		std::atomic<uint32_t>	p_NodeCount;
+
+		void split(uint32_t in_node, uint32_t in_first, uint32_t in_count)
+		{
+			build_node& node = p_Nodes[in_node];
+
+			box centroid_bounds;
+			for (uint32_t i = in_first; i < in_first + in_count; ++i)
+			{
+				node.p_Bounds.grow(p_Bounds[p_Order[i]]);
+				centroid_bounds.grow(p_Centroids[p_Order[i]]);
+			}
+
+			node.p_First = in_first;
+			node.p_Count = in_count;
+
+			if (in_count <= 2)
+				return;
+
+			// binned surface area heuristic over the three axes
+			const glm::vec3 extent = centroid_bounds.p_Max - centroid_bounds.p_Min;
+
+			float best_cost = FLT_MAX;
+			uint32_t best_axis = 0, best_bin = 0;
+
+			// the three axes are binned in one pass over the triangles
+			box bins[3][s_bin_count];
+			uint32_t counts[3][s_bin_count] = {};
+
+			const glm::vec3 scale = glm::vec3(static_cast<float>(s_bin_count)) / glm::max(extent, glm::vec3(FLT_MIN));
+			for (uint32_t i = in_first; i < in_first + in_count; ++i)
+			{
+				const uint32_t t = p_Order[i];
+				const glm::vec3 position = (p_Centroids[t] - centroid_bounds.p_Min) * scale;
+
+				for (uint32_t axis = 0; axis < 3; ++axis)
+				{
+					const uint32_t b = std::min(s_bin_count - 1, static_cast<uint32_t>(position[axis]));
+					bins[axis][b].grow(p_Bounds[t]);
+					++counts[axis][b];
+				}
+			}
+
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				if (extent[axis] <= 0.f)
+					continue;
+
+				// areas and counts left of every split, then swept from the right
+				float left_areas[s_bin_count];
+				uint32_t left_counts[s_bin_count];
+				box left;
+				for (uint32_t b = 0, count = 0; b < s_bin_count - 1; ++b)
+				{
+					left.grow(bins[axis][b]);
+					count += counts[axis][b];
+					left_areas[b] = left.area();
+					left_counts[b] = count;
+				}
+
+				box right;
+				for (uint32_t b = s_bin_count - 1, count = 0; b > 0; --b)
+				{
+					right.grow(bins[axis][b]);
+					count += counts[axis][b];
+
+					if (left_counts[b - 1] == 0 || count == 0)
+						continue;
+
+					const float cost = left_areas[b - 1] * left_counts[b - 1] + right.area() * count;
+					if (cost < best_cost)
+					{
+						best_cost = cost;
+						best_axis = axis;
+						best_bin = b;
+					}
+				}
+			}
+
+			const float area = node.p_Bounds.area();
+			const float split_cost = area > 0.f ? s_traversal_cost + best_cost / area : FLT_MAX;
+			if (split_cost >= in_count && in_count <= s_max_leaf_triangles)
+				return;
+
+			uint32_t* first = &p_Order[in_first];
+			uint32_t* last = first + in_count;
+			uint32_t* middle = first;
+
+			if (best_cost < FLT_MAX)
+			{
+				const float origin = centroid_bounds.p_Min[best_axis];
+				middle = std::partition(first, last, [&](uint32_t t)
+				{
+					return std::min(s_bin_count - 1, static_cast<uint32_t>((p_Centroids[t][best_axis] - origin) * scale[best_axis])) < best_bin;
+				});
+			}
+
+			// all the centroids in one bin, split the triangles in two halves
+			if (middle == first || middle == last)
+			{
+				uint32_t axis = 0;
+				if (extent.y > extent[axis]) axis = 1;
+				if (extent.z > extent[axis]) axis = 2;
+
+				middle = first + in_count / 2;
+				std::nth_element(first, middle, last, [&](uint32_t a, uint32_t b) { return p_Centroids[a][axis] < p_Centroids[b][axis]; });
+			}
+
+			const uint32_t left_count = static_cast<uint32_t>(middle - first);
+			const uint32_t left = p_NodeCount.fetch_add(2);
+
+			node.p_Left = left;
+			node.p_Count = 0;
+
+			if (in_count < s_triangles_per_task)
+			{
+				split(left, in_first, left_count);
+				split(left + 1, in_first + left_count, in_count - left_count);
+			}
+			else
+			{
+				parallel::for_range(0, 2, 1, [&](size_t in_begin, size_t in_end)
+				{
+					for (size_t c = in_begin; c < in_end; ++c)
+					{
+						if (c == 0)
+							split(left, in_first, left_count);
+						else
+							split(left + 1, in_first + left_count, in_count - left_count);
+					}
+				});
+			}
+		}
+	};
+
+	// children ordered so that the nearest is popped first
+	struct entry
+	{
+		uint32_t	p_Child;
+		float		p_Distance;
+	};
+
+	inline void push(entry* io_stack, size_t& io_size, entry* in_children, uint32_t in_count)
+	{
+		// insertion sort, four children at most
+		for (uint32_t c = 1; c < in_count; ++c)
+			for (uint32_t i = c; i > 0 && in_children[i - 1].p_Distance < in_children[i].p_Distance; --i)
+				std::swap(in_children[i - 1], in_children[i]);
+
+		for (uint32_t c = 0; c < in_count && io_size < s_stack_size; ++c)
+			io_stack[io_size++] = in_children[c];
+	}
+
+	// closest point of triangle abc to p, from Real-Time Collision Detection 5.1.5
+	glm::vec3 closestOnTriangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+	{
+		const glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+		const float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+		if (d1 <= 0.f && d2 <= 0.f)
+			return a;
+
+		const glm::vec3 bp = p - b;
+		const float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+		if (d3 >= 0.f && d4 <= d3)
+			return b;
+
+		const float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.f && d1 >= 0.f && d3 <= 0.f)
+			return a + ab * (d1 / (d1 - d3));
+
+		const glm::vec3 cp = p - c;
+		const float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+		if (d6 >= 0.f && d5 <= d6)
+			return c;
+
+		const float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.f && d2 >= 0.f && d6 <= 0.f)
+			return a + ac * (d2 / (d2 - d6));
+
+		const float va = d3 * d6 - d5 * d4;
+		if (va <= 0.f && (d4 - d3) >= 0.f && (d5 - d6) >= 0.f)
+			return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+		const float denominator = 1.f / (va + vb + vc);
+		return a + ab * (vb * denominator) + ac * (vc * denominator);
+	}
+}
+
+namespace compute
+{
+	bool bvh::create(const std::vector<glm::vec4>& in_positions, const std::vector<uint32_t>& in_faces)
+	{
+		destroy();
+
+		const uint32_t triangle_count = static_cast<uint32_t>(in_faces.size() / 3);
+		if (triangle_count == 0 || triangle_count >= (s_leaf >> s_count_bits))
+			return false;
+
+		builder build;
+		build.p_Bounds.resize(triangle_count);
+		build.p_Centroids.resize(triangle_count);
+		build.p_Order.resize(triangle_count);
+
+		parallel::for_range(0, triangle_count, s_slots_per_task, [&](size_t in_begin, size_t in_end)
+		{
+			for (size_t t = in_begin; t < in_end; ++t)
+			{
+				box bounds;
+				for (uint32_t k = 0; k < 3; ++k)
+					bounds.grow(glm::vec3(in_positions[in_faces[3 * t + k]]));
+
+				build.p_Bounds[t] = bounds;
+				build.p_Centroids[t] = (bounds.p_Min + bounds.p_Max) * .5f;
+				build.p_Order[t] = static_cast<uint32_t>(t);
+			}
+		});
+
+		// a binary tree has fewer than twice as many nodes as triangles
+		build.p_Nodes.resize(2 * triangle_count);
+		build.p_NodeCount = 1;
+		build.split(0, 0, triangle_count);
+
+		m_Triangles.swap(build.p_Order);
+
+		// every node takes the two children of its binary node, then opens the
+		// largest of its children until it has four or only leaves. nodes are
+		// stored after their parent, refitting goes through them backwards.
+		const auto& nodes = build.p_Nodes;
+		std::function<uint32_t(uint32_t)> collapse = [&](uint32_t in_node) -> uint32_t
+		{
+			const uint32_t index = static_cast<uint32_t>(m_Nodes.size());
+			m_Nodes.emplace_back();
+
+			uint32_t children[4];
+			uint32_t count = 0;
+
+			if (nodes[in_node].p_Count > 0)
+			{
+				children[count++] = in_node;
+			}
+			else
+			{
+				children[count++] = nodes[in_node].p_Left;
+				children[count++] = nodes[in_node].p_Left + 1;
+			}
+
+			while (count < 4)
+			{
+				uint32_t largest = count;
+				float largest_area = -1.f;
+				for (uint32_t c = 0; c < count; ++c)
+				{
+					const float area = nodes[children[c]].p_Bounds.area();
+					if (nodes[children[c]].p_Count == 0 && area > largest_area)
+					{
+						largest = c;
+						largest_area = area;
+					}
+				}
+
+				if (largest == count)
+					break;
+
+				const uint32_t opened = children[largest];
+				children[largest] = nodes[opened].p_Left;
+				children[count++] = nodes[opened].p_Left + 1;
+			}
+
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				uint32_t child = invalid;
+				box bounds;
+
+				if (c < count)
+				{
+					const build_node& build_child = nodes[children[c]];
+					bounds = build_child.p_Bounds;
+					child = build_child.p_Count > 0
+						? s_leaf | (build_child.p_First << s_count_bits) | build_child.p_Count
+						: collapse(children[c]);
+				}
+
+				node& wide = m_Nodes[index];
+				wide.p_Children[c] = child;
+				for (uint32_t axis = 0; axis < 3; ++axis)
+				{
+					wide.p_Min[axis][c] = bounds.p_Min[axis];
+					wide.p_Max[axis][c] = bounds.p_Max[axis];
+				}
+			}
+
+			return index;
+		};
+
+		m_Nodes.reserve(build.p_NodeCount / 2 + 1);
+		collapse(0);
+
+		m_Corners.resize(3 * triangle_count);
+		refit(in_positions, in_faces);
+
+		LOG(INFO) << fmt::format("bvh: {} triangles, {} nodes", triangle_count, m_Nodes.size());
+		return true;
+	}
+
+	void bvh::destroy()
+	{
+		m_Nodes.clear();
+		m_Triangles.clear();
+		m_Corners.clear();
+	}
+
+	void bvh::leafBounds(uint32_t in_leaf, glm::vec3& out_min, glm::vec3& out_max) const
+	{
+		const uint32_t first = (in_leaf & ~s_leaf) >> s_count_bits;
+		const uint32_t count = in_leaf & s_count_mask;
+
+		out_min = glm::vec3(FLT_MAX);
+		out_max = glm::vec3(-FLT_MAX);
+		for (uint32_t i = 3 * first; i < 3 * (first + count); ++i)
+		{
+			out_min = glm::min(out_min, m_Corners[i]);
+			out_max = glm::max(out_max, m_Corners[i]);
+		}
+	}
+
+	void bvh::refit(const std::vector<glm::vec4>& in_positions, const std::vector<uint32_t>& in_faces)
+	{
+		if (m_Nodes.empty())
+			return;
+
+		parallel::for_range(0, m_Triangles.size(), s_slots_per_task, [&](size_t in_begin, size_t in_end)
+		{
+			for (size_t s = in_begin; s < in_end; ++s)
+				for (uint32_t k = 0; k < 3; ++k)
+					m_Corners[3 * s + k] = glm::vec3(in_positions[in_faces[3 * m_Triangles[s] + k]]);
+		});
+
+		// children are stored after their parents
+		for (size_t n = m_Nodes.size(); n-- > 0;)
+		{
+			node& wide = m_Nodes[n];
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				const uint32_t child = wide.p_Children[c];
+				if (child == invalid)
+					continue;
+
+				glm::vec3 min, max;
+				if (child & s_leaf)
+				{
+					leafBounds(child, min, max);
+				}
+				else
+				{
+					const node& below = m_Nodes[child];
+					min = glm::vec3(FLT_MAX);
+					max = glm::vec3(-FLT_MAX);
+					for (uint32_t b = 0; b < 4; ++b)
+						if (below.p_Children[b] != invalid)
+						{
+							min = glm::min(min, glm::vec3(below.p_Min[0][b], below.p_Min[1][b], below.p_Min[2][b]));
+							max = glm::max(max, glm::vec3(below.p_Max[0][b], below.p_Max[1][b], below.p_Max[2][b]));
+						}
+				}
+
+				for (uint32_t axis = 0; axis < 3; ++axis)
+				{
+					wide.p_Min[axis][c] = min[axis];
+					wide.p_Max[axis][c] = max[axis];
+				}
+			}
+		}
+	}
+
+	bool bvh::raycast(const glm::vec3& in_origin, const glm::vec3& in_direction, float in_max_distance, hit& out_hit) const
+	{
+		out_hit.p_Triangle = invalid;
+		if (m_Nodes.empty())
+			return false;
+
+		using math::float4;
+
+		const float4 origin[3] = { float4(in_origin.x), float4(in_origin.y), float4(in_origin.z) };
+		const float4 inverse[3] = { float4(1.f / in_direction.x), float4(1.f / in_direction.y), float4(1.f / in_direction.z) };
+
+		float best = in_max_distance;
+
+		entry stack[s_stack_size];
+		size_t size = 0;
+		stack[size++] = { 0, 0.f };
+
+		while (size > 0)
+		{
+			const entry current = stack[--size];
+			if (current.p_Distance > best)
+				continue;
+
+			if (current.p_Child & s_leaf)
+			{
+				const uint32_t first = (current.p_Child & ~s_leaf) >> s_count_bits;
+				const uint32_t count = current.p_Child & s_count_mask;
+
+				// Moller-Trumbore, both faces
+				for (uint32_t s = first; s < first + count; ++s)
+				{
+					const glm::vec3& a = m_Corners[3 * s + 0];
+					const glm::vec3 ab = m_Corners[3 * s + 1] - a;
+					const glm::vec3 ac = m_Corners[3 * s + 2] - a;
+
+					const glm::vec3 p = glm::cross(in_direction, ac);
+					const float determinant = glm::dot(ab, p);
+					if (std::abs(determinant) < s_epsilon)
+						continue;
+
+					const float inverse_determinant = 1.f / determinant;
+					const glm::vec3 ao = in_origin - a;
+
+					const float u = glm::dot(ao, p) * inverse_determinant;
+					if (u < 0.f || u > 1.f)
+						continue;
+
+					const glm::vec3 q = glm::cross(ao, ab);
+					const float v = glm::dot(in_direction, q) * inverse_determinant;
+					if (v < 0.f || u + v > 1.f)
+						continue;
+
+					const float t = glm::dot(ac, q) * inverse_determinant;
+					if (t < 0.f || t > best)
+						continue;
+
+					best = t;
+					out_hit.p_Triangle = m_Triangles[s];
+					out_hit.p_Distance = t;
+					out_hit.p_Barycentrics = glm::vec2(u, v);
+				}
+				continue;
+			}
+
+			// slabs of the four children at once
+			const node& wide = m_Nodes[current.p_Child];
+
+			float4 near(0.f), far(best);
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				const float4 t0 = (float4::load(wide.p_Min[axis]) - origin[axis]) * inverse[axis];
+				const float4 t1 = (float4::load(wide.p_Max[axis]) - origin[axis]) * inverse[axis];
+				near = math::max(near, math::min(t0, t1));
+				far = math::min(far, math::max(t0, t1));
+			}
+
+			const uint32_t visit = math::bits(math::greater(near, far)) ^ 0xf;
+			if (visit == 0)
+				continue;
+
+			float nears[4];
+			near.store(nears);
+
+			entry children[4];
+			uint32_t count = 0;
+			for (uint32_t c = 0; c < 4; ++c)
+				if ((visit & (1u << c)) && wide.p_Children[c] != invalid)
+					children[count++] = { wide.p_Children[c], nears[c] };
+
+			push(stack, size, children, count);
+		}
+
+		return out_hit.p_Triangle != invalid;
+	}
+
+	void bvh::closestInLeaf(uint32_t in_leaf, const glm::vec3& in_centre, float& io_distance2, contact& out_contact) const
+	{
+		const uint32_t first = (in_leaf & ~s_leaf) >> s_count_bits;
+		const uint32_t count = in_leaf & s_count_mask;
+
+		for (uint32_t s = first; s < first + count; ++s)
+		{
+			const glm::vec3& a = m_Corners[3 * s + 0];
+			const glm::vec3& b = m_Corners[3 * s + 1];
+			const glm::vec3& c = m_Corners[3 * s + 2];
+
+			const glm::vec3 point = closestOnTriangle(in_centre, a, b, c);
+			const glm::vec3 offset = in_centre - point;
+			const float distance2 = glm::dot(offset, offset);
+			if (distance2 > io_distance2)
+				continue;
+
+			const glm::vec3 normal = glm::cross(b - a, c - a);
+			const float length = glm::length(normal);
+			if (length < s_epsilon)
+				continue;
+
+			io_distance2 = distance2;
+			out_contact.p_Triangle = m_Triangles[s];
+			out_contact.p_Point = point;
+			out_contact.p_Normal = normal / length;
+			out_contact.p_Distance = std::sqrt(distance2);
+		}
+	}
+
+	bool bvh::closest(const glm::vec3& in_centre, float in_radius, contact& out_contact) const
+	{
+		out_contact.p_Triangle = invalid;
+		if (m_Nodes.empty())
+			return false;
+
+		using math::float4;
+
+		const float4 centre[3] = { float4(in_centre.x), float4(in_centre.y), float4(in_centre.z) };
+		const float4 zero(0.f);
+
+		float best = in_radius * in_radius;
+
+		entry stack[s_stack_size];
+		size_t size = 0;
+		stack[size++] = { 0, 0.f };
+
+		while (size > 0)
+		{
+			const entry current = stack[--size];
+			if (current.p_Distance > best)
+				continue;
+
+			if (current.p_Child & s_leaf)
+			{
+				closestInLeaf(current.p_Child, in_centre, best, out_contact);
+				continue;
+			}
+
+			// squared distances from the centre to the boxes of the four children
+			const node& wide = m_Nodes[current.p_Child];
+
+			float4 distance2(0.f);
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				const float4 below = float4::load(wide.p_Min[axis]) - centre[axis];
+				const float4 above = centre[axis] - float4::load(wide.p_Max[axis]);
+				const float4 d = math::max(math::max(below, above), zero);
+				distance2 = distance2 + d * d;
+			}
+
+			// empty children are infinitely far
+			const uint32_t visit = math::bits(math::greater(distance2, float4(best))) ^ 0xf;
+			if (visit == 0)
+				continue;
+
+			float distances[4];
+			distance2.store(distances);
+
+			entry children[4];
+			uint32_t count = 0;
+			for (uint32_t c = 0; c < 4; ++c)
+				if (visit & (1u << c))
+					children[count++] = { wide.p_Children[c], distances[c] };
+
+			push(stack, size, children, count);
+		}
+
+		return out_contact.p_Triangle != invalid;
+	}
+
+	void bvh::collide(const glm::vec3* in_centres, const float* in_radii, size_t in_count, contact* out_contacts) const
+	{
+		parallel::for_range(0, in_count, s_spheres_per_task, [&](size_t in_begin, size_t in_end)
+		{
+			for (size_t s = in_begin; s < in_end; ++s)
+				closest(in_centres[s], in_radii[s], out_contacts[s]);
+		});
+	}
+}
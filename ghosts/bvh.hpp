@@ -0,0 +1,78 @@
+#pragma once
+
+#define GLM_STATIC_CONST_MEMBERS
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace compute
+{
+	// bounding volume hierarchy over the triangles of a mesh, built with the
+	// surface area heuristic and flattened into nodes of four children whose
+	// boxes are tested together. it lives in the space of the mesh: rigid
+	// transforms move the queries into it, deformations refit the boxes.
+	class bvh
+	{
+
+	public:
+
+		static const uint32_t invalid = ~0u;
+
+		struct hit
+		{
+			uint32_t	p_Triangle;		// triangle of the mesh, invalid when missed
+			float		p_Distance;		// along the ray, in units of its direction
+			glm::vec2	p_Barycentrics;	// weights of the second and third corners
+		};
+
+		struct contact
+		{
+			uint32_t	p_Triangle;		// closest triangle, invalid when none is in range
+			glm::vec3	p_Point;		// closest point of the surface
+			glm::vec3	p_Normal;		// of the closest triangle, following its winding
+			float		p_Distance;		// from the centre of the sphere to the point
+		};
+
+	private:
+
+		// the boxes of the four children are stored lane by lane, one
+		// comparison of the SIMD registers tests all of them.
+		struct node
+		{
+			float		p_Min[3][4];
+			float		p_Max[3][4];
+			uint32_t	p_Children[4];	// node index, a leaf of up to 15 triangles, or invalid
+		};
+
+		std::vector<node>		m_Nodes;
+		std::vector<uint32_t>	m_Triangles;	// mesh triangle of every leaf slot
+		std::vector<glm::vec3>	m_Corners;		// three corners of every leaf slot
+
+		void leafBounds(uint32_t in_leaf, glm::vec3& out_min, glm::vec3& out_max) const;
+		void closestInLeaf(uint32_t in_leaf, const glm::vec3& in_centre, float& io_distance2, contact& out_contact) const;
+
+	public:
+
+		// in_faces are three indices of in_positions per triangle
+		bool create(const std::vector<glm::vec4>& in_positions, const std::vector<uint32_t>& in_faces);
+		void destroy();
+
+		// the vertices moved but the triangles are the same, only the boxes are updated
+		void refit(const std::vector<glm::vec4>& in_positions, const std::vector<uint32_t>& in_faces);
+
+		// closest triangle along the ray up to in_max_distance, both faces are hit
+		bool raycast(const glm::vec3& in_origin, const glm::vec3& in_direction, float in_max_distance, hit& out_hit) const;
+
+		// closest point of the surface to in_centre, if closer than in_radius
+		bool closest(const glm::vec3& in_centre, float in_radius, contact& out_contact) const;
+
+		// closest point of the surface to every sphere, in parallel
+		void collide(const glm::vec3* in_centres, const float* in_radii, size_t in_count, contact* out_contacts) const;
+
+		inline bool isEmpty() const { return m_Nodes.empty(); }
+		inline size_t getTriangleCount() const { return m_Triangles.size(); }
+	};
+}
@@ -0,0 +1,1257 @@
+#include "cloth.hpp"
+#include "compute.hpp"
+#include "gpu_cloth.hpp"
+#include "mesh.hpp"
+#include "logging.hpp"
+#include "format.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <numeric>
+#include <tuple>
+
+namespace
+{
+	// largest step the simulation advances by, longer frames are slowed down
+	const float s_max_time_step = 1.f / 30.f;
+
+	// lengths below this are treated as zero
+	const float s_epsilon = 1e-6f;
+
+	// work items per task handed to the worker pool, small enough
+	// for the colours of a few thousand particles to spread out.
+	const size_t s_blocks_per_task = 32;
+	const size_t s_particles_per_task = 1024;
+
+	const uint32_t s_no_island = ~0u;
+
+	inline size_t padded_size(size_t in_count)
+	{
+		return (in_count + 3) & ~size_t(3);
+	}
+
+	// in_task over the active ranges as if they were a single one
+	template<typename Ranges>
+	void for_ranges(const Ranges& in_ranges, size_t in_grain, const std::function<void(size_t, size_t)>& in_task)
+	{
+		const auto& ranges = in_ranges.p_Ranges;
+		const auto& starts = in_ranges.p_Starts;
+
+		if (ranges.size() == 1)
+		{
+			parallel::for_range(ranges[0].first, ranges[0].second, in_grain, in_task);
+			return;
+		}
+
+		if (ranges.empty())
+			return;
+
+		parallel::for_range(0, starts.back(), in_grain, [&](size_t in_begin, size_t in_end)
+		{
+			size_t r = std::upper_bound(starts.begin(), starts.end(), in_begin) - starts.begin() - 1;
+			for (; in_begin < in_end; ++r)
+			{
+				const size_t end = std::min(in_end, starts[r + 1]);
+				const size_t offset = ranges[r].first - starts[r];
+				in_task(in_begin + offset, end + offset);
+				in_begin = end;
+			}
+		});
+	}
+
+	// project four distance constraints at once, XPBD:
+	// dlambda = (-C - alpha * lambda) / (w1 + w2 + alpha), alpha = compliance / dt^2
+	template<typename Block>
+	inline void project(const Block& in_block, math::float4& io_lambda,
+		float* io_x, float* io_y, float* io_z, const float* in_inv_mass, math::float4 in_inv_dt2)
+	{
+		using math::float4;
+
+		const float4 x1 = float4::gather(io_x, in_block.p_First);
+		const float4 y1 = float4::gather(io_y, in_block.p_First);
+		const float4 z1 = float4::gather(io_z, in_block.p_First);
+		const float4 x2 = float4::gather(io_x, in_block.p_Second);
+		const float4 y2 = float4::gather(io_y, in_block.p_Second);
+		const float4 z2 = float4::gather(io_z, in_block.p_Second);
+		const float4 w1 = float4::gather(in_inv_mass, in_block.p_First);
+		const float4 w2 = float4::gather(in_inv_mass, in_block.p_Second);
+
+		const float4 dx = x1 - x2;
+		const float4 dy = y1 - y2;
+		const float4 dz = z1 - z2;
+		const float4 length = math::sqrt(dx * dx + dy * dy + dz * dz);
+
+		const float4 zero(0.f);
+		const float4 epsilon(s_epsilon);
+		const float4 alpha = float4::load(in_block.p_Compliance) * in_inv_dt2;
+		const float4 denominator = w1 + w2 + alpha;
+		const float4 valid = math::greater(denominator, epsilon);
+
+		const float4 c = length - float4::load(in_block.p_RestLength);
+		const float4 dlambda = math::select(valid, (-c - alpha * io_lambda) / math::select(valid, denominator, float4(1.f)), zero);
+		io_lambda += dlambda;
+
+		// gradient direction, zero for coincident particles
+		const float4 scale = math::select(math::greater(length, epsilon), dlambda / math::max(length, epsilon), zero);
+		const float4 s1 = scale * w1;
+		const float4 s2 = scale * w2;
+
+		// the unused lanes aren't written, several blocks of a colour may pad with the dummy
+		const uint32_t lanes = in_block.p_Lanes;
+		(x1 + dx * s1).scatter(io_x, in_block.p_First, lanes);
+		(y1 + dy * s1).scatter(io_y, in_block.p_First, lanes);
+		(z1 + dz * s1).scatter(io_z, in_block.p_First, lanes);
+		(x2 - dx * s2).scatter(io_x, in_block.p_Second, lanes);
+		(y2 - dy * s2).scatter(io_y, in_block.p_Second, lanes);
+		(z2 - dz * s2).scatter(io_z, in_block.p_Second, lanes);
+	}
+}
+
+namespace compute
+{
+	cloth::settings::settings()
+		: p_Enabled(false)
+		, p_Density(0.3f)
+		, p_StretchCompliance(0.f)
+		, p_BendCompliance(0.01f)
+		, p_Damping(0.1f)
+		, p_Thickness(0.01f)
+		, p_SelfCollision(false)
+		, p_PinTop(0.f)
+		, p_Substeps(10)
+		, p_Iterations(1)
+		, p_SleepSpeed(0.02f)
+		, p_SleepSteps(60)
+		, p_Gravity(0.f, -9.81f, 0.f)
+	{
+	}
+
+	cloth::settings cloth::settings::parse(const std::map<std::string, std::string>& in_parameters)
+	{
+		settings result;
+
+		auto read = [&](const char* in_key, float& out_value)
+		{
+			auto it = in_parameters.find(in_key);
+			if (it != in_parameters.end())
+			{
+				out_value = static_cast<float>(std::atof(it->second.c_str()));
+				result.p_Enabled = true;
+			}
+		};
+
+		float enabled = 0.f;
+		float self_collision = result.p_SelfCollision ? 1.f : 0.f;
+		float substeps = static_cast<float>(result.p_Substeps);
+		float iterations = static_cast<float>(result.p_Iterations);
+		float sleep_steps = static_cast<float>(result.p_SleepSteps);
+
+		read("cloth", enabled);
+		read("cloth_density", result.p_Density);
+		read("cloth_stretch", result.p_StretchCompliance);
+		read("cloth_bend", result.p_BendCompliance);
+		read("cloth_damping", result.p_Damping);
+		read("cloth_thickness", result.p_Thickness);
+		read("cloth_self_collision", self_collision);
+		read("cloth_pin_top", result.p_PinTop);
+		read("cloth_substeps", substeps);
+		read("cloth_iterations", iterations);
+		read("cloth_sleep_speed", result.p_SleepSpeed);
+		read("cloth_sleep_steps", sleep_steps);
+
+		result.p_Substeps = std::max(1u, static_cast<uint32_t>(substeps));
+		result.p_Iterations = std::max(1u, static_cast<uint32_t>(iterations));
+		result.p_SleepSteps = std::max(1u, static_cast<uint32_t>(sleep_steps));
+		result.p_SelfCollision = self_collision != 0.f;
+
+		// an explicit "cloth 0" disables it whatever the other parameters
+		if (in_parameters.count("cloth"))
+			result.p_Enabled = enabled != 0.f;
+
+		return result;
+	}
+
+	cloth::cloth()
+		: m_Device(device::CPU)
+		, m_Gpu(nullptr)
+		, m_ParticleCount(0)
+		, m_Resting(false)
+		, m_ActiveChanged(false)
+		, m_MaxRadius(0.f)
+		, m_Previous(0)
+		, m_Current(1)
+		, m_Next(2)
+	{
+	}
+
+	bool cloth::create(const graphics::mesh& in_mesh, const settings& in_settings)
+	{
+		destroy();
+
+		m_Settings = in_settings;
+
+		const auto& positions = in_mesh.p_PosRadius;
+		const auto& faces = in_mesh.p_FaceIndices;
+
+		if (positions.empty() || faces.size() < 3)
+			return false;
+
+		// weld vertices sharing the same position, meshes split them along uv and normal seams
+		std::map<std::tuple<float, float, float>, uint32_t> welded;
+		std::vector<glm::vec3> particles;
+		std::vector<float> radii;
+
+		m_VertexParticle.resize(positions.size());
+		for (size_t v = 0; v < positions.size(); ++v)
+		{
+			auto key = std::make_tuple(positions[v].x, positions[v].y, positions[v].z);
+			auto it = welded.find(key);
+			if (it == welded.end())
+			{
+				it = welded.emplace(key, static_cast<uint32_t>(particles.size())).first;
+				particles.emplace_back(positions[v].x, positions[v].y, positions[v].z);
+				radii.push_back(positions[v].w > 0.f ? positions[v].w : m_Settings.p_Thickness);
+			}
+
+			m_VertexParticle[v] = it->second;
+		}
+
+		m_ParticleCount = particles.size();
+
+		// one more static particle for the unused constraint lanes
+		const size_t padded = padded_size(m_ParticleCount + 1);
+
+		for (auto array : { &m_PosX, &m_PosY, &m_PosZ, &m_PrevX, &m_PrevY, &m_PrevZ, &m_VelX, &m_VelY, &m_VelZ, &m_InvMass, &m_Radius })
+			array->assign(padded, 0.f);
+
+		for (size_t p = 0; p < m_ParticleCount; ++p)
+		{
+			m_PosX[p] = m_PrevX[p] = particles[p].x;
+			m_PosY[p] = m_PrevY[p] = particles[p].y;
+			m_PosZ[p] = m_PrevZ[p] = particles[p].z;
+			m_Radius[p] = radii[p];
+		}
+
+		if (m_Settings.p_SelfCollision)
+		{
+			m_MaxRadius = *std::max_element(radii.begin(), radii.end());
+			m_RestPositions = particles;
+
+			for (auto array : { &m_DeltaX, &m_DeltaY, &m_DeltaZ })
+				array->assign(m_ParticleCount, 0.f);
+
+			// cells twice the largest contact distance, so that a query visits 8 of them
+			m_Hash.create(m_ParticleCount, 4.f * m_MaxRadius);
+		}
+
+		// triangles in particle indices, the degenerate ones are dropped
+		m_Triangles.reserve(faces.size());
+		for (size_t f = 0; f + 2 < faces.size(); f += 3)
+		{
+			const uint32_t a = m_VertexParticle[faces[f + 0]];
+			const uint32_t b = m_VertexParticle[faces[f + 1]];
+			const uint32_t c = m_VertexParticle[faces[f + 2]];
+
+			if (a != b && b != c && c != a)
+				m_Triangles.insert(m_Triangles.end(), { a, b, c });
+		}
+
+		// lumped masses: each particle takes a third of the area of its triangles
+		std::vector<float> masses(m_ParticleCount, 0.f);
+		for (size_t t = 0; t < m_Triangles.size(); t += 3)
+		{
+			const auto& a = particles[m_Triangles[t + 0]];
+			const auto& b = particles[m_Triangles[t + 1]];
+			const auto& c = particles[m_Triangles[t + 2]];
+
+			const float area = 0.5f * glm::length(glm::cross(b - a, c - a));
+			for (uint32_t k = 0; k < 3; ++k)
+				masses[m_Triangles[t + k]] += area * m_Settings.p_Density / 3.f;
+		}
+
+		float top = particles[0].y;
+		for (const auto& p : particles)
+			top = std::max(top, p.y);
+
+		size_t pinned = 0;
+		for (size_t p = 0; p < m_ParticleCount; ++p)
+		{
+			const bool is_pinned = m_Settings.p_PinTop > 0.f && particles[p].y >= top - m_Settings.p_PinTop;
+			m_InvMass[p] = (is_pinned || masses[p] <= 0.f) ? 0.f : 1.f / masses[p];
+			pinned += m_InvMass[p] == 0.f ? 1 : 0;
+		}
+
+		// every edge of every triangle with the vertex opposite to it,
+		// sorting them groups the triangles sharing the same edge.
+		std::vector<std::pair<uint64_t, uint32_t>> edges;
+		edges.reserve(m_Triangles.size());
+		for (size_t t = 0; t < m_Triangles.size(); t += 3)
+		{
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				const uint64_t a = m_Triangles[t + k];
+				const uint64_t b = m_Triangles[t + (k + 1) % 3];
+				const uint32_t opposite = m_Triangles[t + (k + 2) % 3];
+				edges.emplace_back((std::min(a, b) << 32) | std::max(a, b), opposite);
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+
+		auto& constraints = m_Constraints;
+		auto add_constraint = [&](uint32_t a, uint32_t b, float compliance)
+		{
+			if (m_InvMass[a] == 0.f && m_InvMass[b] == 0.f)
+				return;
+
+			constraint c;
+			c.p_First = a;
+			c.p_Second = b;
+			c.p_RestLength = glm::length(particles[a] - particles[b]);
+			c.p_Compliance = compliance;
+			constraints.push_back(c);
+		};
+
+		for (size_t e = 0; e < edges.size();)
+		{
+			size_t end = e + 1;
+			while (end < edges.size() && edges[end].first == edges[e].first)
+				++end;
+
+			add_constraint(static_cast<uint32_t>(edges[e].first >> 32), static_cast<uint32_t>(edges[e].first & 0xffffffff), m_Settings.p_StretchCompliance);
+
+			for (size_t i = e; i < end; ++i)
+				for (size_t j = i + 1; j < end; ++j)
+					if (edges[i].second != edges[j].second)
+						add_constraint(edges[i].second, edges[j].second, m_Settings.p_BendCompliance);
+
+			e = end;
+		}
+
+		buildIslands();
+		colour();
+
+		// nothing to blend from yet
+		publish();
+		publish();
+
+		LOG(INFO) << fmt::format("cloth: {} particles ({} pinned) in {} islands, {} triangles, {} constraints in {} blocks, {} colours",
+			m_ParticleCount, pinned, m_Islands.size(), m_Triangles.size() / 3, constraints.size(), m_Blocks.size(), getColourCount());
+
+		return true;
+	}
+
+	void cloth::destroy()
+	{
+		if (m_Gpu)
+		{
+			m_Gpu->destroy();
+			delete m_Gpu;
+			m_Gpu = nullptr;
+		}
+
+		m_Device = device::CPU;
+		m_ParticleCount = 0;
+
+		for (auto array : { &m_PosX, &m_PosY, &m_PosZ, &m_PrevX, &m_PrevY, &m_PrevZ, &m_VelX, &m_VelY, &m_VelZ, &m_InvMass, &m_Radius })
+			array->clear();
+
+		m_Islands.clear();
+		m_ParticleIsland.clear();
+		m_AwakeInvMass.clear();
+		m_Touched.clear();
+		m_Resting = false;
+
+		m_ActiveParticles.clear();
+		m_ActivePackets.clear();
+		m_ActiveBlocks.clear();
+		m_ActiveChanged = false;
+
+		m_Hash.destroy();
+		m_MaxRadius = 0.f;
+		m_RestPositions.clear();
+		for (auto array : { &m_DeltaX, &m_DeltaY, &m_DeltaZ })
+			array->clear();
+
+		m_Colliders.clear();
+		m_Centres.clear();
+		m_Contacts.clear();
+
+		std::lock_guard<std::mutex> lock(m_StateMutex);
+		for (auto& state : m_States)
+		{
+			state.p_Positions.clear();
+			state.p_Velocities.clear();
+		}
+
+		m_Constraints.clear();
+		m_Blocks.clear();
+		m_Lambdas.clear();
+		m_ColourOffsets.clear();
+		m_GroupOffsets.clear();
+		m_Triangles.clear();
+		m_VertexParticle.clear();
+	}
+
+	bool cloth::setDevice(device in_device, graphics::mesh& io_mesh)
+	{
+		if (in_device == m_Device || m_ParticleCount == 0)
+			return in_device == m_Device;
+
+		if (in_device == device::GPU)
+		{
+			if (!clothing::isSupported(device::GPU))
+				return false;
+
+			// the GPU simulates every particle, the sleeping ones must be dynamic again
+			wake();
+
+			if (!m_Gpu)
+			{
+				m_Gpu = new gpu_cloth();
+				if (!m_Gpu->create(*this, io_mesh))
+				{
+					delete m_Gpu;
+					m_Gpu = nullptr;
+					return false;
+				}
+			}
+
+			// the mesh buffers become the state of the simulation
+			writeBack(io_mesh);
+			io_mesh.update();
+
+			if (m_Settings.p_SelfCollision)
+				LOG(WARNING) << "cloth: self collision is not simulated on the GPU";
+
+			if (!m_Colliders.empty())
+				LOG(WARNING) << "cloth: collisions with bodies are not simulated on the GPU";
+		}
+		else
+		{
+			m_Gpu->download(*this);
+
+			// the GPU state is the last two
+			publish();
+			publish();
+		}
+
+		m_Device = in_device;
+		return true;
+	}
+
+	bool cloth::verify(graphics::mesh& io_mesh, uint32_t in_frames, float in_tolerance)
+	{
+		const device initial_device = m_Device;
+
+		// both devices start from the state on the CPU, through the mesh buffers
+		if (!setDevice(device::CPU, io_mesh))
+			return false;
+
+		snapshot start;
+		save(start);
+
+		const bool self_collision = m_Settings.p_SelfCollision;
+		const float sleep_speed = m_Settings.p_SleepSpeed;
+
+		// neither are simulated on the GPU
+		std::vector<const bvh*> colliders;
+		colliders.swap(m_Colliders);
+		m_Settings.p_SelfCollision = false;
+
+		// nor is sleeping
+		m_Settings.p_SleepSpeed = 0.f;
+		wake();
+
+		const float frame_time = 1.f / 60.f;
+		float max_error = 0.f;
+		bool verified = setDevice(device::GPU, io_mesh);
+
+		if (verified)
+		{
+			for (uint32_t f = 0; f < in_frames; ++f)
+				simulate(frame_time);
+
+			// the GPU only touched the mesh buffers, read the result aside
+			m_Gpu->download(*this);
+			std::vector<float> gpu_x = m_PosX, gpu_y = m_PosY, gpu_z = m_PosZ;
+
+			restore(start);
+			wake();
+
+			m_Device = device::CPU;
+			for (uint32_t f = 0; f < in_frames; ++f)
+				simulate(frame_time);
+
+			for (size_t p = 0; p < m_ParticleCount; ++p)
+			{
+				const glm::vec3 error(m_PosX[p] - gpu_x[p], m_PosY[p] - gpu_y[p], m_PosZ[p] - gpu_z[p]);
+				max_error = std::max(max_error, glm::length(error));
+			}
+		}
+
+		m_Settings.p_SelfCollision = self_collision;
+		m_Settings.p_SleepSpeed = sleep_speed;
+		m_Colliders.swap(colliders);
+
+		// carry on from the state verifying started from, on the device it was
+		// on: the mesh buffers are put back too, the GPU stepped them.
+		restore(start);
+		m_Device = device::CPU;
+
+		if (initial_device == device::GPU)
+			setDevice(device::GPU, io_mesh);
+		else
+		{
+			writeBack(io_mesh);
+			io_mesh.update();
+		}
+
+		if (!verified)
+			return false;
+
+		const bool match = max_error <= in_tolerance;
+		LOG(INFO) << fmt::format("cloth: {} particles over {} frames, largest CPU/GPU difference {} ({})",
+			m_ParticleCount, in_frames, max_error, match ? "match" : "mismatch");
+
+		return match;
+	}
+
+	void cloth::save(snapshot& out_snapshot) const
+	{
+		out_snapshot.p_Positions[0] = m_PosX;
+		out_snapshot.p_Positions[1] = m_PosY;
+		out_snapshot.p_Positions[2] = m_PosZ;
+		out_snapshot.p_Previous[0] = m_PrevX;
+		out_snapshot.p_Previous[1] = m_PrevY;
+		out_snapshot.p_Previous[2] = m_PrevZ;
+		out_snapshot.p_Velocities[0] = m_VelX;
+		out_snapshot.p_Velocities[1] = m_VelY;
+		out_snapshot.p_Velocities[2] = m_VelZ;
+		out_snapshot.p_InvMass = m_InvMass;
+		out_snapshot.p_Islands = m_Islands;
+		out_snapshot.p_Touched = m_Touched;
+		out_snapshot.p_Contacts = m_Contacts;
+		out_snapshot.p_Lambdas = m_Lambdas;
+		out_snapshot.p_Resting = m_Resting;
+
+		// only the simulation writes the states, no lock needed to read them
+		for (uint32_t s = 0; s < 3; ++s)
+			out_snapshot.p_States[s] = m_States[s];
+
+		out_snapshot.p_StateIndices[0] = m_Previous;
+		out_snapshot.p_StateIndices[1] = m_Current;
+		out_snapshot.p_StateIndices[2] = m_Next;
+	}
+
+	void cloth::restore(const snapshot& in_snapshot)
+	{
+		m_PosX = in_snapshot.p_Positions[0];
+		m_PosY = in_snapshot.p_Positions[1];
+		m_PosZ = in_snapshot.p_Positions[2];
+		m_PrevX = in_snapshot.p_Previous[0];
+		m_PrevY = in_snapshot.p_Previous[1];
+		m_PrevZ = in_snapshot.p_Previous[2];
+		m_VelX = in_snapshot.p_Velocities[0];
+		m_VelY = in_snapshot.p_Velocities[1];
+		m_VelZ = in_snapshot.p_Velocities[2];
+		m_InvMass = in_snapshot.p_InvMass;
+		m_Islands = in_snapshot.p_Islands;
+		m_Touched = in_snapshot.p_Touched;
+		m_Contacts = in_snapshot.p_Contacts;
+		m_Lambdas = in_snapshot.p_Lambdas;
+		m_Resting = in_snapshot.p_Resting;
+
+		// which islands are awake may have changed
+		m_ActiveChanged = true;
+
+		std::lock_guard<std::mutex> lock(m_StateMutex);
+		for (uint32_t s = 0; s < 3; ++s)
+			m_States[s] = in_snapshot.p_States[s];
+
+		m_Previous = in_snapshot.p_StateIndices[0];
+		m_Current = in_snapshot.p_StateIndices[1];
+		m_Next = in_snapshot.p_StateIndices[2];
+	}
+
+	void cloth::colour()
+	{
+		const uint32_t dummy = static_cast<uint32_t>(m_ParticleCount);
+
+		// greedy colouring: each constraint takes the first colour none of the constraints
+		// on its two particles has, so at most twice the largest particle degree.
+		std::vector<uint32_t> degrees(m_ParticleCount, 0);
+		for (const auto& c : m_Constraints)
+		{
+			++degrees[c.p_First];
+			++degrees[c.p_Second];
+		}
+
+		const uint32_t max_degree = degrees.empty() ? 0 : *std::max_element(degrees.begin(), degrees.end());
+		const size_t words = (2 * max_degree) / 64 + 1;
+
+		// colours already taken around each particle, one bit per colour
+		std::vector<uint64_t> taken(m_ParticleCount * words, 0);
+		std::vector<uint32_t> colours(m_Constraints.size());
+		uint32_t colour_count = 0;
+
+		for (size_t i = 0; i < m_Constraints.size(); ++i)
+		{
+			uint64_t* first = &taken[m_Constraints[i].p_First * words];
+			uint64_t* second = &taken[m_Constraints[i].p_Second * words];
+
+			uint32_t colour = 0;
+			for (size_t w = 0; w < words; ++w)
+			{
+				const uint64_t free = ~(first[w] | second[w]);
+				if (free == 0)
+					continue;
+
+				uint32_t bit = 0;
+				while ((free & (uint64_t(1) << bit)) == 0)
+					++bit;
+
+				colour = static_cast<uint32_t>(w * 64 + bit);
+				break;
+			}
+
+			first[colour / 64] |= uint64_t(1) << (colour % 64);
+			second[colour / 64] |= uint64_t(1) << (colour % 64);
+
+			colours[i] = colour;
+			colour_count = std::max(colour_count, colour + 1);
+		}
+
+		// counting sort by colour then island, keeping the edge order inside a group for locality.
+		// a constraint belongs to the island of its particles, at least one of them isn't pinned.
+		const size_t island_count = std::max<size_t>(1, m_Islands.size());
+		const size_t group_count = colour_count * island_count;
+
+		std::vector<size_t> groups(m_Constraints.size());
+		for (size_t i = 0; i < m_Constraints.size(); ++i)
+		{
+			const uint32_t first = m_ParticleIsland[m_Constraints[i].p_First];
+			const uint32_t island = first != s_no_island ? first : m_ParticleIsland[m_Constraints[i].p_Second];
+			groups[i] = colours[i] * island_count + island;
+		}
+
+		std::vector<size_t> starts(group_count + 1, 0);
+		for (auto group : groups)
+			++starts[group + 1];
+		for (size_t g = 0; g < group_count; ++g)
+			starts[g + 1] += starts[g];
+
+		std::vector<constraint> sorted(m_Constraints.size());
+		{
+			std::vector<size_t> next(starts.begin(), starts.end() - 1);
+			for (size_t i = 0; i < m_Constraints.size(); ++i)
+				sorted[next[groups[i]]++] = m_Constraints[i];
+		}
+
+		// four consecutive constraints of a group per block, the last block of every
+		// group pads its unused lanes with the dummy. the blocks of a colour run in
+		// parallel and several may pad, so the solver only reads the unused lanes.
+		m_Blocks.clear();
+		m_ColourOffsets.assign(1, 0);
+		m_GroupOffsets.assign(1, 0);
+
+		for (size_t g = 0; g < group_count; ++g)
+		{
+			for (size_t i = starts[g]; i < starts[g + 1]; i += 4)
+			{
+				constraint_block block;
+				block.p_Lanes = static_cast<uint32_t>(std::min<size_t>(4, starts[g + 1] - i));
+				for (uint32_t l = 0; l < 4; ++l)
+				{
+					const bool used = i + l < starts[g + 1];
+					block.p_First[l] = used ? sorted[i + l].p_First : dummy;
+					block.p_Second[l] = used ? sorted[i + l].p_Second : dummy;
+					block.p_RestLength[l] = used ? sorted[i + l].p_RestLength : 0.f;
+					block.p_Compliance[l] = used ? sorted[i + l].p_Compliance : 0.f;
+				}
+				m_Blocks.push_back(block);
+			}
+
+			m_GroupOffsets.push_back(m_Blocks.size());
+			if ((g + 1) % island_count == 0)
+				m_ColourOffsets.push_back(m_Blocks.size());
+		}
+
+		m_Lambdas.assign(m_Blocks.size(), math::float4(0.f));
+		m_ActiveChanged = true;
+	}
+
+	void cloth::buildIslands()
+	{
+		// union-find over the constraints between dynamic particles
+		std::vector<uint32_t> parents(m_ParticleCount);
+		std::iota(parents.begin(), parents.end(), 0u);
+
+		auto find = [&](uint32_t in_particle)
+		{
+			while (parents[in_particle] != in_particle)
+			{
+				parents[in_particle] = parents[parents[in_particle]];
+				in_particle = parents[in_particle];
+			}
+			return in_particle;
+		};
+
+		for (const auto& c : m_Constraints)
+		{
+			if (m_InvMass[c.p_First] == 0.f || m_InvMass[c.p_Second] == 0.f)
+				continue;
+
+			const uint32_t a = find(c.p_First);
+			const uint32_t b = find(c.p_Second);
+			if (a != b)
+				parents[std::max(a, b)] = std::min(a, b);
+		}
+
+		// islands numbered in the order of their first particle
+		std::vector<uint32_t> root_island(m_ParticleCount, s_no_island);
+		std::vector<uint32_t> particle_island(m_ParticleCount, s_no_island);
+		std::vector<uint32_t> offsets(1, 0);
+
+		for (uint32_t p = 0; p < m_ParticleCount; ++p)
+		{
+			if (m_InvMass[p] == 0.f)
+				continue;
+
+			auto& island = root_island[find(p)];
+			if (island == s_no_island)
+			{
+				island = static_cast<uint32_t>(offsets.size() - 1);
+				offsets.push_back(0);
+			}
+
+			particle_island[p] = island;
+			++offsets[island + 1];
+		}
+
+		for (size_t i = 1; i < offsets.size(); ++i)
+			offsets[i] += offsets[i - 1];
+
+		// particles keep their order within an island, the pinned ones go last
+		std::vector<uint32_t> order(m_ParticleCount);
+		{
+			std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+			uint32_t pinned = offsets.back();
+
+			for (uint32_t p = 0; p < m_ParticleCount; ++p)
+				order[particle_island[p] != s_no_island ? next[particle_island[p]]++ : pinned++] = p;
+		}
+
+		reorder(order);
+
+		m_Islands.resize(offsets.size() - 1);
+		m_ParticleIsland.assign(m_ParticleCount, s_no_island);
+
+		for (uint32_t i = 0; i < m_Islands.size(); ++i)
+		{
+			auto& island = m_Islands[i];
+			island.p_First = offsets[i];
+			island.p_End = offsets[i + 1];
+			island.p_QuietSteps = 0;
+			island.p_Awake = true;
+
+			std::fill(m_ParticleIsland.begin() + island.p_First, m_ParticleIsland.begin() + island.p_End, i);
+		}
+
+		m_AwakeInvMass = m_InvMass;
+		m_Touched.assign(m_ParticleCount, s_no_island);
+		m_Resting = false;
+	}
+
+	void cloth::reorder(const std::vector<uint32_t>& in_order)
+	{
+		std::vector<uint32_t> rank(m_ParticleCount);
+		for (uint32_t p = 0; p < m_ParticleCount; ++p)
+			rank[in_order[p]] = p;
+
+		auto permute = [&](auto& io_array)
+		{
+			if (io_array.empty())
+				return;
+
+			auto copy = io_array;
+			for (size_t p = 0; p < m_ParticleCount; ++p)
+				io_array[p] = copy[in_order[p]];
+		};
+
+		for (auto array : { &m_PosX, &m_PosY, &m_PosZ, &m_PrevX, &m_PrevY, &m_PrevZ, &m_VelX, &m_VelY, &m_VelZ, &m_InvMass, &m_Radius, &m_AwakeInvMass })
+			permute(*array);
+		permute(m_RestPositions);
+
+		for (auto& p : m_VertexParticle)
+			p = rank[p];
+		for (auto& p : m_Triangles)
+			p = rank[p];
+		for (auto& c : m_Constraints)
+		{
+			c.p_First = rank[c.p_First];
+			c.p_Second = rank[c.p_Second];
+		}
+	}
+
+	void cloth::active_ranges::add(size_t in_begin, size_t in_end)
+	{
+		if (in_begin >= in_end)
+			return;
+
+		if (p_Ranges.empty())
+			p_Starts.assign(1, 0);
+
+		// ranges that touch or overlap are merged
+		if (!p_Ranges.empty() && in_begin <= p_Ranges.back().second)
+		{
+			const size_t end = std::max(in_end, p_Ranges.back().second);
+			p_Starts.back() += end - p_Ranges.back().second;
+			p_Ranges.back().second = end;
+		}
+		else
+		{
+			p_Ranges.emplace_back(in_begin, in_end);
+			p_Starts.push_back(p_Starts.back() + in_end - in_begin);
+		}
+	}
+
+	void cloth::updateActive()
+	{
+		m_ActiveParticles.clear();
+		m_ActivePackets.clear();
+
+		const size_t colour_count = getColourCount();
+		m_ActiveBlocks.resize(colour_count);
+		for (auto& blocks : m_ActiveBlocks)
+			blocks.clear();
+
+		for (uint32_t i = 0; i < m_Islands.size(); ++i)
+		{
+			const auto& island = m_Islands[i];
+			if (!island.p_Awake)
+				continue;
+
+			// packets on the border with a sleeping island go through the
+			// sleeping particles too, which are static and don't move.
+			m_ActiveParticles.add(island.p_First, island.p_End);
+			m_ActivePackets.add(island.p_First / 4, (island.p_End + 3) / 4);
+
+			for (size_t c = 0; c < colour_count; ++c)
+				m_ActiveBlocks[c].add(m_GroupOffsets[c * m_Islands.size() + i], m_GroupOffsets[c * m_Islands.size() + i + 1]);
+		}
+
+		m_ActiveChanged = false;
+	}
+
+	void cloth::sleep(uint32_t in_island)
+	{
+		auto& island = m_Islands[in_island];
+		for (uint32_t p = island.p_First; p < island.p_End; ++p)
+		{
+			m_InvMass[p] = 0.f;
+			m_VelX[p] = m_VelY[p] = m_VelZ[p] = 0.f;
+		}
+
+		island.p_Awake = false;
+		island.p_QuietSteps = 0;
+		m_ActiveChanged = true;
+	}
+
+	void cloth::wake(uint32_t in_island)
+	{
+		auto& island = m_Islands[in_island];
+		if (island.p_Awake)
+			return;
+
+		std::copy(m_AwakeInvMass.begin() + island.p_First, m_AwakeInvMass.begin() + island.p_End, m_InvMass.begin() + island.p_First);
+
+		island.p_Awake = true;
+		island.p_QuietSteps = 0;
+		m_ActiveChanged = true;
+		m_Resting = false;
+	}
+
+	void cloth::wake()
+	{
+		for (uint32_t i = 0; i < m_Islands.size(); ++i)
+			wake(i);
+	}
+
+	uint64_t cloth::checksum() const
+	{
+		// FNV-1a over the bytes of the particle arrays
+		uint64_t hash = 14695981039346656037ull;
+
+		for (auto array : { &m_PosX, &m_PosY, &m_PosZ, &m_VelX, &m_VelY, &m_VelZ })
+		{
+			const uint8_t* bytes = reinterpret_cast<const uint8_t*>(array->data());
+			for (size_t b = 0; b < m_ParticleCount * sizeof(float); ++b)
+				hash = (hash ^ bytes[b]) * 1099511628211ull;
+		}
+
+		return hash;
+	}
+
+	size_t cloth::getAwakeIslandCount() const
+	{
+		return std::count_if(m_Islands.begin(), m_Islands.end(), [](const island& in_island) { return in_island.p_Awake; });
+	}
+
+	void cloth::updateSleep()
+	{
+		// sleeping islands touched by the awake ones during the step
+		for (const auto& range : m_ActiveParticles.p_Ranges)
+		{
+			for (size_t p = range.first; p < range.second; ++p)
+			{
+				if (m_Touched[p] != s_no_island)
+				{
+					wake(m_Touched[p]);
+					m_Touched[p] = s_no_island;
+				}
+			}
+		}
+
+		if (m_Settings.p_SleepSpeed <= 0.f)
+			return;
+
+		const float max_speed2 = m_Settings.p_SleepSpeed * m_Settings.p_SleepSpeed;
+
+		for (uint32_t i = 0; i < m_Islands.size(); ++i)
+		{
+			auto& island = m_Islands[i];
+			if (!island.p_Awake)
+				continue;
+
+			bool quiet = true;
+			for (uint32_t p = island.p_First; p < island.p_End && quiet; ++p)
+				quiet = m_VelX[p] * m_VelX[p] + m_VelY[p] * m_VelY[p] + m_VelZ[p] * m_VelZ[p] < max_speed2;
+
+			island.p_QuietSteps = quiet ? island.p_QuietSteps + 1 : 0;
+			if (island.p_QuietSteps >= m_Settings.p_SleepSteps)
+				sleep(i);
+		}
+	}
+
+	void cloth::simulate(float in_delta_time)
+	{
+		if (m_ParticleCount == 0 || in_delta_time <= 0.f)
+			return;
+
+		const float dt = std::min(in_delta_time, s_max_time_step) / m_Settings.p_Substeps;
+
+		if (m_Device == device::GPU)
+		{
+			m_Gpu->simulate(*this, dt);
+			return;
+		}
+
+		if (m_ActiveChanged)
+			updateActive();
+
+		// nothing awake, once the state is published at rest there is nothing left to do
+		if (m_ActiveParticles.empty())
+		{
+			if (!m_Resting)
+				publish();
+
+			m_Resting = true;
+			return;
+		}
+
+		for (uint32_t s = 0; s < m_Settings.p_Substeps; ++s)
+		{
+			integrate(dt);
+
+			for (const auto& blocks : m_ActiveBlocks)
+				for (const auto& range : blocks.p_Ranges)
+					std::fill(m_Lambdas.begin() + range.first, m_Lambdas.begin() + range.second, math::float4(0.f));
+
+			for (uint32_t i = 0; i < m_Settings.p_Iterations; ++i)
+				solve(dt);
+
+			if (m_Settings.p_SelfCollision)
+				collide();
+
+			collideBodies();
+
+			updateVelocities(dt);
+		}
+
+		updateSleep();
+		publish();
+	}
+
+	void cloth::publish()
+	{
+		// only the simulation writes the next state, no lock needed
+		auto& next = m_States[m_Next];
+		next.p_Positions.resize(m_ParticleCount);
+		next.p_Velocities.resize(m_ParticleCount);
+
+		for (size_t p = 0; p < m_ParticleCount; ++p)
+		{
+			next.p_Positions[p] = glm::vec3(m_PosX[p], m_PosY[p], m_PosZ[p]);
+			next.p_Velocities[p] = glm::vec3(m_VelX[p], m_VelY[p], m_VelZ[p]);
+		}
+
+		std::lock_guard<std::mutex> lock(m_StateMutex);
+		std::swap(m_Previous, m_Current);
+		std::swap(m_Current, m_Next);
+	}
+
+	void cloth::integrate(float in_dt)
+	{
+		using math::float4;
+
+		const float4 dt(in_dt);
+		const float4 zero(0.f);
+		const float4 gravity_x(m_Settings.p_Gravity.x * in_dt);
+		const float4 gravity_y(m_Settings.p_Gravity.y * in_dt);
+		const float4 gravity_z(m_Settings.p_Gravity.z * in_dt);
+
+		for_ranges(m_ActivePackets, s_particles_per_task / 4, [&](size_t in_begin, size_t in_end)
+		{
+			for (size_t p = in_begin * 4; p < in_end * 4; p += 4)
+			{
+				// static particles keep a zero velocity
+				const float4 dynamic = math::greater(float4::load(&m_InvMass[p]), zero);
+
+				const float4 vx = float4::load(&m_VelX[p]) + math::select(dynamic, gravity_x, zero);
+				const float4 vy = float4::load(&m_VelY[p]) + math::select(dynamic, gravity_y, zero);
+				const float4 vz = float4::load(&m_VelZ[p]) + math::select(dynamic, gravity_z, zero);
+				vx.store(&m_VelX[p]);
+				vy.store(&m_VelY[p]);
+				vz.store(&m_VelZ[p]);
+
+				const float4 x = float4::load(&m_PosX[p]);
+				const float4 y = float4::load(&m_PosY[p]);
+				const float4 z = float4::load(&m_PosZ[p]);
+				x.store(&m_PrevX[p]);
+				y.store(&m_PrevY[p]);
+				z.store(&m_PrevZ[p]);
+
+				(x + vx * dt).store(&m_PosX[p]);
+				(y + vy * dt).store(&m_PosY[p]);
+				(z + vz * dt).store(&m_PosZ[p]);
+			}
+		});
+	}
+
+	void cloth::solve(float in_dt)
+	{
+		const math::float4 inv_dt2(1.f / (in_dt * in_dt));
+
+		const std::function<void(size_t, size_t)> task = [&](size_t in_begin, size_t in_end)
+		{
+			for (size_t b = in_begin; b < in_end; ++b)
+				project(m_Blocks[b], m_Lambdas[b], m_PosX.data(), m_PosY.data(), m_PosZ.data(), m_InvMass.data(), inv_dt2);
+		};
+
+		// gauss-seidel across colours, jacobi free within one: the blocks of a colour
+		// touch disjoint particles so the workers need no synchronisation.
+		for (const auto& blocks : m_ActiveBlocks)
+			for_ranges(blocks, s_blocks_per_task, task);
+	}
+
+	void cloth::collide()
+	{
+		m_Hash.build(m_PosX.data(), m_PosY.data(), m_PosZ.data(), m_ParticleCount);
+
+		// jacobi: every particle sums its own share of the corrections of its contacts,
+		// reading positions only, then all of them move at once. sleeping particles
+		// are in the grid as obstacles, and woken up by the contact at the end of the step.
+		for_ranges(m_ActiveParticles, s_particles_per_task, [&](size_t in_begin, size_t in_end)
+		{
+			for (size_t p = in_begin; p < in_end; ++p)
+			{
+				glm::vec3 delta(0.f);
+				uint32_t contacts = 0;
+				uint32_t touched = s_no_island;
+
+				if (m_InvMass[p] > 0.f)
+				{
+					const glm::vec3 position(m_PosX[p], m_PosY[p], m_PosZ[p]);
+					const glm::vec3& rest = m_RestPositions[p];
+
+					m_Hash.query(position, m_Radius[p] + m_MaxRadius, [&](uint32_t q)
+					{
+						if (q == p)
+							return;
+
+						const float min_distance = m_Radius[p] + m_Radius[q];
+						const glm::vec3 offset = position - glm::vec3(m_PosX[q], m_PosY[q], m_PosZ[q]);
+						const float distance2 = glm::dot(offset, offset);
+
+						if (distance2 >= min_distance * min_distance || distance2 < s_epsilon * s_epsilon)
+							return;
+
+						// already this close at rest, the constraints hold them
+						const glm::vec3 rest_offset = rest - m_RestPositions[q];
+						if (glm::dot(rest_offset, rest_offset) < min_distance * min_distance)
+							return;
+
+						const float distance = std::sqrt(distance2);
+						const float share = m_InvMass[p] / (m_InvMass[p] + m_InvMass[q]);
+						delta += offset * ((min_distance - distance) / distance * share);
+						++contacts;
+
+						const uint32_t island = m_ParticleIsland[q];
+						if (island != s_no_island && !m_Islands[island].p_Awake)
+							touched = island;
+					});
+				}
+
+				if (touched != s_no_island)
+					m_Touched[p] = touched;
+
+				// averaged, so that many contacts don't push a particle too far
+				if (contacts > 1)
+					delta /= static_cast<float>(contacts);
+
+				m_DeltaX[p] = delta.x;
+				m_DeltaY[p] = delta.y;
+				m_DeltaZ[p] = delta.z;
+			}
+		});
+
+		for_ranges(m_ActiveParticles, s_particles_per_task, [&](size_t in_begin, size_t in_end)
+		{
+			for (size_t p = in_begin; p < in_end; ++p)
+			{
+				m_PosX[p] += m_DeltaX[p];
+				m_PosY[p] += m_DeltaY[p];
+				m_PosZ[p] += m_DeltaZ[p];
+			}
+		});
+	}
+
+	void cloth::setColliders(const std::vector<const bvh*>& in_colliders)
+	{
+		m_Colliders.clear();
+		for (auto collider : in_colliders)
+			if (collider && !collider->isEmpty())
+				m_Colliders.push_back(collider);
+
+		m_Centres.resize(m_Colliders.empty() ? 0 : m_ParticleCount);
+		m_Contacts.resize(m_Centres.size());
+
+		// what rests on the old bodies may not on the new ones
+		wake();
+	}
+
+	void cloth::collideBodies()
+	{
+		if (m_Colliders.empty())
+			return;
+
+		// the bodies are static, only the awake particles can run into them
+		const auto& ranges = m_ActiveParticles.p_Ranges;
+
+		for (const auto& range : ranges)
+			for (size_t p = range.first; p < range.second; ++p)
+				m_Centres[p] = glm::vec3(m_PosX[p], m_PosY[p], m_PosZ[p]);
+
+		for (auto collider : m_Colliders)
+		{
+			for (const auto& range : ranges)
+				collider->collide(&m_Centres[range.first], &m_Radius[range.first], range.second - range.first, &m_Contacts[range.first]);
+
+			// the side of the surface a particle is on is the one it started the
+			// sub-step on, so open and thin meshes are two-sided. particles still
+			// on that side are pushed to their radius away from the surface, those
+			// that went through it are brought back to that side of the triangle.
+			for (const auto& range : ranges)
+			{
+				for (size_t p = range.first; p < range.second; ++p)
+				{
+					const bvh::contact& contact = m_Contacts[p];
+					if (contact.p_Triangle == bvh::invalid || m_InvMass[p] == 0.f)
+						continue;
+
+					const glm::vec3 previous(m_PrevX[p], m_PrevY[p], m_PrevZ[p]);
+					const glm::vec3 normal = glm::dot(previous - contact.p_Point, contact.p_Normal) < 0.f ? -contact.p_Normal : contact.p_Normal;
+
+					const glm::vec3 offset = m_Centres[p] - contact.p_Point;
+					const bool same_side = glm::dot(offset, normal) > 0.f && contact.p_Distance > s_epsilon;
+
+					const glm::vec3 position = contact.p_Point + (same_side ? offset / contact.p_Distance : normal) * m_Radius[p];
+
+					m_PosX[p] = position.x;
+					m_PosY[p] = position.y;
+					m_PosZ[p] = position.z;
+					m_Centres[p] = position;
+				}
+			}
+		}
+	}
+
+	void cloth::updateVelocities(float in_dt)
+	{
+		using math::float4;
+
+		const float4 inv_dt(1.f / in_dt);
+		const float4 damping(std::max(0.f, 1.f - m_Settings.p_Damping * in_dt));
+
+		for_ranges(m_ActivePackets, s_particles_per_task / 4, [&](size_t in_begin, size_t in_end)
+		{
+			for (size_t p = in_begin * 4; p < in_end * 4; p += 4)
+			{
+				((float4::load(&m_PosX[p]) - float4::load(&m_PrevX[p])) * inv_dt * damping).store(&m_VelX[p]);
+				((float4::load(&m_PosY[p]) - float4::load(&m_PrevY[p])) * inv_dt * damping).store(&m_VelY[p]);
+				((float4::load(&m_PosZ[p]) - float4::load(&m_PrevZ[p])) * inv_dt * damping).store(&m_VelZ[p]);
+			}
+		});
+	}
+
+	void cloth::writeBack(graphics::mesh& out_mesh, float in_blend) const
+	{
+		if (m_ParticleCount == 0 || out_mesh.p_PosRadius.size() != m_VertexParticle.size())
+			return;
+
+		// the simulation may be publishing meanwhile, only the rotation is locked
+		std::vector<glm::vec3> positions(m_ParticleCount);
+		std::vector<glm::vec3> velocities;
+		{
+			std::lock_guard<std::mutex> lock(m_StateMutex);
+
+			const auto& previous = m_States[m_Previous].p_Positions;
+			const auto& current = m_States[m_Current].p_Positions;
+
+			for (size_t p = 0; p < m_ParticleCount; ++p)
+				positions[p] = glm::mix(previous[p], current[p], in_blend);
+
+			velocities = m_States[m_Current].p_Velocities;
+		}
+
+		// only the runs of vertices that moved are marked, the mesh refreshes
+		// the normals and tangents around them when deformed.
+		uint32_t run_start = 0, run_count = 0;
+		for (uint32_t v = 0; v < m_VertexParticle.size(); ++v)
+		{
+			const uint32_t p = m_VertexParticle[v];
+			const glm::vec4 position(positions[p], m_Radius[p]);
+
+			out_mesh.p_VelInvMass[v] = glm::vec4(velocities[p], m_AwakeInvMass[p]);
+
+			if (out_mesh.p_PosRadius[v] != position)
+			{
+				out_mesh.p_PosRadius[v] = position;
+
+				if (run_count == 0)
+					run_start = v;
+				++run_count;
+			}
+			else if (run_count > 0)
+			{
+				out_mesh.markDirty(run_start, run_count);
+				run_count = 0;
+			}
+		}
+
+		out_mesh.markDirty(run_start, run_count);
+	}
+}
@@ -0,0 +1,269 @@
+#pragma once
+
+#include "bvh.hpp"
+#include "simd.hpp"
+#include "spatial_hash.hpp"
+
+#define GLM_STATIC_CONST_MEMBERS
+#include <glm/vec3.hpp>
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace graphics
+{
+	class mesh;
+}
+
+namespace compute
+{
+	class gpu_cloth;
+
+	// extended position based dynamics (XPBD) cloth.
+	// particles are the welded vertices of a mesh, constraints
+	// are derived from its triangles: a distance constraint for
+	// every edge, and a bending one between the opposite vertices
+	// of every couple of triangles sharing an edge. particles also
+	// collide with each other and with rigid bodies, as spheres of
+	// the radius in p_PosRadius.w. groups of particles connected by
+	// constraints, the islands, fall asleep once they come to rest.
+	class cloth
+	{
+		friend class gpu_cloth;
+
+	public:
+
+		enum class device : uint32_t
+		{
+			CPU,
+			GPU
+		};
+
+		struct settings
+		{
+			settings();
+
+			// read the cloth_* parameters of a material, the
+			// cloth is enabled only if the material has any.
+			static settings parse(const std::map<std::string, std::string>& in_parameters);
+
+			bool		p_Enabled;
+			float		p_Density;				// mass per unit of area
+			float		p_StretchCompliance;	// inverse stiffness of the edges, 0 is inextensible
+			float		p_BendCompliance;		// inverse stiffness of the bending constraints
+			float		p_Damping;				// fraction of velocity lost per second
+			float		p_Thickness;			// particle radius where p_PosRadius.w is zero
+			bool		p_SelfCollision;		// push apart the particles closer than their radii
+			float		p_PinTop;				// particles within this distance from the top don't move
+			uint32_t	p_Substeps;				// sub-steps per simulation step
+			uint32_t	p_Iterations;			// solver iterations per sub-step
+			float		p_SleepSpeed;			// islands slower than this for p_SleepSteps fall asleep, 0 never
+			uint32_t	p_SleepSteps;			// simulation steps, not sub-steps
+			glm::vec3	p_Gravity;
+		};
+
+	private:
+
+		struct constraint
+		{
+			uint32_t	p_First;
+			uint32_t	p_Second;
+			float		p_RestLength;
+			float		p_Compliance;
+		};
+
+		// four constraints with no particle in common, projected in lock-step.
+		// unused lanes read the static dummy particle past the last one and
+		// are never written back, blocks of a colour share it.
+		struct constraint_block
+		{
+			uint32_t	p_First[4];
+			uint32_t	p_Second[4];
+			float		p_RestLength[4];
+			float		p_Compliance[4];
+			uint32_t	p_Lanes;	// used lanes, the first ones
+		};
+
+		settings m_Settings;
+
+		device		m_Device;
+		gpu_cloth*	m_Gpu;	// created the first time the cloth moves to the GPU
+
+		// particles as structure of arrays, padded to a multiple of four
+		size_t				m_ParticleCount;
+		std::vector<float>	m_PosX, m_PosY, m_PosZ;
+		std::vector<float>	m_PrevX, m_PrevY, m_PrevZ;
+		std::vector<float>	m_VelX, m_VelY, m_VelZ;
+		std::vector<float>	m_InvMass;
+		std::vector<float>	m_Radius;
+
+		// islands are the particles connected by constraints, pinned particles
+		// hold them together without joining any. particles are sorted by island
+		// and the pinned ones go last. a sleeping island is static, m_InvMass is
+		// zero and its velocities too, and only wakes up when something touches it.
+		struct island
+		{
+			uint32_t	p_First;		// particles [p_First, p_End)
+			uint32_t	p_End;
+			uint32_t	p_QuietSteps;	// consecutive steps slower than the sleep speed
+			bool		p_Awake;
+		};
+
+		std::vector<island>		m_Islands;
+		std::vector<uint32_t>	m_ParticleIsland;	// invalid for the pinned particles
+		std::vector<float>		m_AwakeInvMass;		// inverse masses whether asleep or not
+		std::vector<uint32_t>	m_Touched;			// sleeping island each particle collided with, or invalid
+		bool					m_Resting;			// all asleep and published as such
+
+		// ranges of blocks or particles taken as one index space, so that the
+		// steps only go through the awake islands.
+		struct active_ranges
+		{
+			std::vector<std::pair<size_t, size_t>>	p_Ranges;	// [first, end), sorted and disjoint
+			std::vector<size_t>						p_Starts;	// index of every range, plus the total
+
+			void add(size_t in_begin, size_t in_end);
+			inline void clear() { p_Ranges.clear(); p_Starts.clear(); }
+			inline bool empty() const { return p_Ranges.empty(); }
+		};
+
+		active_ranges				m_ActiveParticles;
+		active_ranges				m_ActivePackets;	// of four particles
+		std::vector<active_ranges>	m_ActiveBlocks;		// per colour
+		bool						m_ActiveChanged;	// an island fell asleep or woke up
+
+		// self collision: particles closer than their radii in the rest pose are
+		// neighbours on the surface and never collide, the rest are pushed apart.
+		spatial_hash			m_Hash;
+		float					m_MaxRadius;
+		std::vector<glm::vec3>	m_RestPositions;
+		std::vector<float>		m_DeltaX, m_DeltaY, m_DeltaZ;
+
+		// rigid bodies in the space of the cloth, and the contact of every particle
+		std::vector<const bvh*>		m_Colliders;
+		std::vector<glm::vec3>		m_Centres;
+		std::vector<bvh::contact>	m_Contacts;
+
+		// particle state after the last two steps, published for the renderer
+		// to blend between, and the one the next step is published to.
+		struct state
+		{
+			std::vector<glm::vec3> p_Positions;
+			std::vector<glm::vec3> p_Velocities;
+		};
+
+		state				m_States[3];
+		uint32_t			m_Previous;
+		uint32_t			m_Current;
+		uint32_t			m_Next;
+		mutable std::mutex	m_StateMutex;
+
+		std::vector<constraint>			m_Constraints;
+		std::vector<constraint_block>	m_Blocks;
+		std::vector<math::float4>		m_Lambdas;
+
+		// blocks are sorted by colour, the blocks of colour c are [m_ColourOffsets[c], m_ColourOffsets[c + 1]).
+		// no two blocks of the same colour share a particle, so each colour is solved in parallel.
+		// within a colour they are sorted by island, m_GroupOffsets[c * islands + i] is the first
+		// block of colour c and island i, so no block mixes islands.
+		std::vector<size_t>				m_ColourOffsets;
+		std::vector<size_t>				m_GroupOffsets;
+
+		// triangles as particle indices, and the particle of each mesh vertex
+		std::vector<uint32_t> m_Triangles;
+		std::vector<uint32_t> m_VertexParticle;
+
+		// partition the constraints in independent colours and pack them in blocks,
+		// only needed when the constraints change, i.e. when the topology does.
+		void colour();
+
+		// find the islands and sort the particles by island
+		void buildIslands();
+
+		// renumber the particles, new particle p is the old in_order[p]
+		void reorder(const std::vector<uint32_t>& in_order);
+
+		void updateActive();
+		void updateSleep();
+		void sleep(uint32_t in_island);
+		void wake(uint32_t in_island);
+
+		void integrate(float in_dt);
+		void solve(float in_dt);
+		void collide();
+		void collideBodies();
+		void updateVelocities(float in_dt);
+
+		// copy the particles to the next state, which becomes the current one
+		void publish();
+
+		// everything a step changes, verify runs from a copy and puts it
+		// back so that the scheduler and the recorder find the simulation
+		// where they left it.
+		struct snapshot
+		{
+			std::vector<float>			p_Positions[3];
+			std::vector<float>			p_Previous[3];
+			std::vector<float>			p_Velocities[3];
+			std::vector<float>			p_InvMass;
+			std::vector<island>			p_Islands;
+			std::vector<uint32_t>		p_Touched;
+			std::vector<bvh::contact>	p_Contacts;
+			std::vector<math::float4>	p_Lambdas;
+			state						p_States[3];
+			uint32_t					p_StateIndices[3];	// previous, current and next
+			bool						p_Resting;
+		};
+
+		void save(snapshot& out_snapshot) const;
+		void restore(const snapshot& in_snapshot);
+
+	public:
+
+		cloth();
+
+		bool create(const graphics::mesh& in_mesh, const settings& in_settings);
+		void destroy();
+
+		// advance the simulation by in_delta_time seconds, on the CPU it can
+		// run on another thread than writeBack, but not than the rest.
+		void simulate(float in_delta_time);
+
+		// copy positions and velocities back into the mesh vertices and mark
+		// the moved ones, positions blended from the previous step (0) to the
+		// last one (1). only needed on the CPU, the GPU updates the mesh
+		// buffers in place.
+		void writeBack(graphics::mesh& out_mesh, float in_blend = 1.f) const;
+
+		// particles keep their radius away from the surfaces of in_colliders,
+		// which must stay alive and not be refitted while the cloth simulates.
+		void setColliders(const std::vector<const bvh*>& in_colliders);
+
+		// wake every island up, after the settings changed or pinned particles moved
+		void wake();
+
+		// carry on the simulation on in_device, io_mesh has to be the mesh
+		// the cloth was created from: the state goes through its buffers.
+		bool setDevice(device in_device, graphics::mesh& io_mesh);
+		inline device getDevice() const { return m_Device; }
+
+		// simulate in_frames frames on both devices from the same state and
+		// compare the particle positions, true if they are within in_tolerance.
+		// self collision is left out, the GPU doesn't do it. the simulation is
+		// put back where it was, on the device it was.
+		bool verify(graphics::mesh& io_mesh, uint32_t in_frames, float in_tolerance);
+
+		// hash of the particle positions and velocities, equal for states equal bit for bit.
+		// on the GPU the particles aren't read back, it's the state when it moved there.
+		uint64_t checksum() const;
+
+		inline size_t getParticleCount() const { return m_ParticleCount; }
+		inline size_t getConstraintBlockCount() const { return m_Blocks.size(); }
+		inline size_t getColourCount() const { return m_ColourOffsets.empty() ? 0 : m_ColourOffsets.size() - 1; }
+		inline size_t getIslandCount() const { return m_Islands.size(); }
+		size_t getAwakeIslandCount() const;
+	};
+}
@@ -1,14 +1,120 @@
 #include "compute.hpp"
+#include "compiler.hpp"
+#include "hot_reload.hpp"
+#include "logging.hpp"
+#include "ogl.hpp"
+
+namespace
+{
+	const char* s_program_sources[] =
+	{
+		"data/shaders/cloth_integrate.comp",
+		"data/shaders/cloth_project.comp",
+		"data/shaders/cloth_velocity.comp",
+		"data/shaders/cloth_normals.comp"
+	};
+
+	uint32_t build(compiler& in_compiler, const char* cs_source)
+	{
+		gl::uint32 shader_name = in_compiler.create(GL_COMPUTE_SHADER, cs_source);
+		if (!in_compiler.checkShader(shader_name))
+			return 0;
+
+		gl::uint32 program_name = glCreateProgram();
+		glAttachShader(program_name, shader_name);
+		glLinkProgram(program_name);
+
+		if (!in_compiler.checkProgram(program_name))
+		{
+			glDeleteProgram(program_name);
+			return 0;
+		}
+
+		return program_name;
+	}
+}
 
 namespace compute
 {
+	uint32_t clothing::s_Programs[enum_to_t(program::MAX)] = {};
+
 	bool clothing::init()
 	{
+#if GLM_ARCH & GLM_ARCH_SSE2
+		LOG(INFO) << "clothing: constraints projected four at a time with SSE2";
+#else
+		LOG(INFO) << "clothing: constraints projected four at a time with scalar code";
+#endif
+
+		bool gpu_supported = GLEW_VERSION_4_3 || (GLEW_ARB_compute_shader && GLEW_ARB_shader_storage_buffer_object);
+
+		compiler compiler_instance;
+		for (uint32_t p = 0; p < enum_to_t(program::MAX) && gpu_supported; ++p)
+		{
+			s_Programs[p] = build(compiler_instance, s_program_sources[p]);
+			gpu_supported = s_Programs[p] != 0;
+
+			// the clothes look their programs up every step
+			if (gpu_supported)
+				graphics::hot_reload::watch(&s_Programs[p], compiler_instance, s_Programs[p], [p](uint32_t in_program)
+				{
+					glDeleteProgram(s_Programs[p]);
+					s_Programs[p] = in_program;
+				});
+		}
+
+		if (!gpu_supported)
+		{
+			shutdown();
+			LOG(WARNING) << "clothing: compute shaders not available, simulating on the CPU only";
+		}
+
 		return true;
 	}
 
 	bool clothing::shutdown()
 	{
+		for (auto& program_name : s_Programs)
+		{
+			graphics::hot_reload::forget(&program_name);
+
+			if (program_name)
+				glDeleteProgram(program_name);
+			program_name = 0;
+		}
+
 		return true;
 	}
+
+	bool clothing::isSupported(cloth::device in_device)
+	{
+		return in_device == cloth::device::CPU || s_Programs[enum_to_t(program::NORMALS)] != 0;
+	}
+
+	uint32_t clothing::getProgram(program in_program)
+	{
+		return s_Programs[enum_to_t(in_program)];
+	}
+
+	cloth* clothing::create(const graphics::mesh& in_mesh, const cloth::settings& in_settings)
+	{
+		cloth* new_cloth = new cloth();
+		if (!new_cloth->create(in_mesh, in_settings))
+		{
+			delete new_cloth;
+			return nullptr;
+		}
+
+		return new_cloth;
+	}
+
+	void clothing::release(cloth* in_cloth)
+	{
+		if (in_cloth)
+		{
+			in_cloth->destroy();
+		}
+
+		delete in_cloth;
+	}
 }
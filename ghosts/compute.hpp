@@ -1,5 +1,8 @@
 #pragma once
 
+#include "cloth.hpp"
+#include "util.hpp"
+
 namespace compute
 {
 	class clothing
@@ -7,7 +10,32 @@ namespace compute
 
 	public:
 
+		enum class program : uint32_t
+		{
+			INTEGRATE,
+			PROJECT,
+			VELOCITY,
+			NORMALS,
+			MAX
+		};
+
+	private:
+
+		// compute programs of the GPU solver, zero when not available
+		static uint32_t s_Programs[enum_to_t(program::MAX)];
+
+	public:
+
+		// the GPU solver needs a current context with compute shaders,
+		// without them clothes are simulated on the CPU only.
 		static bool init();
 		static bool shutdown();
+
+		static bool isSupported(cloth::device in_device);
+		static uint32_t getProgram(program in_program);
+
+		// simulate the welded vertices of in_mesh, nullptr if the mesh can't be simulated
+		static cloth* create(const graphics::mesh& in_mesh, const cloth::settings& in_settings);
+		static void release(cloth* in_cloth);
 	};
-}
\ No newline at end of file
+}
@@ -1,8 +1,19 @@
 #version 450 core
 
 #define LIGHT		1
+#define AMBIENT		2
 #define FRAG_COLOR	0
 
+// features of the material, each variant is compiled with the defines of its own:
+// WITH_DIFFUSE_MAP		albedo from the DiffuseMap, a constant one otherwise
+// WITH_NORMAL_MAP		normals from the NormalMap, the interpolated ones otherwise
+// WITH_DISPLACEMENT_MAP	texture coordinates offset by the HeightMap, parallax mapping
+// WITH_ENVIRONMENT		image based lighting from the EnvironmentMap
+// DEBUG_NORMALS		draw the tangent-space normals instead of the lighting
+
+// height of the displacement in texture coordinates
+#define PARALLAX_SCALE	0.04
+
 #define DIFFUSE			0
 #define SPECULAR		1
 #define NORMAL			2
@@ -18,6 +29,8 @@ in block
 {
 	vec3 Position;
 	vec3 Normal;
+	vec3 Tangent;
+	vec3 Bitangent;
 	vec2 TexCoords;
 	vec3 LightDir;
 	vec3 ViewDir;
@@ -28,17 +41,24 @@ layout(binding = SPECULAR) uniform sampler2D SpecularMap;
 layout(binding = NORMAL) uniform sampler2D NormalMap;
 layout(binding = ROUGHNESS) uniform sampler2D RoughnessMap;
 layout(binding = DISPLACEMENT) uniform sampler2D HeightMap;
+layout(binding = ENVIRONMENT) uniform samplerCube EnvironmentMap;
+
+layout(binding = AMBIENT) uniform ambient
+{
+	mat4 ViewToWorld;
+	vec4 Irradiance[9];	// spherical harmonics of the irradiance of the environment
+	vec4 Levels;		// levels of the environment map in x, 0 in y without an environment
+} Ambient;
 
 layout(location = FRAG_COLOR, index = 0) out vec4 Color;
 
-vec3 ads(vec3 Normal, vec3 LightDir, vec3 ViewDir)
+vec3 ads(vec3 albedo, vec3 Normal, vec3 LightDir, vec3 ViewDir)
 {
 	vec3 n = normalize( Normal );
 	vec3 l = normalize( LightDir );
 	vec3 v = normalize( ViewDir );
 	vec3 r = reflect( -l, n );
 
-	vec3 albedo = vec3(0.9f);//texture2D(DiffuseMap, In.TexCoords).xyz;
 	vec3 diffuse = albedo * max( dot(l, n), 0.0 );
 	vec3 shininess = vec3(0.8);
 	vec3 specular = shininess * pow( max( dot(r, v), 0.0 ), 64 );
@@ -46,16 +66,77 @@ vec3 ads(vec3 Normal, vec3 LightDir, vec3 ViewDir)
 	return diffuse + specular;
 }
 
+// irradiance of the environment received by a world space normal
+vec3 irradiance(vec3 n)
+{
+	return Ambient.Irradiance[0].rgb * 0.282095
+		+ Ambient.Irradiance[1].rgb * 0.488603 * n.y
+		+ Ambient.Irradiance[2].rgb * 0.488603 * n.z
+		+ Ambient.Irradiance[3].rgb * 0.488603 * n.x
+		+ Ambient.Irradiance[4].rgb * 1.092548 * n.x * n.y
+		+ Ambient.Irradiance[5].rgb * 1.092548 * n.y * n.z
+		+ Ambient.Irradiance[6].rgb * 0.315392 * (3.0 * n.z * n.z - 1.0)
+		+ Ambient.Irradiance[7].rgb * 1.092548 * n.x * n.z
+		+ Ambient.Irradiance[8].rgb * 0.546274 * (n.x * n.x - n.y * n.y);
+}
+
+// image based lighting, the environment map levels are prefiltered for increasing roughness
+vec3 environment(vec3 albedo, vec3 Normal, vec3 ViewDir, float roughness)
+{
+	vec3 n = normalize( Normal );
+	vec3 v = normalize( ViewDir );
+	mat3 view_to_world = mat3( Ambient.ViewToWorld );
+
+	vec3 diffuse = albedo * max( irradiance( view_to_world * n ), 0.0 ) / 3.14159265;
+
+	float lod = roughness * ( Ambient.Levels.x - 1.0 );
+	vec3 specular = textureLod( EnvironmentMap, view_to_world * reflect( -v, n ), lod ).rgb;
+
+	// schlick fresnel of a dielectric, rough surfaces reflect less at grazing angles
+	float f0 = 0.04;
+	float fresnel = f0 + ( max( 1.0 - roughness, f0 ) - f0 ) * pow( 1.0 - max( dot( n, v ), 0.0 ), 5.0 );
+
+	return Ambient.Levels.y * mix( diffuse, specular, fresnel );
+}
+
 void main()
 {
-	vec4 normal = 2.0 * texture( NormalMap, In.TexCoords ) - 1.0;
-	
+#ifdef WITH_DISPLACEMENT_MAP
+	// offset towards the eye by the height around the mid level, the view direction is in tangent space
+	vec3 view_dir = normalize( In.ViewDir );
+	float height = ( texture( HeightMap, In.TexCoords ).r - 0.5 ) * PARALLAX_SCALE;
+	vec2 texcoords = In.TexCoords + height * view_dir.xy;
+#else
+	vec2 texcoords = In.TexCoords;
+#endif
+
+#ifdef WITH_NORMAL_MAP
+	vec3 normal = 2.0 * texture( NormalMap, texcoords ).xyz - 1.0;
+
+	// compressed normal maps only keep x and y, z is rebuilt as the normals are unit ones
+	normal.z = sqrt( max( 1.0 - dot( normal.xy, normal.xy ), 0.0 ) );
+#else
+	// the interpolated normal, in tangent space
+	vec3 normal = vec3( 0.0, 0.0, 1.0 );
+#endif
+
+#ifdef DEBUG_NORMALS
 	// draw tangent-space normals
-	//Color = vec4(vec3(normal), 1.0);
-	
+	Color = vec4( normal * 0.5 + 0.5, 1.0 );
+#else
+#ifdef WITH_DIFFUSE_MAP
+	vec3 albedo = texture( DiffuseMap, texcoords ).rgb;
+#else
+	vec3 albedo = vec3( 0.9 );
+#endif
+
 	// tangent space
-	Color = vec4(ads(normal.xyz, In.LightDir, In.ViewDir), 1.0);
-	
-	// view space
-	//Color = vec4(ads(In.Normal.xyz, normalize(vec3(1.0,2.0,0.0)), -In.Position), 1.0);
+	Color = vec4( ads( albedo, normal, In.LightDir, In.ViewDir ), 1.0 );
+
+#ifdef WITH_ENVIRONMENT
+	// the environment is looked up in world space, through view space
+	vec3 view_normal = mat3( In.Tangent, In.Bitangent, In.Normal ) * normal;
+	Color.rgb += environment( albedo, view_normal, -In.Position, texture( RoughnessMap, texcoords ).r );
+#endif
+#endif
 }
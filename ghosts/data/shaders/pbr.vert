@@ -56,6 +56,8 @@ out block
 {
 	vec3 Position;
 	vec3 Normal;
+	vec3 Tangent;
+	vec3 Bitangent;
 	vec2 TexCoords;
 	vec3 LightDir;
 	vec3 ViewDir;
@@ -82,6 +84,8 @@ void main()
 
 	// outputs in tangent space
 	Out.Normal = normal;
+	Out.Tangent = tangent;
+	Out.Bitangent = bitangent;
 	Out.ViewDir = tbn * normalize(-position);
 	
 	// light direction already comes in view space
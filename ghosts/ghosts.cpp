@@ -2,8 +2,22 @@
 #include "compute.hpp"
 #include "graphics.hpp"
 #include "logging.hpp"
+#include "format.hpp"
 #include "ghosts.hpp"
+#include "texture.hpp"
+#include "hot_reload.hpp"
 
+#include <cfloat>
+
+namespace
+{
+	const char* s_model_files[] =
+	{
+		"data/models/barrel/barrel.awf",
+	//	"data/models/kungfu-panda/kungfu.awf",
+		"data/models/curtain/curtain.awf"
+	};
+}
 
 void ghosts::onKeyStateChange(int Key, key_action old_state, key_action new_state)
 {
@@ -23,6 +37,70 @@ void ghosts::onKeyStateChange(int Key, key_action old_state, key_action new_stat
 		}
 	}
 
+	// normals instead of the lighting CTRL+N
+	if (isKeyPressed(GLFW_KEY_LEFT_CONTROL) && Key == GLFW_KEY_N && new_state == test::KEY_PRESS)
+	{
+		for (auto model : m_Models) {
+			model->toggleRenderMode(framework::model::render_mode::NORMAL);
+		}
+	}
+
+	// cloth on the CPU or the GPU CTRL+G
+	if (isKeyPressed(GLFW_KEY_LEFT_CONTROL) && Key == GLFW_KEY_G && new_state == test::KEY_PRESS)
+	{
+		m_ClothOnGpu = !m_ClothOnGpu;
+		m_Scheduler.wait();
+
+		const auto device = m_ClothOnGpu ? compute::cloth::device::GPU : compute::cloth::device::CPU;
+		for (auto model : m_Models) {
+			model->setClothDevice(device);
+		}
+
+		LOG(INFO) << (m_ClothOnGpu ? "cloth simulated on the GPU" : "cloth simulated on the CPU");
+	}
+
+	// compare cloth devices CTRL+V
+	if (isKeyPressed(GLFW_KEY_LEFT_CONTROL) && Key == GLFW_KEY_V && new_state == test::KEY_PRESS)
+	{
+		m_Scheduler.wait();
+		for (auto model : m_Models) {
+			model->verifyClothes(10);
+		}
+	}
+
+	// pick the rigid mesh at the centre of the view CTRL+P
+	if (isKeyPressed(GLFW_KEY_LEFT_CONTROL) && Key == GLFW_KEY_P && new_state == test::KEY_PRESS)
+	{
+		glm::vec2 window_size(getWindowSize());
+		const glm::mat4 to_world = glm::inverse(glm::perspectiveFov(glm::pi<float>() * 0.25f, window_size.x, window_size.y, 0.1f, 100.0f) * view());
+
+		const glm::vec4 near_point = to_world * glm::vec4(0.f, 0.f, -1.f, 1.f);
+		const glm::vec4 far_point = to_world * glm::vec4(0.f, 0.f, 1.f, 1.f);
+		const glm::vec3 origin = near_point.xyz() / near_point.w;
+		const glm::vec3 direction = glm::normalize(far_point.xyz() / far_point.w - origin);
+
+		size_t picked_model = m_Models.size(), picked_mesh = 0;
+		compute::bvh::hit picked;
+		picked.p_Distance = FLT_MAX;
+
+		for (size_t m = 0; m < m_Models.size(); ++m)
+		{
+			size_t mesh = 0;
+			compute::bvh::hit hit;
+			if (m_Models[m]->raycast(origin, direction, mesh, hit) && hit.p_Distance < picked.p_Distance)
+			{
+				picked = hit;
+				picked_model = m;
+				picked_mesh = mesh;
+			}
+		}
+
+		if (picked_model < m_Models.size())
+			LOG(INFO) << fmt::format("picked model {} mesh {} triangle {} at {}", picked_model, picked_mesh, picked.p_Triangle, picked.p_Distance);
+		else
+			LOG(INFO) << "picked nothing";
+	}
+
 	// shaded CTRL+S
 	if (isKeyPressed(GLFW_KEY_LEFT_CONTROL) && Key == GLFW_KEY_S && new_state == test::KEY_PRESS)
 	{
@@ -36,24 +114,119 @@ bool ghosts::begin()
 {
 	if (graphics::renderer::init() && compute::clothing::init())
 	{
-		if (auto m = framework::model::load("data/models/barrel/barrel.awf", framework::model::file_type::ASCII))
-	//	if (auto m = framework::model::load("data/models/kungfu-panda/kungfu.awf", framework::model::file_type::ASCII))
+		graphics::texture::setMemoryBudget(m_TextureMemory);
+		graphics::texture::setQuality(m_TextureQuality);
+		for (uint32_t sampler = 0; sampler < enum_to_t(graphics::material::sampler::MAX); ++sampler)
+			framework::model::setTextureQuality(static_cast<graphics::material::sampler>(sampler), m_SamplerQualities[sampler]);
+
+		for (auto model_file : s_model_files)
 		{
-			if (m->initialise()) {
-				m_Models.push_back(m);
+			if (auto m = framework::model::load(model_file, framework::model::file_type::ASCII, m_SortVertices))
+			{
+				if (m->initialise(m_StreamTextures, m_CompressTextures)) {
+					m_Models.push_back(m);
+				}
 			}
 		}
+
+		if (m_Environment.create("data/textures/ibl/cubemaps/golden-gate-bridge/"))
+		{
+			for (auto model : m_Models)
+				model->setEnvironment(&m_Environment);
+		}
+		else
+			LOG(WARNING) << "ibl: can't load the environment, the models are lit by the light only";
+
+		if (!m_RecordFile.empty() && m_Recorder.open(m_RecordFile, static_cast<uint32_t>(m_Models.size()), m_RecordChecksums))
+		{
+			for (uint32_t m = 0; m < m_Models.size(); ++m)
+				m_Models[m]->setRecorder(&m_Recorder, m);
+		}
+
+		for (auto model : m_Models)
+		{
+			if (m_ClothVerify && !model->verifyClothes(10))
+				LOG(ERROR) << "cloth: the CPU and GPU simulations differ";
+
+			if (m_ClothOnGpu && !model->setClothDevice(compute::cloth::device::GPU))
+				LOG(WARNING) << "cloth: can't simulate on the GPU, staying on the CPU";
+		}
+
+		// a few steps behind at most, then the simulation slows down
+		const uint32_t max_backlog = 4;
+		if (m_SimulationRate <= 0.f || !m_Scheduler.start(1.f / m_SimulationRate, max_backlog, [this](float in_step) { simulate(in_step); }))
+			LOG(ERROR) << fmt::format("can't simulate at {} steps per second", m_SimulationRate);
+
+		m_LastFrame = std::chrono::steady_clock::now();
+	}
+
+	return true;
+}
+
+bool ghosts::replay(int argc, const char* argv[], int& out_exit_code)
+{
+	std::string replay_file, times_file;
+	bool sort_vertices = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		// the order of the vertices is the order of the particles, it has to be the recorded one
+		sort_vertices |= std::string(argv[i]) == "--sort-vertices";
+
+		if (std::string(argv[i]) == "--replay" && i + 1 < argc)
+			replay_file = argv[++i];
+		else if (std::string(argv[i]) == "--replay-times" && i + 1 < argc)
+			times_file = argv[++i];
+	}
+
+	if (replay_file.empty())
+		return false;
+
+	// compute::clothing isn't initialised without a context, the clothes stay on the CPU.
+	// the recording holds the device changes and verifications, replaying it from the
+	// models as loaded is all there is to do.
+	std::vector<framework::model*> models;
+	for (auto model_file : s_model_files)
+	{
+		if (auto m = framework::model::load(model_file, framework::model::file_type::ASCII, sort_vertices))
+		{
+			if (m->initialiseSimulation())
+				models.push_back(m);
+			else
+				framework::model::release(m);
+		}
 	}
 
+	framework::recorder::report report;
+	const bool match = framework::recorder::replay(replay_file, models, times_file, report);
+
+	for (auto model : models)
+		framework::model::release(model);
+
+	out_exit_code = match ? EXIT_SUCCESS : EXIT_FAILURE;
 	return true;
 }
 
+void ghosts::simulate(float in_step)
+{
+	for (auto model : m_Models) {
+		model->simulate(in_step, compute::cloth::device::CPU);
+	}
+}
+
 bool ghosts::end()
 {
+	m_Scheduler.stop();
+	m_Recorder.close();
+
 	for (auto model : m_Models) {
 		framework::model::release(model);
 	}
 
+	m_Environment.destroy();
+	graphics::material::shutdown();
+	graphics::hot_reload::shutdown();
+
 	return graphics::renderer::shutdown() && compute::clothing::shutdown();
 }
 
@@ -68,14 +241,32 @@ bool ghosts::render()
 	//glm::vec4 light_vec(-1.f, -2.f, 0.f, 100.f);
 	glm::vec4 light_vec(-1.f, -1.f, 0.f, 100.f);
 
-	// simulate
+	// simulate: CPU steps run on the scheduler thread, GPU ones need the context
+	const auto now = std::chrono::steady_clock::now();
+	const float frame_time = std::chrono::duration<float>(now - m_LastFrame).count();
+	m_LastFrame = now;
+
+	const uint32_t steps = m_Scheduler.advance(frame_time);
+	for (uint32_t step = 0; step < steps; ++step) {
+		for (auto model : m_Models) {
+			model->simulate(m_Scheduler.getStep(), compute::cloth::device::GPU);
+		}
+	}
+
+	const float blend = m_Scheduler.getBlend();
 	for (auto model : m_Models) {
-		model->simulate(0.016f);
+		model->present(blend);
 	}
 
+	// the shaders edited since the last frame
+	graphics::hot_reload::update();
+
+	// fit the textures in memory for the levels requested last frame, then the next levels
+	graphics::texture::stream(m_TextureBudget);
+
 	// render
 	for (auto model : m_Models) {
-		model->render(projection_matrix, view(), light_vec);
+		model->render(projection_matrix, view(), light_vec, window_size);
 	}
 
 	return true;
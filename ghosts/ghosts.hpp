@@ -1,6 +1,15 @@
 #pragma once
 
 #include "test.hpp"
+#include "scheduler.hpp"
+#include "recorder.hpp"
+#include "ibl.hpp"
+#include "material.hpp"
+#include "util.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <string>
 
 namespace framework
 {
@@ -15,11 +24,108 @@ private:
 
 	std::vector<framework::model*> m_Models;
 
+	// --cloth-gpu starts the cloth simulation on the GPU, --cloth-verify
+	// compares it to the CPU one once the models are loaded.
+	bool m_ClothOnGpu;
+	bool m_ClothVerify;
+
+	// --sort-vertices lays the vertices of the models out along a space filling curve
+	bool m_SortVertices;
+
+	// --stream-textures loads the smallest levels of the textures only, the others
+	// are uploaded from the next frames on, --texture-budget kilobytes per frame.
+	bool m_StreamTextures;
+	size_t m_TextureBudget;
+
+	// --texture-memory megabytes the storages of the textures are kept within,
+	// the levels the models don't need on screen are dropped to fit.
+	size_t m_TextureMemory;
+
+	// --texture-quality skips the largest levels of the textures of the models,
+	// --texture-quality-<sampler> those of one sampler, e.g. --texture-quality-normal.
+	uint32_t m_TextureQuality;
+	int32_t m_SamplerQualities[enum_to_t(graphics::material::sampler::MAX)];
+
+	// --compress-textures block compresses the uncompressed textures once, the
+	// compressed copies are written next to them and loaded from then on.
+	bool m_CompressTextures;
+
+	// image based lighting of the models, baked from the environment cubemap once
+	// and loaded from the bake from then on.
+	graphics::ibl m_Environment;
+
+	// the simulation steps at --simulation-rate steps per second, 60 by default
+	compute::scheduler m_Scheduler;
+	float m_SimulationRate;
+	std::chrono::steady_clock::time_point m_LastFrame;
+
+	// --record <file> writes the inputs of the simulation to file, with the state
+	// checksums too if --record-checksums is given, see replay to run them again.
+	framework::recorder m_Recorder;
+	std::string m_RecordFile;
+	bool m_RecordChecksums;
+
+	void simulate(float in_step);
+
 public:
 
 	ghosts(int argc, const char* argv[])
 		: test(argc, const_cast<char**>(argv), "ghosts", test::CORE, 4, 5)
-	{}
+		, m_ClothOnGpu(false)
+		, m_ClothVerify(false)
+		, m_SortVertices(false)
+		, m_StreamTextures(false)
+		, m_TextureBudget(4096 * 1024)
+		, m_TextureMemory(size_t(1024) << 20)
+		, m_TextureQuality(0)
+		, m_CompressTextures(false)
+		, m_SimulationRate(60.f)
+		, m_RecordChecksums(false)
+	{
+		const char* sampler_names[enum_to_t(graphics::material::sampler::MAX)] =
+		{
+			"diffuse", "specular", "normal", "roughness", "displacement", "environment"
+		};
+
+		for (auto& quality : m_SamplerQualities)
+			quality = -1;
+
+		for (int i = 1; i < argc; ++i)
+		{
+			m_ClothOnGpu |= std::string(argv[i]) == "--cloth-gpu";
+			m_ClothVerify |= std::string(argv[i]) == "--cloth-verify";
+			m_SortVertices |= std::string(argv[i]) == "--sort-vertices";
+			m_StreamTextures |= std::string(argv[i]) == "--stream-textures";
+			m_CompressTextures |= std::string(argv[i]) == "--compress-textures";
+
+			if (std::string(argv[i]) == "--texture-budget" && i + 1 < argc)
+				m_TextureBudget = static_cast<size_t>(std::atoi(argv[++i])) * 1024;
+
+			if (std::string(argv[i]) == "--texture-memory" && i + 1 < argc)
+				m_TextureMemory = static_cast<size_t>(std::atoi(argv[++i])) << 20;
+
+			if (std::string(argv[i]) == "--texture-quality" && i + 1 < argc)
+				m_TextureQuality = static_cast<uint32_t>(std::atoi(argv[++i]));
+
+			for (uint32_t sampler = 0; sampler < enum_to_t(graphics::material::sampler::MAX); ++sampler)
+				if (std::string(argv[i]) == std::string("--texture-quality-") + sampler_names[sampler] && i + 1 < argc)
+					m_SamplerQualities[sampler] = std::atoi(argv[++i]);
+
+			if (std::string(argv[i]) == "--simulation-rate" && i + 1 < argc)
+				m_SimulationRate = static_cast<float>(std::atof(argv[++i]));
+
+			m_RecordChecksums |= std::string(argv[i]) == "--record-checksums";
+
+			if (std::string(argv[i]) == "--record" && i + 1 < argc)
+				m_RecordFile = argv[++i];
+		}
+	}
+
+	// --replay <file> runs the recorded inputs on the models loaded afresh, on the
+	// CPU, with neither a window nor a context so that it runs without a GPU too.
+	// --replay-times <csv> writes the time of every step, and the exit code is a
+	// failure if any step diverges from its checksum. false without --replay.
+	static bool replay(int argc, const char* argv[], int& out_exit_code);
 
 	virtual bool begin() override;
 	virtual bool end() override;
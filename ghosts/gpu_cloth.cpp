@@ -0,0 +1,325 @@
+#include "gpu_cloth.hpp"
+#include "cloth.hpp"
+#include "compute.hpp"
+#include "mesh.hpp"
+#include "ogl.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	// invocations per work group, local_size_x of the cloth shaders
+	const uint32_t s_group_size = 64;
+
+	// storage buffer bindings shared by the cloth shaders, the mesh buffers
+	// keep the bindings they have when drawn. the normals pass takes the
+	// tangents in the second slot, and the velocities' binding for a slot of
+	// its own, so it fits in the eight buffers compute shaders are granted.
+	enum binding : uint32_t
+	{
+		POSITION = 0,
+		NORMAL = 1,
+		SLOT_0 = 2,
+		SLOT_1 = 3,
+		TANGENT = 3,
+		VELOCITY = 4,
+		SLOT_2 = 5,
+		SLOT_3 = 6,
+		SLOT_4 = 7
+	};
+
+	// uniform locations, see the shaders
+	enum location : uint32_t
+	{
+		COUNT = 0,
+		DT = 1,
+		GRAVITY = 2,
+		INV_DT2 = 1,
+		FIRST = 2,
+		INV_DT = 1,
+		DAMPING = 2,
+		TANGENTS = 1
+	};
+
+	struct gpu_constraint
+	{
+		uint32_t p_First;
+		uint32_t p_Second;
+		float p_RestLength;
+		float p_Compliance;
+	};
+
+	// corners of a triangle as simulated vertices, for the positions, and as
+	// its own mesh vertices with their uv deltas, for the tangents
+	struct gpu_triangle
+	{
+		uint32_t p_Simulated[4];
+		uint32_t p_Corners[4];
+		glm::vec4 p_DeltaUV;	// uv1 - uv0 in xy, uv2 - uv0 in zw
+	};
+
+	inline uint32_t groups(uint32_t in_count)
+	{
+		return (in_count + s_group_size - 1) / s_group_size;
+	}
+
+	template<typename T>
+	void upload(gl::uint32 in_name, const std::vector<T>& in_data)
+	{
+		// empty buffers can't be bound, keep at least one element
+		const size_t size = std::max<size_t>(in_data.size(), 1) * sizeof(T);
+
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, in_name);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, size, nullptr, GL_DYNAMIC_COPY);
+		if (!in_data.empty())
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, in_data.size() * sizeof(T), in_data.data());
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+}
+
+namespace compute
+{
+	gpu_cloth::gpu_cloth()
+		: m_Positions(0)
+		, m_Normals(0)
+		, m_Tangents(0)
+		, m_Velocities(0)
+		, m_ParticleCount(0)
+		, m_VertexCount(0)
+	{
+		memset(m_Buffers, 0, sizeof(m_Buffers));
+	}
+
+	bool gpu_cloth::create(const cloth& in_cloth, const graphics::mesh& in_mesh)
+	{
+		destroy();
+
+		m_Positions = in_mesh.getBuffer(graphics::mesh::buffer::POSITION);
+		m_Normals = in_mesh.getBuffer(graphics::mesh::buffer::NORMAL);
+		m_Velocities = in_mesh.getBuffer(graphics::mesh::buffer::VELOCITY);
+
+		// the tangents follow the cloth like they do on the CPU, when the mesh has them
+		const bool has_tangents = in_mesh.p_Tangents.size() == in_mesh.p_PosRadius.size() && in_mesh.p_TexCoords.size() == in_mesh.p_PosRadius.size();
+		m_Tangents = has_tangents ? in_mesh.getBuffer(graphics::mesh::buffer::TANGENT) : 0;
+
+		if (!m_Positions || !m_Normals || !m_Velocities || in_cloth.m_ParticleCount == 0)
+			return false;
+
+		m_ParticleCount = static_cast<uint32_t>(in_cloth.m_ParticleCount);
+		m_VertexCount = static_cast<uint32_t>(in_cloth.m_VertexParticle.size());
+
+		// the first vertex of each particle is the one simulated
+		m_ParticleVertex.assign(m_ParticleCount, ~0u);
+		for (uint32_t v = 0; v < m_VertexCount; ++v)
+		{
+			auto& vertex = m_ParticleVertex[in_cloth.m_VertexParticle[v]];
+			if (vertex == ~0u)
+				vertex = v;
+		}
+
+		// the constraint blocks without their padding, colour after colour
+		const uint32_t dummy = m_ParticleCount;
+		std::vector<gpu_constraint> constraints;
+		constraints.reserve(in_cloth.m_Constraints.size());
+
+		m_ColourOffsets.assign(1, 0);
+		for (size_t c = 0; c + 1 < in_cloth.m_ColourOffsets.size(); ++c)
+		{
+			for (size_t b = in_cloth.m_ColourOffsets[c]; b < in_cloth.m_ColourOffsets[c + 1]; ++b)
+			{
+				const auto& block = in_cloth.m_Blocks[b];
+				for (uint32_t l = 0; l < 4; ++l)
+				{
+					if (block.p_First[l] == dummy)
+						continue;
+
+					gpu_constraint constraint;
+					constraint.p_First = m_ParticleVertex[block.p_First[l]];
+					constraint.p_Second = m_ParticleVertex[block.p_Second[l]];
+					constraint.p_RestLength = block.p_RestLength[l];
+					constraint.p_Compliance = block.p_Compliance[l];
+					constraints.push_back(constraint);
+				}
+			}
+
+			m_ColourOffsets.push_back(static_cast<uint32_t>(constraints.size()));
+		}
+
+		// triangles around each particle, as a compressed sparse row
+		const auto& triangles = in_cloth.m_Triangles;
+		const uint32_t triangle_count = static_cast<uint32_t>(triangles.size() / 3);
+
+		std::vector<uint32_t> offsets(m_ParticleCount + 1, 0);
+		for (auto p : triangles)
+			++offsets[p + 1];
+		for (uint32_t p = 0; p < m_ParticleCount; ++p)
+			offsets[p + 1] += offsets[p];
+
+		std::vector<uint32_t> adjacency(triangles.size());
+		{
+			std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+			for (uint32_t t = 0; t < triangle_count; ++t)
+				for (uint32_t k = 0; k < 3; ++k)
+					adjacency[next[triangles[3 * t + k]]++] = t;
+		}
+
+		// the faces dropped by the cloth are dropped again to keep the triangles in step
+		std::vector<gpu_triangle> triangle_data;
+		triangle_data.reserve(triangle_count);
+
+		const auto& faces = in_mesh.p_FaceIndices;
+		for (size_t f = 0; f + 2 < faces.size(); f += 3)
+		{
+			const uint32_t a = in_cloth.m_VertexParticle[faces[f + 0]];
+			const uint32_t b = in_cloth.m_VertexParticle[faces[f + 1]];
+			const uint32_t c = in_cloth.m_VertexParticle[faces[f + 2]];
+
+			if (a == b || b == c || c == a)
+				continue;
+
+			gpu_triangle triangle = {};
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				triangle.p_Simulated[k] = m_ParticleVertex[triangles[3 * triangle_data.size() + k]];
+				triangle.p_Corners[k] = faces[f + k];
+			}
+
+			if (m_Tangents)
+			{
+				const glm::vec2 delta_uv1 = in_mesh.p_TexCoords[faces[f + 1]] - in_mesh.p_TexCoords[faces[f + 0]];
+				const glm::vec2 delta_uv2 = in_mesh.p_TexCoords[faces[f + 2]] - in_mesh.p_TexCoords[faces[f + 0]];
+				triangle.p_DeltaUV = glm::vec4(delta_uv1, delta_uv2);
+			}
+
+			triangle_data.push_back(triangle);
+		}
+
+		glGenBuffers(enum_to_t(buffer::MAX), m_Buffers);
+
+		upload(m_Buffers[enum_to_t(buffer::PARTICLE)], m_ParticleVertex);
+		upload(m_Buffers[enum_to_t(buffer::PREVIOUS)], std::vector<glm::vec4>(m_ParticleCount));
+		upload(m_Buffers[enum_to_t(buffer::CONSTRAINT)], constraints);
+		upload(m_Buffers[enum_to_t(buffer::LAMBDA)], std::vector<float>(constraints.size(), 0.f));
+		upload(m_Buffers[enum_to_t(buffer::VERTEX_PARTICLE)], in_cloth.m_VertexParticle);
+		upload(m_Buffers[enum_to_t(buffer::ADJACENCY_OFFSET)], offsets);
+		upload(m_Buffers[enum_to_t(buffer::ADJACENCY)], adjacency);
+		upload(m_Buffers[enum_to_t(buffer::TRIANGLE)], triangle_data);
+
+		return true;
+	}
+
+	void gpu_cloth::destroy()
+	{
+		if (m_Buffers[0])
+			glDeleteBuffers(enum_to_t(buffer::MAX), m_Buffers);
+		memset(m_Buffers, 0, sizeof(m_Buffers));
+
+		m_Positions = m_Normals = m_Tangents = m_Velocities = 0;
+		m_ParticleCount = m_VertexCount = 0;
+
+		m_ColourOffsets.clear();
+		m_ParticleVertex.clear();
+	}
+
+	void gpu_cloth::simulate(const cloth& in_cloth, float in_dt)
+	{
+		const auto& settings = in_cloth.m_Settings;
+
+		const gl::uint32 integrate = clothing::getProgram(clothing::program::INTEGRATE);
+		const gl::uint32 project = clothing::getProgram(clothing::program::PROJECT);
+		const gl::uint32 velocity = clothing::getProgram(clothing::program::VELOCITY);
+		const gl::uint32 normals = clothing::getProgram(clothing::program::NORMALS);
+
+		// constant through the step
+		glProgramUniform1ui(integrate, location::COUNT, m_ParticleCount);
+		glProgramUniform1f(integrate, location::DT, in_dt);
+		glProgramUniform3f(integrate, location::GRAVITY, settings.p_Gravity.x, settings.p_Gravity.y, settings.p_Gravity.z);
+		glProgramUniform1f(project, location::INV_DT2, 1.f / (in_dt * in_dt));
+		glProgramUniform1ui(velocity, location::COUNT, m_ParticleCount);
+		glProgramUniform1f(velocity, location::INV_DT, 1.f / in_dt);
+		glProgramUniform1f(velocity, location::DAMPING, std::max(0.f, 1.f - settings.p_Damping * in_dt));
+		glProgramUniform1ui(normals, location::COUNT, m_VertexCount);
+		glProgramUniform1ui(normals, location::TANGENTS, m_Tangents != 0);
+
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::POSITION, m_Positions);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::NORMAL, m_Normals);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::VELOCITY, m_Velocities);
+
+		for (uint32_t s = 0; s < settings.p_Substeps; ++s)
+		{
+			glUseProgram(integrate);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::SLOT_0, m_Buffers[enum_to_t(buffer::PARTICLE)]);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::SLOT_1, m_Buffers[enum_to_t(buffer::PREVIOUS)]);
+			glDispatchCompute(groups(m_ParticleCount), 1, 1);
+			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_Buffers[enum_to_t(buffer::LAMBDA)]);
+			glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32F, GL_RED, GL_FLOAT, nullptr);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+			// a dispatch per colour, the barrier between them is what
+			// the ordering of gauss-seidel needs across colours.
+			glUseProgram(project);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::SLOT_0, m_Buffers[enum_to_t(buffer::CONSTRAINT)]);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::SLOT_1, m_Buffers[enum_to_t(buffer::LAMBDA)]);
+			for (uint32_t i = 0; i < settings.p_Iterations; ++i)
+			{
+				for (size_t c = 0; c + 1 < m_ColourOffsets.size(); ++c)
+				{
+					const uint32_t count = m_ColourOffsets[c + 1] - m_ColourOffsets[c];
+					glProgramUniform1ui(project, location::COUNT, count);
+					glProgramUniform1ui(project, location::FIRST, m_ColourOffsets[c]);
+					glDispatchCompute(groups(count), 1, 1);
+					glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+				}
+			}
+
+			glUseProgram(velocity);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::SLOT_0, m_Buffers[enum_to_t(buffer::PARTICLE)]);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::SLOT_1, m_Buffers[enum_to_t(buffer::PREVIOUS)]);
+			glDispatchCompute(groups(m_ParticleCount), 1, 1);
+			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+		}
+
+		glUseProgram(normals);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::SLOT_0, m_Buffers[enum_to_t(buffer::VERTEX_PARTICLE)]);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::TANGENT, m_Tangents ? m_Tangents : m_Normals);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::VELOCITY, m_Buffers[enum_to_t(buffer::PARTICLE)]);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::SLOT_2, m_Buffers[enum_to_t(buffer::ADJACENCY_OFFSET)]);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::SLOT_3, m_Buffers[enum_to_t(buffer::ADJACENCY)]);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding::SLOT_4, m_Buffers[enum_to_t(buffer::TRIANGLE)]);
+		glDispatchCompute(groups(m_VertexCount), 1, 1);
+
+		// drawn through storage buffers, and read back by download
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+		// materials draw with program pipelines, which a bound program would override
+		glUseProgram(0);
+	}
+
+	void gpu_cloth::download(cloth& out_cloth) const
+	{
+		std::vector<glm::vec4> positions(m_VertexCount);
+		std::vector<glm::vec4> velocities(m_VertexCount);
+
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_Positions);
+		glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, positions.size() * sizeof(glm::vec4), positions.data());
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_Velocities);
+		glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, velocities.size() * sizeof(glm::vec4), velocities.data());
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+		for (uint32_t p = 0; p < m_ParticleCount; ++p)
+		{
+			const auto& position = positions[m_ParticleVertex[p]];
+			const auto& velocity = velocities[m_ParticleVertex[p]];
+
+			out_cloth.m_PosX[p] = position.x;
+			out_cloth.m_PosY[p] = position.y;
+			out_cloth.m_PosZ[p] = position.z;
+			out_cloth.m_VelX[p] = velocity.x;
+			out_cloth.m_VelY[p] = velocity.y;
+			out_cloth.m_VelZ[p] = velocity.z;
+		}
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "util.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace graphics
+{
+	class mesh;
+}
+
+namespace compute
+{
+	class cloth;
+
+	// the solver of a cloth as compute shaders, working in place on the position,
+	// normal, tangent and velocity buffers of its mesh: simulated vertices never go
+	// through the CPU. each particle is simulated on the first mesh vertex welded
+	// into it, the others copy it when normals are recomputed at the end of a step.
+	class gpu_cloth
+	{
+		enum class buffer : uint32_t
+		{
+			PARTICLE,			// simulated vertex of each particle
+			PREVIOUS,			// particle positions at the start of the sub-step
+			CONSTRAINT,			// distance constraints sorted by colour
+			LAMBDA,				// XPBD multiplier of each constraint
+			VERTEX_PARTICLE,	// particle of each vertex
+			ADJACENCY_OFFSET,	// first triangle around each particle
+			ADJACENCY,			// triangles around the particles
+			TRIANGLE,			// triangle corners as simulated and mesh vertices, with their uvs
+			MAX
+		};
+
+		uint32_t m_Buffers[enum_to_t(buffer::MAX)];
+
+		// mesh buffers, owned by the mesh
+		uint32_t m_Positions;
+		uint32_t m_Normals;
+		uint32_t m_Tangents;	// zero without tangents or uvs
+		uint32_t m_Velocities;
+
+		uint32_t m_ParticleCount;
+		uint32_t m_VertexCount;
+
+		// constraints of colour c are [m_ColourOffsets[c], m_ColourOffsets[c + 1])
+		std::vector<uint32_t> m_ColourOffsets;
+
+		// simulated vertex of each particle, to read the state back
+		std::vector<uint32_t> m_ParticleVertex;
+
+	public:
+
+		gpu_cloth();
+
+		bool create(const cloth& in_cloth, const graphics::mesh& in_mesh);
+		void destroy();
+
+		// sub-steps of in_dt seconds, then the normals and tangents
+		void simulate(const cloth& in_cloth, float in_dt);
+
+		// copy positions and velocities from the mesh buffers into the cloth
+		void download(cloth& out_cloth) const;
+	};
+}
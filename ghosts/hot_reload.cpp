@@ -0,0 +1,322 @@
+#include "hot_reload.hpp"
+#include "watcher.hpp"
+#include "compiler.hpp"
+#include "logging.hpp"
+#include "format.hpp"
+#include "ogl.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace
+{
+	// a save can be several writes, the rebuild waits for the files to be quiet
+	const std::chrono::milliseconds s_settle_time(100);
+
+	struct shader
+	{
+		gl::enumerator	p_Type;
+		std::string		p_File;
+		std::string		p_Arguments;	// the defines of the variant the shader was created for
+	};
+
+	struct program
+	{
+		const void*							p_Owner;
+		std::vector<shader>					p_Shaders;
+		std::vector<std::string>			p_Files;	// every file the shaders were preprocessed from
+		bool								p_Separable;
+		graphics::hot_reload::swap_function	p_Swap;
+		bool								p_Dirty;	// a file changed, rebuild when they can be read
+
+		// the rebuild in flight, 0 if none
+		std::unique_ptr<compiler>			p_Compiler;
+		gl::uint32							p_Program;
+		std::vector<gl::uint32>				p_ShaderNames;
+
+		// the errors of the last rebuild, until one succeeds
+		std::string							p_Errors;
+	};
+
+	std::unique_ptr<framework::file_watcher> s_watcher;
+	std::vector<std::unique_ptr<program>> s_programs;
+
+	std::set<std::string> s_changed;
+	std::chrono::steady_clock::time_point s_last_change;
+
+	// whether the driver tells when a compilation is done without waiting for it
+	int s_parallel_compile = -1;
+
+	bool supports_parallel_compile()
+	{
+		if (s_parallel_compile < 0)
+		{
+			s_parallel_compile = 0;
+
+			gl::int32 count = 0;
+			glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+			for (gl::int32 i = 0; i < count && !s_parallel_compile; ++i)
+			{
+				const std::string extension(reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<gl::uint32>(i))));
+				s_parallel_compile = extension == "GL_KHR_parallel_shader_compile" || extension == "GL_ARB_parallel_shader_compile";
+			}
+		}
+
+		return s_parallel_compile != 0;
+	}
+
+	std::string info_log(gl::uint32 in_name, bool in_program)
+	{
+		gl::int32 length = 0;
+		if (in_program)
+			glGetProgramiv(in_name, GL_INFO_LOG_LENGTH, &length);
+		else
+			glGetShaderiv(in_name, GL_INFO_LOG_LENGTH, &length);
+
+		std::string log(static_cast<size_t>(std::max(length, 1)), '\0');
+		if (in_program)
+			glGetProgramInfoLog(in_name, length, nullptr, &log[0]);
+		else
+			glGetShaderInfoLog(in_name, length, nullptr, &log[0]);
+
+		log.resize(std::strlen(log.c_str()));
+		return log;
+	}
+
+	// the files of the shaders, to name the program in the log
+	std::string describe(const program& in_program)
+	{
+		std::string files;
+		for (const auto& shader : in_program.p_Shaders)
+			files += (files.empty() ? "" : ", ") + shader.p_File;
+		return files;
+	}
+
+	void watch_files(program& in_program)
+	{
+		for (const auto& file : in_program.p_Files)
+			if (!s_watcher->watch(file))
+				LOG(WARNING) << fmt::format("hot reload: can't watch {}", file);
+	}
+
+	// an editor that truncates before writing leaves an empty file for a while
+	bool readable(const std::string& in_file)
+	{
+		std::ifstream file(in_file, std::ios::binary | std::ios::ate);
+		return file && file.tellg() > 0;
+	}
+
+	// compile and link without waiting for the result, false while a file is missing or empty
+	bool start(program& in_program)
+	{
+		for (const auto& shader : in_program.p_Shaders)
+			if (!readable(shader.p_File))
+				return false;
+
+		in_program.p_Compiler.reset(new compiler());
+		in_program.p_ShaderNames.clear();
+		in_program.p_Program = glCreateProgram();
+		glProgramParameteri(in_program.p_Program, GL_PROGRAM_SEPARABLE, in_program.p_Separable ? GL_TRUE : GL_FALSE);
+
+		for (const auto& shader : in_program.p_Shaders)
+		{
+			const gl::uint32 name = in_program.p_Compiler->create(shader.p_Type, shader.p_File, shader.p_Arguments);
+			in_program.p_ShaderNames.push_back(name);
+			glAttachShader(in_program.p_Program, name);
+		}
+
+		glLinkProgram(in_program.p_Program);
+		return true;
+	}
+
+	// swap the program if it linked, false while the driver is still at it
+	bool finish(program& in_program)
+	{
+		if (supports_parallel_compile())
+		{
+			gl::int32 done = GL_TRUE;
+			glGetProgramiv(in_program.p_Program, GL_COMPLETION_STATUS_KHR, &done);
+			if (!done)
+				return false;
+		}
+
+		gl::int32 linked = GL_FALSE;
+		glGetProgramiv(in_program.p_Program, GL_LINK_STATUS, &linked);
+
+		if (linked)
+		{
+			// the includes may have changed too
+			in_program.p_Files.clear();
+			for (auto name : in_program.p_ShaderNames)
+				for (const auto& file : in_program.p_Compiler->getSourceFiles(name))
+					if (std::find(in_program.p_Files.begin(), in_program.p_Files.end(), file) == in_program.p_Files.end())
+						in_program.p_Files.push_back(file);
+			watch_files(in_program);
+
+			in_program.p_Swap(in_program.p_Program);
+			in_program.p_Errors.clear();
+
+			LOG(INFO) << fmt::format("hot reload: {} rebuilt", describe(in_program));
+		}
+		else
+		{
+			std::string errors;
+			for (size_t s = 0; s < in_program.p_ShaderNames.size(); ++s)
+			{
+				gl::int32 compiled = GL_FALSE;
+				glGetShaderiv(in_program.p_ShaderNames[s], GL_COMPILE_STATUS, &compiled);
+				if (!compiled)
+					errors += fmt::format("{}:\n{}\n", in_program.p_Shaders[s].p_File, info_log(in_program.p_ShaderNames[s], false));
+			}
+
+			if (errors.empty())
+				errors = info_log(in_program.p_Program, true);
+
+			// the same errors again aren't news
+			if (errors != in_program.p_Errors)
+				LOG(ERROR) << fmt::format("hot reload: {} kept, the rebuild failed\n{}", describe(in_program), errors);
+
+			in_program.p_Errors = errors;
+			glDeleteProgram(in_program.p_Program);
+		}
+
+		in_program.p_Program = 0;
+		in_program.p_ShaderNames.clear();
+		in_program.p_Compiler.reset();
+		return true;
+	}
+
+	void cancel(program& in_program)
+	{
+		if (in_program.p_Program)
+			glDeleteProgram(in_program.p_Program);
+
+		in_program.p_Program = 0;
+		in_program.p_Compiler.reset();
+	}
+}
+
+namespace graphics
+{
+	void hot_reload::watch(const void* in_owner, const compiler& in_compiler, uint32_t in_program, swap_function in_swap)
+	{
+		if (!s_watcher)
+			s_watcher.reset(new framework::file_watcher());
+
+		std::unique_ptr<program> watched(new program());
+		watched->p_Owner = in_owner;
+		watched->p_Swap = in_swap;
+		watched->p_Program = 0;
+		watched->p_Dirty = false;
+
+		gl::int32 separable = GL_FALSE;
+		glGetProgramiv(in_program, GL_PROGRAM_SEPARABLE, &separable);
+		watched->p_Separable = separable == GL_TRUE;
+
+		gl::int32 count = 0;
+		glGetProgramiv(in_program, GL_ATTACHED_SHADERS, &count);
+
+		std::vector<gl::uint32> names(static_cast<size_t>(count));
+		if (count > 0)
+			glGetAttachedShaders(in_program, count, nullptr, names.data());
+
+		for (auto name : names)
+		{
+			const std::vector<std::string> files = in_compiler.getSourceFiles(name);
+			if (files.empty())
+				continue;
+
+			gl::int32 type = 0;
+			glGetShaderiv(name, GL_SHADER_TYPE, &type);
+			watched->p_Shaders.push_back({ static_cast<gl::enumerator>(type), files.front(), in_compiler.getArguments(name) });
+
+			for (const auto& file : files)
+				if (std::find(watched->p_Files.begin(), watched->p_Files.end(), file) == watched->p_Files.end())
+					watched->p_Files.push_back(file);
+		}
+
+		if (watched->p_Shaders.empty())
+			return;
+
+		watch_files(*watched);
+
+		forget(in_owner);
+		s_programs.push_back(std::move(watched));
+	}
+
+	void hot_reload::forget(const void* in_owner)
+	{
+		for (auto& watched : s_programs)
+			if (watched->p_Owner == in_owner)
+				cancel(*watched);
+
+		s_programs.erase(std::remove_if(s_programs.begin(), s_programs.end(),
+			[in_owner](const std::unique_ptr<program>& in_program) { return in_program->p_Owner == in_owner; }), s_programs.end());
+	}
+
+	std::size_t hot_reload::update()
+	{
+		if (!s_watcher)
+			return 0;
+
+		const auto now = std::chrono::steady_clock::now();
+		for (const auto& file : s_watcher->poll())
+		{
+			// read again even if saved within the second of the last read
+			compiler::invalidate(file);
+			s_changed.insert(file);
+			s_last_change = now;
+		}
+
+		if (!s_changed.empty() && now - s_last_change >= s_settle_time)
+		{
+			for (auto& watched : s_programs)
+				watched->p_Dirty |= std::any_of(watched->p_Files.begin(), watched->p_Files.end(),
+					[](const std::string& in_file) { return s_changed.count(in_file) != 0; });
+
+			s_changed.clear();
+		}
+
+		size_t pending = 0;
+		for (auto& watched : s_programs)
+		{
+			if (watched->p_Program && !finish(*watched))
+				++pending;
+		}
+
+		// checked from the next frame on, the driver may compile them meanwhile
+		for (auto& watched : s_programs)
+		{
+			if (!watched->p_Dirty)
+				continue;
+
+			// a rebuild in flight is of older files, this one replaces it.
+			// a file being replaced is missing for a moment, it is tried again
+			cancel(*watched);
+			watched->p_Dirty = !start(*watched);
+			++pending;
+		}
+
+		return pending;
+	}
+
+	void hot_reload::shutdown()
+	{
+		for (auto& watched : s_programs)
+			cancel(*watched);
+
+		s_programs.clear();
+		s_changed.clear();
+		s_watcher.reset();
+	}
+}
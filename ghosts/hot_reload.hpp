@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+class compiler;
+
+namespace graphics
+{
+	// programs rebuilt while running when a file their shaders were preprocessed
+	// from changes, includes too. the rebuild is queued until the files settle,
+	// compiled and linked at the start of a frame and checked in a later one, so
+	// the driver can compile in the background. the owner only gets a program
+	// that linked, it keeps using the previous one while the errors are reported.
+	struct hot_reload
+	{
+		// the owner takes in_program in place of its current one, and deletes it
+		typedef std::function<void(uint32_t in_program)> swap_function;
+
+		// watch the files of the shaders attached to in_program, created by in_compiler
+		// and still alive. in_owner identifies the program for forget.
+		static void watch(const void* in_owner, const compiler& in_compiler, uint32_t in_program, swap_function in_swap);
+		static void forget(const void* in_owner);
+
+		// queue the programs of the files changed since the last call and swap the
+		// ones done, once a frame on the rendering thread. returns the rebuilds left.
+		static std::size_t update();
+
+		static void shutdown();
+	};
+}
@@ -0,0 +1,464 @@
+#include "ibl.hpp"
+#include "parallel.hpp"
+#include "logging.hpp"
+#include "format.hpp"
+#include "util.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/packing.hpp>
+#include <gli/gli.hpp>
+#include <gli/compress.hpp>
+#include <gli/convert.hpp>
+#include <gli/generate_mipmaps.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <vector>
+
+namespace
+{
+	// faces in the order of the layers of a cubemap
+	const char* s_face_files[] =
+	{
+		"posx.dds",
+		"negx.dds",
+		"posy.dds",
+		"negy.dds",
+		"posz.dds",
+		"negz.dds"
+	};
+
+	const char* s_specular_file = "specular.dds";
+	const char* s_irradiance_file = "irradiance.dds";
+
+	const size_t s_faces = 6;
+
+	// the bake reads the largest level of the faces up to this size, the
+	// prefiltered levels are far blurrier than the faces are detailed.
+	const int s_source_size = 256;
+
+	// roughness 0 at the 128 texels level up to roughness 1 at the 4 texels one
+	const int s_specular_size = 128;
+	const uint32_t s_specular_levels = 6;
+	const uint32_t s_specular_samples = 128;
+
+	// irradiance varies slowly, the spherical harmonics are projected from a small level
+	const int s_irradiance_size = 32;
+
+	// direction through s, t in [0, 1] of a face, following the GL cubemap conventions
+	glm::vec3 face_direction(size_t in_face, float in_s, float in_t)
+	{
+		const float u = 2.f * in_s - 1.f;
+		const float v = 2.f * in_t - 1.f;
+
+		switch (in_face)
+		{
+		case 0: return glm::vec3(1.f, -v, -u);
+		case 1: return glm::vec3(-1.f, -v, u);
+		case 2: return glm::vec3(u, 1.f, v);
+		case 3: return glm::vec3(u, -1.f, -v);
+		case 4: return glm::vec3(u, -v, 1.f);
+		default: return glm::vec3(-u, -v, -1.f);
+		}
+	}
+
+	// face and s, t in [0, 1] a direction goes through, the inverse of face_direction
+	size_t face_coordinates(const glm::vec3& in_direction, float& out_s, float& out_t)
+	{
+		const glm::vec3 a = glm::abs(in_direction);
+
+		size_t face;
+		float major, sc, tc;
+		if (a.x >= a.y && a.x >= a.z)
+		{
+			face = in_direction.x > 0.f ? 0 : 1;
+			major = a.x;
+			sc = in_direction.x > 0.f ? -in_direction.z : in_direction.z;
+			tc = -in_direction.y;
+		}
+		else if (a.y >= a.z)
+		{
+			face = in_direction.y > 0.f ? 2 : 3;
+			major = a.y;
+			sc = in_direction.x;
+			tc = in_direction.y > 0.f ? in_direction.z : -in_direction.z;
+		}
+		else
+		{
+			face = in_direction.z > 0.f ? 4 : 5;
+			major = a.z;
+			sc = in_direction.z > 0.f ? in_direction.x : -in_direction.x;
+			tc = -in_direction.y;
+		}
+
+		out_s = 0.5f * (sc / major + 1.f);
+		out_t = 0.5f * (tc / major + 1.f);
+		return face;
+	}
+
+	// linear radiance of the environment, all its levels sampled as a trilinear sampler would
+	struct radiance
+	{
+		gli::textureCube p_Texture;
+
+		std::vector<std::array<const glm::vec4*, s_faces>> p_Texels;
+		std::vector<int> p_Sizes;
+
+		explicit radiance(const gli::textureCube& in_texture)
+			: p_Texture(in_texture)
+		{
+			for (size_t level = 0; level < p_Texture.levels(); ++level)
+			{
+				std::array<const glm::vec4*, s_faces> faces;
+				for (size_t face = 0; face < s_faces; ++face)
+					faces[face] = p_Texture[face][level].data<glm::vec4>();
+
+				p_Texels.push_back(faces);
+				p_Sizes.push_back(p_Texture.dimensions(level).x);
+			}
+		}
+
+		// texels are clamped to the edges of their face, the filtered sampling
+		// reads from levels blurry enough for the seams not to show.
+		glm::vec4 bilinear(size_t in_face, size_t in_level, float in_s, float in_t) const
+		{
+			const int size = p_Sizes[in_level];
+			const glm::vec4* texels = p_Texels[in_level][in_face];
+
+			const float x = in_s * size - 0.5f;
+			const float y = in_t * size - 0.5f;
+			const float x_floor = glm::floor(x);
+			const float y_floor = glm::floor(y);
+			const float fx = x - x_floor;
+			const float fy = y - y_floor;
+
+			const int x0 = glm::clamp(static_cast<int>(x_floor), 0, size - 1);
+			const int y0 = glm::clamp(static_cast<int>(y_floor), 0, size - 1);
+			const int x1 = glm::min(x0 + 1, size - 1);
+			const int y1 = glm::min(y0 + 1, size - 1);
+
+			const glm::vec4 top = glm::mix(texels[y0 * size + x0], texels[y0 * size + x1], fx);
+			const glm::vec4 bottom = glm::mix(texels[y1 * size + x0], texels[y1 * size + x1], fx);
+			return glm::mix(top, bottom, fy);
+		}
+
+		glm::vec4 sample(const glm::vec3& in_direction, float in_lod) const
+		{
+			float s, t;
+			const size_t face = face_coordinates(in_direction, s, t);
+
+			const float lod = glm::clamp(in_lod, 0.f, static_cast<float>(p_Sizes.size() - 1));
+			const size_t level = static_cast<size_t>(lod);
+			const float blend = lod - level;
+
+			const glm::vec4 fine = bilinear(face, level, s, t);
+			return blend > 0.f && level + 1 < p_Sizes.size() ? glm::mix(fine, bilinear(face, level + 1, s, t), blend) : fine;
+		}
+	};
+
+	// the largest level of a face up to s_source_size as linear RGBA32F texels
+	gli::texture2D load_face(const std::string& in_file)
+	{
+		const gli::texture2D file(gli::load(in_file));
+		if (file.empty())
+			return gli::texture2D();
+
+		size_t level = 0;
+		while (level + 1 < file.levels() && file.dimensions(level).x > s_source_size)
+			++level;
+
+		const gli::texture2D file_level(file, level, level);
+		const gli::texture2D source(gli::is_compressed(file_level.format()) ? gli::decompress(file_level) : file_level);
+
+		const gli::format format = source.format();
+		const bool bgra = format == gli::FORMAT_BGRA8_UNORM_PACK8 || format == gli::FORMAT_BGRA8_SRGB_PACK8;
+		if (!bgra && format != gli::FORMAT_RGBA8_UNORM_PACK8 && format != gli::FORMAT_RGBA8_SRGB_PACK8)
+			return gli::texture2D();
+
+		// photographs are sRGB encoded whether the format says so or not
+		const gli::texture2D srgb(source, bgra ? gli::FORMAT_BGRA8_SRGB_PACK8 : gli::FORMAT_RGBA8_SRGB_PACK8, 0, 0, 0, 0, 0, 0);
+		return gli::convert(srgb, gli::FORMAT_RGBA32_SFLOAT_PACK32);
+	}
+
+	float radical_inverse(uint32_t in_bits)
+	{
+		in_bits = (in_bits << 16u) | (in_bits >> 16u);
+		in_bits = ((in_bits & 0x55555555u) << 1u) | ((in_bits & 0xAAAAAAAAu) >> 1u);
+		in_bits = ((in_bits & 0x33333333u) << 2u) | ((in_bits & 0xCCCCCCCCu) >> 2u);
+		in_bits = ((in_bits & 0x0F0F0F0Fu) << 4u) | ((in_bits & 0xF0F0F0F0u) >> 4u);
+		in_bits = ((in_bits & 0x00FF00FFu) << 8u) | ((in_bits & 0xFF00FF00u) >> 8u);
+		return static_cast<float>(in_bits) * 2.3283064365386963e-10f;
+	}
+
+	// a light direction around the normal (0, 0, 1) with the view along the normal and
+	// the level of the source to read it from, it's weighted by its cosine to the normal
+	struct specular_sample
+	{
+		glm::vec3 p_Direction;
+		float p_Lod;
+	};
+
+	// GGX importance samples of a roughness on a Hammersley set. each sample reads the
+	// level whose texels cover the solid angle the sample stands for, filtered importance
+	// sampling, which keeps the noise out with a few samples.
+	std::vector<specular_sample> specular_samples(float in_roughness, int in_source_size, float in_min_lod)
+	{
+		std::vector<specular_sample> samples;
+
+		if (in_roughness == 0.f)
+		{
+			samples.push_back({ glm::vec3(0.f, 0.f, 1.f), in_min_lod });
+			return samples;
+		}
+
+		const float alpha = in_roughness * in_roughness;
+		const float alpha2 = alpha * alpha;
+		const float texel_solid_angle = 4.f * glm::pi<float>() / (s_faces * in_source_size * in_source_size);
+
+		for (uint32_t i = 0; i < s_specular_samples; ++i)
+		{
+			const float phi = 2.f * glm::pi<float>() * (i + 0.5f) / s_specular_samples;
+			const float xi = radical_inverse(i);
+
+			const float cos_theta = glm::sqrt((1.f - xi) / (1.f + (alpha2 - 1.f) * xi));
+			const float sin_theta = glm::sqrt(1.f - cos_theta * cos_theta);
+			const glm::vec3 half(sin_theta * glm::cos(phi), sin_theta * glm::sin(phi), cos_theta);
+
+			// reflect the view, the normal, around the half vector
+			const glm::vec3 light = 2.f * cos_theta * half - glm::vec3(0.f, 0.f, 1.f);
+			if (light.z <= 0.f)
+				continue;
+
+			// with the view along the normal the pdf of the light is D / 4
+			const float d_denom = cos_theta * cos_theta * (alpha2 - 1.f) + 1.f;
+			const float pdf = alpha2 / (glm::pi<float>() * d_denom * d_denom) / 4.f;
+			const float sample_solid_angle = 1.f / (s_specular_samples * pdf);
+
+			const float lod = 0.5f * glm::log2(sample_solid_angle / texel_solid_angle) + 1.f;
+			samples.push_back({ light, glm::max(lod, in_min_lod) });
+		}
+
+		return samples;
+	}
+
+	gli::textureCube bake_specular(const radiance& in_radiance)
+	{
+		gli::textureCube specular(gli::FORMAT_RGBA16_SFLOAT_PACK16, gli::textureCube::texelcoord_type(s_specular_size), s_specular_levels, gli::default_allocator());
+
+		const int source_size = in_radiance.p_Sizes[0];
+
+		for (uint32_t level = 0; level < s_specular_levels; ++level)
+		{
+			const int size = s_specular_size >> level;
+			const float roughness = static_cast<float>(level) / (s_specular_levels - 1);
+			const float min_lod = glm::max(glm::log2(static_cast<float>(source_size) / size), 0.f);
+			const auto samples = specular_samples(roughness, source_size, min_lod);
+
+			std::array<glm::u16vec4*, s_faces> faces;
+			for (size_t face = 0; face < s_faces; ++face)
+				faces[face] = specular[face][level].data<glm::u16vec4>();
+
+			// rows of all the faces, a few per task
+			const size_t grain = glm::max(1, 1024 / size);
+			parallel::for_range(0, s_faces * size, grain, [&](size_t in_begin, size_t in_end)
+			{
+				for (size_t row = in_begin; row < in_end; ++row)
+				{
+					const size_t face = row / size;
+					const int y = static_cast<int>(row % size);
+
+					for (int x = 0; x < size; ++x)
+					{
+						const glm::vec3 normal = glm::normalize(face_direction(face, (x + 0.5f) / size, (y + 0.5f) / size));
+						const glm::vec3 up = glm::abs(normal.z) < 0.999f ? glm::vec3(0.f, 0.f, 1.f) : glm::vec3(1.f, 0.f, 0.f);
+						const glm::vec3 tangent = glm::normalize(glm::cross(up, normal));
+						const glm::vec3 bitangent = glm::cross(normal, tangent);
+
+						glm::vec3 sum(0.f);
+						float weight = 0.f;
+						for (const auto& sample : samples)
+						{
+							const glm::vec3 light = tangent * sample.p_Direction.x + bitangent * sample.p_Direction.y + normal * sample.p_Direction.z;
+							sum += glm::vec3(in_radiance.sample(light, sample.p_Lod)) * sample.p_Direction.z;
+							weight += sample.p_Direction.z;
+						}
+
+						const glm::vec4 texel(sum / weight, 1.f);
+						faces[face][y * size + x] = glm::u16vec4(
+							glm::packHalf1x16(texel.x), glm::packHalf1x16(texel.y),
+							glm::packHalf1x16(texel.z), glm::packHalf1x16(texel.w));
+					}
+				}
+			});
+		}
+
+		return specular;
+	}
+
+	// spherical harmonics of the radiance, convolved with the cosine lobe: evaluating them
+	// along a normal gives the irradiance it receives.
+	std::array<glm::vec4, graphics::ibl::s_coefficients> bake_irradiance(const radiance& in_radiance)
+	{
+		size_t level = 0;
+		while (level + 1 < in_radiance.p_Sizes.size() && in_radiance.p_Sizes[level] > s_irradiance_size)
+			++level;
+
+		const int size = in_radiance.p_Sizes[level];
+
+		// each face sums on its own, the sums are added once they're done
+		std::array<std::array<glm::vec3, graphics::ibl::s_coefficients>, s_faces> face_sums;
+		parallel::for_range(0, s_faces, 1, [&](size_t in_begin, size_t in_end)
+		{
+			for (size_t face = in_begin; face < in_end; ++face)
+			{
+				auto& sums = face_sums[face];
+				sums.fill(glm::vec3(0.f));
+
+				const glm::vec4* texels = in_radiance.p_Texels[level][face];
+				for (int y = 0; y < size; ++y)
+				{
+					for (int x = 0; x < size; ++x)
+					{
+						const glm::vec3 direction = face_direction(face, (x + 0.5f) / size, (y + 0.5f) / size);
+
+						// solid angle of the texel, the ones in the corners of the face cover less
+						const float length2 = glm::dot(direction, direction);
+						const float solid_angle = (4.f / (size * size)) / (length2 * glm::sqrt(length2));
+
+						const glm::vec3 n = direction / glm::sqrt(length2);
+						const glm::vec3 color = glm::vec3(texels[y * size + x]) * solid_angle;
+
+						sums[0] += color * 0.282095f;
+						sums[1] += color * 0.488603f * n.y;
+						sums[2] += color * 0.488603f * n.z;
+						sums[3] += color * 0.488603f * n.x;
+						sums[4] += color * 1.092548f * n.x * n.y;
+						sums[5] += color * 1.092548f * n.y * n.z;
+						sums[6] += color * 0.315392f * (3.f * n.z * n.z - 1.f);
+						sums[7] += color * 1.092548f * n.x * n.z;
+						sums[8] += color * 0.546274f * (n.x * n.x - n.y * n.y);
+					}
+				}
+			}
+		});
+
+		// cosine lobe convolution of each band
+		const float bands[] = { glm::pi<float>(), 2.f * glm::pi<float>() / 3.f, glm::pi<float>() / 4.f };
+		const uint32_t coefficient_bands[] = { 0, 1, 1, 1, 2, 2, 2, 2, 2 };
+
+		std::array<glm::vec4, graphics::ibl::s_coefficients> coefficients;
+		for (uint32_t c = 0; c < graphics::ibl::s_coefficients; ++c)
+		{
+			glm::vec3 sum(0.f);
+			for (size_t face = 0; face < s_faces; ++face)
+				sum += face_sums[face][c];
+
+			coefficients[c] = glm::vec4(sum * bands[coefficient_bands[c]], 0.f);
+		}
+
+		return coefficients;
+	}
+
+	bool bake(const std::string& in_directory, const std::string& in_specular_file, const std::string& in_irradiance_file)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		std::vector<gli::texture2D> faces;
+		for (auto face_file : s_face_files)
+		{
+			faces.push_back(load_face(in_directory + face_file));
+			if (faces.back().empty() || faces.back().dimensions() != faces.front().dimensions())
+			{
+				LOG(ERROR) << fmt::format("ibl: can't read the face {}{}", in_directory, face_file);
+				return false;
+			}
+		}
+
+		gli::textureCube cube(gli::FORMAT_RGBA32_SFLOAT_PACK32, faces.front().dimensions());
+		for (size_t face = 0; face < s_faces; ++face)
+			memcpy(cube[face][0].data(), faces[face].data(), faces[face].size());
+
+		const radiance source(gli::generate_mipmaps(cube, gli::KERNEL_BOX));
+
+		const gli::textureCube specular(bake_specular(source));
+		const auto coefficients = bake_irradiance(source);
+
+		gli::texture2D irradiance(gli::FORMAT_RGBA32_SFLOAT_PACK32, gli::texture2D::texelcoord_type(graphics::ibl::s_coefficients, 1), 1, gli::default_allocator());
+		memcpy(irradiance.data(), coefficients.data(), sizeof(coefficients));
+
+		if (!gli::save_dds(specular, in_specular_file) || !gli::save_dds(irradiance, in_irradiance_file))
+		{
+			LOG(ERROR) << fmt::format("ibl: can't write the bake of {}", in_directory);
+			return false;
+		}
+
+		const double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		LOG(INFO) << fmt::format("ibl: baked {} from {} texels faces in {:.1f} ms",
+			in_directory, faces.front().dimensions().x, time * 1000.0);
+
+		return true;
+	}
+}
+
+graphics::ibl::ibl()
+	: m_SpecularLevels(0)
+{
+	std::fill(std::begin(m_Irradiance), std::end(m_Irradiance), glm::vec4(0.f));
+}
+
+bool graphics::ibl::create(const std::string& in_directory)
+{
+	const std::string specular_file = in_directory + s_specular_file;
+	const std::string irradiance_file = in_directory + s_irradiance_file;
+
+	// bake again whenever a face is newer than the bake
+	time_t faces_time = 0;
+	for (auto face_file : s_face_files)
+		faces_time = std::max(faces_time, path::modification_time(in_directory + face_file));
+
+	if (path::modification_time(specular_file) < faces_time || path::modification_time(irradiance_file) < faces_time)
+	{
+		if (!bake(in_directory, specular_file, irradiance_file))
+			return false;
+	}
+
+	const gli::texture2D irradiance(gli::load(irradiance_file));
+	if (irradiance.empty() || irradiance.format() != gli::FORMAT_RGBA32_SFLOAT_PACK32 || irradiance.dimensions().x != s_coefficients)
+	{
+		LOG(ERROR) << fmt::format("ibl: can't read {}", irradiance_file);
+		return false;
+	}
+
+	memcpy(m_Irradiance, irradiance.data(), sizeof(m_Irradiance));
+
+	// the levels are known from the header, the texture reads the texels
+	char header[gli::DDS_HEADER_MAX_SIZE];
+	FILE* file = std::fopen(specular_file.c_str(), "rb");
+	const size_t header_size = file ? std::fread(header, 1, sizeof(header), file) : 0;
+	if (file)
+		std::fclose(file);
+
+	gli::dds_layout layout;
+	if (!gli::load_dds_layout(header, header_size, layout))
+	{
+		LOG(ERROR) << fmt::format("ibl: can't read {}", specular_file);
+		return false;
+	}
+
+	m_SpecularLevels = static_cast<uint32_t>(layout.Levels);
+
+	// every level is a roughness, none is skipped for the quality nor dropped for the budget:
+	// the shader picks the level of a roughness from m_SpecularLevels
+	return m_Specular.create(specular_file, false, texture::compression::NONE, 0, false);
+}
+
+void graphics::ibl::destroy()
+{
+	m_Specular.destroy();
+	m_SpecularLevels = 0;
+	std::fill(std::begin(m_Irradiance), std::end(m_Irradiance), glm::vec4(0.f));
+}
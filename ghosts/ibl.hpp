@@ -0,0 +1,43 @@
+#pragma once
+
+#include "resource.hpp"
+#include "texture.hpp"
+
+#include <glm/vec4.hpp>
+
+#include <cstdint>
+#include <string>
+
+namespace graphics
+{
+	// image based lighting from an environment cubemap: its radiance prefiltered
+	// with GGX, the roughness increasing from 0 to 1 down the levels of a cubemap,
+	// and its irradiance as 9 spherical harmonics coefficients.
+	class ibl : public resource<ibl>
+	{
+
+	public:
+
+		static const uint32_t s_coefficients = 9;
+
+	private:
+
+		texture m_Specular;
+		glm::vec4 m_Irradiance[s_coefficients];	// rgb of each coefficient, evaluating them gives the irradiance of a normal
+		uint32_t m_SpecularLevels;
+
+	public:
+
+		ibl();
+
+		// in_directory holds the faces of the cubemap, posx.dds to negz.dds. the bake
+		// is written next to them as specular.dds and irradiance.dds, and loaded from
+		// there until a face is newer than it.
+		bool create(const std::string& in_directory);
+		void destroy();
+
+		inline texture* getSpecular() { return &m_Specular; }
+		inline const glm::vec4* getIrradiance() const { return m_Irradiance; }
+		inline uint32_t getSpecularLevels() const { return m_SpecularLevels; }
+	};
+}
@@ -3,6 +3,7 @@
 #include "util.hpp"
 #include "logging.hpp"
 #include "compiler.hpp"
+#include "hot_reload.hpp"
 
 #include <algorithm>
 #include <iterator>
@@ -93,6 +94,14 @@ bool graphics::line_batcher::initShaders()
 	{
 		glGenProgramPipelines(1, &m_Pipe);
 		glUseProgramStages(m_Pipe, pipe_mask, m_Prog);
+
+		hot_reload::watch(this, compiler_instance, m_Prog, [this, pipe_mask](uint32_t in_program)
+		{
+			glUseProgramStages(m_Pipe, pipe_mask, in_program);
+			glDeleteProgram(m_Prog);
+			m_Prog = in_program;
+		});
+
 		return true;
 	}
 
@@ -214,6 +223,8 @@ void graphics::line_batcher::destroy()
 	glDeleteBuffers(1, &m_VAO);
 	m_VAO = 0;
 
+	hot_reload::forget(this);
+
 	glDeleteProgramPipelines(1, &m_Pipe);
 	m_Pipe = 0;
 
@@ -9,6 +9,11 @@ int main(int argc, const char* argv[])
 
 	try
 	{
+		// replaying simulates only, before any window or context is created
+		int exit_code = EXIT_SUCCESS;
+		if (ghosts::replay(argc, argv, exit_code))
+			return exit_code;
+
 		return ghosts(argc, argv)();
 	}
 	catch (std::exception e)
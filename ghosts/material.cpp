@@ -1,37 +1,102 @@
 #include "material.hpp"
+#include "ibl.hpp"
 #include "ogl.hpp"
 #include "util.hpp"
 #include "compiler.hpp"
+#include "hot_reload.hpp"
+#include "logging.hpp"
+#include "format.hpp"
 
 #include <glm/vec3.hpp>
 #include <gli/gli.hpp>
 #include <array>
+#include <map>
+#include <string>
 
 namespace
 {
-	uint32_t build(uint32_t program_name, compiler& in_compiler, const char* vs_source, const char* fs_source)
+	const char* s_vs_source = "data/shaders/pbr.vert";
+	const char* s_fs_source = "data/shaders/pbr.frag";
+
+	// the defines of each feature in the shaders
+	const char* s_feature_defines[enum_to_t(graphics::material::feature::MAX)] =
 	{
-		assert(glIsProgram(program_name));
+		"WITH_DIFFUSE_MAP",			// DIFFUSE_MAP
+		"WITH_NORMAL_MAP",			// NORMAL_MAP
+		"WITH_DISPLACEMENT_MAP",	// DISPLACEMENT_MAP
+		"WITH_ENVIRONMENT",			// ENVIRONMENT
+		"DEBUG_NORMALS"				// DEBUG_NORMALS
+	};
+
+	// a program of the features, its pipeline has no stages while it doesn't link.
+	// its files are watched either way, fixing them brings it back.
+	struct variant
+	{
+		gl::uint32 p_PipelineName;
+		gl::uint32 p_ProgramName;
+	};
+
+	// the variants compiled so far, by feature mask
+	std::map<uint32_t, variant> s_variants;
+
+	std::string arguments(uint32_t in_features)
+	{
+		std::string defines;
+		for (uint32_t f = 0; f < enum_to_t(graphics::material::feature::MAX); ++f)
+			if (in_features & (1 << f))
+				defines += (defines.empty() ? "-D" : " -D") + std::string(s_feature_defines[f]);
+		return defines;
+	}
 
-		gl::uint32 vert_shader_name = in_compiler.create(GL_VERTEX_SHADER, vs_source);
-		if (!in_compiler.checkShader(vert_shader_name))
-			return 0;
+	bool build(uint32_t program_name, compiler& in_compiler, const std::string& in_arguments)
+	{
+		assert(glIsProgram(program_name));
 
-		gl::uint32 frag_shader_name = in_compiler.create(GL_FRAGMENT_SHADER, fs_source);
-		if (!in_compiler.checkShader(frag_shader_name))
-			return 0;
+		gl::uint32 vert_shader_name = in_compiler.create(GL_VERTEX_SHADER, s_vs_source, in_arguments);
+		gl::uint32 frag_shader_name = in_compiler.create(GL_FRAGMENT_SHADER, s_fs_source, in_arguments);
 
 		glProgramParameteri(program_name, GL_PROGRAM_SEPARABLE, GL_TRUE);
 		glAttachShader(program_name, vert_shader_name);
 		glAttachShader(program_name, frag_shader_name);
 		glLinkProgram(program_name);
 
-		return uint32_t(GL_VERTEX_SHADER_BIT | GL_FRAGMENT_SHADER_BIT);
+		return in_compiler.checkShader(vert_shader_name) && in_compiler.checkShader(frag_shader_name)
+			&& in_compiler.checkProgram(program_name);
+	}
+
+	const variant& find_variant(uint32_t in_features)
+	{
+		auto found = s_variants.find(in_features);
+		if (found != s_variants.end())
+			return found->second;
+
+		const auto defines = arguments(in_features);
+		LOG(INFO) << fmt::format("material: compiling the variant {}", defines.empty() ? "without features" : defines);
+
+		// the map doesn't move its elements, the variant identifies itself for the hot reload
+		variant& compiled = s_variants[in_features];
+		compiled.p_ProgramName = glCreateProgram();
+		glGenProgramPipelines(1, &compiled.p_PipelineName);
+
+		compiler compiler_instance;
+		if (build(compiled.p_ProgramName, compiler_instance, defines))
+			glUseProgramStages(compiled.p_PipelineName, GL_VERTEX_SHADER_BIT | GL_FRAGMENT_SHADER_BIT, compiled.p_ProgramName);
+		else
+			LOG(ERROR) << fmt::format("material: the variant {} doesn't build", defines);
+
+		graphics::hot_reload::watch(&compiled, compiler_instance, compiled.p_ProgramName, [&compiled](uint32_t in_program)
+		{
+			glUseProgramStages(compiled.p_PipelineName, GL_VERTEX_SHADER_BIT | GL_FRAGMENT_SHADER_BIT, in_program);
+			glDeleteProgram(compiled.p_ProgramName);
+			compiled.p_ProgramName = in_program;
+		});
+
+		return compiled;
 	}
 }
 
 graphics::material::material()
-	: m_PipelineName(0), m_ProgramName(0)
+	: m_Features(0), m_Environment(nullptr)
 {
 	// clear texture unit names
 	memset(m_TextureRefs, 0, sizeof(m_TextureRefs));
@@ -41,9 +106,6 @@ graphics::material::material()
 
 bool graphics::material::create()
 {
-	assert(m_ProgramName == 0);
-	assert(m_PipelineName == 0);
-
 	// generate and populate samplers
 	glGenSamplers(enum_to_t(sampler::MAX), &m_SamplerNames[0]);
 
@@ -83,34 +145,30 @@ bool graphics::material::create()
 		glBindBuffer(GL_UNIFORM_BUFFER, 0);
 	}
 
-	char const * VS_SOURCE = "data/shaders/pbr.vert";
-	char const * FS_SOURCE = "data/shaders/pbr.frag";
-
-	m_ProgramName = glCreateProgram();
-
-	compiler compiler_instance;
-	auto pipe_mask = build(m_ProgramName, compiler_instance, VS_SOURCE, FS_SOURCE);
-	if (pipe_mask != 0 && compiler_instance.checkProgram(m_ProgramName))
+	// create the uniform ambient buffer: view to world matrix, irradiance coefficients and environment levels
 	{
-		glGenProgramPipelines(1, &m_PipelineName);
-		glUseProgramStages(m_PipelineName, pipe_mask, m_ProgramName);
-		return true;
+		auto uniform_buffer_size = glm::max(gl::int32(sizeof(glm::mat4) + sizeof(glm::vec4) * (ibl::s_coefficients + 1)), uniform_buffer_offeset);
+
+		glGenBuffers(1, &m_UniformBufferNames[enum_to_t(uniform::AMBIENT)]);
+		glBindBuffer(GL_UNIFORM_BUFFER, m_UniformBufferNames[enum_to_t(uniform::AMBIENT)]);
+		glBufferData(GL_UNIFORM_BUFFER, uniform_buffer_size, NULL, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
 	}
 
-	return false;
+	// the program is compiled when the material is first used, with the features it has then
+	return true;
 }
 
 void graphics::material::associate(texture * textures[sampler::MAX])
 {
 	// associate textures to material
-	// FIXME: Take into account environment map
-	for (uint32_t ti = 0; ti < enum_to_t(sampler::ENVIRONMENT); ++ti)
+	for (uint32_t ti = 0; ti < enum_to_t(sampler::MAX); ++ti)
 		if (textures[ti]) m_TextureRefs[ti] = textures[ti]->getHandle();
 }
 
 void graphics::material::use()
 {
-	glBindProgramPipeline(m_PipelineName);
+	glBindProgramPipeline(find_variant(m_Features).p_PipelineName);
 
 	// bind texture units
 	glBindTextures(0, enum_to_t(sampler::MAX), m_TextureRefs);
@@ -119,26 +177,29 @@ void graphics::material::use()
 	// bind uniform buffers
 	glBindBufferBase(GL_UNIFORM_BUFFER, enum_to_t(uniform::TRANSFORM), m_UniformBufferNames[enum_to_t(uniform::TRANSFORM)]);
 	glBindBufferBase(GL_UNIFORM_BUFFER, enum_to_t(uniform::LIGHT), m_UniformBufferNames[enum_to_t(uniform::LIGHT)]);
+	glBindBufferBase(GL_UNIFORM_BUFFER, enum_to_t(uniform::AMBIENT), m_UniformBufferNames[enum_to_t(uniform::AMBIENT)]);
 }
 
 void graphics::material::destroy()
 {	
-	glDeleteBuffers(enum_to_t(uniform::MAX), m_UniformBufferNames);
-	memset(m_UniformBufferNames, 0, sizeof(m_UniformBufferNames));
-
-	glDeleteProgramPipelines(1, &m_PipelineName);
-	m_PipelineName = 0;
-
-	glDeleteProgram(m_ProgramName);
-	m_ProgramName = 0;
+	// nothing on the GPU before create, there may not even be a context
+	if (m_UniformBufferNames[enum_to_t(uniform::TRANSFORM)] != 0)
+	{
+		glDeleteBuffers(enum_to_t(uniform::MAX), m_UniformBufferNames);
+		memset(m_UniformBufferNames, 0, sizeof(m_UniformBufferNames));
+	}
 
-	glDeleteSamplers(enum_to_t(sampler::MAX), m_SamplerNames);
-	memset(m_SamplerNames, 0, sizeof(m_SamplerNames));
+	if (m_SamplerNames[0] != 0)
+	{
+		glDeleteSamplers(enum_to_t(sampler::MAX), m_SamplerNames);
+		memset(m_SamplerNames, 0, sizeof(m_SamplerNames));
+	}
 
 	memset(m_TextureRefs, 0, sizeof(m_TextureRefs));
+	m_Environment = nullptr;
 }
 
-void graphics::material::update(glm::mat4 prj_matrix, glm::mat4 mv_matrix, glm::vec4 light_dir_intensity)
+void graphics::material::update(glm::mat4 prj_matrix, glm::mat4 mv_matrix, glm::vec4 light_dir_intensity, glm::mat4 view_matrix)
 {
 	// update the transform buffer structure
 	{
@@ -170,4 +231,55 @@ void graphics::material::update(glm::mat4 prj_matrix, glm::mat4 mv_matrix, glm::
 		// make sure the uniform buffer is uploaded
 		glUnmapBuffer(GL_UNIFORM_BUFFER);
 	}
+
+	// update ambient lighting
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, m_UniformBufferNames[enum_to_t(uniform::AMBIENT)]);
+		uint8_t* ambient_buffer_ptr = (uint8_t*)glMapBufferRange(GL_UNIFORM_BUFFER, 0,
+			sizeof(glm::mat4) + sizeof(glm::vec4) * (ibl::s_coefficients + 1), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+		auto view_to_world = glm::inverse(view_matrix);
+		memcpy(ambient_buffer_ptr, &view_to_world[0], sizeof(glm::mat4));
+
+		// the shader leaves the ambient out without levels
+		glm::vec4 levels(0.f);
+		if (m_Environment)
+		{
+			memcpy(ambient_buffer_ptr + sizeof(glm::mat4), m_Environment->getIrradiance(), sizeof(glm::vec4) * ibl::s_coefficients);
+			levels = glm::vec4(static_cast<float>(m_Environment->getSpecularLevels()), 1.f, 0.f, 0.f);
+		}
+		else
+			memset(ambient_buffer_ptr + sizeof(glm::mat4), 0, sizeof(glm::vec4) * ibl::s_coefficients);
+
+		memcpy(ambient_buffer_ptr + sizeof(glm::mat4) + sizeof(glm::vec4) * ibl::s_coefficients, &levels[0], sizeof(glm::vec4));
+
+		// make sure the uniform buffer is uploaded
+		glUnmapBuffer(GL_UNIFORM_BUFFER);
+	}
+}
+
+void graphics::material::setEnvironment(const ibl* in_environment)
+{
+	m_Environment = in_environment;
+	setFeature(feature::ENVIRONMENT, in_environment != nullptr);
+}
+
+void graphics::material::setFeature(feature in_feature, bool in_enable)
+{
+	if (in_enable)
+		m_Features |= (1 << enum_to_t(in_feature));
+	else
+		m_Features &= ~(1 << enum_to_t(in_feature));
+}
+
+void graphics::material::shutdown()
+{
+	for (auto& compiled : s_variants)
+	{
+		hot_reload::forget(&compiled.second);
+		glDeleteProgramPipelines(1, &compiled.second.p_PipelineName);
+		glDeleteProgram(compiled.second.p_ProgramName);
+	}
+
+	s_variants.clear();
 }
@@ -9,6 +9,8 @@
 
 namespace graphics
 {
+	class ibl;
+
 	// physical based render lighting model
 	class material : public resource<material>
 	{
@@ -19,6 +21,7 @@ namespace graphics
 		{
 			TRANSFORM,
 			LIGHT,
+			AMBIENT,
 			MAX
 		};
 
@@ -33,16 +36,29 @@ namespace graphics
 			MAX
 		};
 
+		// paths of the shaders a material takes, each set of them is a variant of the
+		// program compiled the first time a material uses it and shared by the others
+		enum class feature : uint32_t
+		{
+			DIFFUSE_MAP,		// albedo from the diffuse texture, a constant one otherwise
+			NORMAL_MAP,			// normals from the normal texture, the interpolated ones otherwise
+			DISPLACEMENT_MAP,	// parallax mapping with the displacement texture
+			ENVIRONMENT,		// image based lighting, set with the environment
+			DEBUG_NORMALS,		// draw the normals instead of the lighting
+			MAX
+		};
+
 	private:
 
-		handle m_PipelineName;
-		handle m_ProgramName;
+		uint32_t m_Features;
 
 		handle m_UniformBufferNames[uniform::MAX];
 
 		handle m_TextureRefs[sampler::MAX];
 		handle m_SamplerNames[sampler::MAX];
 
+		const ibl* m_Environment;
+
 	public:
 
 		material();
@@ -55,7 +71,21 @@ namespace graphics
 		void update(
 			glm::mat4 prj_matrix,			// projection matrix
 			glm::mat4 mv_matrix,			// model * view matrix
-			glm::vec4 light_dir_intensity);	// light direction vec4.xyz, intensity vec4.w
+			glm::vec4 light_dir_intensity,	// light direction vec4.xyz, intensity vec4.w
+			glm::mat4 view_matrix);			// view matrix, the environment is looked up in world space
+
+		// ambient lighting from in_environment, its specular cubemap is
+		// expected in the ENVIRONMENT sampler. nullptr turns it off.
+		void setEnvironment(const ibl* in_environment);
+
+		void setFeature(feature in_feature, bool in_enable);
+
+		inline bool isFeatureEnabled(feature in_feature) const {
+			return (m_Features & (1 << static_cast<uint32_t>(in_feature))) != 0;
+		}
+
+		// delete the variants compiled so far, once the materials are destroyed
+		static void shutdown();
 
 	};
 }
\ No newline at end of file
@@ -1,6 +1,77 @@
 #include "mesh.hpp"
 #include "ogl.hpp"
 #include "util.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+namespace
+{
+	const float s_epsilon = 1e-12f;
+
+	// welded vertices have normals closer than 60 degrees, hard edges stay split
+	const float s_weld_cosine = .5f;
+
+	// vertices a task recomputes the frames of
+	const size_t s_vertices_per_task = 1024;
+
+	// changed ranges closer than this many vertices are uploaded together
+	const uint32_t s_merge_gap = 64;
+
+	// cache modelled by countCacheMisses, a 32 KiB L1 data cache
+	const size_t s_cache_line = 64;
+	const size_t s_cache_lines = 512;
+
+	// 10 bits of in_value spread over every third bit
+	inline uint32_t spread_bits(uint32_t in_value)
+	{
+		in_value &= 0x3ff;
+		in_value = (in_value | (in_value << 16)) & 0x030000ff;
+		in_value = (in_value | (in_value << 8)) & 0x0300f00f;
+		in_value = (in_value | (in_value << 4)) & 0x030c30c3;
+		in_value = (in_value | (in_value << 2)) & 0x09249249;
+		return in_value;
+	}
+
+	template<typename T>
+	void permute(std::vector<T>& io_array, const std::vector<uint32_t>& in_order)
+	{
+		if (io_array.size() != in_order.size())
+			return;
+
+		std::vector<T> sorted(io_array.size());
+		for (size_t v = 0; v < in_order.size(); ++v)
+			sorted[v] = io_array[in_order[v]];
+
+		io_array.swap(sorted);
+	}
+
+	// sorted vertices as [first, end) ranges, merging those separated by small gaps
+	void toRanges(const std::vector<uint32_t>& in_vertices, std::vector<std::pair<uint32_t, uint32_t>>& out_ranges)
+	{
+		out_ranges.clear();
+		for (auto v : in_vertices)
+		{
+			if (!out_ranges.empty() && v <= out_ranges.back().second + s_merge_gap)
+				out_ranges.back().second = v + 1;
+			else
+				out_ranges.emplace_back(v, v + 1);
+		}
+	}
+
+	template<typename T>
+	void upload(graphics::mesh::handle in_buffer, const std::vector<T>& in_data, const std::vector<std::pair<uint32_t, uint32_t>>& in_ranges)
+	{
+		if (in_buffer == 0 || in_data.empty())
+			return;
+
+		glBindBuffer(GL_ARRAY_BUFFER, in_buffer);
+		for (const auto& range : in_ranges)
+			glBufferSubData(GL_ARRAY_BUFFER, range.first * sizeof(T), (range.second - range.first) * sizeof(T), &in_data[range.first]);
+	}
+}
 
 bool graphics::mesh::create()
 {
@@ -9,12 +80,18 @@ bool graphics::mesh::create()
 	// at least the vertex positions have to be provided
 	bool valid_buffers = false;
 
+	// positions and normals of dynamic meshes are updated by the CPU
+	const gl::enumerator vertex_usage = p_Dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_COPY;
+
 	glGenBuffers(enum_to_t(buffer::MAX), m_IBO);
 
+	if (p_Dynamic)
+		buildAdjacency();
+
 	if (p_PosRadius.size())
 	{
 		glBindBuffer(GL_ARRAY_BUFFER, m_IBO[enum_to_t(buffer::POSITION)]);
-		glBufferData(GL_ARRAY_BUFFER, p_PosRadius.size() * sizeof(glm::vec4), p_PosRadius.data(), GL_STATIC_COPY);
+		glBufferData(GL_ARRAY_BUFFER, p_PosRadius.size() * sizeof(glm::vec4), p_PosRadius.data(), vertex_usage);
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 		valid_buffers = true;
 	}
@@ -22,7 +99,7 @@ bool graphics::mesh::create()
 	if (p_Normals.size() > 0)
 	{
 		glBindBuffer(GL_ARRAY_BUFFER, m_IBO[enum_to_t(buffer::NORMAL)]);
-		glBufferData(GL_ARRAY_BUFFER, p_Normals.size() * sizeof(glm::vec4), p_Normals.data(), GL_STATIC_COPY);
+		glBufferData(GL_ARRAY_BUFFER, p_Normals.size() * sizeof(glm::vec4), p_Normals.data(), vertex_usage);
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 		valid_buffers = true;
 	}
@@ -38,11 +115,19 @@ bool graphics::mesh::create()
 	if (p_Tangents.size() > 0)
 	{
 		glBindBuffer(GL_ARRAY_BUFFER, m_IBO[enum_to_t(buffer::TANGENT)]);
-		glBufferData(GL_ARRAY_BUFFER, p_Tangents.size() * sizeof(glm::vec4), p_Tangents.data(), GL_STATIC_DRAW);
+		glBufferData(GL_ARRAY_BUFFER, p_Tangents.size() * sizeof(glm::vec4), p_Tangents.data(), p_Dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 		valid_buffers = true;
 	}
 
+	// velocities and inverse masses are only read by the simulation
+	if (p_Dynamic && p_VelInvMass.size() > 0)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, m_IBO[enum_to_t(buffer::VELOCITY)]);
+		glBufferData(GL_ARRAY_BUFFER, p_VelInvMass.size() * sizeof(glm::vec4), p_VelInvMass.data(), GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
 	if (p_FaceIndices.size() > 0)
 	{
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_IBO[enum_to_t(buffer::ELEMENT)]);
@@ -74,11 +159,360 @@ void graphics::mesh::use()
 	glDrawElements(GL_TRIANGLES, (gl::sizei)p_FaceIndices.size(), GL_UNSIGNED_INT, gl::bufferOffset(0));
 }
 
+void graphics::mesh::update()
+{
+	assert(p_Dynamic);
+
+	markDirty(0, static_cast<uint32_t>(p_PosRadius.size()));
+	deform();
+}
+
+void graphics::mesh::markDirty(uint32_t in_first, uint32_t in_count)
+{
+	if (in_count == 0)
+		return;
+
+	// writers usually go through the vertices in order
+	const uint32_t end = in_first + in_count;
+	if (!m_DirtyRanges.empty() && in_first >= m_DirtyRanges.back().first && in_first <= m_DirtyRanges.back().second)
+		m_DirtyRanges.back().second = std::max(m_DirtyRanges.back().second, end);
+	else
+		m_DirtyRanges.emplace_back(in_first, end);
+}
+
+void graphics::mesh::sortVertices()
+{
+	assert(m_VAO == 0);
+
+	const uint32_t vertex_count = static_cast<uint32_t>(p_PosRadius.size());
+	if (vertex_count == 0)
+		return;
+
+	glm::vec3 lower(p_PosRadius[0]), upper(p_PosRadius[0]);
+	for (const auto& position : p_PosRadius)
+	{
+		lower = glm::min(lower, glm::vec3(position));
+		upper = glm::max(upper, glm::vec3(position));
+	}
+
+	// 10 bits per axis over the bounds, interleaved
+	const glm::vec3 scale = 1023.f / glm::max(upper - lower, glm::vec3(s_epsilon));
+
+	std::vector<std::pair<uint32_t, uint32_t>> codes(vertex_count);
+	for (uint32_t v = 0; v < vertex_count; ++v)
+	{
+		const glm::uvec3 cell((glm::vec3(p_PosRadius[v]) - lower) * scale);
+		codes[v] = std::make_pair(spread_bits(cell.x) | (spread_bits(cell.y) << 1) | (spread_bits(cell.z) << 2), v);
+	}
+
+	// vertices on the same cell keep the order of the file
+	std::sort(codes.begin(), codes.end());
+
+	std::vector<uint32_t> order(vertex_count), rank(vertex_count);
+	for (uint32_t v = 0; v < vertex_count; ++v)
+	{
+		order[v] = codes[v].second;
+		rank[order[v]] = v;
+	}
+
+	permute(p_PosRadius, order);
+	permute(p_VelInvMass, order);
+	permute(p_Normals, order);
+	permute(p_Tangents, order);
+	permute(p_TexCoords, order);
+
+	// triangles in the order of their first vertex on the curve
+	const size_t triangle_count = p_FaceIndices.size() / 3;
+	std::vector<std::pair<uint32_t, uint32_t>> triangles(triangle_count);
+	for (uint32_t t = 0; t < triangle_count; ++t)
+	{
+		for (uint32_t k = 0; k < 3; ++k)
+			p_FaceIndices[3 * t + k] = rank[p_FaceIndices[3 * t + k]];
+
+		triangles[t] = std::make_pair(std::min({ p_FaceIndices[3 * t + 0], p_FaceIndices[3 * t + 1], p_FaceIndices[3 * t + 2] }), t);
+	}
+
+	std::sort(triangles.begin(), triangles.end());
+
+	std::vector<uint32_t> faces(p_FaceIndices.size());
+	for (size_t t = 0; t < triangle_count; ++t)
+		std::copy_n(&p_FaceIndices[3 * triangles[t].second], 3, &faces[3 * t]);
+
+	p_FaceIndices.swap(faces);
+}
+
+size_t graphics::mesh::countCacheMisses() const
+{
+	const size_t vertices_per_line = s_cache_line / sizeof(glm::vec4);
+
+	std::vector<size_t> tags(s_cache_lines, ~size_t(0));
+	size_t misses = 0;
+
+	for (auto v : p_FaceIndices)
+	{
+		const size_t line = v / vertices_per_line;
+		auto& tag = tags[line % s_cache_lines];
+
+		if (tag != line)
+		{
+			tag = line;
+			++misses;
+		}
+	}
+
+	return misses;
+}
+
+void graphics::mesh::buildAdjacency()
+{
+	const uint32_t vertex_count = static_cast<uint32_t>(p_PosRadius.size());
+
+	// vertices sorted by position, then welded within every run of the same position
+	std::vector<uint32_t> order(vertex_count);
+	for (uint32_t v = 0; v < vertex_count; ++v)
+		order[v] = v;
+
+	std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b)
+	{
+		return std::make_tuple(p_PosRadius[a].x, p_PosRadius[a].y, p_PosRadius[a].z) < std::make_tuple(p_PosRadius[b].x, p_PosRadius[b].y, p_PosRadius[b].z);
+	});
+
+	const bool has_normals = p_Normals.size() == vertex_count;
+
+	m_Weld.assign(vertex_count, 0);
+	uint32_t weld_count = 0;
+	for (size_t run = 0, end = 0; run < order.size(); run = end)
+	{
+		const glm::vec4& position = p_PosRadius[order[run]];
+
+		end = run;
+		while (end < order.size() && p_PosRadius[order[end]].xyz() == position.xyz())
+			++end;
+
+		const uint32_t first_weld = weld_count;
+		for (size_t i = run; i < end; ++i)
+		{
+			const uint32_t v = order[i];
+
+			// the first weld of the run whose first vertex has a similar normal
+			uint32_t weld = weld_count;
+			for (size_t j = run; j < i && weld == weld_count; ++j)
+			{
+				const uint32_t w = m_Weld[order[j]];
+				if (w >= first_weld && (!has_normals || glm::dot(p_Normals[order[j]], p_Normals[v]) > s_weld_cosine))
+					weld = w;
+			}
+
+			if (weld == weld_count)
+				++weld_count;
+
+			m_Weld[v] = weld;
+		}
+	}
+
+	// vertices of every weld
+	m_WeldOffsets.assign(weld_count + 1, 0);
+	for (auto w : m_Weld)
+		++m_WeldOffsets[w + 1];
+	for (uint32_t w = 0; w < weld_count; ++w)
+		m_WeldOffsets[w + 1] += m_WeldOffsets[w];
+
+	m_WeldVertices.resize(vertex_count);
+	{
+		std::vector<uint32_t> cursor(m_WeldOffsets.begin(), m_WeldOffsets.end() - 1);
+		for (uint32_t v = 0; v < vertex_count; ++v)
+			m_WeldVertices[cursor[m_Weld[v]]++] = v;
+	}
+
+	// triangles around every weld, once even when degenerate
+	const uint32_t triangle_count = static_cast<uint32_t>(p_FaceIndices.size() / 3);
+	auto corners = [this](uint32_t t, uint32_t out_welds[3])
+	{
+		uint32_t count = 0;
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			const uint32_t w = m_Weld[p_FaceIndices[3 * t + k]];
+			if (std::find(out_welds, out_welds + count, w) == out_welds + count)
+				out_welds[count++] = w;
+		}
+		return count;
+	};
+
+	m_RingOffsets.assign(weld_count + 1, 0);
+	for (uint32_t t = 0; t < triangle_count; ++t)
+	{
+		uint32_t welds[3];
+		for (uint32_t k = 0, count = corners(t, welds); k < count; ++k)
+			++m_RingOffsets[welds[k] + 1];
+	}
+	for (uint32_t w = 0; w < weld_count; ++w)
+		m_RingOffsets[w + 1] += m_RingOffsets[w];
+
+	m_RingTriangles.resize(m_RingOffsets[weld_count]);
+	{
+		std::vector<uint32_t> cursor(m_RingOffsets.begin(), m_RingOffsets.end() - 1);
+		for (uint32_t t = 0; t < triangle_count; ++t)
+		{
+			uint32_t welds[3];
+			for (uint32_t k = 0, count = corners(t, welds); k < count; ++k)
+				m_RingTriangles[cursor[welds[k]]++] = t;
+		}
+	}
+
+	m_WeldStamps.assign(weld_count, 0);
+	m_Stamp = 0;
+	m_DirtyRanges.clear();
+}
+
+size_t graphics::mesh::deform()
+{
+	if (m_DirtyRanges.empty())
+		return 0;
+
+	if (m_Weld.size() != p_PosRadius.size())
+		buildAdjacency();
+
+	const uint32_t vertex_count = static_cast<uint32_t>(p_PosRadius.size());
+
+	// the ranges may overlap when written out of order
+	std::sort(m_DirtyRanges.begin(), m_DirtyRanges.end());
+
+	std::vector<std::pair<uint32_t, uint32_t>> moved;
+	for (const auto& range : m_DirtyRanges)
+	{
+		const uint32_t first = std::min(range.first, vertex_count);
+		const uint32_t end = std::min(range.second, vertex_count);
+
+		if (!moved.empty() && first <= moved.back().second)
+			moved.back().second = std::max(moved.back().second, end);
+		else if (first < end)
+			moved.emplace_back(first, end);
+	}
+	m_DirtyRanges.clear();
+
+	// a moved vertex changes the triangles around it, hence the frames of all their corners
+	if (++m_Stamp == 0)
+	{
+		std::fill(m_WeldStamps.begin(), m_WeldStamps.end(), 0u);
+		m_Stamp = 1;
+	}
+
+	m_Affected.clear();
+	for (const auto& range : moved)
+	{
+		for (uint32_t v = range.first; v < range.second; ++v)
+		{
+			const uint32_t weld = m_Weld[v];
+			for (uint32_t r = m_RingOffsets[weld]; r < m_RingOffsets[weld + 1]; ++r)
+			{
+				const uint32_t t = m_RingTriangles[r];
+				for (uint32_t k = 0; k < 3; ++k)
+				{
+					const uint32_t corner = m_Weld[p_FaceIndices[3 * t + k]];
+					if (m_WeldStamps[corner] == m_Stamp)
+						continue;
+
+					m_WeldStamps[corner] = m_Stamp;
+					m_Affected.insert(m_Affected.end(), &m_WeldVertices[m_WeldOffsets[corner]], &m_WeldVertices[0] + m_WeldOffsets[corner + 1]);
+				}
+			}
+		}
+	}
+	std::sort(m_Affected.begin(), m_Affected.end());
+
+	const bool has_normals = p_Normals.size() == vertex_count;
+	const bool has_tangents = p_Tangents.size() == vertex_count && p_TexCoords.size() == vertex_count;
+
+	// every vertex gathers the area weighted normals of the triangles around its
+	// weld, and the tangents of its own triangles only, uvs are split along seams.
+	parallel::for_range(0, m_Affected.size(), s_vertices_per_task, [&](size_t in_begin, size_t in_end)
+	{
+		for (size_t a = in_begin; a < in_end; ++a)
+		{
+			const uint32_t v = m_Affected[a];
+			const uint32_t weld = m_Weld[v];
+
+			glm::vec3 normal(0.f), tangent(0.f), bitangent(0.f);
+			for (uint32_t r = m_RingOffsets[weld]; r < m_RingOffsets[weld + 1]; ++r)
+			{
+				const uint32_t* corners = &p_FaceIndices[3 * m_RingTriangles[r]];
+
+				const glm::vec3 p0 = p_PosRadius[corners[0]].xyz();
+				const glm::vec3 delta_pos1 = p_PosRadius[corners[1]].xyz() - p0;
+				const glm::vec3 delta_pos2 = p_PosRadius[corners[2]].xyz() - p0;
+
+				normal += glm::cross(delta_pos1, delta_pos2);
+
+				if (!has_tangents || (corners[0] != v && corners[1] != v && corners[2] != v))
+					continue;
+
+				const glm::vec2 delta_uv1 = p_TexCoords[corners[1]] - p_TexCoords[corners[0]];
+				const glm::vec2 delta_uv2 = p_TexCoords[corners[2]] - p_TexCoords[corners[0]];
+
+				const float determinant = delta_uv1.x * delta_uv2.y - delta_uv1.y * delta_uv2.x;
+				if (std::abs(determinant) < s_epsilon)
+					continue;
+
+				const float r_det = 1.f / determinant;
+				tangent += (delta_pos1 * delta_uv2.y - delta_pos2 * delta_uv1.y) * r_det;
+				bitangent += (delta_pos2 * delta_uv1.x - delta_pos1 * delta_uv2.x) * r_det;
+			}
+
+			const float normal_length = glm::length(normal);
+			if (normal_length < s_epsilon)
+				continue;
+
+			normal /= normal_length;
+			if (has_normals)
+				p_Normals[v] = glm::vec4(normal, 0.f);
+
+			// Gram-Schmidt, the handedness in w rebuilds the bitangent B = (N x T) * H
+			tangent -= normal * glm::dot(normal, tangent);
+			const float tangent_length = glm::length(tangent);
+			if (has_tangents && tangent_length > s_epsilon)
+			{
+				const float handedness = glm::dot(glm::cross(normal, tangent), bitangent) < 0.f ? -1.f : 1.f;
+				p_Tangents[v] = glm::vec4(tangent / tangent_length, handedness);
+			}
+		}
+	});
+
+	// only the changed ranges go to the GPU, nothing to upload before create
+	if (m_VAO != 0)
+	{
+		upload(m_IBO[enum_to_t(buffer::POSITION)], p_PosRadius, moved);
+		if (p_Dynamic)
+			upload(m_IBO[enum_to_t(buffer::VELOCITY)], p_VelInvMass, moved);
+
+		std::vector<std::pair<uint32_t, uint32_t>> changed;
+		toRanges(m_Affected, changed);
+
+		if (has_normals)
+			upload(m_IBO[enum_to_t(buffer::NORMAL)], p_Normals, changed);
+		if (has_tangents)
+			upload(m_IBO[enum_to_t(buffer::TANGENT)], p_Tangents, changed);
+
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	return m_Affected.size();
+}
+
 void graphics::mesh::destroy()
 {
-	glDeleteBuffers(enum_to_t(buffer::MAX), m_IBO);
-	memset(m_IBO, 0, sizeof(m_IBO));
+	// only the names create made, there may not even be a context before it
+	for (auto& buffer_name : m_IBO)
+	{
+		if (buffer_name != 0)
+			glDeleteBuffers(1, &buffer_name);
+		buffer_name = 0;
+	}
 
-	glDeleteBuffers(1, &m_VAO);
+	if (m_VAO != 0)
+		glDeleteVertexArrays(1, &m_VAO);
 	m_VAO = 0;
+
+	for (auto adjacency : { &m_Weld, &m_WeldOffsets, &m_WeldVertices, &m_RingOffsets, &m_RingTriangles, &m_Affected, &m_WeldStamps })
+		adjacency->clear();
+	m_DirtyRanges.clear();
 }
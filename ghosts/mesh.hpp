@@ -6,6 +6,7 @@
 #include <glm/vec2.hpp>
 #include <glm/vec4.hpp>
 
+#include <utility>
 #include <vector>
 
 namespace graphics
@@ -21,6 +22,7 @@ namespace graphics
 			NORMAL,
 			TEXCOORDS,
 			TANGENT,
+			VELOCITY,
 			ELEMENT,
 			MAX
 		};
@@ -30,6 +32,26 @@ namespace graphics
 		handle m_VAO;				// vertex array object
 		handle m_IBO[buffer::MAX];	// input buffer objects
 
+		// vertices sharing a position and a similar normal are welded so deforming
+		// keeps seams smooth. the vertices of weld w are m_WeldVertices[m_WeldOffsets[w],
+		// m_WeldOffsets[w + 1]), the triangles around it m_RingTriangles[m_RingOffsets[w],
+		// m_RingOffsets[w + 1]).
+		std::vector<uint32_t>	m_Weld;
+		std::vector<uint32_t>	m_WeldOffsets;
+		std::vector<uint32_t>	m_WeldVertices;
+		std::vector<uint32_t>	m_RingOffsets;
+		std::vector<uint32_t>	m_RingTriangles;
+
+		// [first, end) vertex ranges moved since the last deform
+		std::vector<std::pair<uint32_t, uint32_t>> m_DirtyRanges;
+
+		// vertices whose frames are recomputed, found once through a stamp per weld
+		std::vector<uint32_t>	m_Affected;
+		std::vector<uint32_t>	m_WeldStamps;
+		uint32_t				m_Stamp;
+
+		void buildAdjacency();
+
 	public:
 
 		math::transform			p_MeshToModel;
@@ -42,8 +64,36 @@ namespace graphics
 		std::vector<glm::vec2>	p_TexCoords;
 		std::vector<uint32_t>	p_FaceIndices;
 
+		// vertices are updated every frame, e.g. simulated
+		bool					p_Dynamic;
+
+		// sort the vertices along a Morton curve through their positions, and the
+		// triangles by their first vertex, so that neighbours on the surface are
+		// neighbours in memory. every attribute and p_FaceIndices are remapped,
+		// it has to be called before create.
+		void sortVertices();
+
+		// vertex fetches missing a 32 KiB direct mapped cache of 64 byte lines,
+		// reading the positions triangle after triangle as the normal, tangent
+		// and constraint passes do: a model of the locality of the mesh.
+		size_t countCacheMisses() const;
+
 		bool create();
 		void use();
 		void destroy();
+
+		// recompute the normals and tangents of all the vertices and upload
+		// them with the positions and velocities, for dynamic meshes.
+		void update();
+
+		// vertices [in_first, in_first + in_count) moved, deform will refresh them
+		void markDirty(uint32_t in_first, uint32_t in_count);
+
+		// recompute normals and tangents around the vertices moved since the last
+		// call only, and upload the changed ranges. returns the number of vertices
+		// whose normal and tangent were recomputed.
+		size_t deform();
+
+		inline handle getBuffer(buffer in_buffer) const { return m_IBO[static_cast<uint32_t>(in_buffer)]; }
 	};
 }
\ No newline at end of file
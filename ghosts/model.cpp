@@ -5,12 +5,16 @@
 #include "material.hpp"
 #include "util.hpp"
 #include "texture.hpp"
+#include "ibl.hpp"
 #include "line_batcher.hpp"
 #include "graphics.hpp"
+#include "compute.hpp"
+#include "recorder.hpp"
 
 #include "tiny_obj_loader.h"
 
 #include <algorithm>
+#include <cfloat>
 #include <map>
 
 namespace framework
@@ -24,6 +28,20 @@ namespace framework
 		"data/textures/defaults/displacement.dds"	// DISPLACEMENT
 	};
 
+	// how the textures of each sampler are compressed, metalness goes to the specular one
+	const graphics::texture::compression s_sampler_compressions[enum_to_t(graphics::material::sampler::MAX)] =
+	{
+		graphics::texture::compression::COLOR,		// DIFFUSE
+		graphics::texture::compression::SCALAR,		// SPECULAR
+		graphics::texture::compression::NORMAL,		// NORMAL
+		graphics::texture::compression::SCALAR,		// ROUGHNESS
+		graphics::texture::compression::SCALAR,		// DISPLACEMENT
+		graphics::texture::compression::COLOR		// ENVIRONMENT
+	};
+
+	// largest levels the textures of each sampler skip, -1 for the global quality
+	int32_t s_sampler_skipped_levels[enum_to_t(graphics::material::sampler::MAX)] = { -1, -1, -1, -1, -1, -1 };
+
 	static std::map<std::string, graphics::texture*> s_texture_names;
 	graphics::texture* generateTexture(const std::string& tex_filename)
 	{
@@ -123,7 +141,7 @@ namespace framework
 		}
 	}
 
-	model* model::loadObj(const std::string& in_file)
+	model* model::loadObj(const std::string& in_file, bool in_sort_vertices)
 	{
 		std::vector<tinyobj::shape_t> shapes;
 		std::vector<tinyobj::material_t> materials;
@@ -212,6 +230,16 @@ namespace framework
 				mesh->p_VelInvMass.emplace_back(glm::vec4::ZERO);
 			}
 
+			if (in_sort_vertices)
+			{
+				const size_t misses = mesh->countCacheMisses();
+				mesh->sortVertices();
+
+				const size_t sorted_misses = mesh->countCacheMisses();
+				LOG(INFO) << fmt::format("shape[{}] vertices sorted, modelled cache misses per pass {} -> {} ({:.1f}%)",
+					i, misses, sorted_misses, misses ? 100.0 * sorted_misses / misses : 100.0);
+			}
+
 			// compute tangents
 			std::vector<glm::vec4> bitangents;
 			computeTangents(mesh->p_FaceIndices, mesh->p_PosRadius, mesh->p_Normals, mesh->p_TexCoords, mesh->p_Tangents, bitangents);
@@ -248,7 +276,7 @@ namespace framework
 			}
 
 			// create the texture set for this material
-			texture_set_t texture_set;
+			texture_set_t texture_set = {};
 			
 			// albedo
 			{
@@ -295,10 +323,16 @@ namespace framework
 					: generateTexture(s_default_texture_files[texture_type]);
 			}
 
-			// create graphics material
+			// create graphics material, its shaders only sample the textures the file names
 			graphics::material* material = new graphics::material();
+			material->setFeature(graphics::material::feature::DIFFUSE_MAP, !materials[i].diffuse_texname.empty());
+			material->setFeature(graphics::material::feature::NORMAL_MAP, !materials[i].bump_texname.empty());
+			material->setFeature(graphics::material::feature::DISPLACEMENT_MAP, !materials[i].displacement_texname.empty());
 			loaded_model->m_Materials.push_back(material);
 			loaded_model->m_MaterialTexturesSet.push_back(texture_set);
+
+			// meshes using this material are simulated if it has cloth parameters
+			loaded_model->m_MaterialClothSettings.push_back(compute::cloth::settings::parse(materials[i].unknown_parameter));
 		}
 
 		return loaded_model;
@@ -306,6 +340,16 @@ namespace framework
 
 	void model::clear()
 	{
+		for (auto cloth : m_Cloths)
+		{
+			compute::clothing::release(cloth);
+		}
+
+		for (auto body : m_Bodies)
+		{
+			delete body;
+		}
+
 		for (auto mesh : m_Meshes)
 		{
 			mesh->destroy();
@@ -336,6 +380,11 @@ namespace framework
 		m_Materials.clear();
 		m_MeshMaterialMap.clear();
 		m_MaterialTexturesSet.clear();
+		m_MaterialClothSettings.clear();
+		m_Cloths.clear();
+		m_Bodies.clear();
+		m_MeshBounds.clear();
+		m_MeshTexcoordDensity.clear();
 	}
 
 	namespace
@@ -357,12 +406,12 @@ namespace framework
 		}
 	}
 
-	model* model::load(const std::string & filename, file_type f_type)
+	model* model::load(const std::string & filename, file_type f_type, bool in_sort_vertices)
 	{
 		switch (f_type)
 		{
 		case file_type::ASCII:
-			return loadObj(filename);
+			return loadObj(filename, in_sort_vertices);
 
 		default:
 			LOG(ERROR) << fmt::format("Model format {}, for file {} not supported!", ft2s(f_type), filename);
@@ -380,19 +429,94 @@ namespace framework
 		delete in_model;
 	}
 
-	bool model::initialise()
+	bool model::initialiseSimulation()
+	{
+		for (size_t m_id = 0; m_id < m_Meshes.size(); ++m_id)
+		{
+			auto mesh = m_Meshes[m_id];
+
+			const size_t material_id = m_MeshMaterialMap[m_id];
+			const bool is_cloth = material_id < m_MaterialClothSettings.size() && m_MaterialClothSettings[material_id].p_Enabled;
+
+			mesh->p_Dynamic = is_cloth;
+
+			m_Cloths.push_back(is_cloth
+				? compute::clothing::create(*mesh, m_MaterialClothSettings[material_id])
+				: nullptr);
+
+			// the hierarchy is built in the space of the model, moving the model moves the queries
+			compute::bvh* body = nullptr;
+			if (!is_cloth)
+			{
+				body = new compute::bvh();
+				if (!body->create(mesh->p_PosRadius, mesh->p_FaceIndices))
+				{
+					delete body;
+					body = nullptr;
+				}
+			}
+			m_Bodies.push_back(body);
+		}
+
+		std::vector<const compute::bvh*> colliders(m_Bodies.begin(), m_Bodies.end());
+		for (auto cloth : m_Cloths)
+			if (cloth)
+				cloth->setColliders(colliders);
+
+		return true;
+	}
+
+	bool model::initialise(bool in_stream_textures, bool in_compress_textures)
 	{
-		bool valid_model = true;
+		bool valid_model = initialiseSimulation();
 		
-		for (auto mesh : m_Meshes) {
+		for (size_t m_id = 0; m_id < m_Meshes.size(); ++m_id)
+		{
+			auto mesh = m_Meshes[m_id];
 			valid_model &= mesh->create();
+
+			// the ratio of the areas of the triangles in texture and model space,
+			// clothes stretch little so their rest shape is kept
+			const auto& positions = mesh->p_PosRadius;
+			const auto& texcoords = mesh->p_TexCoords;
+			const auto& triangles = mesh->p_FaceIndices;
+
+			glm::vec3 lower(FLT_MAX), upper(-FLT_MAX);
+			for (const auto& position : positions)
+			{
+				lower = glm::min(lower, position.xyz());
+				upper = glm::max(upper, position.xyz());
+			}
+
+			const glm::vec3 centre = positions.empty() ? glm::vec3(0.f) : (lower + upper) * 0.5f;
+			float radius = 0.f;
+			for (const auto& position : positions)
+				radius = glm::max(radius, glm::length(position.xyz() - centre));
+
+			float area = 0.f, texcoord_area = 0.f;
+			if (texcoords.size() == positions.size())
+			{
+				for (size_t ti = 0; ti + 2 < triangles.size(); ti += 3)
+				{
+					const uint32_t i0 = triangles[ti + 0], i1 = triangles[ti + 1], i2 = triangles[ti + 2];
+					area += glm::length(glm::cross(positions[i1].xyz() - positions[i0].xyz(), positions[i2].xyz() - positions[i0].xyz()));
+
+					const glm::vec2 e1 = texcoords[i1] - texcoords[i0], e2 = texcoords[i2] - texcoords[i0];
+					texcoord_area += glm::abs(e1.x * e2.y - e1.y * e2.x);
+				}
+			}
+
+			m_MeshBounds.push_back(glm::vec4(centre, radius));
+			m_MeshTexcoordDensity.push_back(area > 0.f ? glm::sqrt(texcoord_area / area) : 0.f);
 		}
 
 		for (auto texture_set : m_MaterialTexturesSet) {
-			for (auto texture : texture_set) {
+			for (size_t sampler = 0; sampler < texture_set.size(); ++sampler) {
+				auto texture = texture_set[sampler];
+				const auto compression = in_compress_textures ? s_sampler_compressions[sampler] : graphics::texture::compression::NONE;
 				for (auto tex_file : s_texture_names) {
 					if (texture && tex_file.second == texture && texture->getHandle() == graphics::texture::invalid) {
-						valid_model &= texture->create(tex_file.first);
+						valid_model &= texture->create(tex_file.first, in_stream_textures, compression, s_sampler_skipped_levels[sampler]);
 						break;
 					}
 				}
@@ -459,13 +583,116 @@ namespace framework
 	{
 		m_ModelToWorld.p_Position = position;
 		m_ModelToWorld.p_Rotation = rotation;
+
+		if (m_Recorder)
+			m_Recorder->transform(m_RecorderIndex, position, rotation);
+	}
+
+	void model::simulate(float in_step, compute::cloth::device in_device)
+	{
+		bool stepped = false;
+		for (auto cloth : m_Cloths)
+		{
+			if (cloth && cloth->getDevice() == in_device)
+			{
+				cloth->simulate(in_step);
+				stepped = true;
+			}
+		}
+
+		// steps without clothes change nothing, they are left out of the recording
+		if (m_Recorder && stepped)
+			m_Recorder->step(m_RecorderIndex, in_device, in_step, m_Recorder->hasChecksums() ? checksum(in_device) : 0);
 	}
 
-	void model::simulate(float delta_time)
+	void model::setRecorder(recorder* in_recorder, uint32_t in_index)
 	{
+		m_Recorder = in_recorder;
+		m_RecorderIndex = in_index;
 	}
 
-	void model::render(glm::mat4 projection, glm::mat4 view_mat, glm::vec4 light)
+	uint64_t model::checksum(compute::cloth::device in_device) const
+	{
+		if (in_device == compute::cloth::device::GPU)
+			return 0;
+
+		uint64_t hash = 0;
+		for (auto cloth : m_Cloths)
+			if (cloth && cloth->getDevice() == in_device)
+				hash = (hash ^ cloth->checksum()) * 1099511628211ull;
+
+		return hash;
+	}
+
+	void model::present(float in_blend)
+	{
+		for (size_t m_id = 0; m_id < m_Cloths.size(); ++m_id)
+		{
+			auto cloth = m_Cloths[m_id];
+
+			// the GPU simulates in the mesh buffers already
+			if (cloth && cloth->getDevice() == compute::cloth::device::CPU)
+			{
+				cloth->writeBack(*m_Meshes[m_id], in_blend);
+				m_Meshes[m_id]->deform();
+			}
+		}
+	}
+
+	bool model::setClothDevice(compute::cloth::device in_device)
+	{
+		if (m_Recorder)
+			m_Recorder->device(m_RecorderIndex, in_device);
+
+		bool changed = true;
+		for (size_t m_id = 0; m_id < m_Cloths.size(); ++m_id)
+			if (auto cloth = m_Cloths[m_id])
+				changed &= cloth->setDevice(in_device, *m_Meshes[m_id]);
+
+		return changed;
+	}
+
+	bool model::verifyClothes(uint32_t in_frames)
+	{
+		// a fraction of the cloth thickness, the two solvers project the same colours in the same order
+		const float tolerance = 1e-3f;
+
+		if (m_Recorder)
+			m_Recorder->verify(m_RecorderIndex, in_frames);
+
+		bool match = true;
+		for (size_t m_id = 0; m_id < m_Cloths.size(); ++m_id)
+			if (auto cloth = m_Cloths[m_id])
+				match &= cloth->verify(*m_Meshes[m_id], in_frames, tolerance);
+
+		return match;
+	}
+
+	bool model::raycast(const glm::vec3& in_origin, const glm::vec3& in_direction, size_t& out_mesh, compute::bvh::hit& out_hit) const
+	{
+		// rigid transform, the ray goes in the space of the model rather than the hierarchies out of it
+		const glm::quat to_model = glm::conjugate(m_ModelToWorld.p_Rotation);
+		const glm::vec3 origin = to_model * (in_origin - m_ModelToWorld.p_Position.xyz());
+		const glm::vec3 direction = to_model * in_direction;
+
+		out_hit.p_Triangle = compute::bvh::invalid;
+
+		float max_distance = FLT_MAX;
+		for (size_t m_id = 0; m_id < m_Bodies.size(); ++m_id)
+		{
+			compute::bvh::hit hit;
+			if (m_Bodies[m_id] && m_Bodies[m_id]->raycast(origin, direction, max_distance, hit))
+			{
+				max_distance = hit.p_Distance;
+				out_hit = hit;
+				out_mesh = m_id;
+			}
+		}
+
+		return out_hit.p_Triangle != compute::bvh::invalid;
+	}
+
+	void model::render(glm::mat4 projection, glm::mat4 view_mat, glm::vec4 light, glm::vec2 in_viewport)
 	{
 		glm::mat4 model_mat = glm::translate(glm::mat4::IDENTITY, m_ModelToWorld.p_Position.xyz());
 		model_mat *= glm::mat4_cast(m_ModelToWorld.p_Rotation);
@@ -493,8 +720,10 @@ namespace framework
 				assert(m_id < m_MeshMaterialMap.size());
 				auto material = m_Materials[m_MeshMaterialMap[m_id]];
 
-				material->associate(m_MaterialTexturesSet[m_id].data());
-				material->update(projection, model_view, glm::vec4(glm::vec3(light_view), light_intensity));
+				requestTextures(m_id, projection, model_view, in_viewport);
+				material->setFeature(graphics::material::feature::DEBUG_NORMALS, isRenderModeEnabled(render_mode::NORMAL));
+				material->associate(m_MaterialTexturesSet[m_MeshMaterialMap[m_id]].data());
+				material->update(projection, model_view, glm::vec4(glm::vec3(light_view), light_intensity), view_mat);
 				material->use();
 
 				// draw the mesh
@@ -517,6 +746,47 @@ namespace framework
 		}
 	}
 
+	void model::setTextureQuality(graphics::material::sampler in_sampler, int32_t in_skipped_levels)
+	{
+		s_sampler_skipped_levels[enum_to_t(in_sampler)] = in_skipped_levels;
+	}
+
+	void model::requestTextures(size_t in_mesh, const glm::mat4& in_projection, const glm::mat4& in_model_view, glm::vec2 in_viewport)
+	{
+		// the texture coordinates between two pixels where the bounding sphere is the
+		// closest to the eye, the near plane of a perspective projection bounds it
+		const glm::vec4 bounds = m_MeshBounds[in_mesh];
+		const float depth = -(in_model_view * glm::vec4(bounds.xyz(), 1.f)).z;
+		const float near_plane = in_projection[3][2] / (in_projection[2][2] - 1.f);
+
+		if (depth + bounds.w < near_plane)
+			return;
+
+		const float distance = glm::max(depth - bounds.w, near_plane);
+		const float units_per_pixel = 2.f * distance / (in_projection[1][1] * in_viewport.y);
+		const float footprint = m_MeshTexcoordDensity[in_mesh] * units_per_pixel;
+
+		const auto& texture_set = m_MaterialTexturesSet[m_MeshMaterialMap[in_mesh]];
+		for (size_t sampler = 0; sampler < texture_set.size(); ++sampler)
+		{
+			if (!texture_set[sampler])
+				continue;
+
+			// the environment is looked up by direction, all its levels are used
+			texture_set[sampler]->request(sampler == enum_to_t(graphics::material::sampler::ENVIRONMENT) ? 0.f : footprint);
+		}
+	}
+
+	void model::setEnvironment(graphics::ibl* in_environment)
+	{
+		// the environment is shared by the models, they only refer to its cubemap
+		for (auto& texture_set : m_MaterialTexturesSet)
+			texture_set[enum_to_t(graphics::material::sampler::ENVIRONMENT)] = in_environment ? in_environment->getSpecular() : nullptr;
+
+		for (auto material : m_Materials)
+			material->setEnvironment(in_environment);
+	}
+
 	void model::setRenderMode(render_mode in_rm, bool in_enable)
 	{
 		if (in_enable) {
@@ -2,6 +2,7 @@
 
 #include "transform.hpp"
 #include "material.hpp"
+#include "cloth.hpp"
 #include "util.hpp"
 
 #include <string>
@@ -14,10 +15,13 @@ namespace graphics
 	class mesh;
 	class texture;
 	class line_batcher;
+	class ibl;
 }
 
 namespace framework
 {
+	class recorder;
+
 	class model
 	{
 
@@ -54,10 +58,31 @@ namespace framework
 		// while the element refers to the material index inside m_Materials.
 		std::vector<size_t> m_MeshMaterialMap;
 
+		// cloth settings of each material, and the simulation
+		// of each mesh, nullptr for the meshes that are rigid.
+		std::vector<compute::cloth::settings> m_MaterialClothSettings;
+		std::vector<compute::cloth*> m_Cloths;
+
+		// bounding sphere of each mesh in the space of the model, centre xyz and radius w,
+		// and the texture coordinates its surface spans per unit, to request texture levels
+		std::vector<glm::vec4> m_MeshBounds;
+		std::vector<float> m_MeshTexcoordDensity;
+
+		// triangle hierarchy of each rigid mesh in the space of the model, the clothes
+		// collide with them. nullptr for the clothes.
+		std::vector<compute::bvh*> m_Bodies;
+
 		// set of rendering modes
 		uint32_t m_RenderModeStates;
 
-		static model* loadObj(const std::string& in_file);
+		// receives the inputs of the simulation, as model m_RecorderIndex
+		recorder* m_Recorder;
+		uint32_t m_RecorderIndex;
+
+		static model* loadObj(const std::string& in_file, bool in_sort_vertices);
+
+		// request the textures of mesh in_mesh at the level its closest point needs on screen
+		void requestTextures(size_t in_mesh, const glm::mat4& in_projection, const glm::mat4& in_model_view, glm::vec2 in_viewport);
 
 		void clear();
 
@@ -70,13 +95,50 @@ namespace framework
 			MAX
 		};
 
-		static model* load(const std::string& filename, file_type f_type);
+		// in_sort_vertices reorders the vertices of the meshes for locality, see graphics::mesh::sortVertices
+		static model* load(const std::string& filename, file_type f_type, bool in_sort_vertices = false);
 		static void release(model* in_model);
 
-		bool initialise();
+		// the largest levels the textures of in_sampler skip when the models are
+		// initialised, -1 leaves them to graphics::texture::setQuality.
+		static void setTextureQuality(graphics::material::sampler in_sampler, int32_t in_skipped_levels);
+
+		// in_stream_textures only loads the smallest levels of the textures, see graphics::texture::stream.
+		// in_compress_textures block compresses the uncompressed ones for the sampler they are bound to.
+		bool initialise(bool in_stream_textures = false, bool in_compress_textures = false);
+
+		// the clothes and rigid bodies of the meshes alone, without a context: initialise
+		// calls it, a model initialised this way simulates on the CPU but can't render.
+		bool initialiseSimulation();
 		void update(glm::vec4 position, glm::quat rotation);
-		void simulate(float delta_time);
-		void render(glm::mat4 projection, glm::mat4 view, glm::vec4 light);
+
+		// step the clothes simulated on in_device, CPU ones can step on another
+		// thread than the one rendering, GPU ones need the rendering context.
+		void simulate(float in_step, compute::cloth::device in_device);
+
+		// copy the CPU clothes to their meshes, in_blend between their last two steps
+		void present(float in_blend);
+
+		// move the clothes of the model to in_device, false if any of them can't
+		bool setClothDevice(compute::cloth::device in_device);
+
+		// compare the CPU and GPU simulations of the clothes over in_frames frames
+		bool verifyClothes(uint32_t in_frames);
+
+		// record the inputs of the simulation from now on as model in_index, nullptr stops
+		void setRecorder(recorder* in_recorder, uint32_t in_index);
+
+		// hash of the CPU state of the clothes simulated on in_device, 0 on the
+		// GPU: its clothes are in the mesh buffers and aren't read back.
+		uint64_t checksum(compute::cloth::device in_device) const;
+
+		// closest triangle of the rigid meshes along a world space ray
+		bool raycast(const glm::vec3& in_origin, const glm::vec3& in_direction, size_t& out_mesh, compute::bvh::hit& out_hit) const;
+		// in_viewport in pixels, the textures are requested at the level the meshes need
+		void render(glm::mat4 projection, glm::mat4 view, glm::vec4 light, glm::vec2 in_viewport);
+
+		// light the materials with in_environment too, nullptr leaves them with the light only
+		void setEnvironment(graphics::ibl* in_environment);
 
 		void setRenderMode(render_mode in_rm, bool in_enable);
 
@@ -0,0 +1,270 @@
+#include "recorder.hpp"
+#include "model.hpp"
+#include "logging.hpp"
+#include "format.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cstring>
+
+namespace
+{
+	const char s_magic[4] = { 'G', 'S', 'I', 'M' };
+	const uint32_t s_version = 1;
+
+	// header flags
+	const uint32_t s_checksums = 1;
+
+	// divergences logged one by one, the rest are only counted
+	const uint64_t s_max_logged_divergences = 8;
+
+	template<typename T>
+	inline bool read(std::ifstream& in_stream, T& out_value)
+	{
+		return static_cast<bool>(in_stream.read(reinterpret_cast<char*>(&out_value), sizeof(T)));
+	}
+}
+
+namespace framework
+{
+	recorder::recorder()
+		: m_Checksums(false)
+	{
+	}
+
+	recorder::~recorder()
+	{
+		close();
+	}
+
+	bool recorder::open(const std::string& in_file, uint32_t in_model_count, bool in_checksums)
+	{
+		close();
+
+		m_Stream.open(in_file, std::ios::binary | std::ios::trunc);
+		if (!m_Stream)
+		{
+			LOG(ERROR) << fmt::format("recorder: can't write {}", in_file);
+			return false;
+		}
+
+		m_Checksums = in_checksums;
+
+		m_Stream.write(s_magic, sizeof(s_magic));
+		write(s_version);
+		write(in_model_count);
+		write(m_Checksums ? s_checksums : 0u);
+
+		LOG(INFO) << fmt::format("recorder: recording {} models to {}{}", in_model_count, in_file, m_Checksums ? " with checksums" : "");
+		return true;
+	}
+
+	void recorder::close()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (m_Stream.is_open())
+			m_Stream.close();
+	}
+
+	void recorder::step(uint32_t in_model, compute::cloth::device in_device, float in_step, uint64_t in_checksum)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (!m_Stream.is_open())
+			return;
+
+		write(event::STEP);
+		write(in_model);
+		write(in_device);
+		write(in_step);
+		if (m_Checksums)
+			write(in_checksum);
+	}
+
+	void recorder::transform(uint32_t in_model, const glm::vec4& in_position, const glm::quat& in_rotation)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (!m_Stream.is_open())
+			return;
+
+		write(event::TRANSFORM);
+		write(in_model);
+		write(in_position);
+		write(in_rotation);
+	}
+
+	void recorder::device(uint32_t in_model, compute::cloth::device in_device)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (!m_Stream.is_open())
+			return;
+
+		write(event::DEVICE);
+		write(in_model);
+		write(in_device);
+	}
+
+	void recorder::verify(uint32_t in_model, uint32_t in_frames)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (!m_Stream.is_open())
+			return;
+
+		write(event::VERIFY);
+		write(in_model);
+		write(in_frames);
+	}
+
+	bool recorder::replay(const std::string& in_file, const std::vector<model*>& in_models, const std::string& in_times_file, report& out_report)
+	{
+		out_report = report();
+		out_report.p_MinTime = DBL_MAX;
+
+		std::ifstream stream(in_file, std::ios::binary);
+		if (!stream)
+		{
+			LOG(ERROR) << fmt::format("replay: can't read {}", in_file);
+			return false;
+		}
+
+		char magic[sizeof(s_magic)];
+		uint32_t version = 0, model_count = 0, flags = 0;
+
+		if (!stream.read(magic, sizeof(magic)) || std::memcmp(magic, s_magic, sizeof(magic)) != 0
+			|| !read(stream, version) || !read(stream, model_count) || !read(stream, flags) || version != s_version)
+		{
+			LOG(ERROR) << fmt::format("replay: {} isn't a recording of version {}", in_file, s_version);
+			return false;
+		}
+
+		if (model_count != in_models.size())
+		{
+			LOG(ERROR) << fmt::format("replay: {} records {} models, {} are loaded", in_file, model_count, in_models.size());
+			return false;
+		}
+
+		std::ofstream times;
+		if (!in_times_file.empty())
+		{
+			times.open(in_times_file, std::ios::trunc);
+			if (times)
+				times << "step;model;device;milliseconds;match\n";
+			else
+				LOG(WARNING) << fmt::format("replay: can't write {}", in_times_file);
+		}
+
+		const bool checksums = (flags & s_checksums) != 0;
+
+		// the events were recorded in this order, they are run in it: steps on
+		// different threads were on different clothes and don't depend on each other.
+		event type;
+		while (read(stream, type))
+		{
+			uint32_t m = 0;
+			if (!read(stream, m) || m >= in_models.size() || type >= event::MAX)
+			{
+				LOG(ERROR) << fmt::format("replay: {} is corrupted after {} steps", in_file, out_report.p_Steps);
+				return false;
+			}
+
+			model* target = in_models[m];
+			bool valid = true;
+
+			switch (type)
+			{
+			case event::STEP:
+			{
+				compute::cloth::device device;
+				float step = 0.f;
+				uint64_t checksum = 0;
+
+				valid = read(stream, device) && read(stream, step) && (!checksums || read(stream, checksum));
+				if (!valid)
+					break;
+
+				const auto start = std::chrono::high_resolution_clock::now();
+				target->simulate(step, device);
+				const double time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+				out_report.p_TotalTime += time;
+				out_report.p_MinTime = std::min(out_report.p_MinTime, time);
+				out_report.p_MaxTime = std::max(out_report.p_MaxTime, time);
+
+				const bool match = !checksums || target->checksum(device) == checksum;
+				if (!match)
+				{
+					if (out_report.p_Divergences == 0)
+						out_report.p_FirstDivergence = out_report.p_Steps;
+
+					if (out_report.p_Divergences < s_max_logged_divergences)
+						LOG(ERROR) << fmt::format("replay: step {} of model {} diverges from the recording", out_report.p_Steps, m);
+
+					++out_report.p_Divergences;
+				}
+
+				if (times.is_open())
+					times << fmt::format("{};{};{};{:.4f};{}\n", out_report.p_Steps, m, enum_to_t(device), time * 1000.0, match ? 1 : 0);
+
+				++out_report.p_Steps;
+				break;
+			}
+
+			case event::TRANSFORM:
+			{
+				glm::vec4 position;
+				glm::quat rotation;
+
+				valid = read(stream, position) && read(stream, rotation);
+				if (valid)
+					target->update(position, rotation);
+				break;
+			}
+
+			case event::DEVICE:
+			{
+				compute::cloth::device device;
+
+				// without a context the clothes can't move to the GPU, their steps there are
+				// left out and the CPU state diverges from the recorded one once they come back.
+				valid = read(stream, device);
+				if (valid && !target->setClothDevice(device))
+					LOG(WARNING) << fmt::format("replay: model {} can't simulate on the GPU, its steps there are skipped", m);
+				break;
+			}
+
+			case event::VERIFY:
+			{
+				uint32_t frames = 0;
+
+				valid = read(stream, frames);
+				if (valid)
+					target->verifyClothes(frames);
+				break;
+			}
+
+			default:
+				valid = false;
+				break;
+			}
+
+			if (!valid)
+			{
+				LOG(ERROR) << fmt::format("replay: {} is truncated after {} steps", in_file, out_report.p_Steps);
+				return false;
+			}
+		}
+
+		if (out_report.p_Steps == 0)
+			out_report.p_MinTime = 0.0;
+
+		LOG(INFO) << fmt::format("replay: {} steps in {:.3f} ms, {:.4f} ms per step ({:.4f} - {:.4f}), {}",
+			out_report.p_Steps, out_report.p_TotalTime * 1000.0,
+			out_report.p_Steps ? out_report.p_TotalTime * 1000.0 / out_report.p_Steps : 0.0,
+			out_report.p_MinTime * 1000.0, out_report.p_MaxTime * 1000.0,
+			!checksums ? "no checksums to compare" : out_report.p_Divergences == 0 ? "no divergence"
+				: fmt::format("{} divergent steps from step {}", out_report.p_Divergences, out_report.p_FirstDivergence));
+
+		return out_report.p_Divergences == 0;
+	}
+}
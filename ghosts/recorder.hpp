@@ -0,0 +1,79 @@
+#pragma once
+
+#include "cloth.hpp"
+#include "transform.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace framework
+{
+	class model;
+
+	// binary stream of what drives the simulation of the models: their steps,
+	// transforms and cloth device changes, in the order the models received them.
+	// steps may carry a checksum of the CPU cloth state they reached, replaying
+	// the stream on the same models loaded afresh has to reach it bit for bit.
+	class recorder
+	{
+
+	public:
+
+		enum class event : uint8_t
+		{
+			STEP,		// model, device, step [, checksum]
+			TRANSFORM,	// model, position, rotation
+			DEVICE,		// model, device
+			VERIFY,		// model, frames
+			MAX
+		};
+
+		struct report
+		{
+			uint64_t	p_Steps;
+			uint64_t	p_Divergences;		// steps whose checksum differs from the recorded one
+			uint64_t	p_FirstDivergence;	// index of the first one, valid if there are any
+			double		p_TotalTime;		// seconds spent in the steps
+			double		p_MinTime;
+			double		p_MaxTime;
+		};
+
+	private:
+
+		std::ofstream	m_Stream;
+		std::mutex		m_Mutex;	// CPU steps are recorded from the scheduler thread
+		bool			m_Checksums;
+
+		template<typename T>
+		inline void write(const T& in_value)
+		{
+			m_Stream.write(reinterpret_cast<const char*>(&in_value), sizeof(T));
+		}
+
+	public:
+
+		recorder();
+		~recorder();
+
+		// in_model_count is checked against the models the stream is replayed on
+		bool open(const std::string& in_file, uint32_t in_model_count, bool in_checksums);
+		void close();
+
+		inline bool isOpen() const { return m_Stream.is_open(); }
+		inline bool hasChecksums() const { return m_Checksums; }
+
+		// in_checksum is only written if the recording has checksums
+		void step(uint32_t in_model, compute::cloth::device in_device, float in_step, uint64_t in_checksum);
+		void transform(uint32_t in_model, const glm::vec4& in_position, const glm::quat& in_rotation);
+		void device(uint32_t in_model, compute::cloth::device in_device);
+		void verify(uint32_t in_model, uint32_t in_frames);
+
+		// run the events of in_file on in_models, on this thread and without rendering,
+		// the models only need their simulation initialised, see model::initialiseSimulation.
+		// the time of every step goes to in_times_file as csv, if not empty.
+		static bool replay(const std::string& in_file, const std::vector<model*>& in_models, const std::string& in_times_file, report& out_report);
+	};
+}
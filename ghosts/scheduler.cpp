@@ -0,0 +1,126 @@
+#include "scheduler.hpp"
+#include "logging.hpp"
+#include "format.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace compute
+{
+	scheduler::scheduler()
+		: m_Step(0.f)
+		, m_MaxBacklog(0)
+		, m_Accumulator(0.f)
+		, m_Requested(0)
+		, m_Completed(0)
+		, m_Stop(false)
+	{
+	}
+
+	scheduler::~scheduler()
+	{
+		stop();
+	}
+
+	bool scheduler::start(float in_step, uint32_t in_max_backlog, std::function<void(float)> in_task)
+	{
+		if (isRunning() || in_step <= 0.f || !in_task)
+			return false;
+
+		m_Task = std::move(in_task);
+		m_Step = in_step;
+		m_MaxBacklog = std::max(in_max_backlog, 1u);
+		m_Accumulator = 0.f;
+		m_Requested = 0;
+		m_Completed = 0;
+		m_Stop = false;
+
+		m_Thread = std::thread([this] { run(); });
+
+		LOG(INFO) << fmt::format("scheduler: {:.1f} steps per second, up to {} behind", 1.f / m_Step, m_MaxBacklog);
+		return true;
+	}
+
+	void scheduler::stop()
+	{
+		if (!isRunning())
+			return;
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Stop = true;
+		}
+		m_Queued.notify_one();
+
+		m_Thread.join();
+		m_Task = nullptr;
+	}
+
+	void scheduler::run()
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		for (;;)
+		{
+			m_Queued.wait(lock, [this] { return m_Stop || m_Completed < m_Requested; });
+			if (m_Stop)
+				break;
+
+			lock.unlock();
+			m_Task(m_Step);
+			lock.lock();
+
+			++m_Completed;
+			if (m_Completed == m_Requested)
+				m_Idle.notify_all();
+		}
+
+		m_Idle.notify_all();
+	}
+
+	uint32_t scheduler::advance(float in_frame_time)
+	{
+		if (!isRunning())
+			return 0;
+
+		uint32_t due = 0;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+
+			m_Accumulator += std::max(in_frame_time, 0.f);
+			due = static_cast<uint32_t>(std::floor(m_Accumulator / m_Step));
+			m_Accumulator -= due * m_Step;
+
+			// steps that don't fit in the backlog are dropped, their time is already taken
+			// out of the accumulator and lowering due discards it: the simulation slows down
+			const uint32_t backlog = static_cast<uint32_t>(m_Requested - m_Completed);
+			const uint32_t room = m_MaxBacklog > backlog ? m_MaxBacklog - backlog : 0;
+			if (due > room)
+				due = room;
+
+			m_Requested += due;
+		}
+
+		if (due > 0)
+			m_Queued.notify_one();
+
+		return due;
+	}
+
+	void scheduler::wait()
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_Idle.wait(lock, [this] { return m_Stop || m_Completed == m_Requested; });
+	}
+
+	float scheduler::getBlend()
+	{
+		if (!isRunning())
+			return 1.f;
+
+		// the frame is one step behind the queued steps, in between the two
+		// completed last if the simulation keeps up, at the last one if not.
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		const float blend = static_cast<float>(m_Requested - m_Completed) + m_Accumulator / m_Step;
+		return std::min(std::max(blend, 0.f), 1.f);
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace compute
+{
+	// runs a simulation at a fixed rate on its own thread, decoupled from the
+	// frame rate: every frame queues the steps due since the last one and the
+	// renderer blends the last two completed steps. the simulation runs the
+	// same steps whatever the frame rate, when it falls behind by more than
+	// the backlog time is dropped and it slows down instead of spiralling.
+	class scheduler
+	{
+		std::thread				m_Thread;
+		std::mutex				m_Mutex;
+		std::condition_variable	m_Queued;
+		std::condition_variable	m_Idle;
+
+		std::function<void(float)> m_Task;
+
+		float		m_Step;
+		uint32_t	m_MaxBacklog;
+		float		m_Accumulator;	// frame time not simulated yet, less than a step
+		uint64_t	m_Requested;	// steps queued since started
+		uint64_t	m_Completed;	// steps done since started
+		bool		m_Stop;
+
+		void run();
+
+	public:
+
+		scheduler();
+		~scheduler();
+
+		// call in_task with in_step every step, at most in_max_backlog steps behind
+		bool start(float in_step, uint32_t in_max_backlog, std::function<void(float)> in_task);
+		void stop();
+
+		// queue the steps due after in_frame_time more seconds, returns their count
+		uint32_t advance(float in_frame_time);
+
+		// wait for the queued steps, the simulation can be changed until the next advance
+		void wait();
+
+		// where the frame is between the last two completed steps, one step late
+		float getBlend();
+
+		inline float getStep() const { return m_Step; }
+		inline bool isRunning() const { return m_Thread.joinable(); }
+	};
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+
+#if GLM_ARCH & GLM_ARCH_SSE2
+#	include <emmintrin.h>
+#endif
+
+namespace math
+{
+	// four floats processed in lock-step, the scalar
+	// fall-back is used when SSE2 is not available.
+	struct float4
+	{
+#if GLM_ARCH & GLM_ARCH_SSE2
+		__m128 p_Value;
+
+		float4() {}
+		explicit float4(__m128 in_value) : p_Value(in_value) {}
+		explicit float4(float in_scalar) : p_Value(_mm_set1_ps(in_scalar)) {}
+		float4(float x, float y, float z, float w) : p_Value(_mm_setr_ps(x, y, z, w)) {}
+
+		static inline float4 load(const float* in_data) { return float4(_mm_loadu_ps(in_data)); }
+		inline void store(float* out_data) const { _mm_storeu_ps(out_data, p_Value); }
+
+		inline float lane(uint32_t i) const { float values[4]; store(values); return values[i]; }
+#else
+		float p_Value[4];
+
+		float4() {}
+		explicit float4(float in_scalar) : p_Value{ in_scalar, in_scalar, in_scalar, in_scalar } {}
+		float4(float x, float y, float z, float w) : p_Value{ x, y, z, w } {}
+
+		static inline float4 load(const float* in_data) { return float4(in_data[0], in_data[1], in_data[2], in_data[3]); }
+		inline void store(float* out_data) const { for (int i = 0; i < 4; ++i) out_data[i] = p_Value[i]; }
+
+		inline float lane(uint32_t i) const { return p_Value[i]; }
+#endif
+
+		// load the four elements addressed by in_indices
+		static inline float4 gather(const float* in_data, const uint32_t* in_indices)
+		{
+			return float4(in_data[in_indices[0]], in_data[in_indices[1]], in_data[in_indices[2]], in_data[in_indices[3]]);
+		}
+
+		// store the first in_lanes lanes to the elements addressed by in_indices,
+		// lanes sharing the same index are written in order.
+		inline void scatter(float* out_data, const uint32_t* in_indices, uint32_t in_lanes = 4) const
+		{
+			float values[4];
+			store(values);
+			for (uint32_t i = 0; i < in_lanes; ++i)
+				out_data[in_indices[i]] = values[i];
+		}
+	};
+
+#if GLM_ARCH & GLM_ARCH_SSE2
+	inline float4 operator+(float4 a, float4 b) { return float4(_mm_add_ps(a.p_Value, b.p_Value)); }
+	inline float4 operator-(float4 a, float4 b) { return float4(_mm_sub_ps(a.p_Value, b.p_Value)); }
+	inline float4 operator*(float4 a, float4 b) { return float4(_mm_mul_ps(a.p_Value, b.p_Value)); }
+	inline float4 operator/(float4 a, float4 b) { return float4(_mm_div_ps(a.p_Value, b.p_Value)); }
+	inline float4 operator-(float4 a) { return float4(_mm_sub_ps(_mm_setzero_ps(), a.p_Value)); }
+
+	inline float4 min(float4 a, float4 b) { return float4(_mm_min_ps(a.p_Value, b.p_Value)); }
+	inline float4 max(float4 a, float4 b) { return float4(_mm_max_ps(a.p_Value, b.p_Value)); }
+	inline float4 sqrt(float4 a) { return float4(_mm_sqrt_ps(a.p_Value)); }
+
+	// comparisons return a mask, all bits set in the lanes where the comparison holds
+	inline float4 greater(float4 a, float4 b) { return float4(_mm_cmpgt_ps(a.p_Value, b.p_Value)); }
+	inline float4 less(float4 a, float4 b) { return float4(_mm_cmplt_ps(a.p_Value, b.p_Value)); }
+
+	// a where the mask is set, b elsewhere
+	inline float4 select(float4 mask, float4 a, float4 b)
+	{
+		return float4(_mm_or_ps(_mm_and_ps(mask.p_Value, a.p_Value), _mm_andnot_ps(mask.p_Value, b.p_Value)));
+	}
+
+	inline bool any(float4 mask) { return _mm_movemask_ps(mask.p_Value) != 0; }
+
+	// bit i set where lane i of the mask is
+	inline uint32_t bits(float4 mask) { return static_cast<uint32_t>(_mm_movemask_ps(mask.p_Value)); }
+#else
+	namespace detail
+	{
+		template<typename F>
+		inline float4 apply(float4 a, float4 b, F f)
+		{
+			return float4(f(a.p_Value[0], b.p_Value[0]), f(a.p_Value[1], b.p_Value[1]), f(a.p_Value[2], b.p_Value[2]), f(a.p_Value[3], b.p_Value[3]));
+		}
+
+		inline float mask(bool in_value) { uint32_t bits = in_value ? ~0u : 0u; float result; memcpy(&result, &bits, 4); return result; }
+		inline bool is_set(float in_value) { uint32_t bits; memcpy(&bits, &in_value, 4); return bits != 0; }
+	}
+
+	inline float4 operator+(float4 a, float4 b) { return detail::apply(a, b, [](float x, float y) { return x + y; }); }
+	inline float4 operator-(float4 a, float4 b) { return detail::apply(a, b, [](float x, float y) { return x - y; }); }
+	inline float4 operator*(float4 a, float4 b) { return detail::apply(a, b, [](float x, float y) { return x * y; }); }
+	inline float4 operator/(float4 a, float4 b) { return detail::apply(a, b, [](float x, float y) { return x / y; }); }
+	inline float4 operator-(float4 a) { return float4(0.f) - a; }
+
+	inline float4 min(float4 a, float4 b) { return detail::apply(a, b, [](float x, float y) { return x < y ? x : y; }); }
+	inline float4 max(float4 a, float4 b) { return detail::apply(a, b, [](float x, float y) { return x > y ? x : y; }); }
+	inline float4 sqrt(float4 a) { return detail::apply(a, a, [](float x, float) { return std::sqrt(x); }); }
+
+	inline float4 greater(float4 a, float4 b) { return detail::apply(a, b, [](float x, float y) { return detail::mask(x > y); }); }
+	inline float4 less(float4 a, float4 b) { return detail::apply(a, b, [](float x, float y) { return detail::mask(x < y); }); }
+
+	inline float4 select(float4 mask, float4 a, float4 b)
+	{
+		return float4(
+			detail::is_set(mask.p_Value[0]) ? a.p_Value[0] : b.p_Value[0],
+			detail::is_set(mask.p_Value[1]) ? a.p_Value[1] : b.p_Value[1],
+			detail::is_set(mask.p_Value[2]) ? a.p_Value[2] : b.p_Value[2],
+			detail::is_set(mask.p_Value[3]) ? a.p_Value[3] : b.p_Value[3]);
+	}
+
+	inline bool any(float4 mask)
+	{
+		return detail::is_set(mask.p_Value[0]) || detail::is_set(mask.p_Value[1]) || detail::is_set(mask.p_Value[2]) || detail::is_set(mask.p_Value[3]);
+	}
+
+	inline uint32_t bits(float4 mask)
+	{
+		return (detail::is_set(mask.p_Value[0]) ? 1u : 0u) | (detail::is_set(mask.p_Value[1]) ? 2u : 0u) | (detail::is_set(mask.p_Value[2]) ? 4u : 0u) | (detail::is_set(mask.p_Value[3]) ? 8u : 0u);
+	}
+#endif
+
+	inline float4& operator+=(float4& a, float4 b) { return a = a + b; }
+	inline float4& operator-=(float4& a, float4 b) { return a = a - b; }
+	inline float4& operator*=(float4& a, float4 b) { return a = a * b; }
+}
@@ -0,0 +1,167 @@
+#include "spatial_hash.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+
+namespace
+{
+	// points counted by a task, fewer points are hashed on the calling thread
+	const size_t s_points_per_chunk = 2048;
+
+	// bits of the table entry sorted by every radix pass
+	const uint32_t s_radix_bits = 11;
+	const uint32_t s_radix_size = 1u << s_radix_bits;
+}
+
+namespace compute
+{
+	spatial_hash::spatial_hash()
+		: m_Spacing(1.f)
+		, m_Mask(0)
+		, m_PassCount(0)
+		, m_ChunkCount(0)
+		, m_Count(0)
+	{
+	}
+
+	void spatial_hash::create(size_t in_max_count, float in_spacing)
+	{
+		m_Spacing = in_spacing > 0.f ? in_spacing : 1.f;
+
+		// about four entries per point keeps the collisions between cells rare
+		size_t table_size = 1;
+		uint32_t table_bits = 0;
+		while (table_size < 4 * in_max_count)
+		{
+			table_size *= 2;
+			++table_bits;
+		}
+		m_Mask = static_cast<uint32_t>(table_size - 1);
+		m_PassCount = std::max<uint32_t>(1, (table_bits + s_radix_bits - 1) / s_radix_bits);
+
+		// no more chunks than digits fit in the points, so the histograms of a
+		// pass stay about as large as the points.
+		m_ChunkCount = std::max<size_t>(1, std::min(parallel::concurrency(), (in_max_count + s_points_per_chunk - 1) / s_points_per_chunk));
+		m_Count = 0;
+
+		m_CellBegin.assign(table_size, 0);
+		m_CellEnd.assign(table_size, 0);
+		m_Keys.assign(in_max_count, 0);
+		m_Sorted.assign(in_max_count, 0);
+		m_KeysScratch.assign(in_max_count, 0);
+		m_SortedScratch.assign(in_max_count, 0);
+		m_ChunkCounts.assign(m_ChunkCount * s_radix_size, 0);
+	}
+
+	void spatial_hash::destroy()
+	{
+		m_Mask = 0;
+		m_PassCount = 0;
+		m_ChunkCount = 0;
+		m_Count = 0;
+
+		m_CellBegin.clear();
+		m_CellEnd.clear();
+		m_Keys.clear();
+		m_Sorted.clear();
+		m_KeysScratch.clear();
+		m_SortedScratch.clear();
+		m_ChunkCounts.clear();
+	}
+
+	void spatial_hash::build(const float* in_x, const float* in_y, const float* in_z, size_t in_count)
+	{
+		if (m_CellBegin.empty())
+			return;
+
+		in_count = std::min(in_count, m_Sorted.size());
+
+		// empty the entries the last build filled, the sorted keys still name
+		// them and the first point of a run is the only one writing its entry.
+		const size_t previous_count = m_Count;
+		parallel::for_range(0, previous_count, s_points_per_chunk, [&](size_t in_begin, size_t in_end)
+		{
+			for (size_t i = in_begin; i < in_end; ++i)
+			{
+				const uint32_t entry = m_Keys[i];
+				if (i == 0 || m_Keys[i - 1] != entry)
+					m_CellBegin[entry] = m_CellEnd[entry] = 0;
+			}
+		});
+
+		m_Count = in_count;
+		if (in_count == 0)
+			return;
+
+		parallel::for_range(0, in_count, s_points_per_chunk, [&](size_t in_begin, size_t in_end)
+		{
+			for (size_t p = in_begin; p < in_end; ++p)
+			{
+				m_Keys[p] = hash(cell(in_x[p]), cell(in_y[p]), cell(in_z[p]));
+				m_Sorted[p] = static_cast<uint32_t>(p);
+			}
+		});
+
+		// least significant digit first, every pass is stable so the points of
+		// an entry end up in point order.
+		const size_t chunk_size = (in_count + m_ChunkCount - 1) / m_ChunkCount;
+
+		for (uint32_t pass = 0; pass < m_PassCount; ++pass)
+		{
+			const uint32_t shift = pass * s_radix_bits;
+
+			parallel::for_range(0, m_ChunkCount, 1, [&](size_t in_begin, size_t in_end)
+			{
+				for (size_t c = in_begin; c < in_end; ++c)
+				{
+					uint32_t* counts = &m_ChunkCounts[c * s_radix_size];
+					std::fill(counts, counts + s_radix_size, 0u);
+
+					for (size_t p = c * chunk_size, end = std::min(in_count, p + chunk_size); p < end; ++p)
+						++counts[(m_Keys[p] >> shift) & (s_radix_size - 1)];
+				}
+			});
+
+			// the histograms become the offsets of every chunk inside a digit
+			uint32_t start = 0;
+			for (uint32_t d = 0; d < s_radix_size; ++d)
+				for (size_t c = 0; c < m_ChunkCount; ++c)
+				{
+					const uint32_t count = m_ChunkCounts[c * s_radix_size + d];
+					m_ChunkCounts[c * s_radix_size + d] = start;
+					start += count;
+				}
+
+			parallel::for_range(0, m_ChunkCount, 1, [&](size_t in_begin, size_t in_end)
+			{
+				for (size_t c = in_begin; c < in_end; ++c)
+				{
+					uint32_t* offsets = &m_ChunkCounts[c * s_radix_size];
+
+					for (size_t p = c * chunk_size, end = std::min(in_count, p + chunk_size); p < end; ++p)
+					{
+						const uint32_t slot = offsets[(m_Keys[p] >> shift) & (s_radix_size - 1)]++;
+						m_KeysScratch[slot] = m_Keys[p];
+						m_SortedScratch[slot] = m_Sorted[p];
+					}
+				}
+			});
+
+			m_Keys.swap(m_KeysScratch);
+			m_Sorted.swap(m_SortedScratch);
+		}
+
+		// the runs of equal keys are the ranges of the occupied entries
+		parallel::for_range(0, in_count, s_points_per_chunk, [&](size_t in_begin, size_t in_end)
+		{
+			for (size_t i = in_begin; i < in_end; ++i)
+			{
+				const uint32_t entry = m_Keys[i];
+				if (i == 0 || m_Keys[i - 1] != entry)
+					m_CellBegin[entry] = static_cast<uint32_t>(i);
+				if (i + 1 == in_count || m_Keys[i + 1] != entry)
+					m_CellEnd[entry] = static_cast<uint32_t>(i + 1);
+			}
+		});
+	}
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#define GLM_STATIC_CONST_MEMBERS
+#include <glm/vec3.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace compute
+{
+	// uniform grid of points hashed into a fixed size table, rebuilt
+	// from scratch with a radix sort of the (entry, point) pairs: the points
+	// of a cell are stored contiguously and the runs of equal entries give
+	// the range of every occupied cell. the work scales with the points,
+	// the table is only touched where points land, and building the grid
+	// allocates nothing once created.
+	class spatial_hash
+	{
+		float		m_Spacing;
+		uint32_t	m_Mask;			// table size minus one, the size is a power of two
+		uint32_t	m_PassCount;	// radix passes covering the bits of the mask
+		size_t		m_ChunkCount;	// points are counted in this many chunks in parallel
+		size_t		m_Count;		// points sorted by the last build
+
+		std::vector<uint32_t>	m_CellBegin;	// first sorted point of every table entry
+		std::vector<uint32_t>	m_CellEnd;		// one past the last sorted point, equal to the begin when empty
+		std::vector<uint32_t>	m_Keys;			// table entry of every sorted point
+		std::vector<uint32_t>	m_Sorted;		// point indices sorted by table entry
+		std::vector<uint32_t>	m_KeysScratch;	// the other half of the radix passes
+		std::vector<uint32_t>	m_SortedScratch;
+		std::vector<uint32_t>	m_ChunkCounts;	// per chunk histograms of a radix digit
+
+		inline int32_t cell(float in_coordinate) const
+		{
+			return static_cast<int32_t>(std::floor(in_coordinate / m_Spacing));
+		}
+
+		inline uint32_t hash(int32_t x, int32_t y, int32_t z) const
+		{
+			return ((static_cast<uint32_t>(x) * 92837111u) ^ (static_cast<uint32_t>(y) * 689287499u) ^ (static_cast<uint32_t>(z) * 283923481u)) & m_Mask;
+		}
+
+	public:
+
+		spatial_hash();
+
+		// in_spacing is the cell size: queries up to half of it visit 8 cells,
+		// up to the whole of it 27, which is the largest distance allowed.
+		void create(size_t in_max_count, float in_spacing);
+		void destroy();
+
+		// sort the first in_count points into the grid
+		void build(const float* in_x, const float* in_y, const float* in_z, size_t in_count);
+
+		// call in_function with the index of every point in the cells overlapping
+		// the box of half size in_distance around in_position. points further than
+		// in_distance are reported as well, each point is reported once as long
+		// as in_distance doesn't exceed the spacing.
+		template<typename F>
+		void query(const glm::vec3& in_position, float in_distance, F in_function) const;
+
+		inline float getSpacing() const { return m_Spacing; }
+	};
+
+	template<typename F>
+	void spatial_hash::query(const glm::vec3& in_position, float in_distance, F in_function) const
+	{
+		if (m_CellBegin.empty())
+			return;
+
+		const int32_t x0 = cell(in_position.x - in_distance), x1 = cell(in_position.x + in_distance);
+		const int32_t y0 = cell(in_position.y - in_distance), y1 = cell(in_position.y + in_distance);
+		const int32_t z0 = cell(in_position.z - in_distance), z1 = cell(in_position.z + in_distance);
+
+		// distinct cells may share a table entry, visit each entry once. only the
+		// entries with points are remembered, and a bit per entry modulo 64 spares
+		// searching them unless two entries may be the same.
+		const size_t max_entries = 27;
+		uint32_t entries[max_entries];
+		size_t entry_count = 0;
+		uint64_t seen = 0;
+
+		for (int32_t z = z0; z <= z1; ++z)
+			for (int32_t y = y0; y <= y1; ++y)
+				for (int32_t x = x0; x <= x1; ++x)
+				{
+					const uint32_t entry = hash(x, y, z);
+					const uint32_t begin = m_CellBegin[entry];
+					const uint32_t end = m_CellEnd[entry];
+
+					if (begin == end)
+						continue;
+
+					const uint64_t bit = uint64_t(1) << (entry & 63);
+					if (seen & bit)
+					{
+						bool visited = false;
+						for (size_t e = 0; e < entry_count && !visited; ++e)
+							visited = entries[e] == entry;
+
+						if (visited)
+							continue;
+					}
+
+					seen |= bit;
+					if (entry_count < max_entries)
+						entries[entry_count++] = entry;
+
+					for (uint32_t i = begin; i < end; ++i)
+						in_function(m_Sorted[i]);
+				}
+	}
+}
@@ -1,120 +1,534 @@
 #include "texture.hpp"
 #include "ogl.hpp"
+#include "parallel.hpp"
+#include "logging.hpp"
+#include "format.hpp"
+#include "util.hpp"
 
 #include <glm/vec3.hpp>
 #include <gli/gli.hpp>
+#include <gli/compress.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include <vector>
 
 namespace
 {
-	gl::uint32 build(char const* Filename)
+	void allocate(gli::target TextureTarget, gl::enumerator Target, gli::gl::format const & Format,
+		glm::tvec3<gl::sizei> const & Dimensions, std::size_t Layers, std::size_t Faces, std::size_t Levels)
 	{
-		gli::texture Texture(gli::load(Filename));
-		if (Texture.empty())
-			return 0;
-
-		gli::gl GL;
-		gli::gl::format const Format = GL.translate(Texture.format());
-		gli::gl::swizzles const Swizzles = GL.translate(Texture.swizzles());
-		gl::enumerator Target = GL.translate(Texture.target());
-
-		gl::uint32 TextureName = 0;
-		glGenTextures(1, &TextureName);
-		glBindTexture(Target, TextureName);
-		glTexParameteri(Target, GL_TEXTURE_BASE_LEVEL, 0);
-		glTexParameteri(Target, GL_TEXTURE_MAX_LEVEL, static_cast<gl::int32>(Texture.levels() - 1));
-		glTexParameteri(Target, GL_TEXTURE_SWIZZLE_R, Swizzles[0]);
-		glTexParameteri(Target, GL_TEXTURE_SWIZZLE_G, Swizzles[1]);
-		glTexParameteri(Target, GL_TEXTURE_SWIZZLE_B, Swizzles[2]);
-		glTexParameteri(Target, GL_TEXTURE_SWIZZLE_A, Swizzles[3]);
-
-		glm::tvec3<gl::sizei> const Dimensions(Texture.dimensions());
-
-		switch (Texture.target())
+		switch (TextureTarget)
 		{
 		case gli::TARGET_1D:
 			glTexStorage1D(
-				Target, static_cast<gl::int32>(Texture.levels()), Format.Internal, Dimensions.x);
+				Target, static_cast<gl::int32>(Levels), Format.Internal, Dimensions.x);
 			break;
 		case gli::TARGET_1D_ARRAY:
 		case gli::TARGET_2D:
 		case gli::TARGET_CUBE:
 			glTexStorage2D(
-				Target, static_cast<gl::int32>(Texture.levels()), Format.Internal,
-				Dimensions.x, Texture.target() == gli::TARGET_2D ? Dimensions.y : static_cast<gl::sizei>(Texture.layers() * Texture.faces()));
+				Target, static_cast<gl::int32>(Levels), Format.Internal,
+				Dimensions.x, TextureTarget == gli::TARGET_1D_ARRAY ? static_cast<gl::sizei>(Layers * Faces) : Dimensions.y);
 			break;
 		case gli::TARGET_2D_ARRAY:
 		case gli::TARGET_3D:
 		case gli::TARGET_CUBE_ARRAY:
 			glTexStorage3D(
-				Target, static_cast<gl::int32>(Texture.levels()), Format.Internal,
-				Dimensions.x, Dimensions.y, Texture.target() == gli::TARGET_3D ? Dimensions.z : static_cast<gl::sizei>(Texture.layers() * Texture.faces()));
+				Target, static_cast<gl::int32>(Levels), Format.Internal,
+				Dimensions.x, Dimensions.y, TextureTarget == gli::TARGET_3D ? Dimensions.z : static_cast<gl::sizei>(Layers * Faces));
 			break;
 		default:
 			assert(0);
 			break;
 		}
+	}
+
+	void upload(gli::target TextureTarget, gl::enumerator Target, gli::format TextureFormat, gli::gl::format const & Format,
+		std::size_t Layer, std::size_t Face, std::size_t Level, glm::tvec3<gl::sizei> const & Dimensions, std::size_t Size, void const* Data)
+	{
+		Target = gli::is_target_cube(TextureTarget) ? static_cast<gl::enumerator>(GL_TEXTURE_CUBE_MAP_POSITIVE_X + Face) : Target;
+
+		switch (TextureTarget)
+		{
+		case gli::TARGET_1D:
+			if (gli::is_compressed(TextureFormat))
+				glCompressedTexSubImage1D(
+					Target, static_cast<gl::int32>(Level), 0, Dimensions.x,
+					Format.Internal, static_cast<gl::sizei>(Size), Data);
+			else
+				glTexSubImage1D(
+					Target, static_cast<gl::int32>(Level), 0, Dimensions.x,
+					Format.External, Format.Type, Data);
+			break;
+		case gli::TARGET_1D_ARRAY:
+		case gli::TARGET_2D:
+		case gli::TARGET_CUBE:
+			if (gli::is_compressed(TextureFormat))
+				glCompressedTexSubImage2D(
+					Target, static_cast<gl::int32>(Level),
+					0, 0, Dimensions.x, TextureTarget == gli::TARGET_1D_ARRAY ? static_cast<gl::sizei>(Layer) : Dimensions.y,
+					Format.Internal, static_cast<gl::sizei>(Size), Data);
+			else
+				glTexSubImage2D(
+					Target, static_cast<gl::int32>(Level),
+					0, 0, Dimensions.x, TextureTarget == gli::TARGET_1D_ARRAY ? static_cast<gl::sizei>(Layer) : Dimensions.y,
+					Format.External, Format.Type, Data);
+			break;
+		case gli::TARGET_2D_ARRAY:
+		case gli::TARGET_3D:
+		case gli::TARGET_CUBE_ARRAY:
+			if (gli::is_compressed(TextureFormat))
+				glCompressedTexSubImage3D(
+					Target, static_cast<gl::int32>(Level),
+					0, 0, 0, Dimensions.x, Dimensions.y, TextureTarget == gli::TARGET_3D ? Dimensions.z : static_cast<gl::sizei>(Layer),
+					Format.Internal, static_cast<gl::sizei>(Size), Data);
+			else
+				glTexSubImage3D(
+					Target, static_cast<gl::int32>(Level),
+					0, 0, 0, Dimensions.x, Dimensions.y, TextureTarget == gli::TARGET_3D ? Dimensions.z : static_cast<gl::sizei>(Layer),
+					Format.External, Format.Type, Data);
+			break;
+		default: assert(0); break;
+		}
+	}
+
+	// the levels from FirstLevel only
+	gl::uint32 build(gli::texture const & Texture, std::size_t FirstLevel)
+	{
+		if (Texture.empty())
+			return 0;
+
+		FirstLevel = std::min(FirstLevel, Texture.levels() - 1);
+
+		gli::gl GL;
+		gli::gl::format const Format = GL.translate(Texture.format());
+		gli::gl::swizzles const Swizzles = GL.translate(Texture.swizzles());
+		gl::enumerator Target = GL.translate(Texture.target());
+
+		gl::uint32 TextureName = 0;
+		glGenTextures(1, &TextureName);
+		glBindTexture(Target, TextureName);
+		glTexParameteri(Target, GL_TEXTURE_BASE_LEVEL, 0);
+		glTexParameteri(Target, GL_TEXTURE_MAX_LEVEL, static_cast<gl::int32>(Texture.levels() - 1 - FirstLevel));
+		glTexParameteri(Target, GL_TEXTURE_SWIZZLE_R, Swizzles[0]);
+		glTexParameteri(Target, GL_TEXTURE_SWIZZLE_G, Swizzles[1]);
+		glTexParameteri(Target, GL_TEXTURE_SWIZZLE_B, Swizzles[2]);
+		glTexParameteri(Target, GL_TEXTURE_SWIZZLE_A, Swizzles[3]);
+
+		allocate(Texture.target(), Target, Format, glm::tvec3<gl::sizei>(Texture.dimensions(FirstLevel)), Texture.layers(), Texture.faces(), Texture.levels() - FirstLevel);
 
 		for (std::size_t Layer = 0; Layer < Texture.layers(); ++Layer)
 			for (std::size_t Face = 0; Face < Texture.faces(); ++Face)
-				for (std::size_t Level = 0; Level < Texture.levels(); ++Level)
+				for (std::size_t Level = FirstLevel; Level < Texture.levels(); ++Level)
+					upload(Texture.target(), Target, Texture.format(), Format, Layer, Face, Level - FirstLevel,
+						glm::tvec3<gl::sizei>(Texture.dimensions(Level)), Texture.size(Level), Texture.data(Layer, Face, Level));
+
+		return TextureName;
+	}
+
+	// levels up to this size per face are loaded with the texture, a 64x64 RGBA8 one
+	const size_t s_resident_level_size = 64 * 64 * 4;
+
+	// bytes read ahead of their upload, in frame budgets
+	const size_t s_read_ahead = 4;
+
+	enum class read_state : uint8_t
+	{
+		IDLE,
+		READING,
+		READY,
+		FAILED
+	};
+
+	// a DDS texture whose storage holds the levels from p_Allocated, the larger ones
+	// are still in its file. sampling is clamped to the levels from p_Resident, the
+	// next one is read on a worker until the storage is filled. the levels from
+	// p_Floor always stay, the ones before p_Finest can't be read.
+	struct resident
+	{
+		graphics::texture*			p_Texture;
+		std::string					p_File;
+		gli::dds_layout				p_Layout;
+		gli::gl::format				p_Format;
+		gli::gl::swizzles			p_Swizzles;
+		gl::enumerator				p_Target;
+		gl::uint32					p_Name;
+		size_t						p_Finest;
+		size_t						p_Floor;
+		size_t						p_Allocated;
+		size_t						p_Resident;
+		size_t						p_Wanted;	// level the last request resolves
+		size_t						p_Level;	// level the budget allows
+		uint32_t					p_Used;		// frame of the last request
+		std::vector<char>			p_Data;		// level p_DataLevel of every layer and face, once READY
+		size_t						p_DataLevel;
+		std::atomic<read_state>		p_State;
+	};
+
+	std::vector<std::shared_ptr<resident>> s_resident;
+
+	// bytes of every texture storage, the DDS ones are kept within the budget
+	size_t s_memory_budget = std::numeric_limits<size_t>::max();
+	size_t s_memory_usage = 0;
+
+	// requests are made while rendering, stream reads them the next frame
+	uint32_t s_frame = 1;
+
+	// largest levels the textures skip when created
+	uint32_t s_skipped_levels = 0;
+
+	// textures sampled below their request, logged when it changes
+	size_t s_degraded = 0;
+
+	bool s_streaming = false;
+	std::chrono::steady_clock::time_point s_stream_start;
+	size_t s_streamed_size = 0;
+
+	inline glm::tvec3<gl::sizei> level_dimensions(const gli::dds_layout& in_layout, size_t in_level)
+	{
+		return glm::tvec3<gl::sizei>(glm::max(in_layout.Dimensions >> gli::texture::texelcoord_type(static_cast<int>(in_level)), gli::texture::texelcoord_type(1)));
+	}
+
+	inline size_t levels_size(const gli::dds_layout& in_layout, size_t in_first, size_t in_last)
+	{
+		size_t size = 0;
+		for (size_t level = in_first; level <= in_last; ++level)
+			size += in_layout.level_size(level);
+		return size;
+	}
+
+	// bytes of a storage holding the levels from in_first, 0 past the smallest level
+	inline size_t storage_size(const gli::dds_layout& in_layout, size_t in_first)
+	{
+		return levels_size(in_layout, in_first, in_layout.Levels - 1) * in_layout.Layers * in_layout.Faces;
+	}
+
+	// in_level as glCopyImageSubData sees it, the layers and faces are its depth
+	inline glm::tvec3<gl::sizei> copy_extent(const gli::dds_layout& in_layout, size_t in_level)
+	{
+		glm::tvec3<gl::sizei> extent = level_dimensions(in_layout, in_level);
+		const gl::sizei layers = static_cast<gl::sizei>(in_layout.Layers * in_layout.Faces);
+
+		switch (in_layout.Target)
+		{
+		case gli::TARGET_1D: extent.y = 1; extent.z = 1; break;
+		case gli::TARGET_1D_ARRAY: extent.y = layers; extent.z = 1; break;
+		case gli::TARGET_2D: extent.z = 1; break;
+		case gli::TARGET_3D: break;
+		default: extent.z = layers; break;
+		}
+
+		return extent;
+	}
+
+	// the level whose texels are in_footprint apart, in texture coordinates
+	inline size_t footprint_level(const gli::dds_layout& in_layout, float in_footprint)
+	{
+		const float texels = in_footprint * static_cast<float>(glm::max(in_layout.Dimensions.x, in_layout.Dimensions.y));
+		return texels > 1.f ? static_cast<size_t>(std::log2(texels)) : 0;
+	}
+
+	// levels in_first to in_last follow each other in every face, one read per face
+	bool read_levels(const std::string& in_file, const gli::dds_layout& in_layout, size_t in_first, size_t in_last, std::vector<char>& out_data)
+	{
+		FILE* file = std::fopen(in_file.c_str(), "rb");
+		if (!file)
+			return false;
+
+		const size_t face_size = levels_size(in_layout, in_first, in_last);
+		out_data.resize(face_size * in_layout.Layers * in_layout.Faces);
+
+		bool valid = true;
+		char* data = out_data.data();
+		for (size_t layer = 0; layer < in_layout.Layers && valid; ++layer)
+			for (size_t face = 0; face < in_layout.Faces && valid; ++face, data += face_size)
+				valid = std::fseek(file, static_cast<long>(in_layout.offset(layer, face, in_first)), SEEK_SET) == 0
+					&& std::fread(data, 1, face_size, file) == face_size;
+
+		std::fclose(file);
+		return valid;
+	}
+
+	// in_data as read by read_levels, the texture is bound
+	void upload_levels(const resident& in_texture, size_t in_first, size_t in_last, const std::vector<char>& in_data)
+	{
+		const gli::dds_layout& layout = in_texture.p_Layout;
+
+		const char* data = in_data.data();
+		for (size_t layer = 0; layer < layout.Layers; ++layer)
+			for (size_t face = 0; face < layout.Faces; ++face)
+				for (size_t level = in_first; level <= in_last; ++level)
 				{
-					glm::tvec3<gl::sizei> Dimensions(Texture.dimensions(Level));
-					Target = gli::is_target_cube(Texture.target()) ? static_cast<gl::enumerator>(GL_TEXTURE_CUBE_MAP_POSITIVE_X + Face) : Target;
+					const size_t size = layout.level_size(level);
+					upload(layout.Target, in_texture.p_Target, layout.Format, in_texture.p_Format, layer, face,
+						level - in_texture.p_Allocated, level_dimensions(layout, level), size, data);
+					data += size;
+				}
+
+		glTexParameteri(in_texture.p_Target, GL_TEXTURE_BASE_LEVEL, static_cast<gl::int32>(in_first - in_texture.p_Allocated));
+	}
+
+	// move in_texture to a storage of the levels from in_first, the resident levels
+	// both storages hold are copied on the GPU. the texture gets a new name and is bound.
+	void reallocate(resident& in_texture, size_t in_first)
+	{
+		const gli::dds_layout& layout = in_texture.p_Layout;
+		const size_t kept = std::max(in_first, in_texture.p_Resident);
+
+		gl::uint32 name = 0;
+		glGenTextures(1, &name);
+		glBindTexture(in_texture.p_Target, name);
+		glTexParameteri(in_texture.p_Target, GL_TEXTURE_SWIZZLE_R, in_texture.p_Swizzles[0]);
+		glTexParameteri(in_texture.p_Target, GL_TEXTURE_SWIZZLE_G, in_texture.p_Swizzles[1]);
+		glTexParameteri(in_texture.p_Target, GL_TEXTURE_SWIZZLE_B, in_texture.p_Swizzles[2]);
+		glTexParameteri(in_texture.p_Target, GL_TEXTURE_SWIZZLE_A, in_texture.p_Swizzles[3]);
+
+		allocate(layout.Target, in_texture.p_Target, in_texture.p_Format, level_dimensions(layout, in_first), layout.Layers, layout.Faces, layout.Levels - in_first);
+		glTexParameteri(in_texture.p_Target, GL_TEXTURE_BASE_LEVEL, static_cast<gl::int32>(std::min(kept, layout.Levels - 1) - in_first));
+		glTexParameteri(in_texture.p_Target, GL_TEXTURE_MAX_LEVEL, static_cast<gl::int32>(layout.Levels - 1 - in_first));
+
+		for (size_t level = kept; level < layout.Levels; ++level)
+		{
+			const glm::tvec3<gl::sizei> extent = copy_extent(layout, level);
+			glCopyImageSubData(
+				in_texture.p_Name, in_texture.p_Target, static_cast<gl::int32>(level - in_texture.p_Allocated), 0, 0, 0,
+				name, in_texture.p_Target, static_cast<gl::int32>(level - in_first), 0, 0, 0,
+				extent.x, extent.y, extent.z);
+		}
+
+		if (in_texture.p_Name)
+			glDeleteTextures(1, &in_texture.p_Name);
+
+		s_memory_usage += storage_size(layout, in_first);
+		s_memory_usage -= storage_size(layout, in_texture.p_Allocated);
+
+		in_texture.p_Name = name;
+		in_texture.p_Allocated = in_first;
+		in_texture.p_Resident = kept;
+	}
+
+	// loads the levels of a DDS from its smallest ones, up to the budget, or only
+	// the smallest ones if in_streaming. the levels before in_finest are never read.
+	// nullptr if in_file isn't a DDS.
+	std::shared_ptr<resident> load_resident(graphics::texture* in_texture, const std::string& in_file, bool in_streaming, size_t in_finest)
+	{
+		char header[gli::DDS_HEADER_MAX_SIZE];
+		FILE* file = std::fopen(in_file.c_str(), "rb");
+		if (!file)
+			return nullptr;
+
+		const size_t header_size = std::fread(header, 1, sizeof(header), file);
+		std::fclose(file);
+
+		auto texture = std::make_shared<resident>();
+		gli::dds_layout& layout = texture->p_Layout;
+		if (!gli::load_dds_layout(header, header_size, layout))
+			return nullptr;
+
+		const size_t finest = std::min(in_finest, layout.Levels - 1);
 
-					switch (Texture.target())
+		size_t floor = layout.Levels - 1;
+		while (floor > finest && layout.level_size(floor - 1) <= s_resident_level_size)
+			--floor;
+
+		// over the budget the texture starts blurry rather than failing
+		const size_t first = in_streaming || s_memory_usage + storage_size(layout, finest) > s_memory_budget ? floor : finest;
+
+		std::vector<char> data;
+		if (!read_levels(in_file, layout, first, layout.Levels - 1, data))
+		{
+			LOG(ERROR) << fmt::format("texture: can't read {}", in_file);
+			return nullptr;
+		}
+
+		gli::gl GL;
+		texture->p_Texture = in_texture;
+		texture->p_File = in_file;
+		texture->p_Format = GL.translate(layout.Format);
+		texture->p_Target = GL.translate(layout.Target);
+		texture->p_Name = 0;
+		texture->p_Finest = finest;
+		texture->p_Floor = floor;
+		texture->p_Allocated = layout.Levels;
+		texture->p_Resident = layout.Levels;
+		texture->p_Wanted = 0;
+		texture->p_Level = first;
+		texture->p_Used = 0;
+		texture->p_DataLevel = 0;
+		texture->p_State = read_state::IDLE;
+
+		// the swizzles of the format, like gli::texture::swizzles without custom ones
+		texture->p_Swizzles = GL.translate(gli::detail::get_format_info(layout.Format).Swizzles);
+
+		reallocate(*texture, first);
+		upload_levels(*texture, first, layout.Levels - 1, data);
+		texture->p_Resident = first;
+
+		s_resident.push_back(texture);
+		return texture;
+	}
+
+	// the first level of each texture within s_memory_budget, in p_Level. returns
+	// the number of textures requested last frame left below their request.
+	size_t fit_budget(uint32_t in_frame)
+	{
+		size_t usage = s_memory_usage;
+		for (auto& texture : s_resident)
+		{
+			// what is there stays while it fits, the levels that can't be read go
+			texture->p_Level = std::max(std::min(texture->p_Wanted, texture->p_Allocated), texture->p_Finest);
+			usage += storage_size(texture->p_Layout, texture->p_Level);
+			usage -= storage_size(texture->p_Layout, texture->p_Allocated);
+		}
+
+		if (usage > s_memory_budget)
+		{
+			std::vector<resident*> order;
+			order.reserve(s_resident.size());
+			for (auto& texture : s_resident)
+				order.push_back(texture.get());
+
+			// least recently used first
+			std::stable_sort(order.begin(), order.end(),
+				[](const resident* in_a, const resident* in_b) { return in_a->p_Used < in_b->p_Used; });
+
+			auto drop = [&usage](resident& in_texture, size_t in_level)
+			{
+				if (in_level <= in_texture.p_Level)
+					return;
+
+				usage -= storage_size(in_texture.p_Layout, in_texture.p_Level) - storage_size(in_texture.p_Layout, in_level);
+				in_texture.p_Level = in_level;
+			};
+
+			// the levels larger than requested
+			for (auto texture : order)
+				if (usage > s_memory_budget)
+					drop(*texture, texture->p_Wanted);
+
+			// the textures not requested last frame, down to their smallest levels
+			for (auto texture : order)
+				if (usage > s_memory_budget && texture->p_Used != in_frame)
+					drop(*texture, texture->p_Floor);
+
+			// a level of the largest textures in turn
+			while (usage > s_memory_budget)
+			{
+				resident* largest = nullptr;
+				size_t largest_size = 0;
+				for (auto texture : order)
+				{
+					const size_t size = texture->p_Level < texture->p_Floor ? texture->p_Layout.level_size(texture->p_Level) * texture->p_Layout.Layers * texture->p_Layout.Faces : 0;
+					if (size > largest_size)
 					{
-					case gli::TARGET_1D:
-						if (gli::is_compressed(Texture.format()))
-							glCompressedTexSubImage1D(
-								Target, static_cast<gl::int32>(Level), 0, Dimensions.x,
-								Format.Internal, static_cast<gl::sizei>(Texture.size(Level)), Texture.data(Layer, Face, Level));
-						else
-							glTexSubImage1D(
-								Target, static_cast<gl::int32>(Level), 0, Dimensions.x,
-								Format.External, Format.Type, Texture.data(Layer, Face, Level));
-						break;
-					case gli::TARGET_1D_ARRAY:
-					case gli::TARGET_2D:
-					case gli::TARGET_CUBE:
-						if (gli::is_compressed(Texture.format()))
-							glCompressedTexSubImage2D(
-								Target, static_cast<gl::int32>(Level),
-								0, 0, Dimensions.x, Texture.target() == gli::TARGET_1D_ARRAY ? static_cast<gl::sizei>(Layer) : Dimensions.y,
-								Format.Internal, static_cast<gl::sizei>(Texture.size(Level)), Texture.data(Layer, Face, Level));
-						else
-							glTexSubImage2D(
-								Target, static_cast<gl::int32>(Level),
-								0, 0, Dimensions.x, Texture.target() == gli::TARGET_1D_ARRAY ? static_cast<gl::sizei>(Layer) : Dimensions.y,
-								Format.External, Format.Type, Texture.data(Layer, Face, Level));
-						break;
-					case gli::TARGET_2D_ARRAY:
-					case gli::TARGET_3D:
-					case gli::TARGET_CUBE_ARRAY:
-						if (gli::is_compressed(Texture.format()))
-							glCompressedTexSubImage3D(
-								Target, static_cast<gl::int32>(Level),
-								0, 0, 0, Dimensions.x, Dimensions.y, Texture.target() == gli::TARGET_3D ? Dimensions.z : static_cast<gl::sizei>(Layer),
-								Format.Internal, static_cast<gl::sizei>(Texture.size(Level)), Texture.data(Layer, Face, Level));
-						else
-							glTexSubImage3D(
-								Target, static_cast<gl::int32>(Level),
-								0, 0, 0, Dimensions.x, Dimensions.y, Texture.target() == gli::TARGET_3D ? Dimensions.z : static_cast<gl::sizei>(Layer),
-								Format.External, Format.Type, Texture.data(Layer, Face, Level));
-						break;
-					default: assert(0); break;
+						largest = texture;
+						largest_size = size;
 					}
 				}
 
-		return TextureName;
+				if (!largest)
+					break;
+
+				drop(*largest, largest->p_Level + 1);
+			}
+		}
+
+		return static_cast<size_t>(std::count_if(s_resident.begin(), s_resident.end(),
+			[in_frame](const std::shared_ptr<resident>& in_texture) { return in_texture->p_Used == in_frame && in_texture->p_Level > in_texture->p_Wanted; }));
+	}
+
+	inline size_t next_level_size(const resident& in_texture)
+	{
+		return in_texture.p_Layout.level_size(in_texture.p_Resident - 1) * in_texture.p_Layout.Layers * in_texture.p_Layout.Faces;
+	}
+
+	const char* s_compression_names[enum_to_t(graphics::texture::compression::MAX)] =
+	{
+		"",
+		"color",
+		"normal",
+		"scalar"
+	};
+
+	// the block compressed copy of in_file, compressed and written the first time
+	// and again whenever in_file changes. returns in_file if it is already compressed
+	// or if its format can't be, the derived texture can't be written either.
+	std::string compressed_file(const std::string& in_file, graphics::texture::compression in_compression)
+	{
+		const std::string derived_file = fmt::format("{}.{}.dds", in_file, s_compression_names[enum_to_t(in_compression)]);
+
+		const time_t source_time = path::modification_time(in_file);
+		if (source_time != 0 && path::modification_time(derived_file) >= source_time)
+			return derived_file;
+
+		const gli::texture mapped(gli::map_dds(in_file));
+		const gli::texture source(mapped.empty() ? gli::load(in_file) : mapped);
+		if (source.empty() || gli::is_compressed(source.format()) || !gli::is_compressible(source.format()))
+			return in_file;
+
+		const gli::content content = in_compression == graphics::texture::compression::NORMAL ? gli::CONTENT_NORMAL
+			: in_compression == graphics::texture::compression::SCALAR ? gli::CONTENT_SCALAR
+			: gli::CONTENT_COLOR;
+
+		const auto start = std::chrono::steady_clock::now();
+		const gli::texture compressed(gli::compress(source, gli::compressed_format(source, content)));
+		const double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		if (compressed.empty() || !gli::save_dds(compressed, derived_file))
+		{
+			LOG(WARNING) << fmt::format("texture: can't write the compressed copy of {}", in_file);
+			return in_file;
+		}
+
+		LOG(INFO) << fmt::format("texture: {} compressed from {} KB to {} KB in {:.1f} ms",
+			in_file, source.size() / 1024, compressed.size() / 1024, time * 1000.0);
+
+		return derived_file;
 	}
 }
 
-bool graphics::texture::create(const std::string & filename)
+bool graphics::texture::create(const std::string & filename, bool streaming, compression in_compression, int32_t in_skipped_levels, bool in_evictable)
 {
 	m_TextureName = 0;
+	m_Size = 0;
+	m_Footprint = 0.f;
+	m_Requested = 0;
 
 	if (!filename.empty())
-		m_TextureName = build(filename.c_str());
+	{
+		const std::string file = in_compression != compression::NONE ? compressed_file(filename, in_compression) : filename;
+
+		const size_t skipped = in_skipped_levels < 0 ? s_skipped_levels : static_cast<size_t>(in_skipped_levels);
+
+		// a DDS is read level by level and kept within the budget
+		const std::shared_ptr<resident> managed = in_evictable ? load_resident(this, file, streaming, skipped) : nullptr;
+		if (managed)
+		{
+			m_TextureName = managed->p_Name;
+			m_Size = storage_size(managed->p_Layout, managed->p_Allocated);
+		}
+
+		// the other containers and the textures kept whole are loaded at once, only their levels kept are uploaded
+		if (m_TextureName == texture::invalid)
+		{
+			gli::texture mapped(gli::map_dds(file));
+			const gli::texture loaded(mapped.empty() ? gli::load(file) : mapped);
+			m_TextureName = build(loaded, skipped);
+
+			if (m_TextureName != texture::invalid)
+			{
+				for (size_t level = std::min(skipped, loaded.levels() - 1); level < loaded.levels(); ++level)
+					m_Size += loaded.size(level) * loaded.layers() * loaded.faces();
+			}
+			s_memory_usage += m_Size;
+		}
+	}
 
 	return m_TextureName != texture::invalid;
 }
@@ -125,8 +539,23 @@ void graphics::texture::use(uint32_t texture_unit)
 	glBindTextures(texture_unit, 1, &m_TextureName);
 }
 
+void graphics::texture::request(float in_texcoords_per_pixel)
+{
+	if (m_Requested != s_frame || in_texcoords_per_pixel < m_Footprint)
+		m_Footprint = in_texcoords_per_pixel;
+
+	m_Requested = s_frame;
+}
+
 void graphics::texture::destroy()
 {
+	// a read in flight keeps its state alive until it is done
+	s_resident.erase(std::remove_if(s_resident.begin(), s_resident.end(),
+		[this](const std::shared_ptr<resident>& in_texture) { return in_texture->p_Texture == this; }), s_resident.end());
+
+	s_memory_usage -= m_Size;
+	m_Size = 0;
+
 	if (m_TextureName)
 	{
 		assert(glIsTexture(m_TextureName));
@@ -134,3 +563,153 @@ void graphics::texture::destroy()
 		m_TextureName = texture::invalid;
 	}
 }
+
+void graphics::texture::setQuality(uint32_t in_skipped_levels)
+{
+	s_skipped_levels = in_skipped_levels;
+}
+
+void graphics::texture::setMemoryBudget(size_t in_bytes)
+{
+	s_memory_budget = in_bytes;
+}
+
+size_t graphics::texture::getMemoryUsage()
+{
+	return s_memory_usage;
+}
+
+size_t graphics::texture::stream(size_t in_budget)
+{
+	const uint32_t frame = s_frame++;
+
+	if (s_resident.empty())
+		return 0;
+
+	// the level each texture needs, from the requests of the last frame it was drawn.
+	// textures never requested want every level but are the first to go.
+	for (auto& texture : s_resident)
+	{
+		const graphics::texture& owner = *texture->p_Texture;
+		texture->p_Used = owner.m_Requested;
+		texture->p_Wanted = glm::clamp(footprint_level(texture->p_Layout, owner.m_Footprint), texture->p_Finest, texture->p_Floor);
+	}
+
+	const size_t degraded = fit_budget(frame);
+	if (degraded != s_degraded)
+	{
+		if (degraded > 0)
+			LOG(WARNING) << fmt::format("texture: {} textures sampled below their level within a budget of {} KB", degraded, s_memory_budget / 1024);
+		else
+			LOG(INFO) << "texture: every texture is back to its level";
+		s_degraded = degraded;
+	}
+
+	// the storages shrink before the others grow into the memory they free
+	auto resize = [](resident& in_texture)
+	{
+		reallocate(in_texture, in_texture.p_Level);
+		in_texture.p_Texture->m_TextureName = in_texture.p_Name;
+		in_texture.p_Texture->m_Size = storage_size(in_texture.p_Layout, in_texture.p_Allocated);
+	};
+
+	for (auto& texture : s_resident)
+		if (texture->p_Level > texture->p_Allocated)
+			resize(*texture);
+
+	for (auto& texture : s_resident)
+		if (texture->p_Level < texture->p_Allocated)
+			resize(*texture);
+
+	std::vector<std::shared_ptr<resident>> streaming;
+	for (auto& texture : s_resident)
+	{
+		// a level read before the storage shrank past it
+		if (texture->p_State == read_state::READY && texture->p_DataLevel + 1 != texture->p_Resident)
+		{
+			std::vector<char>().swap(texture->p_Data);
+			texture->p_State = read_state::IDLE;
+		}
+
+		if (texture->p_Resident > texture->p_Allocated)
+			streaming.push_back(texture);
+	}
+
+	if (streaming.empty())
+	{
+		if (s_streaming)
+			LOG(INFO) << fmt::format("texture: streaming complete after {:.0f} ms, {} KB uploaded",
+				std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - s_stream_start).count(), s_streamed_size / 1024);
+
+		s_streaming = false;
+		return 0;
+	}
+
+	if (!s_streaming)
+	{
+		s_streaming = true;
+		s_stream_start = std::chrono::steady_clock::now();
+		s_streamed_size = 0;
+	}
+
+	// the smallest levels first, all the textures get sharper at the same pace
+	std::stable_sort(streaming.begin(), streaming.end(),
+		[](const std::shared_ptr<resident>& in_a, const std::shared_ptr<resident>& in_b) { return next_level_size(*in_a) < next_level_size(*in_b); });
+
+	size_t uploaded = 0, reading = 0, remaining = 0;
+	for (auto& texture : streaming)
+	{
+		const size_t size = next_level_size(*texture);
+
+		if (texture->p_State == read_state::READY && (uploaded == 0 || uploaded + size <= in_budget))
+		{
+			const size_t level = texture->p_Resident - 1;
+
+			glBindTexture(texture->p_Target, texture->p_Name);
+			upload_levels(*texture, level, level, texture->p_Data);
+
+			texture->p_Resident = level;
+			std::vector<char>().swap(texture->p_Data);
+			texture->p_State = read_state::IDLE;
+			uploaded += size;
+		}
+		else if (texture->p_State == read_state::FAILED)
+		{
+			// the levels already there stay, the texture is only blurrier
+			LOG(ERROR) << fmt::format("texture: can't read level {} of {}", texture->p_Resident - 1, texture->p_File);
+			texture->p_Finest = texture->p_Resident;
+			texture->p_State = read_state::IDLE;
+			continue;
+		}
+
+		if (texture->p_Resident == texture->p_Allocated)
+			continue;
+
+		++remaining;
+
+		if (texture->p_State == read_state::IDLE)
+		{
+			const size_t next_size = next_level_size(*texture);
+			if (reading > 0 && reading + next_size > in_budget * s_read_ahead)
+				continue;
+
+			texture->p_State = read_state::READING;
+
+			const size_t level = texture->p_Resident - 1;
+			texture->p_DataLevel = level;
+
+			std::shared_ptr<resident> task = texture;
+			parallel::async([task, level]()
+			{
+				task->p_State = read_levels(task->p_File, task->p_Layout, level, level, task->p_Data) ? read_state::READY : read_state::FAILED;
+			});
+
+			reading += next_size;
+		}
+		else
+			reading += size;
+	}
+
+	s_streamed_size += uploaded;
+	return remaining;
+}
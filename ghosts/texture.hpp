@@ -1,6 +1,9 @@
 #pragma once
 
 #include "resource.hpp"
+
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 namespace graphics
@@ -10,12 +13,62 @@ namespace graphics
 
 		handle m_TextureName;
 
+		// bytes of its storage, counted against the memory budget
+		size_t m_Size;
+
+		// finest footprint asked by request in the frame m_Requested, 0 if never requested
+		float m_Footprint;
+		uint32_t m_Requested;
+
 	public:
 
-		bool create(const std::string& filename);
+		// what the texels are used for, an uncompressed texture is block compressed
+		// to the format that keeps them best: BC1 or BC3 for colours, BC5 for normals
+		// and BC4 for single values. NONE keeps the texture as it is.
+		enum class compression : uint32_t
+		{
+			NONE,
+			COLOR,
+			NORMAL,
+			SCALAR,
+			MAX
+		};
+
+		// a streamed texture only loads its smallest levels here, sampling is clamped
+		// to them and stream() brings the larger ones in the frames to come.
+		// the compressed copy of a texture is written next to it as <filename>.<usage>.dds,
+		// it is used instead of compressing again while it is newer than the texture.
+		// the in_skipped_levels largest levels are neither read from a DDS nor allocated,
+		// -1 skips the ones of setQuality. the smallest level always stays.
+		// a texture that isn't in_evictable is loaded whole and kept out of the memory
+		// budget, for textures whose levels aren't interchangeable like the roughness
+		// levels of a prefiltered environment map.
+		bool create(const std::string& filename, bool streaming = false, compression in_compression = compression::NONE, int32_t in_skipped_levels = -1, bool in_evictable = true);
 		void destroy();
 		void use(uint32_t texture_unit);
 
 		inline handle getHandle() const { return m_TextureName; }
+
+		// the texture is sampled this frame with in_texcoords_per_pixel between neighbour
+		// pixels, the residency keeps the level that resolves the finest footprint asked.
+		// 0 wants every level, as for textures looked up by direction.
+		void request(float in_texcoords_per_pixel);
+
+		// the number of largest levels the textures created from now on skip, 0 keeps
+		// them all: detail traded for load time and memory without touching the files.
+		static void setQuality(uint32_t in_skipped_levels);
+
+		// fit the levels of the evictable DDS textures in in_bytes of storage: the levels larger
+		// than their last request are dropped first, then the textures not requested
+		// lately, least recently used first, and then a level of the largest ones in
+		// turn. the smallest levels always stay, textures get blurrier rather than fail.
+		static void setMemoryBudget(size_t in_bytes);
+		static size_t getMemoryUsage();
+
+		// resize the storages for the budget and the requests, then upload the levels
+		// read since the last call, the smallest first, up to in_budget bytes: one
+		// level is always uploaded to make progress. returns the number of textures
+		// still streaming.
+		static size_t stream(size_t in_budget);
 	};
 }
@@ -0,0 +1,145 @@
+#include "watcher.hpp"
+#include "logging.hpp"
+#include "format.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace
+{
+	// how often the modification times are compared without inotify
+	const std::chrono::milliseconds s_scan_period(250);
+
+	// the directory of in_file as inotify takes it, and the prefix of the names it reports
+	inline std::string directory(const std::string& in_file)
+	{
+		const std::string prefix = path::left(in_file, '/');
+		return prefix == in_file ? std::string() : prefix;
+	}
+}
+
+namespace framework
+{
+	file_watcher::file_watcher()
+		: m_Inotify(-1)
+	{
+#if defined(__linux__)
+		m_Inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (m_Inotify < 0)
+			LOG(WARNING) << fmt::format("watcher: inotify not available ({}), polling the modification times", errno);
+#endif
+	}
+
+	file_watcher::~file_watcher()
+	{
+		clear();
+
+#if defined(__linux__)
+		if (m_Inotify >= 0)
+			close(m_Inotify);
+#endif
+	}
+
+	bool file_watcher::watch(const std::string& in_file)
+	{
+		if (m_Files.count(in_file))
+			return true;
+
+		const time_t time = path::modification_time(in_file);
+		if (time == 0)
+			return false;
+
+#if defined(__linux__)
+		if (m_Inotify >= 0)
+		{
+			const std::string prefix = directory(in_file);
+			const bool watched = std::any_of(m_Directories.begin(), m_Directories.end(),
+				[&prefix](const std::pair<const int, std::string>& in_directory) { return in_directory.second == prefix; });
+
+			if (!watched)
+			{
+				// a file replaced by a rename is a new file, its directory is watched instead
+				const int descriptor = inotify_add_watch(m_Inotify, prefix.empty() ? "." : prefix.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+				if (descriptor < 0)
+				{
+					LOG(WARNING) << fmt::format("watcher: can't watch {} ({})", prefix, errno);
+					return false;
+				}
+
+				m_Directories[descriptor] = prefix;
+			}
+		}
+#endif
+
+		m_Files[in_file] = time;
+		return true;
+	}
+
+	void file_watcher::clear()
+	{
+#if defined(__linux__)
+		for (const auto& directory : m_Directories)
+			inotify_rm_watch(m_Inotify, directory.first);
+#endif
+
+		m_Directories.clear();
+		m_Files.clear();
+	}
+
+	std::vector<std::string> file_watcher::poll()
+	{
+		std::vector<std::string> changed;
+
+#if defined(__linux__)
+		if (m_Inotify >= 0)
+		{
+			alignas(inotify_event) char buffer[4096];
+			for (;;)
+			{
+				const ssize_t size = read(m_Inotify, buffer, sizeof(buffer));
+				if (size <= 0)
+					break;
+
+				for (ssize_t offset = 0; offset < size; )
+				{
+					const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+					offset += sizeof(inotify_event) + event->len;
+
+					const auto directory = m_Directories.find(event->wd);
+					if (directory == m_Directories.end() || event->len == 0)
+						continue;
+
+					const std::string file = directory->second + event->name;
+					if (m_Files.count(file) && std::find(changed.begin(), changed.end(), file) == changed.end())
+						changed.push_back(file);
+				}
+			}
+
+			return changed;
+		}
+#endif
+
+		const auto now = std::chrono::steady_clock::now();
+		if (now - m_LastScan < s_scan_period)
+			return changed;
+
+		m_LastScan = now;
+		for (auto& file : m_Files)
+		{
+			const time_t time = path::modification_time(file.first);
+			if (time != 0 && time != file.second)
+			{
+				file.second = time;
+				changed.push_back(file.first);
+			}
+		}
+
+		return changed;
+	}
+}
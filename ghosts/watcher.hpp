@@ -0,0 +1,39 @@
+#pragma once
+
+#include <chrono>
+#include <ctime>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace framework
+{
+	// files changed since they were last polled. on Linux inotify watches their
+	// directories, so editors saving through a temporary file and a rename are
+	// seen too. elsewhere the modification times are compared a few times a second.
+	class file_watcher
+	{
+		int m_Inotify;
+
+		// inotify watch of each directory, and the files watched in it
+		std::map<int, std::string> m_Directories;
+		std::map<std::string, time_t> m_Files;
+
+		std::chrono::steady_clock::time_point m_LastScan;
+
+	public:
+
+		file_watcher();
+		~file_watcher();
+
+		file_watcher(const file_watcher&) = delete;
+		file_watcher& operator=(const file_watcher&) = delete;
+
+		// in_file as the compiler names it, false if it can't be watched
+		bool watch(const std::string& in_file);
+		void clear();
+
+		// the watched files changed since the last call, each once
+		std::vector<std::string> poll();
+	};
+}